@@ -0,0 +1,41 @@
+#include <gamelib_archive.hpp>
+
+#if __cplusplus >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace filesystem = std::filesystem;
+#elif __has_include(<experimental/filesystem>)
+#include <experimental/filesystem>
+namespace filesystem = std::experimental::filesystem;
+#endif
+
+// assetpack writes every file under a directory into one archive
+// names are relative to the directory and use '/' so they match the names games load
+int main(int argc, char** argv) {
+	if (argc != 3) {
+		std::cerr << "usage: " << argv[0] << " archive.pak directory\n";
+		return 1;
+	}
+	std::string output = argv[1];
+	filesystem::path root = argv[2];
+	if (!filesystem::is_directory(root)) {
+		std::cerr << "'" << root.string() << "' is not a directory\n";
+		return 1;
+	}
+
+	std::vector<std::string> names;
+	for (auto& entry : filesystem::recursive_directory_iterator(root)) {
+		if (!filesystem::is_regular_file(entry.path()))
+			continue;
+		names.push_back(entry.path().lexically_relative(root).generic_string());
+	}
+	// sorted so the same directory always packs the same archive
+	std::sort(names.begin(), names.end());
+
+	std::string prefix = root.generic_string();
+	if (!prefix.empty() && prefix.back() != '/')
+		prefix += '/';
+	if (!GameLib::Archive::pack(output, names, prefix))
+		return 1;
+	std::cout << "packed " << names.size() << " files into " << output << "\n";
+	return 0;
+}
@@ -2,14 +2,26 @@
 #define GAMELIB_HPP
 
 #include <gamelib_base.hpp>
+#include <gamelib_archive.hpp>
 #include <gamelib_context.hpp>
 #include <gamelib_object.hpp>
 #include <gamelib_actor.hpp>
+#include <gamelib_collision.hpp>
 #include <gamelib_world.hpp>
+#include <gamelib_world_streamer.hpp>
 #include <gamelib_locator.hpp>
 #include <gamelib_command.hpp>
 #include <gamelib_random.hpp>
+#include <gamelib_replay.hpp>
+#include <gamelib_snapshot.hpp>
+#include <gamelib_rewind.hpp>
+#include <gamelib_net.hpp>
+#include <gamelib_rollback.hpp>
 #include <gamelib_font.hpp>
+#include <gamelib_asset_loader.hpp>
+#include <gamelib_frame_pacer.hpp>
+#include <gamelib_hot_reload.hpp>
+#include <gamelib_software_audio.hpp>
 
 namespace GameLib {
 }
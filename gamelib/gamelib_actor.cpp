@@ -16,6 +16,93 @@ namespace GameLib {
 
 	Actor::~Actor() { HFLOGDEBUG("Deleting (%d) '%s'", id_, name().c_str()); }
 
+	std::ostream& Actor::writeCharStream(std::ostream& s) const {
+		// floats are written with enough digits to read back the same value
+		auto flags = s.flags();
+		auto precision = s.precision(9);
+		s << "actor " << (int)charDesc_ << " " << id_;
+		for (auto* v : { &position, &velocity, &size })
+			s << " " << v->x << " " << v->y << " " << v->z;
+		s << " " << sprite.libId << " " << sprite.id << " " << sprite.flipX << " " << sprite.flipY;
+		s << " " << (bool)visible << " " << (bool)active << " " << t0 << " " << t1;
+		s.precision(precision);
+		s.flags(flags);
+		return s;
+	}
+
+	std::istream& Actor::readCharStream(std::istream& s) {
+		std::string cmd;
+		s >> cmd;
+		if (cmd != "actor")
+			return s;
+		int c = 0;
+		bool b[4]{};
+		s >> c >> id_;
+		for (auto* v : { &position, &velocity, &size })
+			s >> v->x >> v->y >> v->z;
+		s >> sprite.libId >> sprite.id >> b[0] >> b[1];
+		s >> b[2] >> b[3] >> t0 >> t1;
+		charDesc_ = (char)c;
+		sprite.flipX = b[0];
+		sprite.flipY = b[1];
+		visible = b[2];
+		active = b[3];
+		lastPosition = position;
+		sweepStart = position;
+		return s;
+	}
+
+	void Actor::saveState(ACTORSTATE& state) const {
+		state.id = id_;
+		state.type = (uint8_t)type_;
+		state.charDesc = charDesc_;
+		state.visible = visible ? 1 : 0;
+		state.active = active ? 1 : 0;
+		state.jumped = jumped ? 1 : 0;
+		state.flipX = sprite.flipX ? 1 : 0;
+		state.flipY = sprite.flipY ? 1 : 0;
+		state.position = position;
+		state.lastPosition = lastPosition;
+		state.sweepStart = sweepStart;
+		state.velocity = velocity;
+		state.size = size;
+		state.spriteLibId = sprite.libId;
+		state.spriteId = sprite.id;
+		state.dt = dt;
+		state.t0 = t0;
+		state.t1 = t1;
+		auto box2d = Locator::getBox2D();
+		state.hasBody = box2d && box2dId >= 0 ? 1 : 0;
+		state.body = state.hasBody ? box2d->bodyState(box2dId, box2dType) : BODYSTATE();
+	}
+
+	void Actor::loadState(const ACTORSTATE& state) {
+		id_ = state.id;
+		// actors made after the restore must not take a restored id
+		idSource_ = std::max(idSource_, id_ + 1);
+		charDesc_ = state.charDesc;
+		visible = state.visible;
+		active = state.active;
+		jumped = state.jumped;
+		sprite.flipX = state.flipX != 0;
+		sprite.flipY = state.flipY != 0;
+		position = state.position;
+		lastPosition = state.lastPosition;
+		sweepStart = state.sweepStart;
+		dPosition = position - lastPosition;
+		velocity = state.velocity;
+		size = state.size;
+		sprite.libId = state.spriteLibId;
+		sprite.id = state.spriteId;
+		dt = state.dt;
+		t0 = state.t0;
+		t1 = state.t1;
+		auto box2d = Locator::getBox2D();
+		if (state.hasBody && box2d && box2dId >= 0) {
+			box2d->setState(box2dId, box2dType, state.body);
+		}
+	}
+
 	void Actor::beginPlay(float t) {
 		t0 = t;
 		t1 = t;
@@ -23,6 +110,7 @@ namespace GameLib {
 			actor_->beginPlay(*this);
 		if (physics_)
 			physics_->beginPlay(*this);
+		sweepStart = position;
 	}
 
 	void Actor::update(float deltaTime, World& world) {
@@ -41,6 +129,8 @@ namespace GameLib {
 	}
 
 	void Actor::postupdate() {
+		// Box2D moved the actor after its collisions were checked, so the next step sweeps from here
+		sweepStart = position;
 		if (physics_)
 			physics_->postupdate(*this);
 	}
@@ -50,7 +140,8 @@ namespace GameLib {
 			return;
 		lastPosition = position;
 		physics_->update(*this, world);
-		if (actor_) {
+		// with contact events, collisions arrive through beginContact() and endContact() instead
+		if (actor_ && !world.useContactEvents) {
 			if (physics_->collideWorld(*this, world))
 				actor_->handleCollisionWorld(*this, world);
 
@@ -67,36 +158,135 @@ namespace GameLib {
 				if (physics_->collideDynamic(*this, *b))
 					actor_->handleCollisionDynamic(*this, *b);
 			}
+		}
+		// Box2D makes no contacts between two static bodies, so static actors find their triggers here either way
+		if (actor_ && (!world.useContactEvents || isStatic())) {
+			// only triggers whose boxes overlap this one are handed to collideTrigger()
+			triggerInfo.current.clear();
+			world.forEachTrigger(position2d(), position2d() + size2d(), [&](Actor& trigger) {
+				if (this->getId() != trigger.getId() && physics_->collideTrigger(*this, trigger))
+					triggerInfo.current.push_back({ trigger.getId(), world.getActor(trigger.getId()) });
+			});
+			// a trigger may move itself when an overlap begins or ends
+			if (_updateOverlaps())
+				world.triggersMoved();
+		}
+		dPosition = position - lastPosition;
+	}
 
-			if (triggerInfo.overlapping && triggerInfo.triggerActor.use_count()) {
-				auto trigger = triggerInfo.triggerActor.lock();
-				if (!physics_->collideTrigger(*this, *trigger)) {
-					triggerInfo.overlapping = false;
-					triggerInfo.triggerActor.reset();
-					actor_->endOverlap(*this, *trigger);
-
-					if (trigger->actor_) {
-						trigger->triggerInfo.overlapping = false;
-						trigger->actor_->endTriggerOverlap(*trigger, *this);
-					}
-				}
+	bool Actor::_updateOverlaps() {
+		auto& current = triggerInfo.current;
+		auto& overlaps = triggerInfo.overlaps;
+		if (!std::is_sorted(current.begin(), current.end()))
+			std::sort(current.begin(), current.end());
+
+		// both lists are sorted, so walk them together and only act on pairs that changed
+		bool changed = false;
+		size_t i = 0;
+		size_t j = 0;
+		while (i < current.size() || j < overlaps.size()) {
+			if (j == overlaps.size() || (i < current.size() && current[i].id < overlaps[j].id)) {
+				auto trigger = current[i++].actor.lock();
+				if (trigger)
+					_beginOverlap(*trigger);
+				changed = true;
+			} else if (i == current.size() || overlaps[j].id < current[i].id) {
+				auto trigger = overlaps[j++].actor.lock();
+				if (trigger)
+					_endOverlap(*trigger);
+				changed = true;
 			} else {
-				for (auto trigger : world.triggerActors) {
-					if (this->getId() == trigger->getId())
+				i++;
+				j++;
+			}
+		}
+
+		// current becomes the cached set, the old cache is reused as scratch space next step
+		std::swap(current, overlaps);
+		triggerInfo.overlapping = !overlaps.empty();
+		return changed;
+	}
+
+	void Actor::endOverlaps(World& world) {
+		if (isTrigger()) {
+			// find the actors overlapping this trigger first, the events may change the lists
+			std::vector<ActorPtr> overlapping;
+			OVERLAPINFO info{ id_ };
+			for (auto* actors : { &world.dynamicActors, &world.staticActors }) {
+				for (auto& a : *actors) {
+					auto& overlaps = a->triggerInfo.overlaps;
+					auto it = std::lower_bound(overlaps.begin(), overlaps.end(), info);
+					if (it == overlaps.end() || it->id != id_)
 						continue;
-					if (!triggerInfo.overlapping && physics_->collideTrigger(*this, *trigger)) {
-						triggerInfo.overlapping = true;
-						actor_->beginOverlap(*this, *trigger);
-						if (trigger->actor_) {
-							trigger->triggerInfo.overlapping = true;
-							trigger->actor_->beginTriggerOverlap(*trigger, *this);
-							triggerInfo.triggerActor = trigger;
-						}
-					}
+					overlaps.erase(it);
+					a->triggerInfo.overlapping = !overlaps.empty();
+					overlapping.push_back(a);
 				}
 			}
+			for (auto& a : overlapping)
+				a->_endOverlap(*this);
+			return;
 		}
-		dPosition = position - lastPosition;
+		std::vector<OVERLAPINFO> overlaps;
+		std::swap(overlaps, triggerInfo.overlaps);
+		triggerInfo.overlapping = false;
+		for (auto& o : overlaps) {
+			if (auto trigger = o.actor.lock())
+				_endOverlap(*trigger);
+		}
+	}
+
+	void Actor::_beginOverlap(Actor& trigger) {
+		if (actor_)
+			actor_->beginOverlap(*this, trigger);
+		trigger.triggerInfo.overlapCount++;
+		trigger.triggerInfo.overlapping = true;
+		if (trigger.actor_)
+			trigger.actor_->beginTriggerOverlap(trigger, *this);
+	}
+
+	void Actor::_endOverlap(Actor& trigger) {
+		if (actor_)
+			actor_->endOverlap(*this, trigger);
+		trigger.triggerInfo.overlapCount = std::max(0, trigger.triggerInfo.overlapCount - 1);
+		trigger.triggerInfo.overlapping = trigger.triggerInfo.overlapCount > 0;
+		if (trigger.actor_)
+			trigger.actor_->endTriggerOverlap(trigger, *this);
+	}
+
+	void Actor::beginContact(Actor* other, World& world) {
+		// triggers only hear about contacts through the actor overlapping them
+		if (!actor_ || isTrigger())
+			return;
+		if (!other) {
+			actor_->handleCollisionWorld(*this, world);
+		} else if (other->isTrigger()) {
+			auto& overlaps = triggerInfo.overlaps;
+			OVERLAPINFO info{ other->getId(), world.getActor(other->getId()) };
+			auto it = std::lower_bound(overlaps.begin(), overlaps.end(), info);
+			if (it != overlaps.end() && it->id == info.id)
+				return;
+			overlaps.insert(it, info);
+			triggerInfo.overlapping = true;
+			_beginOverlap(*other);
+		} else if (other->isStatic()) {
+			actor_->handleCollisionStatic(*this, *other);
+		} else if (other->isDynamic()) {
+			actor_->handleCollisionDynamic(*this, *other);
+		}
+	}
+
+	void Actor::endContact(Actor* other, World& world) {
+		if (!actor_ || isTrigger() || !other || !other->isTrigger())
+			return;
+		auto& overlaps = triggerInfo.overlaps;
+		OVERLAPINFO info{ other->getId() };
+		auto it = std::lower_bound(overlaps.begin(), overlaps.end(), info);
+		if (it == overlaps.end() || it->id != info.id)
+			return;
+		overlaps.erase(it);
+		triggerInfo.overlapping = !overlaps.empty();
+		_endOverlap(*other);
 	}
 
 	void Actor::draw(Graphics& graphics) {
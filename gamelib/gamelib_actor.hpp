@@ -3,6 +3,7 @@
 
 #include <gamelib_base.hpp>
 #include <gamelib_actor_component.hpp>
+#include <gamelib_collision.hpp>
 #include <gamelib_graphics_component.hpp>
 #include <gamelib_input_component.hpp>
 #include <gamelib_object.hpp>
@@ -10,6 +11,32 @@
 #include <gamelib_world.hpp>
 
 namespace GameLib {
+	// ACTORSTATE is what changes about an actor during play, as plain data for snapshots
+	struct ACTORSTATE {
+		uint32_t id{ 0 };
+		// Actor::DYNAMIC, STATIC or TRIGGER
+		uint8_t type{ 0 };
+		char charDesc{ '?' };
+		uint8_t visible{ 1 };
+		uint8_t active{ 1 };
+		uint8_t jumped{ 0 };
+		uint8_t flipX{ 0 };
+		uint8_t flipY{ 0 };
+		// body is set when the actor has a Box2D body
+		uint8_t hasBody{ 0 };
+		glm::vec3 position{ 0.0f, 0.0f, 0.0f };
+		glm::vec3 lastPosition{ 0.0f, 0.0f, 0.0f };
+		glm::vec3 sweepStart{ 0.0f, 0.0f, 0.0f };
+		glm::vec3 velocity{ 0.0f, 0.0f, 0.0f };
+		glm::vec3 size{ 0.0f, 0.0f, 0.0f };
+		uint32_t spriteLibId{ 0 };
+		uint32_t spriteId{ 0 };
+		float dt{ 0.0f };
+		float t0{ 0.0f };
+		float t1{ 0.0f };
+		BODYSTATE body;
+	};
+
 	class InputComponent;
 	class PhysicsComponent;
 	class GraphicsComponent;
@@ -40,6 +67,19 @@ namespace GameLib {
 
 		// returns a character description of the actor which is for saving/loading
 		virtual char charDesc() const { return charDesc_; }
+		void setCharDesc(char c) { charDesc_ = c; }
+
+		// writes the id, placement, motion, sprite and flags of the actor, components are not written
+		std::ostream& writeCharStream(std::ostream& s) const override;
+
+		// reads what writeCharStream() wrote, including the id so references to the actor stay valid
+		std::istream& readCharStream(std::istream& s) override;
+
+		// fills state from the actor and its Box2D body, components are not saved
+		void saveState(ACTORSTATE& state) const;
+
+		// sets what saveState() saved, including the id, and moves the Box2D body if the actor has one
+		void loadState(const ACTORSTATE& state);
 
 		InputComponent* inputComponent() { return input_.get(); }
 		ActorComponent* actorComponent() { return actor_.get(); }
@@ -62,6 +102,12 @@ namespace GameLib {
 		// Called each frame for the object to handle collisions and physics
 		void physics(float deltaTime, World& world);
 
+		// Called when a Box2D contact with other starts, other is nullptr for world tiles
+		void beginContact(Actor* other, World& world);
+
+		// Called when a Box2D contact with other ends, other is nullptr for world tiles
+		void endContact(Actor* other, World& world);
+
 		// Called each frame to draw itself (not called for invisible objects)
 		void draw(Graphics& graphics);
 
@@ -95,10 +141,17 @@ namespace GameLib {
 			velocity.y = v.y;
 		}
 
-		// returns signed distance from p to center (in world units)
+		// contact queries are closed form box tests, define GAMELIB_SDF_CONTACTS to use
+		// the original ray marched signed distance field as a reference instead
+
+		// returns signed distance from p to the actor's box (in world units)
 		float sdf(glm::vec2 p, float radius = 0.0f) const {
-			glm::vec2 q = glm::abs(p - center2d()) - size2d();
+#ifdef GAMELIB_SDF_CONTACTS
+			glm::vec2 q = glm::abs(p - center2d()) - size2d() * 0.5f;
 			return glm::length(glm::max(q, 0.0f)) + glm::min(glm::max(q.x, q.y), 0.0f) - radius;
+#else
+			return distanceAABB(p, position2d(), position2d() + size2d()) - radius;
+#endif
 			// glm::vec2 c = center2d();
 			// glm::vec2 half = size2d() * 0.5f;
 			// glm::vec2 halfs{ std::max(p.x - c.x - half.x, c.x - p.x - half.x),
@@ -129,25 +182,44 @@ namespace GameLib {
 		// if p does not intersect, p is returned
 		glm::vec2 support(glm::vec2 p) const {
 			glm::vec2 c = center2d();
+#ifdef GAMELIB_SDF_CONTACTS
 			glm::vec2 dir = c - p;
 			float tmax = glm::length(dir) + glm::length(size2d());
 			return raymarch(p, glm::normalize(dir), 0, tmax);
+#else
+			return supportAABB(p, c, position2d(), position2d() + size2d());
+#endif
 		}
 
 
 		// calculate gradient to produce normal vector on surface
 		glm::vec2 normal(glm::vec2 p) const {
+#ifdef GAMELIB_SDF_CONTACTS
 			glm::vec2 N = { sdf({ p.x + EPSILON, p.y }) - sdf({ p.x - EPSILON, p.y }),
 							sdf({ p.x, p.y + EPSILON }) - sdf({ p.x, p.y - EPSILON }) };
 			return glm::normalize(N);
+#else
+			return normalAABB(p, position2d(), position2d() + size2d());
+#endif
 		}
 
 
 		// calculate gradient to produce tangent vector on surface
 		glm::vec2 tangent(glm::vec2 p) const {
+#ifdef GAMELIB_SDF_CONTACTS
 			glm::vec2 T = { sdf({ p.x, p.y + EPSILON }) - sdf({ p.x, p.y - EPSILON }),
 							sdf({ p.x + EPSILON, p.y }) - sdf({ p.x - EPSILON, p.y }) };
 			return glm::normalize(T);
+#else
+			glm::vec2 N = normalAABB(p, position2d(), position2d() + size2d());
+			return { N.y, N.x };
+#endif
+		}
+
+
+		// returns true if this overlaps other and fills in the contact between the boxes
+		bool contact(const Actor& other, CONTACTINFO& info) const {
+			return contactAABB(position2d(), position2d() + size2d(), other.position2d(), other.position2d() + other.size2d(), info);
 		}
 
 
@@ -380,6 +452,11 @@ namespace GameLib {
 		glm::vec3 position{ 0.0f, 0.0f, 0.0f };
 		glm::vec3 lastPosition{ 0.0f, 0.0f, 0.0f };
 		glm::vec3 dPosition{ 0.0f, 0.0f, 0.0f };
+		// where the next world sweep starts, the position before Box2D moved the actor in the last step
+		glm::vec3 sweepStart{ 0.0f, 0.0f, 0.0f };
+
+		// moves the actor without sweeping through the world on the way, for spawning and teleporting
+		void teleport(glm::vec3 p) { position = lastPosition = sweepStart = p; }
 
 		// size (in world units, assume 1 = grid size)
 		glm::vec3 size{ 1.0f, 1.0f, 1.0f };
@@ -403,17 +480,37 @@ namespace GameLib {
 			glm::vec3 a{ 0.0f, 0.0f, 0.0f };
 		} physicsInfo;
 
+		// first solid tile touched while moving from sweepStart to position, set by collideWorld()
+		TILEHIT worldHit;
+
 		////////////////////////////////////////////////////
 		// DYNAMIC, STATIC, TRIGGER INFORMATION ////////////
 		////////////////////////////////////////////////////
 
+		struct OVERLAPINFO {
+			unsigned id{ 0 };
+			ActorWPtr actor;
+
+			bool operator<(const OVERLAPINFO& other) const { return id < other.id; }
+		};
+
 		struct TRIGGERINFO {
+			// true if this actor overlaps a trigger, or this trigger is overlapped by an actor
 			bool overlapping{ false };
-			ActorWPtr triggerActor;
+			// number of actors overlapping this trigger
+			int overlapCount{ 0 };
+			// triggers overlapped at the end of the last physics step, sorted by id
+			std::vector<OVERLAPINFO> overlaps;
+			// triggers overlapped during this physics step, sorted by id
+			std::vector<OVERLAPINFO> current;
 		} triggerInfo;
 
 		enum { NONE = 0, DYNAMIC = 1, STATIC = 2, TRIGGER = 4 };
 
+		// sends end overlap events for every overlap this actor is part of and forgets them
+		// used when the actor leaves the world
+		void endOverlaps(World& world);
+
 		bool isDynamic() const { return type_ == DYNAMIC; }
 		bool isStatic() const { return type_ == STATIC; }
 		bool isTrigger() const { return type_ == TRIGGER; }
@@ -423,6 +520,16 @@ namespace GameLib {
 		void makeTrigger();
 
 	protected:
+		// diffs triggerInfo.current against triggerInfo.overlaps and sends begin/end overlap events
+		// returns true if any overlap began or ended
+		bool _updateOverlaps();
+
+		// sends begin overlap events to this actor and trigger
+		void _beginOverlap(Actor& trigger);
+
+		// sends end overlap events to this actor and trigger
+		void _endOverlap(Actor& trigger);
+
 		std::string _updateDesc() override { return { "Actor" }; }
 		std::string _updateInfo() override { return { "Actor" }; }
 		char charDesc_ = '?';
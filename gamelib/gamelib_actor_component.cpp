@@ -10,6 +10,13 @@ namespace GameLib {
 	}
 
 	void DainNickJosephWorldCollidingActorComponent::handleCollisionWorld(Actor& actor, World& world) {
+		// stop at the wall that was hit, even if this step carried the actor past it
+		glm::vec3 d = actor.position - actor.sweepStart;
+		if (actor.worldHit.normal.x != 0.0f)
+			actor.position.x = actor.sweepStart.x + d.x * actor.worldHit.t;
+		if (actor.worldHit.normal.y != 0.0f)
+			actor.position.y = actor.sweepStart.y + d.y * actor.worldHit.t;
+
 		float subTileSize = 1.0;
 		float y = 0;
 		int horizontalScore = 0;
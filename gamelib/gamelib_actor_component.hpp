@@ -6,6 +6,9 @@
 #include <gamelib_world.hpp>
 
 namespace GameLib {
+	class SnapshotWriter;
+	class SnapshotReader;
+
 	class ActorComponent {
 	public:
 		virtual ~ActorComponent() {}
@@ -28,6 +31,9 @@ namespace GameLib {
 		// endTriggerOverlap() is called when the trigger is not overlapped by an actor
 		virtual void endTriggerOverlap(Actor& a, Actor& b) {}
 		virtual int getHealth(Actor& actor){return 0;}
+		// writeState() writes game state a snapshot must keep, readState() reads it back in the same order
+		virtual void writeState(const Actor& actor, SnapshotWriter& w) const {}
+		virtual void readState(Actor& actor, SnapshotReader& r) {}
 	};
 
 	class RandomActorComponent : public ActorComponent {
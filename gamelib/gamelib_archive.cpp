@@ -0,0 +1,216 @@
+#include "pch.h"
+#include <gamelib_archive.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace GameLib {
+	// file data is aligned so formats that read words from memory do not straddle
+	constexpr uint64_t ArchiveAlignment = 16;
+
+	uint64_t hashArchiveName(const std::string& name) {
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : name) {
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+
+	bool MappedFile::open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		HANDLE mapping = nullptr;
+		const void* data = nullptr;
+		if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+			data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data) {
+			if (mapping)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		file_ = file;
+		mapping_ = mapping;
+		data_ = (const uint8_t*)data;
+		size_ = (size_t)fileSize.QuadPart;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		void* data = MAP_FAILED;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+			data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// the mapping keeps the file alive
+		::close(fd);
+		if (data == MAP_FAILED)
+			return false;
+		data_ = (const uint8_t*)data;
+		size_ = (size_t)st.st_size;
+#endif
+		return true;
+	}
+
+
+	void MappedFile::close() {
+		if (!data_)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+		CloseHandle(mapping_);
+		CloseHandle(file_);
+		file_ = nullptr;
+		mapping_ = nullptr;
+#else
+		munmap((void*)data_, size_);
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+
+	bool Archive::open(const std::string& path) {
+		close();
+		if (!file_.open(path))
+			return false;
+		data_ = file_.data();
+		size_ = file_.size();
+
+		ARCHIVEHEADER expected;
+		ARCHIVEHEADER header;
+		bool valid = size_ >= sizeof(header);
+		if (valid) {
+			memcpy(&header, data_, sizeof(header));
+			valid = !memcmp(header.magic, expected.magic, 4) && header.version == expected.version &&
+					header.indexOffset % alignof(ARCHIVEENTRY) == 0 && header.indexOffset <= size_ &&
+					header.count <= (size_ - header.indexOffset) / sizeof(ARCHIVEENTRY);
+		}
+		if (!valid) {
+			HFLOGERROR("'%s' is not an asset archive", path.c_str());
+			close();
+			return false;
+		}
+		entries_ = (const ARCHIVEENTRY*)(data_ + header.indexOffset);
+		count_ = header.count;
+		for (size_t i = 0; i < count_; i++) {
+			const ARCHIVEENTRY& e = entries_[i];
+			if (e.offset > size_ || e.size > size_ - e.offset || e.nameOffset > size_ || e.nameSize > size_ - e.nameOffset) {
+				HFLOGERROR("'%s' has a damaged index", path.c_str());
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	void Archive::close() {
+		file_.close();
+		data_ = nullptr;
+		size_ = 0;
+		entries_ = nullptr;
+		count_ = 0;
+	}
+
+
+	const void* Archive::find(const std::string& name, size_t& size) const {
+		if (!data_)
+			return nullptr;
+		uint64_t hash = hashArchiveName(name);
+		auto first = std::lower_bound(
+			entries_, entries_ + count_, hash, [](const ARCHIVEENTRY& e, uint64_t h) { return e.hash < h; });
+		// names are compared in case two hash the same
+		for (auto e = first; e != entries_ + count_ && e->hash == hash; e++) {
+			if (e->nameSize == name.size() && !memcmp(data_ + e->nameOffset, name.data(), name.size())) {
+				size = (size_t)e->size;
+				return data_ + e->offset;
+			}
+		}
+		return nullptr;
+	}
+
+
+	SDL_RWops* Archive::openRW(const std::string& name) const {
+		size_t size;
+		const void* data = find(name, size);
+		if (!data)
+			return nullptr;
+		return SDL_RWFromConstMem(data, (int)size);
+	}
+
+
+	bool Archive::pack(const std::string& path, const std::vector<std::string>& names, const std::string& root) {
+		std::ofstream fout(path, std::ios::binary);
+		if (!fout) {
+			HFLOGERROR("cannot write '%s'", path.c_str());
+			return false;
+		}
+
+		ARCHIVEHEADER header;
+		fout.write((const char*)&header, sizeof(header));
+		uint64_t offset = sizeof(header);
+		auto align = [&fout, &offset](uint64_t alignment) {
+			static const char zeros[ArchiveAlignment]{};
+			uint64_t padding = (alignment - offset % alignment) % alignment;
+			fout.write(zeros, padding);
+			offset += padding;
+		};
+
+		std::vector<ARCHIVEENTRY> entries;
+		std::vector<char> buffer;
+		for (auto& name : names) {
+			std::ifstream fin(root + name, std::ios::binary);
+			if (!fin) {
+				HFLOGERROR("cannot read '%s'", (root + name).c_str());
+				return false;
+			}
+			buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+			align(ArchiveAlignment);
+			ARCHIVEENTRY e;
+			e.hash = hashArchiveName(name);
+			e.offset = offset;
+			e.size = buffer.size();
+			fout.write(buffer.data(), buffer.size());
+			offset += buffer.size();
+			entries.push_back(e);
+		}
+
+		align(ArchiveAlignment);
+		header.indexOffset = offset;
+		header.count = (uint32_t)entries.size();
+		uint64_t nameOffset = offset + entries.size() * sizeof(ARCHIVEENTRY);
+		for (size_t i = 0; i < entries.size(); i++) {
+			entries[i].nameOffset = nameOffset;
+			entries[i].nameSize = (uint32_t)names[i].size();
+			nameOffset += names[i].size();
+		}
+		// names keep the order files were written, so sort the index last
+		std::vector<size_t> order(entries.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) { return entries[a].hash < entries[b].hash; });
+		for (size_t i : order)
+			fout.write((const char*)&entries[i], sizeof(ARCHIVEENTRY));
+		for (auto& name : names)
+			fout.write(name.data(), name.size());
+
+		fout.seekp(0);
+		fout.write((const char*)&header, sizeof(header));
+		return (bool)fout;
+	}
+} // namespace GameLib
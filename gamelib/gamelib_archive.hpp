@@ -0,0 +1,110 @@
+#ifndef GAMELIB_ARCHIVE_HPP
+#define GAMELIB_ARCHIVE_HPP
+
+#include <gamelib_base.hpp>
+#include <cstring>
+
+namespace GameLib {
+	// ARCHIVEHEADER starts a packed asset archive
+	struct ARCHIVEHEADER {
+		char magic[4]{ 'G', 'L', 'P', 'K' };
+		// version 2 widened ARCHIVEENTRY::nameOffset to 64 bits
+		uint32_t version{ 2 };
+		// number of ARCHIVEENTRY structs in the index
+		uint32_t count{ 0 };
+		uint32_t reserved{ 0 };
+		// offset of the index from the start of the archive
+		uint64_t indexOffset{ 0 };
+	};
+
+	// ARCHIVEENTRY is a file in the index, entries are sorted by hash
+	struct ARCHIVEENTRY {
+		// hashArchiveName() of the name
+		uint64_t hash{ 0 };
+		// offset and size of the file data from the start of the archive
+		uint64_t offset{ 0 };
+		uint64_t size{ 0 };
+		// offset and size of the name from the start of the archive, names are not null terminated
+		uint64_t nameOffset{ 0 };
+		uint32_t nameSize{ 0 };
+		uint32_t reserved{ 0 };
+	};
+
+	// MappedFile is a read only file mapped into memory
+	class MappedFile {
+	public:
+		MappedFile() {}
+		~MappedFile() { close(); }
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// returns false if the file is missing or empty
+		bool open(const std::string& path);
+
+		// unmaps the file, pointers into data() are no longer valid
+		void close();
+
+		bool isOpen() const { return data_ != nullptr; }
+		const uint8_t* data() const { return data_; }
+		size_t size() const { return size_; }
+
+	private:
+		const uint8_t* data_{ nullptr };
+		size_t size_{ 0 };
+#ifdef _WIN32
+		void* file_{ nullptr };
+		void* mapping_{ nullptr };
+#endif
+	};
+
+	// returns the 64 bit FNV-1a hash of an archive name
+	uint64_t hashArchiveName(const std::string& name);
+
+	// Archive is a read only pack of files mapped into memory
+	// The layout is an ARCHIVEHEADER, the file data, the index and the names
+	class Archive {
+	public:
+		Archive() {}
+		~Archive() { close(); }
+		Archive(const Archive&) = delete;
+		Archive& operator=(const Archive&) = delete;
+
+		// maps the archive at path into memory, returns false if it is missing or not an archive
+		bool open(const std::string& path);
+
+		// unmaps the archive, pointers returned by find() are no longer valid
+		void close();
+
+		bool isOpen() const { return file_.isOpen(); }
+
+		// returns number of files in the archive
+		size_t count() const { return count_; }
+
+		// returns the data of the file called name and its size, or nullptr if it is not in the archive
+		const void* find(const std::string& name, size_t& size) const;
+
+		bool contains(const std::string& name) const {
+			size_t size;
+			return find(name, size) != nullptr;
+		}
+
+		// returns true if p points into the mapped archive, as the data returned by find() does
+		bool owns(const void* p) const { return data_ && p >= data_ && p < data_ + size_; }
+
+		// returns an SDL_RWops reading the file from the mapped memory, or nullptr if it is not in the archive
+		// the SDL_RWops must be closed before the archive is
+		SDL_RWops* openRW(const std::string& name) const;
+
+		// writes an archive of the files in names, read from root + name, returns false if any could not be read
+		static bool pack(const std::string& path, const std::vector<std::string>& names, const std::string& root);
+
+	private:
+		MappedFile file_;
+		const uint8_t* data_{ nullptr };
+		size_t size_{ 0 };
+		const ARCHIVEENTRY* entries_{ nullptr };
+		size_t count_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
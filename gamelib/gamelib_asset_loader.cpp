@@ -0,0 +1,269 @@
+#include "pch.h"
+#include <gamelib_asset_loader.hpp>
+
+namespace GameLib {
+	void AssetLoader::start(unsigned threadCount) {
+		stop();
+		if (!threadCount) {
+			unsigned cores = std::thread::hardware_concurrency();
+			threadCount = cores > 1 ? cores - 1 : 1;
+		}
+		stopping_ = false;
+		for (unsigned i = 0; i < threadCount; i++)
+			threads_.emplace_back(&AssetLoader::_run, this);
+		context_.imageReloader = [this](ImageHandle image, const std::string& filename) { reloadImage(image, filename); };
+	}
+
+
+	void AssetLoader::stop() {
+		if (threads_.empty())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(jobMutex_);
+			stopping_ = true;
+		}
+		jobReady_.notify_all();
+		for (auto& t : threads_)
+			t.join();
+		threads_.clear();
+		for (auto& job : jobs_) {
+			job.promise->set_value(false);
+			finished_++;
+			failed_ = true;
+		}
+		jobs_.clear();
+		context_.imageReloader = nullptr;
+		context_.cancelImageReloads();
+	}
+
+
+	AssetLoader::Future AssetLoader::loadImage(const std::string& filename) {
+		return _queue([this, filename]() -> Finish {
+			SDL_RWops* rw = context_.openAsset(filename);
+			SDL_Surface* surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+			if (!surface) {
+				HFLOGERROR("'%s' not found", filename.c_str());
+				return nullptr;
+			}
+			return [this, filename, surface]() {
+				ImageHandle image = context_.createImage(filename, surface);
+				SDL_FreeSurface(surface);
+				HFLOGINFO("loaded '%s'", filename.c_str());
+				return (bool)image;
+			};
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::reloadImage(ImageHandle image, const std::string& filename) {
+		return _queue([this, image, filename]() -> Finish {
+			SDL_RWops* rw = context_.openAsset(filename);
+			SDL_Surface* surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+			if (!surface) {
+				HFLOGERROR("'%s' not found", filename.c_str());
+				return [this, image]() { return context_.restoreImage(image, nullptr); };
+			}
+			return [this, image, surface]() {
+				bool restored = context_.restoreImage(image, surface);
+				SDL_FreeSurface(surface);
+				return restored;
+			};
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::loadTileset(int tilesetId, int w, int h, const std::string& filename) {
+		return _queue([this, tilesetId, w, h, filename]() -> Finish {
+			SDL_RWops* rw = context_.openAsset(filename);
+			SDL_Surface* surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+			if (!surface) {
+				HFLOGERROR("'%s' not found", filename.c_str());
+				return nullptr;
+			}
+			auto tiles = std::make_shared<std::vector<SDL_Surface*>>(Context::splitTileset(surface, w, h));
+			SDL_FreeSurface(surface);
+			return [this, tilesetId, filename, tiles]() {
+				int tileCount = context_.createTileset(tilesetId, *tiles, filename);
+				for (auto tile : *tiles)
+					SDL_FreeSurface(tile);
+				if (tileCount)
+					HFLOGINFO("loaded '%s'", filename.c_str());
+				return tileCount > 0;
+			};
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::readFile(const std::string& path, std::function<bool(const std::string&)> finish) {
+		return _queue([path, finish]() -> Finish {
+			auto contents = std::make_shared<std::string>();
+			std::ifstream fin(path, std::ios::binary);
+			if (!fin) {
+				HFLOGERROR("'%s' not found", path.c_str());
+				return nullptr;
+			}
+			contents->assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+			return [finish, contents]() { return finish(*contents); };
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::loadAudioClip(int clipId, const std::string& filename) {
+		return _queue([this, clipId, filename]() -> Finish {
+			// clips stay encoded until they play or are preloaded
+			const uint8_t* data;
+			size_t size;
+			std::string path;
+			if (!context_.findAsset(filename, data, size, path)) {
+				HFLOGWARN("Unable to load '%s'", filename.c_str());
+				return nullptr;
+			}
+			return [this, clipId, filename, data, size, path]() {
+				context_.addAudioClip(clipId, filename, data, size, path);
+				HFLOGINFO("loaded '%s'", filename.c_str());
+				return true;
+			};
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::preloadAudioClip(int clipId) {
+		AudioHandle clip = context_.findAudioClip(clipId);
+		AUDIOINFO* audio = context_.audioClips().get(clip);
+		if (!audio || audio->chunk || !context_.audioInitialized()) {
+			std::promise<bool> done;
+			done.set_value(audio && audio->chunk);
+			return done.get_future().share();
+		}
+		// the decode works on a copy so the clip may be unloaded meanwhile
+		auto source = std::make_shared<AUDIOINFO>();
+		source->encoded = audio->encoded;
+		source->encodedSize = audio->encodedSize;
+		source->path = audio->path;
+		return _queue([this, clip, source]() -> Finish {
+			SDL_RWops* rw = Context::openAudioClip(*source);
+			Mix_Chunk* chunk = rw ? Mix_LoadWAV_RW(rw, 1) : nullptr;
+			if (!chunk)
+				return nullptr;
+			return [this, clip, chunk]() {
+				context_.setDecodedAudioClip(clip, chunk);
+				return true;
+			};
+		});
+	}
+
+
+	int AssetLoader::preloadAudioClips(size_t minEncodedBytes) {
+		int count = 0;
+		for (int clipId : context_.audioClipIds()) {
+			AUDIOINFO* audio = context_.getAudioClip(clipId);
+			if (audio && !audio->chunk && audio->encodedSize >= minEncodedBytes) {
+				preloadAudioClip(clipId);
+				count++;
+			}
+		}
+		return count;
+	}
+
+
+	AssetLoader::Future AssetLoader::loadMusicClip(int musicId, const std::string& filename) {
+		return _queue([this, musicId, filename]() -> Finish {
+			return [this, musicId, filename]() { return context_.loadMusicClip(musicId, filename) != nullptr; };
+		});
+	}
+
+
+	AssetLoader::Future AssetLoader::loadFont(Font& font, const std::string& filename, int ptsize) {
+		Font* f = &font;
+		return _queue([f, filename, ptsize]() -> Finish {
+			if (!f->load(filename, ptsize)) {
+				HFLOGWARN("Unable to load '%s'", filename.c_str());
+				return nullptr;
+			}
+			return []() { return true; };
+		});
+	}
+
+
+	int AssetLoader::update(int maxAssets) {
+		int count = 0;
+		while (!maxAssets || count < maxAssets) {
+			JOB job;
+			{
+				std::lock_guard<std::mutex> lock(decodedMutex_);
+				if (decoded_.empty())
+					break;
+				job = std::move(decoded_.front());
+				decoded_.pop_front();
+			}
+			bool loaded = job.finish && job.finish();
+			job.promise->set_value(loaded);
+			failed_ = failed_ || !loaded;
+			finished_++;
+			count++;
+			if (onProgress)
+				onProgress(finished_, queued_);
+		}
+		return count;
+	}
+
+
+	bool AssetLoader::finish() {
+		while (finished_ < queued_) {
+			{
+				std::unique_lock<std::mutex> lock(decodedMutex_);
+				decodedReady_.wait(lock, [this] { return !decoded_.empty(); });
+			}
+			update();
+		}
+		bool loaded = !failed_;
+		failed_ = false;
+		return loaded;
+	}
+
+
+	AssetLoader::Future AssetLoader::_queue(Decode decode) {
+		JOB job;
+		job.promise = std::make_shared<std::promise<bool>>();
+		job.decode = std::move(decode);
+		Future future = job.promise->get_future().share();
+		queued_++;
+		if (threads_.empty()) {
+			_decode(job);
+			return future;
+		}
+		{
+			std::lock_guard<std::mutex> lock(jobMutex_);
+			jobs_.push_back(std::move(job));
+		}
+		jobReady_.notify_one();
+		return future;
+	}
+
+
+	void AssetLoader::_decode(JOB& job) {
+		job.finish = job.decode();
+		job.decode = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(decodedMutex_);
+			decoded_.push_back(std::move(job));
+		}
+		decodedReady_.notify_one();
+	}
+
+
+	void AssetLoader::_run() {
+		for (;;) {
+			JOB job;
+			{
+				std::unique_lock<std::mutex> lock(jobMutex_);
+				jobReady_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+				if (stopping_)
+					return;
+				job = std::move(jobs_.front());
+				jobs_.pop_front();
+			}
+			_decode(job);
+		}
+	}
+} // namespace GameLib
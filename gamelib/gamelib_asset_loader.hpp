@@ -0,0 +1,122 @@
+#ifndef GAMELIB_ASSET_LOADER_HPP
+#define GAMELIB_ASSET_LOADER_HPP
+
+#include <gamelib_context.hpp>
+#include <gamelib_font.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+
+namespace GameLib {
+	// AssetLoader decodes images, tilesets, sounds and fonts on loader threads
+	// Textures can only be created by the renderer, so decoded assets wait for update() on the main thread
+	// Search paths and archives must not change while assets are loading
+	class AssetLoader {
+	public:
+		// ready once the asset is in the Context, true if it loaded
+		using Future = std::shared_future<bool>;
+		// runs on the main thread once an asset is decoded, returns true if the asset loaded
+		using Finish = std::function<bool()>;
+		// runs on a loader thread, returns nullptr if the asset could not be decoded
+		using Decode = std::function<Finish()>;
+
+		AssetLoader(Context& context) : context_(context) {}
+		// decoded assets are still moved into the Context so their surfaces are freed
+		~AssetLoader() {
+			stop();
+			update();
+		}
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		// starts threadCount loader threads, 0 uses one less than the number of cores
+		// assets queued before start() are decoded when they are queued
+		void start(unsigned threadCount = 0);
+
+		// stops the loader threads, assets that were not decoded fail
+		void stop();
+
+		bool running() const { return !threads_.empty(); }
+
+		// same as Context::loadImage()
+		Future loadImage(const std::string& filename);
+
+		// decodes an evicted image and restores its texture, start() makes this the context's imageReloader
+		Future reloadImage(ImageHandle image, const std::string& filename);
+
+		// same as Context::loadTileset()
+		Future loadTileset(int tilesetId, int w, int h, const std::string& filename);
+
+		// reads a file from the file system, not the archives, and passes it to finish on the main thread
+		// finish returns true if it used the contents
+		Future readFile(const std::string& path, std::function<bool(const std::string&)> finish);
+
+		// same as Context::loadAudioClip()
+		Future loadAudioClip(int clipId, const std::string& filename);
+
+		// decodes a loaded clip so its first play does not decode on the main thread
+		Future preloadAudioClip(int clipId);
+
+		// preloads every clip of at least minEncodedBytes that is not decoded, returns the number queued
+		int preloadAudioClips(size_t minEncodedBytes);
+
+		// same as Context::loadMusicClip(), music streams while it plays so it is opened by update()
+		Future loadMusicClip(int musicId, const std::string& filename);
+
+		// same as Font::load(), font must outlive the loader
+		Future loadFont(Font& font, const std::string& filename, int ptsize);
+
+		// runs decode on a loader thread and the Finish it returns in update(), for assets the loader does not know
+		Future queue(Decode decode) { return _queue(std::move(decode)); }
+
+		// moves decoded assets into the Context, at most maxAssets of them if it is not 0
+		// call once a frame on the main thread, returns the number of assets finished
+		int update(int maxAssets = 0);
+
+		// waits for every queued asset to finish, returns false if any failed to load
+		bool finish();
+
+		// number of assets queued since the loader was created
+		unsigned queued() const { return queued_; }
+
+		// number of assets that have finished loading or failed
+		unsigned finished() const { return finished_; }
+
+		// returns finished() / queued(), 1 if nothing is queued
+		float progress() const { return queued_ ? (float)finished_ / (float)queued_ : 1.0f; }
+
+		// called by update() each time an asset finishes
+		std::function<void(unsigned finished, unsigned queued)> onProgress;
+
+	private:
+		struct JOB {
+			std::shared_ptr<std::promise<bool>> promise;
+			Decode decode;
+			Finish finish;
+		};
+
+		Future _queue(Decode decode);
+		void _decode(JOB& job);
+		void _run();
+
+		Context& context_;
+		std::vector<std::thread> threads_;
+
+		std::mutex jobMutex_;
+		std::condition_variable jobReady_;
+		std::deque<JOB> jobs_;
+		bool stopping_{ false };
+
+		std::mutex decodedMutex_;
+		std::condition_variable decodedReady_;
+		std::deque<JOB> decoded_;
+
+		unsigned queued_{ 0 };
+		unsigned finished_{ 0 };
+		bool failed_{ false };
+	};
+} // namespace GameLib
+
+#endif
@@ -4,28 +4,19 @@
 
 namespace GameLib {
     void Audio::playAudio(int audioClipId, bool stopPrevious) {
-        if (stopPrevious)
-            stopAudio(audioClipId);
-        Context* context = Locator::getContext();
-        lastChannel_ = context->playAudioClip(audioClipId);
-        audioClipToChannelMap_[audioClipId] = lastChannel_;
+        std::lock_guard<std::mutex> lock(requestMutex_);
+        requests_.push_back({ audioClipId, stopPrevious });
     };
 
-    void Audio::stopAudio(int audioClipId) {
-        Context* context = Locator::getContext();
-        int channel = audioClipToChannelMap_[audioClipId];
-        context->stopAudioChannel(channel);
-    }
+    void Audio::stopAudio(int audioClipId) { _stopVoices(audioClipId); }
 
     void Audio::setVolume(float volume) {
         Context* context = Locator::getContext();
-        context->setChannelVolume(lastChannel_, volume);
+        volume_ = volume;
+        context->setChannelVolume(-1, volume);
     }
 
-    float Audio::getVolume() const {
-        Context* context = Locator::getContext();
-        return context->getChannelVolume(lastChannel_);
-    }
+    float Audio::getVolume() const { return volume_; }
 
     void Audio::playMusic(int musicClipId, int loops, float fadems) {
         Context* context = Locator::getContext();
@@ -36,4 +27,99 @@ namespace GameLib {
         Context* context = Locator::getContext();
         context->stopMusicClip();
     }
+
+    void Audio::update() {
+        {
+            std::lock_guard<std::mutex> lock(requestMutex_);
+            pending_.swap(requests_);
+        }
+        Context* context = Locator::getContext();
+        int channels = context->audioChannelCount();
+        if (!channels) {
+            pending_.clear();
+            return;
+        }
+        if ((int)voices_.size() != channels)
+            voices_.resize(channels);
+        for (int i = 0; i < channels; i++) {
+            if (voices_[i].clipId >= 0 && !context->audioChannelPlaying(i))
+                voices_[i] = VOICE();
+        }
+
+        Uint32 now = SDL_GetTicks();
+        for (auto& r : pending_) {
+            CLIPSETTINGS& settings = clipSettings_[r.clipId];
+            // a clip started this frame has lastStartTicks == now, so duplicates in one frame always merge
+            if (settings.started && now - settings.lastStartTicks < std::max(dedupWindowMs, 1u)) {
+                merged_++;
+                continue;
+            }
+            if (r.stopPrevious)
+                _stopVoices(r.clipId);
+            int channel = _findVoice(settings, r.clipId);
+            if (channel < 0) {
+                dropped_++;
+                continue;
+            }
+            // playing on a busy channel halts its clip, so stealing does not need a separate halt
+            if (voices_[channel].clipId >= 0)
+                stolen_++;
+            if (context->playAudioClip(r.clipId, channel) < 0) {
+                voices_[channel] = VOICE();
+                dropped_++;
+                continue;
+            }
+            voices_[channel] = { r.clipId, settings.priority, now };
+            settings.lastStartTicks = now;
+            settings.started = true;
+            played_++;
+        }
+        pending_.clear();
+    }
+
+    void Audio::logStats() const {
+        HFLOGINFO("Audio: %u played, %u merged, %u stolen, %u dropped", played_, merged_, stolen_, dropped_);
+    }
+
+    int Audio::_findVoice(const CLIPSETTINGS& settings, int clipId) const {
+        auto older = [](const VOICE& a, const VOICE& b) { return (Sint32)(a.startTicks - b.startTicks) < 0; };
+        int count = 0;
+        int oldest = -1;
+        int freeVoice = -1;
+        int victim = -1;
+        for (int i = 0; i < (int)voices_.size(); i++) {
+            const VOICE& v = voices_[i];
+            if (v.clipId < 0) {
+                if (freeVoice < 0)
+                    freeVoice = i;
+                continue;
+            }
+            if (v.clipId == clipId) {
+                count++;
+                if (oldest < 0 || older(v, voices_[oldest]))
+                    oldest = i;
+            }
+            if (v.priority > settings.priority)
+                continue;
+            if (victim < 0 || v.priority < voices_[victim].priority ||
+                (v.priority == voices_[victim].priority && older(v, voices_[victim])))
+                victim = i;
+        }
+        // past its limit a clip restarts its oldest voice instead of taking another
+        if (count >= settings.maxVoices)
+            return oldest;
+        if (freeVoice >= 0)
+            return freeVoice;
+        return victim;
+    }
+
+    void Audio::_stopVoices(int clipId) {
+        Context* context = Locator::getContext();
+        for (int i = 0; i < (int)voices_.size(); i++) {
+            if (voices_[i].clipId == clipId) {
+                context->stopAudioChannel(i);
+                voices_[i] = VOICE();
+            }
+        }
+    }
 }
@@ -14,19 +14,75 @@ namespace GameLib {
         virtual float getVolume() const { return 0.0f; }
         virtual void playMusic(int musicClipId, int loops, float fadems) {}
         virtual void stopMusic() {}
+        // starts the clips requested since the last update, call once a frame
+        virtual void update() {}
     };
 
+    // Audio is a voice manager, playAudio() only queues a request and update() sends them to the mixer
+    // Requests for a clip that started within dedupWindowMs are merged, each clip has a voice limit,
+    // and when every channel is busy the lowest priority voice is stolen
     class Audio : public IAudio {
     public:
+        // may be called from any thread
         void playAudio(int audioClipId, bool stopPrevious) override;
         void stopAudio(int audioClipId) override;
         void setVolume(float volume) override;
         float getVolume() const override;
         void playMusic(int musicClipId, int loops, float fadems) override;
         void stopMusic() override;
+        void update() override;
+
+        // voices of clips with a higher priority steal from lower ones, the default is 0
+        void setClipPriority(int audioClipId, int priority) { clipSettings_[audioClipId].priority = priority; }
+
+        // most voices a clip may play at once, the oldest is restarted past the limit, the default is 4
+        void setClipLimit(int audioClipId, int maxVoices) { clipSettings_[audioClipId].maxVoices = maxVoices; }
+
+        // logs how many requests were played, merged, stolen and dropped
+        void logStats() const;
+
+        // requests for a clip within this many milliseconds of its last start are merged
+        Uint32 dedupWindowMs{ 30 };
+
+        unsigned played() const { return played_; }
+        unsigned merged() const { return merged_; }
+        unsigned stolen() const { return stolen_; }
+        unsigned dropped() const { return dropped_; }
+
     private:
-        int lastChannel_{ -1 };
-        std::map<int, int> audioClipToChannelMap_;
+        struct REQUEST {
+            int clipId{ -1 };
+            bool stopPrevious{ false };
+        };
+
+        struct VOICE {
+            int clipId{ -1 };
+            int priority{ 0 };
+            Uint32 startTicks{ 0 };
+        };
+
+        struct CLIPSETTINGS {
+            int priority{ 0 };
+            int maxVoices{ 4 };
+            Uint32 lastStartTicks{ 0 };
+            bool started{ false };
+        };
+
+        int _findVoice(const CLIPSETTINGS& settings, int clipId) const;
+        void _stopVoices(int clipId);
+
+        std::mutex requestMutex_;
+        std::vector<REQUEST> requests_;
+        // swapped with requests_ by update() so the lock is only held for the swap
+        std::vector<REQUEST> pending_;
+        std::vector<VOICE> voices_;
+        std::map<int, CLIPSETTINGS> clipSettings_;
+        float volume_{ 1.0f };
+
+        unsigned played_{ 0 };
+        unsigned merged_{ 0 };
+        unsigned stolen_{ 0 };
+        unsigned dropped_{ 0 };
     };
 }
 
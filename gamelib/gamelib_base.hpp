@@ -50,15 +50,48 @@ namespace GameLib {
 		int h{ 0 };
 	};
 
+	struct TEXTUREINFO {
+		// nullptr while the image is evicted
+		SDL_Texture* texture{ nullptr };
+		int w{ 0 };
+		int h{ 0 };
+		// the file an evicted image is reloaded from
+		std::string filename;
+		// frame the image was last drawn, the least recently drawn images are evicted first
+		unsigned lastUsed{ 0 };
+		// an evicted image was drawn and is being reloaded
+		bool reloading{ false };
+	};
+
+	struct TILESET {
+		std::vector<TILEIMAGE> tiles;
+		// file the tileset was cut from, empty if it was not loaded from a file
+		std::string filename;
+	};
+
 	struct AUDIOINFO {
+		// decoded clip, nullptr until it is first played or preloaded, and again after it is evicted
 		Mix_Chunk* chunk{ nullptr };
 		std::string name;
+		// the clip as stored in a mapped archive, or the path it is read from when it is decoded
+		const uint8_t* encoded{ nullptr };
+		size_t encodedSize{ 0 };
+		std::string path;
+		// the name the clip was loaded by, to find it on the search paths when its archive is closed
+		std::string filename;
+		// use count when the clip last played, the least recently used clips are evicted first
+		unsigned lastUsed{ 0 };
 
-		operator bool() const { return chunk != nullptr; }
+		operator bool() const { return chunk != nullptr || encoded != nullptr || !path.empty(); }
 
 		void free() {
-			Mix_FreeChunk(chunk);
+			if (chunk)
+				Mix_FreeChunk(chunk);
 			chunk = nullptr;
+			encoded = nullptr;
+			encodedSize = 0;
+			path.clear();
+			filename.clear();
 		}
 
 		~AUDIOINFO() {
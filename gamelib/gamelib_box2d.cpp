@@ -2,17 +2,15 @@
 #include <gamelib_box2d.hpp>
 
 namespace GameLib {
-	Box2D::Box2D() {}
+	Box2D::Box2D() : world_(std::make_unique<b2World>(gravity_)) { world_->SetContactListener(&contactListener_); }
 
 
-	Box2D::~Box2D() {}
+	Box2D::~Box2D() { stopThread(); }
 
 
 	void Box2D::init() {
-		//{ world_ = b2World{ gravity_ }; }
-
 		StaticBody groundBody;
-		groundBody.init(world_, { 0.0f, -10.0f }, { 50.0f, 10.0f }, 0.0f, 0.0f);
+		groundBody.init(*world_, { 0.0f, -10.0f }, { 50.0f, 10.0f }, 0.0f, 0.0f);
 		staticBodies.push_back(groundBody);
 	}
 
@@ -20,29 +18,246 @@ namespace GameLib {
 	void Box2D::setGravity(glm::vec2 a_g) {
 		gravity_.x = a_g.x;
 		gravity_.y = a_g.y;
-		world_.SetGravity(gravity_);
+		std::lock_guard<std::mutex> lock(worldMutex_);
+		world_->SetGravity(gravity_);
 	}
 
 
 	void Box2D::update(float timeStep) {
+		if (running_) {
+			// only take a snapshot the physics thread has finished since the last one
+			if (readyIndex_.load() & NEW_SNAPSHOT)
+				frontIndex_ = readyIndex_.exchange(frontIndex_) & 3;
+			return;
+		}
 		constexpr int velocityIterations = 1;
 		constexpr int positionIterations = 1;
-		world_.Step(timeStep, velocityIterations, positionIterations);
+		std::lock_guard<std::mutex> lock(worldMutex_);
+		world_->Step(timeStep, velocityIterations, positionIterations);
+		// a zero step only updates contacts, so those the step made or ended are reported now
+		// rather than left for the next rebuild to find without events
+		if (collideAfterStep_)
+			world_->Step(0.0f, velocityIterations, positionIterations);
+	}
+
+
+	void Box2D::startThread(float fixedStep) {
+		if (running_)
+			return;
+		fixedStep_ = fixedStep;
+		// the main thread reads a complete snapshot until the physics thread publishes one
+		_publishSnapshot();
+		frontIndex_ = readyIndex_.exchange(frontIndex_) & 3;
+		running_ = true;
+		thread_ = std::thread(&Box2D::_threadMain, this);
+	}
+
+
+	void Box2D::stopThread() {
+		if (!running_)
+			return;
+		running_ = false;
+		thread_.join();
+		_applyCommands();
+	}
+
+
+	void Box2D::setPosition(int id, b2BodyType type, glm::vec2 p) {
+		if (!running_) {
+			getBody(id, type)->setPosition(p);
+			return;
+		}
+		_queueCommand(BODYCOMMAND::SETPOSITION, id, type, p);
+	}
+
+
+	void Box2D::setVelocity(int id, b2BodyType type, glm::vec2 v) {
+		if (!running_) {
+			getBody(id, type)->setVelocity(v);
+			return;
+		}
+		_queueCommand(BODYCOMMAND::SETVELOCITY, id, type, v);
 	}
 
 
-	int Box2D::initBody(b2BodyType type, glm::vec2 position, glm::vec2 halfSize, float density, float friction) {
+	void Box2D::applyImpulse(int id, b2BodyType type, glm::vec2 v) {
+		if (!running_) {
+			getBody(id, type)->applyImpulse(v);
+			return;
+		}
+		_queueCommand(BODYCOMMAND::APPLYIMPULSE, id, type, v);
+	}
+
+
+	void Box2D::setState(int id, b2BodyType type, const BODYSTATE& state) {
+		if (!running_) {
+			getBody(id, type)->setState(state);
+			return;
+		}
+		_queueCommand(BODYCOMMAND::SETPOSITION, id, type, state.position);
+		_queueCommand(BODYCOMMAND::SETVELOCITY, id, type, state.velocity);
+	}
+
+
+	void Box2D::rebuild() {
+		if (running_) {
+			HFLOGERROR("Box2D cannot be rebuilt while threaded");
+			return;
+		}
+		// bodies made in a different order, or at other indices after a restore, are still made alike
+		std::vector<PhysicsBody*> order;
+		auto add = [&order](auto& bodies) {
+			size_t first = order.size();
+			for (auto& b : bodies) {
+				if (b.body)
+					order.push_back(&b);
+			}
+			std::stable_sort(order.begin() + first, order.end(), [](PhysicsBody* a, PhysicsBody* b) {
+				return getUserData(a->body) < getUserData(b->body);
+			});
+		};
+		add(staticBodies);
+		add(dynamicBodies);
+		std::vector<BODYSTATE> states(order.size());
+		for (size_t i = 0; i < order.size(); i++)
+			states[i] = order[i]->state();
+
+		std::lock_guard<std::mutex> lock(worldMutex_);
+		world_ = std::make_unique<b2World>(gravity_);
+		world_->SetContactListener(&contactListener_);
+		for (size_t i = 0; i < order.size(); i++)
+			order[i]->create(*world_, states[i]);
+		// events of the old world, such as the ends a restore made by removing bodies, are not the new world's
+		contactListener_.events.clear();
+		// a zero step finds the contacts touching now, their events are dropped as the old world reported them
+		world_->Step(0.0f, 1, 1);
+		contactListener_.events.clear();
+		collideAfterStep_ = true;
+	}
+
+
+	BODYSTATE Box2D::bodyState(int id, b2BodyType type) const {
+		if (!running_) {
+			const PhysicsBody& body = type == b2_staticBody ? (const PhysicsBody&)staticBodies[id] : dynamicBodies[id];
+			return body.state();
+		}
+		const SNAPSHOT& front = snapshots_[frontIndex_];
+		const auto& states = type == b2_staticBody ? front.staticBodies : front.dynamicBodies;
+		const auto& generations = type == b2_staticBody ? front.staticGenerations : front.dynamicGenerations;
+		const PhysicsBody& body = type == b2_staticBody ? (const PhysicsBody&)staticBodies[id] : dynamicBodies[id];
+		if (id < (int)states.size() && generations[id] == body.generation)
+			return states[id];
+		// bodies created since the snapshot have not moved yet, a snapshot of an old body at this index is not theirs
+		return { { body.bodyDef.position.x, body.bodyDef.position.y }, { 0.0f, 0.0f } };
+	}
+
+
+	void Box2D::_threadMain() {
+		constexpr int velocityIterations = 1;
+		constexpr int positionIterations = 1;
+		auto step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(fixedStep_));
+		auto next = std::chrono::steady_clock::now();
+		while (running_) {
+			_applyCommands();
+			{
+				std::lock_guard<std::mutex> lock(worldMutex_);
+				world_->Step(fixedStep_, velocityIterations, positionIterations);
+			}
+			_publishSnapshot();
+			next += step;
+			auto now = std::chrono::steady_clock::now();
+			if (next < now) {
+				// too far behind to catch up, drop the missed steps instead of spiralling
+				next = now;
+			}
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+
+	void Box2D::_queueCommand(int type, int id, b2BodyType bodyType, glm::vec2 value) {
+		// only the main thread makes bodies, so their generations are read here without the world lock
+		unsigned generation = getBody(id, bodyType)->generation;
+		std::lock_guard<std::mutex> lock(commandMutex_);
+		commands_.push_back({ type, id, bodyType, value, generation });
+	}
+
+
+	void Box2D::_applyCommands() {
+		{
+			std::lock_guard<std::mutex> lock(commandMutex_);
+			std::swap(commands_, pendingCommands_);
+		}
+		std::lock_guard<std::mutex> lock(worldMutex_);
+		for (auto& c : pendingCommands_) {
+			PhysicsBody* body = getBody(c.id, c.bodyType);
+			// the body was destroyed after the command was queued, and its index may belong to a new body
+			if (!body || !body->body || body->generation != c.generation)
+				continue;
+			switch (c.type) {
+			case BODYCOMMAND::SETPOSITION: body->setPosition(c.value); break;
+			case BODYCOMMAND::SETVELOCITY: body->setVelocity(c.value); break;
+			case BODYCOMMAND::APPLYIMPULSE: body->applyImpulse(c.value); break;
+			}
+		}
+		pendingCommands_.clear();
+	}
+
+
+	void Box2D::_publishSnapshot() {
+		SNAPSHOT& back = snapshots_[backIndex_];
+		{
+			std::lock_guard<std::mutex> lock(worldMutex_);
+			back.staticBodies.resize(staticBodies.size());
+			back.staticGenerations.resize(staticBodies.size());
+			for (size_t i = 0; i < staticBodies.size(); i++) {
+				back.staticBodies[i] = staticBodies[i].state();
+				back.staticGenerations[i] = staticBodies[i].generation;
+			}
+			back.dynamicBodies.resize(dynamicBodies.size());
+			back.dynamicGenerations.resize(dynamicBodies.size());
+			for (size_t i = 0; i < dynamicBodies.size(); i++) {
+				back.dynamicBodies[i] = dynamicBodies[i].state();
+				back.dynamicGenerations[i] = dynamicBodies[i].generation;
+			}
+		}
+		backIndex_ = readyIndex_.exchange(backIndex_ | NEW_SNAPSHOT) & 3;
+	}
+
+
+	int Box2D::initBody(b2BodyType type,
+		glm::vec2 position,
+		glm::vec2 halfSize,
+		float density,
+		float friction,
+		bool sensor,
+		uintptr_t userData) {
 		int id = 0;
 		StaticBody sbody;
 		DynamicBody dbody;
+		std::lock_guard<std::mutex> lock(worldMutex_);
 		switch (type) {
 		case b2_staticBody:
-			sbody.init(world_, position, halfSize, density, friction);
+			sbody.init(*world_, position, halfSize, density, friction, sensor, userData);
+			if (!freeStaticBodies_.empty()) {
+				id = freeStaticBodies_.back();
+				freeStaticBodies_.pop_back();
+				sbody.generation = staticBodies[id].generation + 1;
+				staticBodies[id] = std::move(sbody);
+				break;
+			}
 			staticBodies.push_back(std::move(sbody));
 			id = static_cast<int>(staticBodies.size() - 1);
 			break;
 		case b2_dynamicBody:
-			dbody.init(world_, position, halfSize, density, friction);
+			dbody.init(*world_, position, halfSize, density, friction, sensor, userData);
+			if (!freeDynamicBodies_.empty()) {
+				id = freeDynamicBodies_.back();
+				freeDynamicBodies_.pop_back();
+				dbody.generation = dynamicBodies[id].generation + 1;
+				dynamicBodies[id] = std::move(dbody);
+				break;
+			}
 			dynamicBodies.push_back(std::move(dbody));
 			id = static_cast<int>(dynamicBodies.size() - 1);
 			break;
@@ -50,4 +265,37 @@ namespace GameLib {
 		}
 		return id;
 	}
+
+
+	void Box2D::destroyBody(int id, b2BodyType type) {
+		std::lock_guard<std::mutex> lock(worldMutex_);
+		PhysicsBody* body = getBody(id, type);
+		if (!body || !body->body)
+			return;
+		world_->DestroyBody(body->body);
+		body->body = nullptr;
+		(type == b2_staticBody ? freeStaticBodies_ : freeDynamicBodies_).push_back(id);
+	}
+
+
+	int Box2D::queryAABB(glm::vec2 lower, glm::vec2 upper, uintptr_t* results, int maxResults) const {
+		int count = 0;
+		if (maxResults <= 0)
+			return 0;
+		queryAABB(lower, upper, [&](uintptr_t userData) {
+			results[count++] = userData;
+			return count < maxResults;
+		});
+		return count;
+	}
+
+
+	int Box2D::raycasts(const glm::vec2* p1, const glm::vec2* p2, int count, RAYCASTHIT* hits) const {
+		int hitCount = 0;
+		for (int i = 0; i < count; i++) {
+			if (raycast(p1[i], p2[i], hits[i]))
+				hitCount++;
+		}
+		return hitCount;
+	}
 } // namespace GameLib
@@ -5,60 +5,128 @@
 #include <box2d/box2d.h>
 #elif __has_include(<Box2D/Box2D.h>)
 #include <Box2d/Box2d.h>
+// Box2D 2.3 stores user data as a void pointer
+#define GAMELIB_BOX2D_VOID_USERDATA
 #else
 #error "Box2D headers not found"
 #endif
 #include <glm/glm.hpp>
 #include <hatchetfish.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace GameLib {
+	// returns the user data stored in a body
+	inline uintptr_t getUserData(b2Body* body) {
+#ifdef GAMELIB_BOX2D_VOID_USERDATA
+		return reinterpret_cast<uintptr_t>(body->GetUserData());
+#else
+		return body->GetUserData().pointer;
+#endif
+	}
+
+	// BODYSTATE is the transform of a body published after a step
+	struct BODYSTATE {
+		glm::vec2 position{ 0.0f, 0.0f };
+		glm::vec2 velocity{ 0.0f, 0.0f };
+		float angle{ 0.0f };
+		float angularVelocity{ 0.0f };
+	};
+
 	struct PhysicsBody {
 		b2BodyDef bodyDef;
 		b2Body* body{ nullptr };
 		b2PolygonShape shape;
 		b2FixtureDef fixtureDef;
+		// counts the bodies that had this index before, so queued commands and snapshots of an old body are told apart
+		unsigned generation{ 0 };
 
 		PhysicsBody(b2BodyType type) { bodyDef.type = type; }
 
-		void init(b2World& w, glm::vec2 position, glm::vec2 halfSize, float density, float friction) {
+		void init(b2World& w,
+			glm::vec2 position,
+			glm::vec2 halfSize,
+			float density,
+			float friction,
+			bool sensor = false,
+			uintptr_t userData = 0) {
 			bodyDef.position.x = position.x;
 			bodyDef.position.y = position.y;
-			body = w.CreateBody(&bodyDef);
-			shape.SetAsBox(halfSize.x, halfSize.y);
-			switch (bodyDef.type) {
-			case b2_staticBody: body->CreateFixture(&shape, density); break;
-			case b2_dynamicBody:
-				fixtureDef.shape = &shape;
-				fixtureDef.friction = friction;
-				fixtureDef.density = density;
-				body->CreateFixture(&fixtureDef);
-				break;
-			default:
+#ifdef GAMELIB_BOX2D_VOID_USERDATA
+			bodyDef.userData = reinterpret_cast<void*>(userData);
+#else
+			bodyDef.userData.pointer = userData;
+#endif
+			if (bodyDef.type != b2_staticBody && bodyDef.type != b2_dynamicBody) {
 				HFLOGERROR("Body definition type not supported");
 				exit(0);
-				break;
 			}
+			shape.SetAsBox(halfSize.x, halfSize.y);
+			fixtureDef.density = density;
+			// sensors report contacts but never push bodies apart
+			fixtureDef.isSensor = sensor;
+			if (bodyDef.type == b2_dynamicBody && !sensor)
+				fixtureDef.friction = friction;
+			create(w, { position });
 		}
 
-		// sets transform of body with no rotation
-		void setPosition(glm::vec2 p) { body->SetTransform({ p.x, p.y }, 0.0f); }
+		// makes the body in w from its definitions with the transform and velocities in state
+		void create(b2World& w, const BODYSTATE& state) {
+			b2BodyDef def = bodyDef;
+			def.position = { state.position.x, state.position.y };
+			def.angle = state.angle;
+			def.linearVelocity = { state.velocity.x, state.velocity.y };
+			def.angularVelocity = state.angularVelocity;
+			body = w.CreateBody(&def);
+			// a copied body still points at the shape it was copied from
+			fixtureDef.shape = &shape;
+			body->CreateFixture(&fixtureDef);
+		}
+
+		// sets transform of body with no rotation and wakes it, a sleeping body would not see its new contacts
+		void setPosition(glm::vec2 p) {
+			body->SetTransform({ p.x, p.y }, 0.0f);
+			body->SetAwake(true);
+		}
 
 		// sets linear velocity of body
 		void setVelocity(glm::vec2 v) { body->SetLinearVelocity({ v.x, v.y }); }
 
+		// puts back a transform and velocities from state() and wakes the body
+		void setState(const BODYSTATE& state) {
+			body->SetTransform({ state.position.x, state.position.y }, state.angle);
+			body->SetLinearVelocity({ state.velocity.x, state.velocity.y });
+			body->SetAngularVelocity(state.angularVelocity);
+			body->SetAwake(true);
+		}
+
 		void applyImpulse(glm::vec2 v) { body->ApplyLinearImpulse({ v.x, v.y }, body->GetPosition(), false); }
 
-		// returns current position of body
+		// returns current position of body, or where it was created if it has been destroyed
 		glm::vec2 position() const {
+			if (!body)
+				return { bodyDef.position.x, bodyDef.position.y };
 			auto p = body->GetPosition();
 			return { p.x, p.y };
 		}
 
 		// returns current linear of body
 		glm::vec2 velocity() const {
+			if (!body)
+				return { 0.0f, 0.0f };
 			auto v = body->GetLinearVelocity();
 			return { v.x, v.y };
 		}
+
+		// returns transform and velocities of body
+		BODYSTATE state() const {
+			if (!body)
+				return { position(), velocity() };
+			return { position(), velocity(), body->GetAngle(), body->GetAngularVelocity() };
+		}
 	};
 
 	struct StaticBody : public PhysicsBody {
@@ -69,6 +137,38 @@ namespace GameLib {
 		DynamicBody() : PhysicsBody(b2_dynamicBody) {}
 	};
 
+	// CONTACTEVENT is a contact that started or ended during a step
+	struct CONTACTEVENT {
+		// user data of the two bodies, 0 for bodies without user data
+		uintptr_t a{ 0 };
+		uintptr_t b{ 0 };
+		// true when the contact started, false when it ended
+		bool begin{ false };
+		// true if either fixture is a sensor
+		bool sensor{ false };
+	};
+
+	// RAYCASTHIT is the closest body hit by a ray
+	struct RAYCASTHIT {
+		// fraction along the ray where it hit
+		float fraction{ 1.0f };
+		glm::vec2 point{ 0.0f, 0.0f };
+		glm::vec2 normal{ 0.0f, 0.0f };
+		// user data of the body that was hit
+		uintptr_t userData{ 0 };
+	};
+
+	// BODYCOMMAND is a change to a body queued for the physics thread
+	struct BODYCOMMAND {
+		enum { SETPOSITION, SETVELOCITY, APPLYIMPULSE };
+		int type{ SETPOSITION };
+		int id{ -1 };
+		b2BodyType bodyType{ b2_dynamicBody };
+		glm::vec2 value{ 0.0f, 0.0f };
+		// generation of the body when the command was queued, commands for a destroyed body are dropped
+		unsigned generation{ 0 };
+	};
+
 	class Box2D {
 	public:
 		Box2D();
@@ -76,10 +176,127 @@ namespace GameLib {
 
 		void init();
 		void setGravity(glm::vec2 a_g);
+
+		// steps the world, or when threaded picks up the newest snapshot from the physics thread
 		void update(float timestep);
 
+		// starts stepping the world on its own thread every fixedStep seconds
+		// while threaded, bodies must be changed with setPosition(), setVelocity() and applyImpulse()
+		// and read with bodyState(), getBody() is only safe to use when not threaded
+		void startThread(float fixedStep);
+
+		// stops the physics thread and returns to stepping in update()
+		void stopThread();
+
+		// returns true if the world is stepped on its own thread
+		bool threaded() const { return running_; }
+
+		// moves a body, queued when threaded
+		void setPosition(int id, b2BodyType type, glm::vec2 p);
+
+		// sets linear velocity of a body, queued when threaded
+		void setVelocity(int id, b2BodyType type, glm::vec2 v);
+
+		// applies an impulse at the center of a body, queued when threaded
+		void applyImpulse(int id, b2BodyType type, glm::vec2 v);
+
+		// puts back a body's state from bodyState(), when threaded only position and velocity are queued
+		void setState(int id, b2BodyType type, const BODYSTATE& state);
+
+		// makes the world again from the bodies' states alone, dropping Box2D's contacts, warm starting,
+		// sleep timers and buffered contact events, so two worlds with the same bodies step alike however
+		// they got there. Bodies are made in order of user data then index, contacts already touching
+		// begin without events, and from then on contacts are also updated after each step so the next
+		// rebuild finds them as the step left them. Not allowed while threaded
+		void rebuild();
+
+		// returns the transform of a body, from the snapshot picked up by update() when threaded
+		BODYSTATE bodyState(int id, b2BodyType type) const;
+
 		// returns index to body in the list
-		int initBody(b2BodyType type, glm::vec2 position, glm::vec2 halfSize, float density, float friction);
+		int initBody(b2BodyType type,
+			glm::vec2 position,
+			glm::vec2 halfSize,
+			float density,
+			float friction,
+			bool sensor = false,
+			uintptr_t userData = 0);
+
+		// removes a body from the world, its index is reused by the next initBody() of the same type
+		void destroyBody(int id, b2BodyType type);
+
+		// returns contacts that started or ended since the last clearContactEvents(), not safe when threaded
+		const std::vector<CONTACTEVENT>& contactEvents() const { return contactListener_.events; }
+
+		// clears the buffered contact events
+		void clearContactEvents() { contactListener_.events.clear(); }
+
+		// swaps the buffered contact events into events, safe when threaded
+		void takeContactEvents(std::vector<CONTACTEVENT>& events) {
+			std::lock_guard<std::mutex> lock(worldMutex_);
+			events.clear();
+			std::swap(events, contactListener_.events);
+		}
+
+		// calls f(userData) for every body whose bounds overlap the box from lower to upper
+		// bounds are Box2D's padded broadphase boxes, stops early if f returns false
+		template <typename F>
+		void queryAABB(glm::vec2 lower, glm::vec2 upper, F f) const {
+			class Callback : public b2QueryCallback {
+			public:
+				Callback(F& f) : f_(f) {}
+				bool ReportFixture(b2Fixture* fixture) override { return f_(getUserData(fixture->GetBody())); }
+
+			private:
+				F& f_;
+			} callback(f);
+			b2AABB aabb;
+			aabb.lowerBound = { lower.x, lower.y };
+			aabb.upperBound = { upper.x, upper.y };
+			std::lock_guard<std::mutex> lock(worldMutex_);
+			world_->QueryAABB(&callback, aabb);
+		}
+
+		// writes user data of bodies overlapping the box into results, returns number written
+		int queryAABB(glm::vec2 lower, glm::vec2 upper, uintptr_t* results, int maxResults) const;
+
+		// finds the closest body on the segment from p1 to p2 for which accept(userData) returns true
+		template <typename F>
+		bool raycast(glm::vec2 p1, glm::vec2 p2, RAYCASTHIT& hit, F accept) const {
+			class Callback : public b2RayCastCallback {
+			public:
+				Callback(F& accept, RAYCASTHIT& hit) : accept_(accept), hit_(hit) {}
+				float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override {
+					uintptr_t userData = getUserData(fixture->GetBody());
+					// -1 ignores this fixture, returning fraction clips the ray so only closer hits follow
+					if (!accept_(userData))
+						return -1.0f;
+					hit_ = { fraction, { point.x, point.y }, { normal.x, normal.y }, userData };
+					found = true;
+					return fraction;
+				}
+
+				bool found{ false };
+
+			private:
+				F& accept_;
+				RAYCASTHIT& hit_;
+			} callback(accept, hit);
+			hit = RAYCASTHIT{};
+			if (p1 == p2)
+				return false;
+			std::lock_guard<std::mutex> lock(worldMutex_);
+			world_->RayCast(&callback, { p1.x, p1.y }, { p2.x, p2.y });
+			return callback.found;
+		}
+
+		// finds the closest body on the segment from p1 to p2
+		bool raycast(glm::vec2 p1, glm::vec2 p2, RAYCASTHIT& hit) const {
+			return raycast(p1, p2, hit, [](uintptr_t) { return true; });
+		}
+
+		// casts count rays from p1[i] to p2[i] into hits[i], returns number of rays that hit
+		int raycasts(const glm::vec2* p1, const glm::vec2* p2, int count, RAYCASTHIT* hits) const;
 
 		PhysicsBody* getBody(int id, b2BodyType type = b2_dynamicBody) {
 			switch (type) {
@@ -91,11 +308,68 @@ namespace GameLib {
 
 
 	private:
+		// Box2D does not allow changing the world during Step(), so contacts are buffered
+		class ContactListener : public b2ContactListener {
+		public:
+			void BeginContact(b2Contact* contact) override { _push(contact, true); }
+			void EndContact(b2Contact* contact) override { _push(contact, false); }
+
+			std::vector<CONTACTEVENT> events;
+
+		private:
+			void _push(b2Contact* contact, bool begin) {
+				b2Fixture* fixtureA = contact->GetFixtureA();
+				b2Fixture* fixtureB = contact->GetFixtureB();
+				events.push_back({ getUserData(fixtureA->GetBody()),
+					getUserData(fixtureB->GetBody()),
+					begin,
+					fixtureA->IsSensor() || fixtureB->IsSensor() });
+			}
+		};
+
+		// body transforms for the static and dynamic body lists and the generations of the bodies they came from
+		struct SNAPSHOT {
+			std::vector<BODYSTATE> staticBodies;
+			std::vector<BODYSTATE> dynamicBodies;
+			std::vector<unsigned> staticGenerations;
+			std::vector<unsigned> dynamicGenerations;
+		};
+
+		void _threadMain();
+		void _queueCommand(int type, int id, b2BodyType bodyType, glm::vec2 value);
+		void _applyCommands();
+		void _publishSnapshot();
+
 		b2Vec2 gravity_{ 0.0f, 9.8f };
-		b2World world_{ gravity_ };
+		// rebuild() replaces the world
+		std::unique_ptr<b2World> world_;
+		ContactListener contactListener_;
+		// true once rebuilt, then update() collides again after each step
+		bool collideAfterStep_{ false };
+
+		// held while the world is stepped or changed so queries and new bodies are safe from the main thread
+		mutable std::mutex worldMutex_;
+		std::thread thread_;
+		std::atomic<bool> running_{ false };
+		float fixedStep_{ 1.0f / 120.0f };
+
+		std::mutex commandMutex_;
+		std::vector<BODYCOMMAND> commands_;
+		std::vector<BODYCOMMAND> pendingCommands_;
+
+		// triple buffer, the physics thread writes back while the main thread reads front
+		// and the newest complete snapshot waits in ready, NEW_SNAPSHOT marks it unread
+		static constexpr int NEW_SNAPSHOT = 4;
+		SNAPSHOT snapshots_[3];
+		int backIndex_{ 0 };
+		int frontIndex_{ 1 };
+		std::atomic<int> readyIndex_{ 2 };
 
 		std::vector<StaticBody> staticBodies;
 		std::vector<DynamicBody> dynamicBodies;
+		// indices of destroyed bodies
+		std::vector<int> freeStaticBodies_;
+		std::vector<int> freeDynamicBodies_;
 	};
 } // namespace GameLib
 
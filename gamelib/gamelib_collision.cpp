@@ -0,0 +1,586 @@
+#include "pch.h"
+#include <gamelib_collision.hpp>
+#include <bitset>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GAMELIB_COLLISION_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GAMELIB_COLLISION_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define GAMELIB_COLLISION_NEON
+#endif
+
+namespace GameLib {
+	namespace {
+		constexpr float inf = std::numeric_limits<float>::infinity();
+
+		inline int countBits(uint32_t bits) { return (int)std::bitset<32>(bits).count(); }
+
+		inline void setHit(uint32_t* hitMask, size_t i) { hitMask[i >> 5] |= 1u << (i & 31); }
+
+		// scalar loop used for the fallback and for the tail of the SIMD loops
+		// bit i of hitMask is box first + i
+		int overlapTail(size_t i,
+			size_t first,
+			size_t last,
+			glm::vec2 amin,
+			glm::vec2 amax,
+			const AABBArray& boxes,
+			uint32_t* hitMask) {
+			int hits = 0;
+			for (; i < last - first; i++) {
+				glm::vec2 bmin{ boxes.minX[first + i], boxes.minY[first + i] };
+				glm::vec2 bmax{ boxes.maxX[first + i], boxes.maxY[first + i] };
+				if (overlapAABB(amin, amax, bmin, bmax)) {
+					setHit(hitMask, i);
+					hits++;
+				}
+			}
+			return hits;
+		}
+
+		// scalar loop used for the fallback and for the tail of the SIMD loops
+		int contactTail(size_t i,
+			glm::vec2 amin,
+			glm::vec2 amax,
+			const AABBArray& boxes,
+			uint32_t* hitMask,
+			float* distance,
+			float* normalX,
+			float* normalY) {
+			int hits = 0;
+			CONTACTINFO contact;
+			for (; i < boxes.size(); i++) {
+				glm::vec2 bmin{ boxes.minX[i], boxes.minY[i] };
+				glm::vec2 bmax{ boxes.maxX[i], boxes.maxY[i] };
+				if (contactAABB(amin, amax, bmin, bmax, contact)) {
+					setHit(hitMask, i);
+					hits++;
+				}
+				distance[i] = contact.distance;
+				normalX[i] = contact.normal.x;
+				normalY[i] = contact.normal.y;
+			}
+			return hits;
+		}
+
+		// fills one axis of the contact points, faces are used if this axis separates the boxes or is the normal
+		// otherwise both points sit in the middle of the shared interval
+		void contactAxis(float amin, float amax, float bmin, float bmax, float dir, bool face, float& pa, float& pb) {
+			if (face) {
+				pa = dir > 0.0f ? amax : amin;
+				pb = dir > 0.0f ? bmin : bmax;
+			} else {
+				pa = pb = (std::max(amin, bmin) + std::min(amax, bmax)) * 0.5f;
+			}
+		}
+
+		// scalar loop used for the fallback and for the tail of the SIMD loops
+		int sweptTail(size_t i,
+			glm::vec2 p,
+			glm::vec2 s,
+			glm::vec2 v,
+			const AABBArray& boxes,
+			uint32_t* hitMask,
+			float* entryTime) {
+			int hits = 0;
+			for (; i < boxes.size(); i++) {
+				glm::vec2 bmin{ boxes.minX[i], boxes.minY[i] };
+				glm::vec2 bmax{ boxes.maxX[i], boxes.maxY[i] };
+				bool hit;
+				entryTime[i] = sweptAABB(p, s, v, bmin, bmax, hit);
+				if (hit) {
+					setHit(hitMask, i);
+					hits++;
+				}
+			}
+			return hits;
+		}
+	} // namespace
+
+
+	const char* collisionKernelName() {
+#if defined(GAMELIB_COLLISION_AVX2)
+		return "AVX2";
+#elif defined(GAMELIB_COLLISION_SSE2)
+		return "SSE2";
+#elif defined(GAMELIB_COLLISION_NEON)
+		return "NEON";
+#else
+		return "scalar";
+#endif
+	}
+
+
+	float distanceAABB(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax) {
+		glm::vec2 c = (bmin + bmax) * 0.5f;
+		glm::vec2 q = glm::abs(p - c) - (bmax - bmin) * 0.5f;
+		return glm::length(glm::max(q, 0.0f)) + std::min(std::max(q.x, q.y), 0.0f);
+	}
+
+
+	glm::vec2 normalAABB(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax) {
+		glm::vec2 d = p - (bmin + bmax) * 0.5f;
+		glm::vec2 q = glm::abs(d) - (bmax - bmin) * 0.5f;
+		glm::vec2 s{ d.x >= 0.0f ? 1.0f : -1.0f, d.y >= 0.0f ? 1.0f : -1.0f };
+		if (q.x > 0.0f || q.y > 0.0f) {
+			// outside, points away from the nearest face or corner
+			return glm::normalize(glm::max(q, 0.0f) * s);
+		}
+		// inside, the nearest face is the one with the least penetration
+		if (q.x > q.y)
+			return { s.x, 0.0f };
+		return { 0.0f, s.y };
+	}
+
+
+	glm::vec2 supportAABB(glm::vec2 p, glm::vec2 q, glm::vec2 bmin, glm::vec2 bmax) {
+		if (overlapAABB(p, p, bmin, bmax))
+			return p;
+		glm::vec2 d = q - p;
+		float enter = 0.0f;
+		float leave = 1.0f;
+		for (int axis = 0; axis < 2; axis++) {
+			if (d[axis] == 0.0f) {
+				if (p[axis] < bmin[axis] || p[axis] > bmax[axis])
+					return q;
+				continue;
+			}
+			float t1 = (bmin[axis] - p[axis]) / d[axis];
+			float t2 = (bmax[axis] - p[axis]) / d[axis];
+			enter = std::max(enter, std::min(t1, t2));
+			leave = std::min(leave, std::max(t1, t2));
+		}
+		if (enter > leave)
+			return q;
+		return p + d * enter;
+	}
+
+
+	bool contactAABB(glm::vec2 amin, glm::vec2 amax, glm::vec2 bmin, glm::vec2 bmax, CONTACTINFO& contact) {
+		// gap is positive along an axis that separates the boxes
+		glm::vec2 gap{ std::max(bmin.x - amax.x, amin.x - bmax.x), std::max(bmin.y - amax.y, amin.y - bmax.y) };
+		glm::vec2 dir{ (bmin.x + bmax.x) - (amin.x + amax.x) >= 0.0f ? 1.0f : -1.0f,
+					   (bmin.y + bmax.y) - (amin.y + amax.y) >= 0.0f ? 1.0f : -1.0f };
+		bool overlap = gap.x <= 0.0f && gap.y <= 0.0f;
+		bool faceX;
+		bool faceY;
+		if (overlap) {
+			// push out along the axis of least penetration
+			faceX = gap.x > gap.y;
+			faceY = !faceX;
+			contact.distance = std::max(gap.x, gap.y);
+			contact.normal = { faceX ? dir.x : 0.0f, faceY ? dir.y : 0.0f };
+		} else {
+			glm::vec2 sep = glm::max(gap, 0.0f);
+			faceX = gap.x > 0.0f;
+			faceY = gap.y > 0.0f;
+			contact.distance = std::sqrt(sep.x * sep.x + sep.y * sep.y);
+			contact.normal = { sep.x * dir.x / contact.distance, sep.y * dir.y / contact.distance };
+		}
+		contactAxis(amin.x, amax.x, bmin.x, bmax.x, dir.x, faceX, contact.pointA.x, contact.pointB.x);
+		contactAxis(amin.y, amax.y, bmin.y, bmax.y, dir.y, faceY, contact.pointA.y, contact.pointB.y);
+		return overlap;
+	}
+
+
+	float sweptAABB(glm::vec2 p, glm::vec2 s, glm::vec2 v, glm::vec2 bmin, glm::vec2 bmax, bool& hit) {
+		glm::vec2 normal;
+		return sweptAABB(p, s, v, bmin, bmax, normal, hit);
+	}
+
+
+	float sweptAABB(glm::vec2 p, glm::vec2 s, glm::vec2 v, glm::vec2 bmin, glm::vec2 bmax, glm::vec2& normal, bool& hit) {
+		glm::vec2 ap1 = p;
+		glm::vec2 ap2 = p + s;
+		// distance to cover before the boxes meet on each axis
+		glm::vec2 gap{ v.x > 0.0f ? bmin.x - ap2.x : bmax.x - ap1.x, v.y > 0.0f ? bmin.y - ap2.y : bmax.y - ap1.y };
+
+		float enterX = -inf;
+		float leaveX = inf;
+		if (v.x != 0.0f) {
+			enterX = gap.x / v.x;
+			leaveX = (v.x > 0.0f ? bmax.x - ap1.x : bmin.x - ap2.x) / v.x;
+		}
+
+		float enterY = -inf;
+		float leaveY = inf;
+		if (v.y != 0.0f) {
+			enterY = gap.y / v.y;
+			leaveY = (v.y > 0.0f ? bmax.y - ap1.y : bmin.y - ap2.y) / v.y;
+		}
+
+		float enterTime = std::max(enterX, enterY);
+		float leaveTime = std::min(leaveX, leaveY);
+		bool miss = enterTime > leaveTime;
+		miss |= enterX < 0.0f && enterY < 0.0f;
+		miss |= enterX < 0.0f && (ap2.x < bmin.x || ap1.x > bmax.x);
+		miss |= enterY < 0.0f && (ap2.y < bmin.y || ap1.y > bmax.y);
+		hit = !miss;
+		normal = { 0.0f, 0.0f };
+		if (!hit)
+			return 1.0f;
+		// the face is on the axis entered last
+		if (enterX > enterY)
+			normal.x = gap.x < 0.0f ? 1.0f : -1.0f;
+		else
+			normal.y = gap.y < 0.0f ? 1.0f : -1.0f;
+		return enterTime;
+	}
+
+
+	int broadPhaseAABBs(glm::vec2 p, glm::vec2 s, glm::vec2 v, const AABBArray& boxes, uint32_t* hitMask) {
+		glm::vec2 amin{ v.x > 0 ? p.x : p.x + v.x, v.y > 0 ? p.y : p.y + v.y };
+		glm::vec2 amax = amin + glm::abs(v) + s;
+		return overlapAABBs(amin, amax, boxes, hitMask);
+	}
+
+
+	int overlapAABBs(glm::vec2 amin, glm::vec2 amax, const AABBArray& boxes, uint32_t* hitMask) {
+		return overlapAABBs(amin, amax, boxes, 0, boxes.size(), hitMask);
+	}
+
+
+	int overlapAABBs(glm::vec2 amin, glm::vec2 amax, const AABBArray& boxes, size_t first, size_t last, uint32_t* hitMask) {
+		const size_t n = last - first;
+		std::memset(hitMask, 0, ((n + 31) >> 5) * sizeof(uint32_t));
+		int hits = 0;
+		size_t i = 0;
+#if defined(GAMELIB_COLLISION_AVX2)
+		const __m256 aminX = _mm256_set1_ps(amin.x);
+		const __m256 aminY = _mm256_set1_ps(amin.y);
+		const __m256 amaxX = _mm256_set1_ps(amax.x);
+		const __m256 amaxY = _mm256_set1_ps(amax.y);
+		for (; i + 8 <= n; i += 8) {
+			__m256 bminX = _mm256_loadu_ps(&boxes.minX[first + i]);
+			__m256 bminY = _mm256_loadu_ps(&boxes.minY[first + i]);
+			__m256 bmaxX = _mm256_loadu_ps(&boxes.maxX[first + i]);
+			__m256 bmaxY = _mm256_loadu_ps(&boxes.maxY[first + i]);
+			__m256 x = _mm256_and_ps(_mm256_cmp_ps(aminX, bmaxX, _CMP_LE_OQ), _mm256_cmp_ps(amaxX, bminX, _CMP_GE_OQ));
+			__m256 y = _mm256_and_ps(_mm256_cmp_ps(aminY, bmaxY, _CMP_LE_OQ), _mm256_cmp_ps(amaxY, bminY, _CMP_GE_OQ));
+			uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_and_ps(x, y));
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_SSE2)
+		const __m128 aminX = _mm_set1_ps(amin.x);
+		const __m128 aminY = _mm_set1_ps(amin.y);
+		const __m128 amaxX = _mm_set1_ps(amax.x);
+		const __m128 amaxY = _mm_set1_ps(amax.y);
+		for (; i + 4 <= n; i += 4) {
+			__m128 bminX = _mm_loadu_ps(&boxes.minX[first + i]);
+			__m128 bminY = _mm_loadu_ps(&boxes.minY[first + i]);
+			__m128 bmaxX = _mm_loadu_ps(&boxes.maxX[first + i]);
+			__m128 bmaxY = _mm_loadu_ps(&boxes.maxY[first + i]);
+			__m128 x = _mm_and_ps(_mm_cmple_ps(aminX, bmaxX), _mm_cmpge_ps(amaxX, bminX));
+			__m128 y = _mm_and_ps(_mm_cmple_ps(aminY, bmaxY), _mm_cmpge_ps(amaxY, bminY));
+			uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_and_ps(x, y));
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_NEON)
+		const float32x4_t aminX = vdupq_n_f32(amin.x);
+		const float32x4_t aminY = vdupq_n_f32(amin.y);
+		const float32x4_t amaxX = vdupq_n_f32(amax.x);
+		const float32x4_t amaxY = vdupq_n_f32(amax.y);
+		const uint32x4_t laneBits = { 1, 2, 4, 8 };
+		for (; i + 4 <= n; i += 4) {
+			float32x4_t bminX = vld1q_f32(&boxes.minX[first + i]);
+			float32x4_t bminY = vld1q_f32(&boxes.minY[first + i]);
+			float32x4_t bmaxX = vld1q_f32(&boxes.maxX[first + i]);
+			float32x4_t bmaxY = vld1q_f32(&boxes.maxY[first + i]);
+			uint32x4_t x = vandq_u32(vcleq_f32(aminX, bmaxX), vcgeq_f32(amaxX, bminX));
+			uint32x4_t y = vandq_u32(vcleq_f32(aminY, bmaxY), vcgeq_f32(amaxY, bminY));
+			uint32_t bits = vaddvq_u32(vandq_u32(vandq_u32(x, y), laneBits));
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#endif
+		return hits + overlapTail(i, first, last, amin, amax, boxes, hitMask);
+	}
+
+
+	int sweptAABBs(glm::vec2 p, glm::vec2 s, glm::vec2 v, const AABBArray& boxes, uint32_t* hitMask, float* entryTime) {
+		const size_t n = boxes.size();
+		std::memset(hitMask, 0, boxes.maskWords() * sizeof(uint32_t));
+		int hits = 0;
+		size_t i = 0;
+		// the sign of the velocity is the same for every lane, so the axis setup is chosen once
+		const bool movingX = v.x != 0.0f;
+		const bool movingY = v.y != 0.0f;
+		const bool positiveX = v.x > 0.0f;
+		const bool positiveY = v.y > 0.0f;
+#if defined(GAMELIB_COLLISION_AVX2)
+		const __m256 ap1X = _mm256_set1_ps(p.x);
+		const __m256 ap1Y = _mm256_set1_ps(p.y);
+		const __m256 ap2X = _mm256_set1_ps(p.x + s.x);
+		const __m256 ap2Y = _mm256_set1_ps(p.y + s.y);
+		const __m256 vX = _mm256_set1_ps(v.x);
+		const __m256 vY = _mm256_set1_ps(v.y);
+		const __m256 negInf = _mm256_set1_ps(-inf);
+		const __m256 posInf = _mm256_set1_ps(inf);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		for (; i + 8 <= n; i += 8) {
+			__m256 bminX = _mm256_loadu_ps(&boxes.minX[i]);
+			__m256 bminY = _mm256_loadu_ps(&boxes.minY[i]);
+			__m256 bmaxX = _mm256_loadu_ps(&boxes.maxX[i]);
+			__m256 bmaxY = _mm256_loadu_ps(&boxes.maxY[i]);
+			__m256 enterX = negInf;
+			__m256 leaveX = posInf;
+			if (movingX) {
+				enterX = _mm256_div_ps(positiveX ? _mm256_sub_ps(bminX, ap2X) : _mm256_sub_ps(bmaxX, ap1X), vX);
+				leaveX = _mm256_div_ps(positiveX ? _mm256_sub_ps(bmaxX, ap1X) : _mm256_sub_ps(bminX, ap2X), vX);
+			}
+			__m256 enterY = negInf;
+			__m256 leaveY = posInf;
+			if (movingY) {
+				enterY = _mm256_div_ps(positiveY ? _mm256_sub_ps(bminY, ap2Y) : _mm256_sub_ps(bmaxY, ap1Y), vY);
+				leaveY = _mm256_div_ps(positiveY ? _mm256_sub_ps(bmaxY, ap1Y) : _mm256_sub_ps(bminY, ap2Y), vY);
+			}
+			__m256 enterTime = _mm256_max_ps(enterX, enterY);
+			__m256 leaveTime = _mm256_min_ps(leaveX, leaveY);
+			__m256 behindX = _mm256_cmp_ps(enterX, zero, _CMP_LT_OQ);
+			__m256 behindY = _mm256_cmp_ps(enterY, zero, _CMP_LT_OQ);
+			__m256 apartX = _mm256_or_ps(_mm256_cmp_ps(ap2X, bminX, _CMP_LT_OQ), _mm256_cmp_ps(ap1X, bmaxX, _CMP_GT_OQ));
+			__m256 apartY = _mm256_or_ps(_mm256_cmp_ps(ap2Y, bminY, _CMP_LT_OQ), _mm256_cmp_ps(ap1Y, bmaxY, _CMP_GT_OQ));
+			__m256 miss = _mm256_cmp_ps(enterTime, leaveTime, _CMP_GT_OQ);
+			miss = _mm256_or_ps(miss, _mm256_and_ps(behindX, behindY));
+			miss = _mm256_or_ps(miss, _mm256_and_ps(behindX, apartX));
+			miss = _mm256_or_ps(miss, _mm256_and_ps(behindY, apartY));
+			_mm256_storeu_ps(entryTime + i, _mm256_blendv_ps(enterTime, one, miss));
+			uint32_t bits = ~(uint32_t)_mm256_movemask_ps(miss) & 0xFF;
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_SSE2)
+		const __m128 ap1X = _mm_set1_ps(p.x);
+		const __m128 ap1Y = _mm_set1_ps(p.y);
+		const __m128 ap2X = _mm_set1_ps(p.x + s.x);
+		const __m128 ap2Y = _mm_set1_ps(p.y + s.y);
+		const __m128 vX = _mm_set1_ps(v.x);
+		const __m128 vY = _mm_set1_ps(v.y);
+		const __m128 negInf = _mm_set1_ps(-inf);
+		const __m128 posInf = _mm_set1_ps(inf);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= n; i += 4) {
+			__m128 bminX = _mm_loadu_ps(&boxes.minX[i]);
+			__m128 bminY = _mm_loadu_ps(&boxes.minY[i]);
+			__m128 bmaxX = _mm_loadu_ps(&boxes.maxX[i]);
+			__m128 bmaxY = _mm_loadu_ps(&boxes.maxY[i]);
+			__m128 enterX = negInf;
+			__m128 leaveX = posInf;
+			if (movingX) {
+				enterX = _mm_div_ps(positiveX ? _mm_sub_ps(bminX, ap2X) : _mm_sub_ps(bmaxX, ap1X), vX);
+				leaveX = _mm_div_ps(positiveX ? _mm_sub_ps(bmaxX, ap1X) : _mm_sub_ps(bminX, ap2X), vX);
+			}
+			__m128 enterY = negInf;
+			__m128 leaveY = posInf;
+			if (movingY) {
+				enterY = _mm_div_ps(positiveY ? _mm_sub_ps(bminY, ap2Y) : _mm_sub_ps(bmaxY, ap1Y), vY);
+				leaveY = _mm_div_ps(positiveY ? _mm_sub_ps(bmaxY, ap1Y) : _mm_sub_ps(bminY, ap2Y), vY);
+			}
+			__m128 enterTime = _mm_max_ps(enterX, enterY);
+			__m128 leaveTime = _mm_min_ps(leaveX, leaveY);
+			__m128 behindX = _mm_cmplt_ps(enterX, zero);
+			__m128 behindY = _mm_cmplt_ps(enterY, zero);
+			__m128 apartX = _mm_or_ps(_mm_cmplt_ps(ap2X, bminX), _mm_cmpgt_ps(ap1X, bmaxX));
+			__m128 apartY = _mm_or_ps(_mm_cmplt_ps(ap2Y, bminY), _mm_cmpgt_ps(ap1Y, bmaxY));
+			__m128 miss = _mm_cmpgt_ps(enterTime, leaveTime);
+			miss = _mm_or_ps(miss, _mm_and_ps(behindX, behindY));
+			miss = _mm_or_ps(miss, _mm_and_ps(behindX, apartX));
+			miss = _mm_or_ps(miss, _mm_and_ps(behindY, apartY));
+			_mm_storeu_ps(entryTime + i, _mm_or_ps(_mm_and_ps(miss, one), _mm_andnot_ps(miss, enterTime)));
+			uint32_t bits = ~(uint32_t)_mm_movemask_ps(miss) & 0xF;
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_NEON)
+		const float32x4_t ap1X = vdupq_n_f32(p.x);
+		const float32x4_t ap1Y = vdupq_n_f32(p.y);
+		const float32x4_t ap2X = vdupq_n_f32(p.x + s.x);
+		const float32x4_t ap2Y = vdupq_n_f32(p.y + s.y);
+		const float32x4_t vX = vdupq_n_f32(v.x);
+		const float32x4_t vY = vdupq_n_f32(v.y);
+		const float32x4_t negInf = vdupq_n_f32(-inf);
+		const float32x4_t posInf = vdupq_n_f32(inf);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const uint32x4_t laneBits = { 1, 2, 4, 8 };
+		for (; i + 4 <= n; i += 4) {
+			float32x4_t bminX = vld1q_f32(&boxes.minX[i]);
+			float32x4_t bminY = vld1q_f32(&boxes.minY[i]);
+			float32x4_t bmaxX = vld1q_f32(&boxes.maxX[i]);
+			float32x4_t bmaxY = vld1q_f32(&boxes.maxY[i]);
+			float32x4_t enterX = negInf;
+			float32x4_t leaveX = posInf;
+			if (movingX) {
+				enterX = vdivq_f32(positiveX ? vsubq_f32(bminX, ap2X) : vsubq_f32(bmaxX, ap1X), vX);
+				leaveX = vdivq_f32(positiveX ? vsubq_f32(bmaxX, ap1X) : vsubq_f32(bminX, ap2X), vX);
+			}
+			float32x4_t enterY = negInf;
+			float32x4_t leaveY = posInf;
+			if (movingY) {
+				enterY = vdivq_f32(positiveY ? vsubq_f32(bminY, ap2Y) : vsubq_f32(bmaxY, ap1Y), vY);
+				leaveY = vdivq_f32(positiveY ? vsubq_f32(bmaxY, ap1Y) : vsubq_f32(bminY, ap2Y), vY);
+			}
+			float32x4_t enterTime = vmaxq_f32(enterX, enterY);
+			float32x4_t leaveTime = vminq_f32(leaveX, leaveY);
+			uint32x4_t behindX = vcltq_f32(enterX, zero);
+			uint32x4_t behindY = vcltq_f32(enterY, zero);
+			uint32x4_t apartX = vorrq_u32(vcltq_f32(ap2X, bminX), vcgtq_f32(ap1X, bmaxX));
+			uint32x4_t apartY = vorrq_u32(vcltq_f32(ap2Y, bminY), vcgtq_f32(ap1Y, bmaxY));
+			uint32x4_t miss = vcgtq_f32(enterTime, leaveTime);
+			miss = vorrq_u32(miss, vandq_u32(behindX, behindY));
+			miss = vorrq_u32(miss, vandq_u32(behindX, apartX));
+			miss = vorrq_u32(miss, vandq_u32(behindY, apartY));
+			vst1q_f32(entryTime + i, vbslq_f32(miss, one, enterTime));
+			uint32_t bits = vaddvq_u32(vandq_u32(vmvnq_u32(miss), laneBits));
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#endif
+		return hits + sweptTail(i, p, s, v, boxes, hitMask, entryTime);
+	}
+
+
+	int contactAABBs(glm::vec2 amin,
+		glm::vec2 amax,
+		const AABBArray& boxes,
+		uint32_t* hitMask,
+		float* distance,
+		float* normalX,
+		float* normalY) {
+		const size_t n = boxes.size();
+		std::memset(hitMask, 0, boxes.maskWords() * sizeof(uint32_t));
+		int hits = 0;
+		size_t i = 0;
+		const float acX = amin.x + amax.x;
+		const float acY = amin.y + amax.y;
+#if defined(GAMELIB_COLLISION_AVX2)
+		const __m256 aminX = _mm256_set1_ps(amin.x);
+		const __m256 aminY = _mm256_set1_ps(amin.y);
+		const __m256 amaxX = _mm256_set1_ps(amax.x);
+		const __m256 amaxY = _mm256_set1_ps(amax.y);
+		const __m256 centerX = _mm256_set1_ps(acX);
+		const __m256 centerY = _mm256_set1_ps(acY);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 minusOne = _mm256_set1_ps(-1.0f);
+		for (; i + 8 <= n; i += 8) {
+			__m256 bminX = _mm256_loadu_ps(&boxes.minX[i]);
+			__m256 bminY = _mm256_loadu_ps(&boxes.minY[i]);
+			__m256 bmaxX = _mm256_loadu_ps(&boxes.maxX[i]);
+			__m256 bmaxY = _mm256_loadu_ps(&boxes.maxY[i]);
+			__m256 gapX = _mm256_max_ps(_mm256_sub_ps(bminX, amaxX), _mm256_sub_ps(aminX, bmaxX));
+			__m256 gapY = _mm256_max_ps(_mm256_sub_ps(bminY, amaxY), _mm256_sub_ps(aminY, bmaxY));
+			__m256 dirX = _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(_mm256_sub_ps(_mm256_add_ps(bminX, bmaxX), centerX), zero, _CMP_GE_OQ));
+			__m256 dirY = _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(_mm256_sub_ps(_mm256_add_ps(bminY, bmaxY), centerY), zero, _CMP_GE_OQ));
+			__m256 overlap = _mm256_and_ps(_mm256_cmp_ps(gapX, zero, _CMP_LE_OQ), _mm256_cmp_ps(gapY, zero, _CMP_LE_OQ));
+			// overlapping lanes push out along the axis of least penetration
+			__m256 faceX = _mm256_cmp_ps(gapX, gapY, _CMP_GT_OQ);
+			__m256 depth = _mm256_max_ps(gapX, gapY);
+			__m256 pushX = _mm256_and_ps(faceX, dirX);
+			__m256 pushY = _mm256_andnot_ps(faceX, dirY);
+			// separated lanes use the distance between the nearest features
+			__m256 sepX = _mm256_max_ps(gapX, zero);
+			__m256 sepY = _mm256_max_ps(gapY, zero);
+			__m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(sepX, sepX), _mm256_mul_ps(sepY, sepY)));
+			__m256 awayX = _mm256_div_ps(_mm256_mul_ps(sepX, dirX), length);
+			__m256 awayY = _mm256_div_ps(_mm256_mul_ps(sepY, dirY), length);
+			_mm256_storeu_ps(distance + i, _mm256_blendv_ps(length, depth, overlap));
+			_mm256_storeu_ps(normalX + i, _mm256_blendv_ps(awayX, pushX, overlap));
+			_mm256_storeu_ps(normalY + i, _mm256_blendv_ps(awayY, pushY, overlap));
+			uint32_t bits = (uint32_t)_mm256_movemask_ps(overlap);
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_SSE2)
+		const __m128 aminX = _mm_set1_ps(amin.x);
+		const __m128 aminY = _mm_set1_ps(amin.y);
+		const __m128 amaxX = _mm_set1_ps(amax.x);
+		const __m128 amaxY = _mm_set1_ps(amax.y);
+		const __m128 centerX = _mm_set1_ps(acX);
+		const __m128 centerY = _mm_set1_ps(acY);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		for (; i + 4 <= n; i += 4) {
+			__m128 bminX = _mm_loadu_ps(&boxes.minX[i]);
+			__m128 bminY = _mm_loadu_ps(&boxes.minY[i]);
+			__m128 bmaxX = _mm_loadu_ps(&boxes.maxX[i]);
+			__m128 bmaxY = _mm_loadu_ps(&boxes.maxY[i]);
+			__m128 gapX = _mm_max_ps(_mm_sub_ps(bminX, amaxX), _mm_sub_ps(aminX, bmaxX));
+			__m128 gapY = _mm_max_ps(_mm_sub_ps(bminY, amaxY), _mm_sub_ps(aminY, bmaxY));
+			__m128 positiveX = _mm_cmpge_ps(_mm_sub_ps(_mm_add_ps(bminX, bmaxX), centerX), zero);
+			__m128 positiveY = _mm_cmpge_ps(_mm_sub_ps(_mm_add_ps(bminY, bmaxY), centerY), zero);
+			__m128 dirX = _mm_or_ps(_mm_and_ps(positiveX, one), _mm_andnot_ps(positiveX, minusOne));
+			__m128 dirY = _mm_or_ps(_mm_and_ps(positiveY, one), _mm_andnot_ps(positiveY, minusOne));
+			__m128 overlap = _mm_and_ps(_mm_cmple_ps(gapX, zero), _mm_cmple_ps(gapY, zero));
+			// overlapping lanes push out along the axis of least penetration
+			__m128 faceX = _mm_cmpgt_ps(gapX, gapY);
+			__m128 depth = _mm_max_ps(gapX, gapY);
+			__m128 pushX = _mm_and_ps(faceX, dirX);
+			__m128 pushY = _mm_andnot_ps(faceX, dirY);
+			// separated lanes use the distance between the nearest features
+			__m128 sepX = _mm_max_ps(gapX, zero);
+			__m128 sepY = _mm_max_ps(gapY, zero);
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(sepX, sepX), _mm_mul_ps(sepY, sepY)));
+			__m128 awayX = _mm_div_ps(_mm_mul_ps(sepX, dirX), length);
+			__m128 awayY = _mm_div_ps(_mm_mul_ps(sepY, dirY), length);
+			_mm_storeu_ps(distance + i, _mm_or_ps(_mm_and_ps(overlap, depth), _mm_andnot_ps(overlap, length)));
+			_mm_storeu_ps(normalX + i, _mm_or_ps(_mm_and_ps(overlap, pushX), _mm_andnot_ps(overlap, awayX)));
+			_mm_storeu_ps(normalY + i, _mm_or_ps(_mm_and_ps(overlap, pushY), _mm_andnot_ps(overlap, awayY)));
+			uint32_t bits = (uint32_t)_mm_movemask_ps(overlap);
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#elif defined(GAMELIB_COLLISION_NEON)
+		const float32x4_t aminX = vdupq_n_f32(amin.x);
+		const float32x4_t aminY = vdupq_n_f32(amin.y);
+		const float32x4_t amaxX = vdupq_n_f32(amax.x);
+		const float32x4_t amaxY = vdupq_n_f32(amax.y);
+		const float32x4_t centerX = vdupq_n_f32(acX);
+		const float32x4_t centerY = vdupq_n_f32(acY);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t minusOne = vdupq_n_f32(-1.0f);
+		const uint32x4_t laneBits = { 1, 2, 4, 8 };
+		for (; i + 4 <= n; i += 4) {
+			float32x4_t bminX = vld1q_f32(&boxes.minX[i]);
+			float32x4_t bminY = vld1q_f32(&boxes.minY[i]);
+			float32x4_t bmaxX = vld1q_f32(&boxes.maxX[i]);
+			float32x4_t bmaxY = vld1q_f32(&boxes.maxY[i]);
+			float32x4_t gapX = vmaxq_f32(vsubq_f32(bminX, amaxX), vsubq_f32(aminX, bmaxX));
+			float32x4_t gapY = vmaxq_f32(vsubq_f32(bminY, amaxY), vsubq_f32(aminY, bmaxY));
+			float32x4_t dirX = vbslq_f32(vcgeq_f32(vsubq_f32(vaddq_f32(bminX, bmaxX), centerX), zero), one, minusOne);
+			float32x4_t dirY = vbslq_f32(vcgeq_f32(vsubq_f32(vaddq_f32(bminY, bmaxY), centerY), zero), one, minusOne);
+			uint32x4_t overlap = vandq_u32(vcleq_f32(gapX, zero), vcleq_f32(gapY, zero));
+			// overlapping lanes push out along the axis of least penetration
+			uint32x4_t faceX = vcgtq_f32(gapX, gapY);
+			float32x4_t depth = vmaxq_f32(gapX, gapY);
+			float32x4_t pushX = vbslq_f32(faceX, dirX, zero);
+			float32x4_t pushY = vbslq_f32(faceX, zero, dirY);
+			// separated lanes use the distance between the nearest features
+			float32x4_t sepX = vmaxq_f32(gapX, zero);
+			float32x4_t sepY = vmaxq_f32(gapY, zero);
+			float32x4_t length = vsqrtq_f32(vaddq_f32(vmulq_f32(sepX, sepX), vmulq_f32(sepY, sepY)));
+			float32x4_t awayX = vdivq_f32(vmulq_f32(sepX, dirX), length);
+			float32x4_t awayY = vdivq_f32(vmulq_f32(sepY, dirY), length);
+			vst1q_f32(distance + i, vbslq_f32(overlap, depth, length));
+			vst1q_f32(normalX + i, vbslq_f32(overlap, pushX, awayX));
+			vst1q_f32(normalY + i, vbslq_f32(overlap, pushY, awayY));
+			uint32_t bits = vaddvq_u32(vandq_u32(overlap, laneBits));
+			hitMask[i >> 5] |= bits << (i & 31);
+			hits += countBits(bits);
+		}
+#endif
+		return hits + contactTail(i, amin, amax, boxes, hitMask, distance, normalX, normalY);
+	}
+} // namespace GameLib
@@ -0,0 +1,135 @@
+#ifndef GAMELIB_COLLISION_HPP
+#define GAMELIB_COLLISION_HPP
+
+#include <gamelib_base.hpp>
+
+namespace GameLib {
+	// AABBArray is a packed structure of arrays of 2D boxes used for batched collision tests
+	struct AABBArray {
+		std::vector<float> minX;
+		std::vector<float> minY;
+		std::vector<float> maxX;
+		std::vector<float> maxY;
+
+		// returns number of boxes
+		size_t size() const { return minX.size(); }
+
+		// returns number of 32 bit words needed for a hit mask of this array
+		size_t maskWords() const { return (size() + 31) >> 5; }
+
+		void clear() {
+			minX.clear();
+			minY.clear();
+			maxX.clear();
+			maxY.clear();
+		}
+
+		void reserve(size_t count) {
+			minX.reserve(count);
+			minY.reserve(count);
+			maxX.reserve(count);
+			maxY.reserve(count);
+		}
+
+		void push_back(glm::vec2 bmin, glm::vec2 bmax) {
+			minX.push_back(bmin.x);
+			minY.push_back(bmin.y);
+			maxX.push_back(bmax.x);
+			maxY.push_back(bmax.y);
+		}
+	};
+
+	// returns true if bit i of a hit mask is set
+	inline bool testHit(const uint32_t* hitMask, size_t i) { return (hitMask[i >> 5] >> (i & 31)) & 1; }
+
+	// calls f(i) for every bit i set in a hit mask of count bits, skipping empty words
+	template <typename F>
+	void forEachHit(const uint32_t* hitMask, size_t count, F f) {
+		for (size_t w = 0; w < ((count + 31) >> 5); w++) {
+			size_t i = w << 5;
+			for (uint32_t bits = hitMask[w]; bits; bits >>= 1, i++) {
+				if (bits & 1)
+					f(i);
+			}
+		}
+	}
+
+	// returns true if box a overlaps box b, touching edges count as overlapping
+	inline bool overlapAABB(glm::vec2 amin, glm::vec2 amax, glm::vec2 bmin, glm::vec2 bmax) {
+		return amin.x <= bmax.x && amax.x >= bmin.x && amin.y <= bmax.y && amax.y >= bmin.y;
+	}
+
+	// returns the point of box b closest to p, or p itself if it is inside
+	inline glm::vec2 closestPointAABB(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax) { return glm::clamp(p, bmin, bmax); }
+
+	// returns signed distance from p to the surface of box b, negative inside
+	float distanceAABB(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax);
+
+	// returns the outward unit normal of the face of box b nearest to p
+	glm::vec2 normalAABB(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax);
+
+	// returns the first point of box b on the segment from p to q
+	// p is returned if it is inside, q is returned if the segment misses
+	glm::vec2 supportAABB(glm::vec2 p, glm::vec2 q, glm::vec2 bmin, glm::vec2 bmax);
+
+	// CONTACTINFO describes the closest features of two boxes
+	struct CONTACTINFO {
+		// separation between the boxes, negative is the penetration depth
+		float distance{ 0.0f };
+		// unit normal pointing from a to b, along the axis of least penetration when overlapping
+		glm::vec2 normal{ 0.0f, 0.0f };
+		// closest point on a
+		glm::vec2 pointA{ 0.0f, 0.0f };
+		// closest point on b
+		glm::vec2 pointB{ 0.0f, 0.0f };
+	};
+
+	// computes the contact between box a and box b, returns true if they overlap
+	bool contactAABB(glm::vec2 amin, glm::vec2 amax, glm::vec2 bmin, glm::vec2 bmax, CONTACTINFO& contact);
+
+	// sweeps box a at position p with size s along v against the box b
+	// returns the entry time, or 1 with hit set to false if there is no hit
+	float sweptAABB(glm::vec2 p, glm::vec2 s, glm::vec2 v, glm::vec2 bmin, glm::vec2 bmax, bool& hit);
+
+	// same as sweptAABB() and also sets normal to the face of b that was hit, zero if there is no hit
+	float sweptAABB(glm::vec2 p, glm::vec2 s, glm::vec2 v, glm::vec2 bmin, glm::vec2 bmax, glm::vec2& normal, bool& hit);
+
+	// returns true if the box at p with size s swept along v overlaps box b, matching broadPhaseAABBs() per box
+	inline bool broadPhaseAABB(glm::vec2 p, glm::vec2 s, glm::vec2 v, glm::vec2 bmin, glm::vec2 bmax) {
+		glm::vec2 amin{ v.x > 0 ? p.x : p.x + v.x, v.y > 0 ? p.y : p.y + v.y };
+		return overlapAABB(amin, amin + glm::abs(v) + s, bmin, bmax);
+	}
+
+	// tests box a against every box in boxes, sets bit i of hitMask if box i overlaps
+	// hitMask must hold boxes.maskWords() words, returns number of hits
+	int overlapAABBs(glm::vec2 amin, glm::vec2 amax, const AABBArray& boxes, uint32_t* hitMask);
+
+	// same as overlapAABBs() for the boxes from first up to last, bit i of hitMask is box first + i
+	// hitMask must hold (last - first + 31) / 32 words, returns number of hits
+	int overlapAABBs(glm::vec2 amin, glm::vec2 amax, const AABBArray& boxes, size_t first, size_t last, uint32_t* hitMask);
+
+	// tests the box swept from p along v against every box in boxes, sets bit i of hitMask if box i overlaps
+	// hitMask must hold boxes.maskWords() words, returns number of hits
+	int broadPhaseAABBs(glm::vec2 p, glm::vec2 s, glm::vec2 v, const AABBArray& boxes, uint32_t* hitMask);
+
+	// sweeps box at p with size s along v against every box in boxes, matching sweptAABB() per box
+	// sets bit i of hitMask and entryTime[i] for hits, entryTime[i] is 1 for misses
+	// hitMask must hold boxes.maskWords() words, entryTime must hold boxes.size() floats, returns number of hits
+	int sweptAABBs(glm::vec2 p, glm::vec2 s, glm::vec2 v, const AABBArray& boxes, uint32_t* hitMask, float* entryTime);
+
+	// computes the contact between box a and every box in boxes, matching contactAABB() per box
+	// sets bit i of hitMask if box i overlaps, distance, normalX and normalY must hold boxes.size() floats
+	// hitMask must hold boxes.maskWords() words, returns number of hits
+	int contactAABBs(glm::vec2 amin,
+		glm::vec2 amax,
+		const AABBArray& boxes,
+		uint32_t* hitMask,
+		float* distance,
+		float* normalX,
+		float* normalY);
+
+	// returns the name of the instruction set used by the batched kernels
+	const char* collisionKernelName();
+} // namespace GameLib
+
+#endif
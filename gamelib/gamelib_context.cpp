@@ -64,9 +64,7 @@ namespace GameLib {
             _setError("one or more subsystems not initialized");
         }
 
-        keyboard.scancodes.resize(SDL_NUM_SCANCODES);
-
-        _openGameControllers();
+        // controllers already plugged in are reported with SDL_CONTROLLERDEVICEADDED on the first getEvents()
 
         return true;
     }
@@ -119,8 +117,12 @@ namespace GameLib {
     }
 
     void Context::_kill() {
+        stopControllerSampling();
         _closeGameControllers();
         freeImages();
+        if (placeholder_)
+            SDL_DestroyTexture(placeholder_);
+        placeholder_ = nullptr;
         freeTilesets();
         freeAudioClips();
         freeMusicClips();
@@ -134,30 +136,67 @@ namespace GameLib {
     // GAME CONTROLLERS //////////////////////////////////////////////
     //////////////////////////////////////////////////////////////////
 
-    void Context::_openGameControllers() {
-        gameControllersConnected = std::min<int>(MaxGameControllers, SDL_NumJoysticks());
-
+    // controller axes and buttons tracked in GAMECONTROLLERSTATE
+    static const SDL_GameControllerAxis ControllerAxes[] = {
+        SDL_CONTROLLER_AXIS_LEFTX,
+        SDL_CONTROLLER_AXIS_LEFTY,
+        SDL_CONTROLLER_AXIS_RIGHTX,
+        SDL_CONTROLLER_AXIS_RIGHTY,
+    };
+    static const SDL_GameControllerButton ControllerButtons[] = {
+        SDL_CONTROLLER_BUTTON_A,
+        SDL_CONTROLLER_BUTTON_B,
+        SDL_CONTROLLER_BUTTON_X,
+        SDL_CONTROLLER_BUTTON_Y,
+        SDL_CONTROLLER_BUTTON_BACK,
+        SDL_CONTROLLER_BUTTON_START,
+    };
+    static constexpr int ControllerAxisCount = sizeof(ControllerAxes) / sizeof(ControllerAxes[0]);
+    static constexpr int ControllerButtonCount = sizeof(ControllerButtons) / sizeof(ControllerButtons[0]);
+
+    static float axisValue(Sint16 value) { return clamp<float>(value / 32767.0f, -1.0f, 1.0f); }
+
+    void Context::_addGameController(int deviceIndex) {
+        if (!SDL_IsGameController(deviceIndex))
+            return;
+        SDL_GameController* controller = SDL_GameControllerOpen(deviceIndex);
+        if (!controller)
+            return;
+        SDL_JoystickID instanceId = SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controller));
+        const char* name = SDL_GameControllerName(controller);
+        std::lock_guard<std::mutex> lock(controllerMutex_);
+        // SDL opens are reference counted, so a controller that is already open only needs closing again
+        if (_findGameController(instanceId) >= 0) {
+            SDL_GameControllerClose(controller);
+            return;
+        }
         for (int i = 0; i < MaxGameControllers; i++) {
             GAMECONTROLLERSTATE& j = gameControllers[i];
-            if (SDL_IsGameController(i)) {
-                // do not open controllers already opened
-                if (j.controller)
-                    continue;
-                j.controller = SDL_GameControllerOpen(i);
-                // reset this joystick if it wasn't opened
-                if (!j.controller) {
-                    j = GAMECONTROLLERSTATE();
-                } else {
-                    j.name = SDL_GameControllerNameForIndex(i);
-                    HFLOGINFO("Joystick %i '%s' connected", i, j.name.c_str());
-                }
-                j.enabled = j.controller != nullptr;
-            } else if (j.enabled) {
-                HFLOGINFO("Joystick %i '%s' disconnected", i, j.name.c_str());
-                SDL_GameControllerClose(j.controller);
-                j = GAMECONTROLLERSTATE();
-            }
+            if (j.controller)
+                continue;
+            j = GAMECONTROLLERSTATE();
+            j.controller = controller;
+            j.instanceId = instanceId;
+            j.name = name ? name : "";
+            j.enabled = true;
+            gameControllersConnected++;
+            HFLOGINFO("Joystick %i '%s' connected", i, j.name.c_str());
+            return;
         }
+        HFLOGWARN("Joystick '%s' ignored, all %i slots in use", name ? name : "", MaxGameControllers);
+        SDL_GameControllerClose(controller);
+    }
+
+    void Context::_removeGameController(SDL_JoystickID instanceId) {
+        std::lock_guard<std::mutex> lock(controllerMutex_);
+        int i = _findGameController(instanceId);
+        if (i < 0)
+            return;
+        GAMECONTROLLERSTATE& j = gameControllers[i];
+        HFLOGINFO("Joystick %i '%s' disconnected", i, j.name.c_str());
+        SDL_GameControllerClose(j.controller);
+        j = GAMECONTROLLERSTATE();
+        gameControllersConnected--;
     }
 
     void Context::_closeGameControllers() {
@@ -169,27 +208,101 @@ namespace GameLib {
             SDL_GameControllerClose(j.controller);
             j = GAMECONTROLLERSTATE();
         }
+        gameControllersConnected = 0;
     }
 
-    void Context::_updateGameControllers() {
-        for (unsigned i = 0; i < gameControllersConnected; i++) {
-            GAMECONTROLLERSTATE& j = gameControllers[i];
-            if (!j.enabled)
-                continue;
-            short s1x = SDL_GameControllerGetAxis(j.controller, SDL_CONTROLLER_AXIS_LEFTX);
-            short s1y = SDL_GameControllerGetAxis(j.controller, SDL_CONTROLLER_AXIS_LEFTY);
-            short s2x = SDL_GameControllerGetAxis(j.controller, SDL_CONTROLLER_AXIS_RIGHTX);
-            short s2y = SDL_GameControllerGetAxis(j.controller, SDL_CONTROLLER_AXIS_RIGHTY);
-            j.axis1.x = clamp<float>(s1x / 32767.0f, -1.0f, 1.0f);
-            j.axis1.y = clamp<float>(s1y / 32767.0f, -1.0f, 1.0f);
-            j.axis2.x = clamp<float>(s2x / 32767.0f, -1.0f, 1.0f);
-            j.axis2.y = clamp<float>(s2y / 32767.0f, -1.0f, 1.0f);
-            j.a = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_A);
-            j.b = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_B);
-            j.x = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_X);
-            j.y = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_Y);
-            j.back = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_BACK);
-            j.start = SDL_GameControllerGetButton(j.controller, SDL_CONTROLLER_BUTTON_START);
+    int Context::_findGameController(SDL_JoystickID instanceId) const {
+        for (int i = 0; i < MaxGameControllers; i++) {
+            if (gameControllers[i].controller && gameControllers[i].instanceId == instanceId)
+                return i;
+        }
+        return -1;
+    }
+
+    void Context::_applyControllerEvent(const INPUTEVENT& e) {
+        GAMECONTROLLERSTATE& j = gameControllers[(e.code >> 8) & (MaxGameControllers - 1)];
+        int input = e.code & 0xff;
+        if (e.type == INPUTEVENT::CONTROLLERAXIS) {
+            switch (input) {
+            case SDL_CONTROLLER_AXIS_LEFTX: j.axis1.x = e.value; break;
+            case SDL_CONTROLLER_AXIS_LEFTY: j.axis1.y = e.value; break;
+            case SDL_CONTROLLER_AXIS_RIGHTX: j.axis2.x = e.value; break;
+            case SDL_CONTROLLER_AXIS_RIGHTY: j.axis2.y = e.value; break;
+            }
+        } else {
+            switch (input) {
+            case SDL_CONTROLLER_BUTTON_A: j.a = e.value; break;
+            case SDL_CONTROLLER_BUTTON_B: j.b = e.value; break;
+            case SDL_CONTROLLER_BUTTON_X: j.x = e.value; break;
+            case SDL_CONTROLLER_BUTTON_Y: j.y = e.value; break;
+            case SDL_CONTROLLER_BUTTON_BACK: j.back = e.value; break;
+            case SDL_CONTROLLER_BUTTON_START: j.start = e.value; break;
+            }
+        }
+        inputEvents.push(e);
+    }
+
+    // SDL_GameControllerUpdate() takes the SDL joystick lock, so it is safe to call from the sampling thread
+    void Context::startControllerSampling(int hz) {
+        if (sampling_ || hz <= 0)
+            return;
+        sampling_ = true;
+        controllerThread_ = std::thread(&Context::_sampleControllers, this, hz);
+    }
+
+    void Context::stopControllerSampling() {
+        if (!sampling_)
+            return;
+        sampling_ = false;
+        controllerThread_.join();
+    }
+
+    void Context::_sampleControllers(int hz) {
+        // last sampled values, only changes become events
+        SDL_GameController* sampled[MaxGameControllers]{ nullptr };
+        Sint16 axes[MaxGameControllers][ControllerAxisCount]{};
+        Uint8 buttons[MaxGameControllers][ControllerButtonCount]{};
+
+        auto period = std::chrono::microseconds(1000000 / hz);
+        auto next = std::chrono::steady_clock::now();
+        while (sampling_) {
+            {
+                std::lock_guard<std::mutex> lock(controllerMutex_);
+                SDL_GameControllerUpdate();
+                uint32_t timestamp = SDL_GetTicks();
+                for (int i = 0; i < MaxGameControllers; i++) {
+                    SDL_GameController* controller = gameControllers[i].controller;
+                    if (controller != sampled[i]) {
+                        // a new controller in this slot starts from rest
+                        sampled[i] = controller;
+                        memset(axes[i], 0, sizeof(axes[i]));
+                        memset(buttons[i], 0, sizeof(buttons[i]));
+                    }
+                    if (!controller)
+                        continue;
+                    for (int k = 0; k < ControllerAxisCount; k++) {
+                        Sint16 value = SDL_GameControllerGetAxis(controller, ControllerAxes[k]);
+                        if (value == axes[i][k])
+                            continue;
+                        axes[i][k] = value;
+                        controllerEvents_.push(
+                            { timestamp, INPUTEVENT::CONTROLLERAXIS, (uint16_t)(i << 8 | ControllerAxes[k]), axisValue(value) });
+                    }
+                    for (int k = 0; k < ControllerButtonCount; k++) {
+                        Uint8 value = SDL_GameControllerGetButton(controller, ControllerButtons[k]);
+                        if (value == buttons[i][k])
+                            continue;
+                        buttons[i][k] = value;
+                        controllerEvents_.push(
+                            { timestamp, INPUTEVENT::CONTROLLERBUTTON, (uint16_t)(i << 8 | ControllerButtons[k]), (float)value });
+                    }
+                }
+            }
+            next += period;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now)
+                next = now;
+            std::this_thread::sleep_until(next);
         }
     }
 
@@ -198,13 +311,7 @@ namespace GameLib {
     //////////////////////////////////////////////////////////////////
 
     int Context::getEvents() {
-        static int checkForGameControllers = 100;
-
-        if (--checkForGameControllers <= 0) {
-            checkForGameControllers = 100;
-            _openGameControllers();
-        }
-        _updateGameControllers();
+        keyboard.beginFrame();
 
         int eventCount{ 0 };
         SDL_Event e;
@@ -215,20 +322,53 @@ namespace GameLib {
                 quitRequested = 1;
                 break;
             case SDL_KEYDOWN:
-                keyboard.keys[e.key.keysym.sym] = 1;
-                keyboard.scancodes[e.key.keysym.scancode] = 1;
                 keyboard.mod = e.key.keysym.mod;
+                if (e.key.repeat || e.key.keysym.scancode >= SDL_NUM_SCANCODES)
+                    break;
+                keyboard.keyDown(e.key.keysym.scancode);
+                inputEvents.push({ e.key.timestamp, INPUTEVENT::KEYDOWN, (uint16_t)e.key.keysym.scancode, 1.0f });
                 break;
             case SDL_KEYUP:
-                keyboard.keys[e.key.keysym.sym] = 0;
-                keyboard.scancodes[e.key.keysym.scancode] = 0;
                 keyboard.mod = e.key.keysym.mod;
+                if (e.key.keysym.scancode >= SDL_NUM_SCANCODES)
+                    break;
+                keyboard.keyUp(e.key.keysym.scancode);
+                inputEvents.push({ e.key.timestamp, INPUTEVENT::KEYUP, (uint16_t)e.key.keysym.scancode, 0.0f });
+                break;
+            case SDL_CONTROLLERDEVICEADDED:
+                _addGameController(e.cdevice.which);
+                break;
+            case SDL_CONTROLLERDEVICEREMOVED:
+                _removeGameController(e.cdevice.which);
                 break;
+            case SDL_CONTROLLERAXISMOTION: {
+                // the sampling thread reports these itself with finer timestamps
+                int i = _findGameController(e.caxis.which);
+                if (sampling_ || i < 0)
+                    break;
+                _applyControllerEvent(
+                    { e.caxis.timestamp, INPUTEVENT::CONTROLLERAXIS, (uint16_t)(i << 8 | e.caxis.axis), axisValue(e.caxis.value) });
+                break;
+            }
+            case SDL_CONTROLLERBUTTONDOWN:
+            case SDL_CONTROLLERBUTTONUP: {
+                int i = _findGameController(e.cbutton.which);
+                if (sampling_ || i < 0)
+                    break;
+                _applyControllerEvent(
+                    { e.cbutton.timestamp, INPUTEVENT::CONTROLLERBUTTON, (uint16_t)(i << 8 | e.cbutton.button), (float)e.cbutton.state });
+                break;
+            }
             default:
                 break;
             }
             ++eventCount;
         }
+        INPUTEVENT sample;
+        while (controllerEvents_.pop(sample)) {
+            _applyControllerEvent(sample);
+            ++eventCount;
+        }
         return eventCount;
     }
 
@@ -243,6 +383,10 @@ namespace GameLib {
         return SDL_RenderCopy(renderer_, texture, nullptr, &dstrect);
     }
 
+    int Context::drawTexture(glm::vec2 position, glm::vec2 size, ImageHandle image) {
+        return drawTexture(position, size, useImage(image));
+    }
+
     int Context::drawTexture(glm::vec2 position, int tilesetId, int tileId) {
 #ifndef _DEBUG
         TILEIMAGE* t = getTileFast(tilesetId, tileId);
@@ -274,7 +418,28 @@ namespace GameLib {
         SDL_RenderClear(renderer_);
     }
 
-    void Context::swapBuffers() { SDL_RenderPresent(renderer_); }
+    void Context::swapBuffers() {
+        SDL_RenderPresent(renderer_);
+        _trimTextures();
+        frame_++;
+    }
+
+    bool Context::setVSync(bool enabled) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        return renderer_ && SDL_RenderSetVSync(renderer_, enabled ? 1 : 0) == 0;
+#else
+        // older SDL only reads the hint when a renderer is created
+        return false;
+#endif
+    }
+
+    int Context::refreshRate() const {
+        SDL_DisplayMode mode;
+        int display = window_ ? SDL_GetWindowDisplayIndex(window_) : 0;
+        if (display < 0 || SDL_GetCurrentDisplayMode(display, &mode) != 0 || mode.refresh_rate <= 0)
+            return 60;
+        return mode.refresh_rate;
+    }
 
     //////////////////////////////////////////////////////////////////
     // SEARCH PATHS //////////////////////////////////////////////////
@@ -319,129 +484,361 @@ namespace GameLib {
         return path;
     }
 
-    //////////////////////////////////////////////////////////////////
-    // IMAGES ////////////////////////////////////////////////////////
-    //////////////////////////////////////////////////////////////////
+    bool Context::addArchive(const std::string& filename) {
+        std::string p = findSearchPath(filename);
+        if (p.empty())
+            return false;
+        auto archive = std::make_unique<Archive>();
+        if (!archive->open(p))
+            return false;
+        HFLOGINFO("mapped '%s' with %i assets", p.c_str(), (int)archive->count());
+        archives_.push_back(std::move(archive));
+        return true;
+    }
 
-    SDL_Texture* Context::loadImage(const std::string& filename) {
+    void Context::clearArchives() {
+        // clips still encoded in an archive are read from the search paths instead, decoded clips keep playing
+        audioIds_.forEach([this](int id, AudioHandle h) {
+            AUDIOINFO* audio = audioClips_.get(h);
+            if (!audio || !audio->encoded)
+                return;
+            for (auto& archive : archives_) {
+                if (!archive->owns(audio->encoded))
+                    continue;
+                audio->encoded = nullptr;
+                audio->encodedSize = 0;
+                audio->path = findSearchPath(audio->filename);
+                if (audio->path.empty() && !audio->chunk)
+                    HFLOGWARN("'%s' was only in a closed archive and cannot be played", audio->filename.c_str());
+                break;
+            }
+        });
+        archives_.clear();
+    }
+
+    SDL_RWops* Context::openAsset(const std::string& filename) const {
+        for (auto& archive : archives_) {
+            SDL_RWops* rw = archive->openRW(filename);
+            if (rw)
+                return rw;
+        }
         std::string p = findSearchPath(filename);
         if (p.empty())
             return nullptr;
-        filesystem::path path = p;
-        std::string resourceName = std::move(path.filename().string());
-        if (images_.count(resourceName)) {
-            SDL_DestroyTexture(images_[resourceName].texture);
+        return SDL_RWFromFile(p.c_str(), "rb");
+    }
+
+    bool Context::findAsset(const std::string& filename, const uint8_t*& data, size_t& size, std::string& path) const {
+        for (auto& archive : archives_) {
+            data = (const uint8_t*)archive->find(filename, size);
+            if (data)
+                return true;
+        }
+        data = nullptr;
+        path = findSearchPath(filename);
+        if (path.empty())
+            return false;
+        std::error_code ec;
+        size = (size_t)filesystem::file_size(path, ec);
+        return !ec;
+    }
+
+    bool Context::readAsset(const std::string& filename, std::string& contents) const {
+        for (auto& archive : archives_) {
+            size_t size;
+            const char* data = (const char*)archive->find(filename, size);
+            if (data) {
+                contents.assign(data, size);
+                return true;
+            }
         }
-        SDL_Surface* img = IMG_Load(p.c_str());
+        std::string p = findSearchPath(filename);
+        if (p.empty())
+            return false;
+        std::ifstream fin(p, std::ios::binary);
+        if (!fin)
+            return false;
+        contents.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////
+    // IMAGES ////////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////
+
+    ImageHandle Context::loadImage(const std::string& filename) {
+        SDL_RWops* rw = openAsset(filename);
+        if (!rw)
+            return ImageHandle();
+        SDL_Surface* img = IMG_Load_RW(rw, 1);
         if (!img) {
-            HFLOGERROR("'%s' not found", resourceName.c_str());
-            return nullptr;
+            HFLOGERROR("'%s' not found", filename.c_str());
+            return ImageHandle();
         }
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, img);
-        images_[resourceName].texture = texture;
+        ImageHandle h = createImage(filename, img);
         SDL_FreeSurface(img);
         HFLOGINFO("loaded '%s'", filename.c_str());
-        return texture;
+        return h;
     }
 
-    void Context::freeImages() {
-        for (auto& [k, v] : images_) {
-            SDL_DestroyTexture(v.texture);
-            v.texture = nullptr;
+    ImageHandle Context::createImage(const std::string& filename, SDL_Surface* surface) {
+        filesystem::path path = filename;
+        std::string resourceName = std::move(path.filename().string());
+        unloadImage(resourceName);
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, surface);
+        if (!texture)
+            return ImageHandle();
+        ImageHandle h = images_.add();
+        TEXTUREINFO& image = images_.getFast(h);
+        image.texture = texture;
+        image.w = surface->w;
+        image.h = surface->h;
+        image.filename = filename;
+        image.lastUsed = frame_;
+        images_.setBytes(h, (size_t)surface->w * surface->h * 4);
+        imageNames_[resourceName] = h;
+        return h;
+    }
+
+    bool Context::restoreImage(ImageHandle h, SDL_Surface* surface) {
+        TEXTUREINFO* image = images_.get(h);
+        if (!image)
+            return false;
+        // a reload that was cancelled or already restored is dropped
+        if (!image->reloading)
+            return image->texture != nullptr;
+        if (!surface) {
+            // a failed reload of an evicted image leaves reloading set so it is not tried every frame
+            if (image->texture)
+                image->reloading = false;
+            return false;
         }
-        images_.clear();
+        image->reloading = false;
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, surface);
+        if (!texture)
+            return false;
+        if (image->texture)
+            SDL_DestroyTexture(image->texture);
+        else
+            textureReloads_++;
+        image->texture = texture;
+        image->w = surface->w;
+        image->h = surface->h;
+        images_.setBytes(h, (size_t)surface->w * surface->h * 4);
+        return true;
+    }
+
+    void Context::reloadImage(ImageHandle h, const std::string& filename) {
+        TEXTUREINFO* image = images_.get(h);
+        if (!image)
+            return;
+        image->filename = filename;
+        image->reloading = true;
+        if (imageReloader) {
+            imageReloader(h, filename);
+            return;
+        }
+        SDL_RWops* rw = openAsset(filename);
+        SDL_Surface* surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+        if (!surface)
+            HFLOGERROR("'%s' not found", filename.c_str());
+        restoreImage(h, surface);
+        if (surface)
+            SDL_FreeSurface(surface);
     }
 
-    bool Context::imageLoaded(const std::string& resourceName) const { return images_.count(resourceName); }
+    std::vector<std::string> Context::imageNames() const {
+        std::vector<std::string> names;
+        for (auto& [name, h] : imageNames_)
+            names.push_back(name);
+        return names;
+    }
 
-    SDL_Texture* Context::getImage(const std::string& resourceName) const {
-        if (images_.count(resourceName)) {
-            return images_.at(resourceName).texture;
+    SDL_Texture* Context::useImage(ImageHandle h) {
+        TEXTUREINFO* image = images_.get(h);
+        if (!image)
+            return nullptr;
+        image->lastUsed = frame_;
+        if (image->texture)
+            return image->texture;
+        if (!image->reloading) {
+            image->reloading = true;
+            if (imageReloader) {
+                imageReloader(h, image->filename);
+            } else {
+                SDL_RWops* rw = openAsset(image->filename);
+                SDL_Surface* surface = rw ? IMG_Load_RW(rw, 1) : nullptr;
+                if (surface) {
+                    restoreImage(h, surface);
+                    SDL_FreeSurface(surface);
+                    return image->texture;
+                }
+                HFLOGERROR("'%s' not found", image->filename.c_str());
+            }
         }
-        return nullptr;
+        if (!placeholder_) {
+            // a grey checkerboard stretched over the image until it is back
+            const Uint32 pixels[4] = { 0xff808080, 0xffc0c0c0, 0xffc0c0c0, 0xff808080 };
+            placeholder_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 2, 2);
+            if (placeholder_)
+                SDL_UpdateTexture(placeholder_, nullptr, pixels, 2 * sizeof(Uint32));
+        }
+        return placeholder_;
     }
 
-    //////////////////////////////////////////////////////////////////
-    // TILESET ///////////////////////////////////////////////////////
-    //////////////////////////////////////////////////////////////////
+    void Context::cancelImageReloads() {
+        for (auto& [name, h] : imageNames_) {
+            if (TEXTUREINFO* image = images_.get(h))
+                image->reloading = false;
+        }
+    }
 
-    std::vector<TILEIMAGE>& Context::_initTileset(int id) {
-        if (!tilesets_.count(id)) {
-            auto& tileset = tilesets_[id];
-            tileset.clear();
-        } else {
-            auto& tileset = tilesets_[id];
-            for (auto& t : tileset) {
-                if (t.texture) {
-                    SDL_DestroyTexture(t.texture);
+    void Context::_trimTextures() {
+        if (!textureBudget_)
+            return;
+        while (images_.residentBytes() > textureBudget_) {
+            // images drawn this frame are kept even past the budget
+            ImageHandle victim;
+            unsigned oldest = frame_;
+            for (auto& [name, h] : imageNames_) {
+                const TEXTUREINFO* image = images_.get(h);
+                if (image && image->texture && image->lastUsed < oldest) {
+                    victim = h;
+                    oldest = image->lastUsed;
                 }
-                t = TILEIMAGE();
             }
-            tilesets_[id].clear();
+            if (!victim)
+                return;
+            TEXTUREINFO& image = images_.getFast(victim);
+            SDL_DestroyTexture(image.texture);
+            image.texture = nullptr;
+            images_.setBytes(victim, 0);
+            textureEvictions_++;
         }
-        return tilesets_[id];
     }
 
-    int Context::_addTile(int tilesetId, SDL_Surface* surface) {
-        auto& tileset = tilesets_[tilesetId];
+    void Context::unloadImage(const std::string& resourceName) {
+        auto it = imageNames_.find(resourceName);
+        if (it == imageNames_.end())
+            return;
+        images_.release(it->second);
+        imageNames_.erase(it);
+    }
 
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, surface);
-        if (!texture)
-            return 0;
+    void Context::freeImages() {
+        for (auto& [k, v] : imageNames_) {
+            images_.release(v);
+        }
+        imageNames_.clear();
+    }
+
+    bool Context::imageLoaded(const std::string& resourceName) const { return imageNames_.count(resourceName); }
+
+    ImageHandle Context::findImage(const std::string& resourceName) const {
+        auto it = imageNames_.find(resourceName);
+        return it != imageNames_.end() ? it->second : ImageHandle();
+    }
 
-        TILEIMAGE t;
-        t.texture = texture;
-        t.tileId = (int)tileset.size();
-        t.tilesetId = tilesetId;
-        t.w = surface->w;
-        t.h = surface->h;
-        tileset.push_back(t);
-        return t.tileId;
+    SDL_Texture* Context::getImage(const std::string& resourceName) const {
+        const TEXTUREINFO* image = images_.get(findImage(resourceName));
+        return image ? image->texture : nullptr;
     }
 
+    //////////////////////////////////////////////////////////////////
+    // TILESET ///////////////////////////////////////////////////////
+    //////////////////////////////////////////////////////////////////
+
     int Context::loadTileset(int tilesetId, int w, int h, const std::string& filename) {
-        std::string p = findSearchPath(filename);
-        if (p.empty())
+        SDL_RWops* rw = openAsset(filename);
+        if (!rw)
             return 0;
-        SDL_Surface* surface = IMG_Load(p.c_str());
+        SDL_Surface* surface = IMG_Load_RW(rw, 1);
         if (!surface)
             return 0;
-        int tileCount = 0;
+        std::vector<SDL_Surface*> tiles = splitTileset(surface, w, h);
+        SDL_FreeSurface(surface);
+        int tileCount = createTileset(tilesetId, tiles, filename);
+        for (auto tile : tiles)
+            SDL_FreeSurface(tile);
+        if (tileCount)
+            HFLOGINFO("loaded '%s'", filename.c_str());
+        return tileCount;
+    }
+
+    std::vector<SDL_Surface*> Context::splitTileset(SDL_Surface* surface, int w, int h) {
+        std::vector<SDL_Surface*> tiles;
         SDL_Rect dstrect{ 0, 0, w, h };
-        auto tileset = _initTileset(tilesetId);
         for (int y = 0; y < surface->h; y += h) {
             for (int x = 0; x < surface->w; x += w) {
                 SDL_Surface* tile = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
                 if (!tile) {
-                    SDL_FreeSurface(surface);
-                    return 0;
+                    for (auto t : tiles)
+                        SDL_FreeSurface(t);
+                    return {};
                 }
                 SDL_Rect srcrect{ x, y, w, h };
                 SDL_BlitSurface(surface, &srcrect, tile, &dstrect);
-                _addTile(tilesetId, tile);
-                tileCount++;
+                tiles.push_back(tile);
             }
         }
-        HFLOGINFO("loaded '%s'", filename.c_str());
-        return tileCount;
+        return tiles;
     }
 
-    void Context::freeTilesets() {
-        for (auto& [k, v] : tilesets_) {
-            for (auto& t : v) {
-                SDL_DestroyTexture(t.texture);
-                t.texture = nullptr;
-            }
+    int Context::createTileset(int tilesetId, const std::vector<SDL_Surface*>& tiles, const std::string& filename) {
+        if (tiles.empty())
+            return 0;
+        unloadTileset(tilesetId);
+        TilesetHandle h = tilesets_.add();
+        TILESET& tileset = tilesets_.getFast(h);
+        tileset.filename = filename;
+        size_t bytes = 0;
+        for (auto surface : tiles) {
+            // a tile that fails keeps its place so the tile ids after it do not shift
+            TILEIMAGE t;
+            t.texture = SDL_CreateTextureFromSurface(renderer_, surface);
+            t.tileId = (int)tileset.tiles.size();
+            t.tilesetId = tilesetId;
+            t.w = surface->w;
+            t.h = surface->h;
+            tileset.tiles.push_back(t);
+            bytes += (size_t)t.w * t.h * 4;
         }
+        tilesets_.setBytes(h, bytes);
+        tilesetIds_.set(tilesetId, h);
+        return (int)tileset.tiles.size();
     }
 
-    TILEIMAGE* Context::getTile(int tilesetId, int tileId) {
-        if (!tilesets_.count(tilesetId))
-            return nullptr;
-        auto& tileset = tilesets_.at(tilesetId);
-        if (tileId >= tileset.size())
+    void Context::unloadTileset(int tilesetId) {
+        TilesetHandle h = tilesetIds_.get(tilesetId);
+        if (!h)
+            return;
+        tilesets_.release(h);
+        tilesetIds_.set(tilesetId, TilesetHandle());
+    }
+
+    void Context::freeTilesets() {
+        tilesetIds_.forEach([this](int id, TilesetHandle h) { tilesets_.release(h); });
+        tilesetIds_.clear();
+    }
+
+    std::vector<int> Context::tilesetIds() const {
+        std::vector<int> ids;
+        tilesetIds_.forEach([&ids](int id, TilesetHandle h) { ids.push_back(id); });
+        return ids;
+    }
+
+    TILEIMAGE* Context::getTile(int tilesetId, int tileId) { return getTile(tilesetIds_.get(tilesetId), tileId); }
+
+    TILEIMAGE* Context::getTile(TilesetHandle tileset, int tileId) {
+        TILESET* t = tilesets_.get(tileset);
+        if (!t || (unsigned)tileId >= t->tiles.size())
             return nullptr;
-        return &tileset[tileId];
+        return &t->tiles[tileId];
+    }
+
+    int Context::getTileCount(int tilesetId) {
+        TILESET* t = tilesets_.get(tilesetIds_.get(tilesetId));
+        return t ? (int)t->tiles.size() : 0;
     }
 
     //////////////////////////////////////////////////////////////////
@@ -449,54 +846,163 @@ namespace GameLib {
     //////////////////////////////////////////////////////////////////
 
     AUDIOINFO* Context::initAudioClip(int clipId) {
-        if (audioClips_[clipId]) {
-            audioClips_[clipId].free();
-            audioClips_[clipId] = AUDIOINFO();
-        }
-        return &audioClips_[clipId];
+        unloadAudioClip(clipId);
+        AudioHandle h = audioClips_.add();
+        audioIds_.set(clipId, h);
+        return &audioClips_.getFast(h);
     }
 
-    AUDIOINFO* Context::getAudioClip(int clipId) {
-        if (audioClips_.count(clipId))
-            return &audioClips_[clipId];
-        return nullptr;
+    AUDIOINFO* Context::getAudioClip(int clipId) { return audioClips_.get(audioIds_.get(clipId)); }
+
+    void Context::unloadAudioClip(int clipId) {
+        AudioHandle h = audioIds_.get(clipId);
+        if (!h)
+            return;
+        audioClips_.release(h);
+        audioIds_.set(clipId, AudioHandle());
     }
 
     void Context::freeAudioClips() {
-        for (auto& [k, v] : audioClips_) {
-            v.free();
-        }
-        audioClips_.clear();
+        audioIds_.forEach([this](int id, AudioHandle h) { audioClips_.release(h); });
+        audioIds_.clear();
     }
 
     AUDIOINFO* Context::loadAudioClip(int clipId, const std::string& filename) {
-        if (!audioInitialized_)
-            return nullptr;
-        std::string p = findSearchPath(filename);
-        if (p.empty())
+        // clips are only found here, so they load without an audio device and play once one is open
+        const uint8_t* data;
+        size_t size;
+        std::string path;
+        if (!findAsset(filename, data, size, path)) {
+            HFLOGWARN("Unable to load '%s'", filename.c_str());
             return nullptr;
+        }
+        HFLOGINFO("loaded '%s'", filename.c_str());
+        return addAudioClip(clipId, filename, data, size, path);
+    }
+
+    AUDIOINFO* Context::addAudioClip(int clipId,
+                                     const std::string& filename,
+                                     const uint8_t* data,
+                                     size_t size,
+                                     const std::string& path) {
         AUDIOINFO& audio = *initAudioClip(clipId);
+        filesystem::path p = filename;
+        audio.name = p.filename().string();
+        audio.encoded = data;
+        audio.encodedSize = size;
+        audio.path = data ? std::string() : path;
+        audio.filename = filename;
+        return &audio;
+    }
 
-        Mix_Chunk* chunk = Mix_LoadWAV(p.c_str());
+    bool Context::decodeAudioClip(int clipId) {
+        AudioHandle h = audioIds_.get(clipId);
+        AUDIOINFO* audio = audioClips_.get(h);
+        if (!audio || !audioInitialized_)
+            return false;
+        if (audio->chunk) {
+            audioCacheHits_++;
+            return true;
+        }
+        SDL_RWops* rw = openAudioClip(*audio);
+        Mix_Chunk* chunk = rw ? Mix_LoadWAV_RW(rw, 1) : nullptr;
         if (!chunk) {
-            HFLOGWARN("Unable to load '%s'", filename.c_str());
+            HFLOGWARN("Unable to decode '%s'", audio->name.c_str());
             HFLOGWARN("Mix_LoadWAV returned '%s'", Mix_GetError());
-            return nullptr;
+            return false;
         }
-        filesystem::path path = p;
-        audio.chunk = chunk;
-        audio.name = path.filename().string();
-        HFLOGINFO("loaded '%s'", filename.c_str());
-        return &audio;
+        setDecodedAudioClip(h, chunk);
+        return true;
+    }
+
+    SDL_RWops* Context::openAudioClip(const AUDIOINFO& audio) {
+        if (audio.encoded)
+            return SDL_RWFromConstMem(audio.encoded, (int)audio.encodedSize);
+        if (!audio.path.empty())
+            return SDL_RWFromFile(audio.path.c_str(), "rb");
+        return nullptr;
+    }
+
+    void Context::setDecodedAudioClip(AudioHandle clip, Mix_Chunk* chunk) {
+        AUDIOINFO* audio = audioClips_.get(clip);
+        // the clip was unloaded while it decoded, a reloaded clip has a new handle
+        if (!audio || audio->chunk) {
+            Mix_FreeChunk(chunk);
+            return;
+        }
+        audio->chunk = chunk;
+        audio->lastUsed = ++audioUseCount_;
+        audioDecodedBytes_ += chunk->alen;
+        audioCacheMisses_++;
+        audioClips_.setBytes(clip, audioClips_.bytes(clip) + chunk->alen);
+        _trimAudioCache(clip);
+    }
+
+    void Context::setAudioBudget(size_t bytes) {
+        audioBudget_ = bytes;
+        _trimAudioCache(AudioHandle());
+    }
+
+    std::vector<int> Context::audioClipIds() const {
+        std::vector<int> ids;
+        audioIds_.forEach([&ids](int id, AudioHandle h) { ids.push_back(id); });
+        return ids;
+    }
+
+    void Context::_trimAudioCache(AudioHandle keep) {
+        while (audioDecodedBytes_ > audioBudget_) {
+            // the least recently played clip that is not playing now and can be decoded again
+            AudioHandle victim;
+            unsigned oldest = 0;
+            audioIds_.forEach([&](int id, AudioHandle h) {
+                const AUDIOINFO* audio = audioClips_.get(h);
+                if (h == keep || !audio || !audio->chunk || _audioChunkPlaying(audio->chunk))
+                    return;
+                if (!victim || audio->lastUsed < oldest) {
+                    victim = h;
+                    oldest = audio->lastUsed;
+                }
+            });
+            if (!victim)
+                return;
+            AUDIOINFO& audio = audioClips_.getFast(victim);
+            audioDecodedBytes_ -= audio.chunk->alen;
+            audioClips_.setBytes(victim, audioClips_.bytes(victim) - audio.chunk->alen);
+            Mix_FreeChunk(audio.chunk);
+            audio.chunk = nullptr;
+            audioEvictions_++;
+        }
+    }
+
+    bool Context::_audioChunkPlaying(Mix_Chunk* chunk) const {
+        int channels = audioChannelCount();
+        for (int i = 0; i < channels; i++) {
+            if (Mix_Playing(i) && Mix_GetChunk(i) == chunk)
+                return true;
+        }
+        return false;
     }
 
     int Context::playAudioClip(int clipId, int channel) {
         if (!audioInitialized_)
             return -1;
-        AUDIOINFO* audio = getAudioClip(clipId);
-        if (!audio)
+        if (!decodeAudioClip(clipId))
             return -1;
-        return Mix_PlayChannel(-1, audio->chunk, 0);
+        AUDIOINFO* audio = getAudioClip(clipId);
+        audio->lastUsed = ++audioUseCount_;
+        return Mix_PlayChannel(channel, audio->chunk, 0);
+    }
+
+    int Context::audioChannelCount() const {
+        if (!audioInitialized_)
+            return 0;
+        return Mix_AllocateChannels(-1);
+    }
+
+    bool Context::audioChannelPlaying(int channel) const {
+        if (!audioInitialized_)
+            return false;
+        return Mix_Playing(channel) != 0;
     }
 
     void Context::stopAudioChannel(int channel) {
@@ -518,46 +1024,61 @@ namespace GameLib {
 	}
 
     MUSICINFO* Context::initMusicClip(int musicId) {
-        if (musicClips_[musicId]) {
-            musicClips_[musicId].free();
-            musicClips_[musicId] = MUSICINFO();
-        }
-        return &musicClips_[musicId];
+        unloadMusicClip(musicId);
+        MusicHandle h = musicClips_.add();
+        musicIds_.set(musicId, h);
+        return &musicClips_.getFast(h);
     }
 
     MUSICINFO* Context::loadMusicClip(int musicId, const std::string& filename) {
         if (!audioInitialized_)
             return nullptr;
-        std::string p = findSearchPath(filename);
-        if (p.empty())
+        SDL_RWops* rw = openAsset(filename);
+        if (!rw)
             return nullptr;
-        MUSICINFO& music = *initMusicClip(musicId);
+        // music is decoded as it plays, so the compressed size is what stays resident
+        Sint64 size = SDL_RWsize(rw);
 
-        Mix_Music* chunk = Mix_LoadMUS(p.c_str());
+        // music streams from rw while it plays, archive memory stays mapped until the Context is destroyed
+        Mix_Music* chunk = Mix_LoadMUS_RW(rw, 1);
         if (!chunk) {
             HFLOGWARN("Unable to load '%s'", filename.c_str());
             HFLOGWARN("Mix_LoadWAV returned '%s'", Mix_GetError());
             return nullptr;
         }
-        filesystem::path path = p;
+        MUSICINFO& music = *initMusicClip(musicId);
+        filesystem::path path = filename;
         music.chunk = chunk;
         music.name = path.filename().string();
+        musicClips_.setBytes(musicIds_.get(musicId), size > 0 ? (size_t)size : 0);
         HFLOGINFO("loaded '%s'", filename.c_str());
         return &music;
     }
 
-    MUSICINFO* Context::getMusicClip(int musicId) {
-        if (!musicClips_.count(musicId)) {
-            return nullptr;
-        }
-        return &musicClips_[musicId];
+    MUSICINFO* Context::getMusicClip(int musicId) { return musicClips_.get(musicIds_.get(musicId)); }
+
+    void Context::unloadMusicClip(int musicId) {
+        MusicHandle h = musicIds_.get(musicId);
+        if (!h)
+            return;
+        musicClips_.release(h);
+        musicIds_.set(musicId, MusicHandle());
     }
 
     void Context::freeMusicClips() {
-        for (auto& [k, v] : musicClips_) {
-            v.free();
-        }
-        musicClips_.clear();
+        musicIds_.forEach([this](int id, MusicHandle h) { musicClips_.release(h); });
+        musicIds_.clear();
+    }
+
+    void Context::logResidentMemory() const {
+        auto mb = [](size_t bytes) { return bytes / (1024.0 * 1024.0); };
+        HFLOGINFO("images:   %3i %8.3f MB, %u evictions, %u reloads",
+                  (int)images_.count(), mb(images_.residentBytes()), textureEvictions_, textureReloads_);
+        HFLOGINFO("tilesets: %3i %8.3f MB", (int)tilesets_.count(), mb(tilesets_.residentBytes()));
+        HFLOGINFO("audio:    %3i %8.3f MB", (int)audioClips_.count(), mb(audioClips_.residentBytes()));
+        HFLOGINFO("audio cache: %8.3f of %8.3f MB, %u hits, %u misses, %u evictions",
+                  mb(audioDecodedBytes_), mb(audioBudget_), audioCacheHits_, audioCacheMisses_, audioEvictions_);
+        HFLOGINFO("music:    %3i %8.3f MB", (int)musicClips_.count(), mb(musicClips_.residentBytes()));
     }
 
     bool Context::playMusicClip(int musicId, int loops, int fadems) {
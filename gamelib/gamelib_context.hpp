@@ -1,7 +1,12 @@
 #ifndef GAMELIB_CONTEXT_HPP
 #define GAMELIB_CONTEXT_HPP
 
+#include <gamelib_archive.hpp>
 #include <gamelib_base.hpp>
+#include <gamelib_input_event.hpp>
+#include <gamelib_resource_pool.hpp>
+#include <bitset>
+#include <mutex>
 
 namespace GameLib {
     constexpr int WindowDefault = 0;
@@ -12,6 +17,11 @@ namespace GameLib {
 
     static constexpr int LIBXOR_TILESET32 = -1;
 
+    using ImageHandle = ResourceHandle<TEXTUREINFO>;
+    using TilesetHandle = ResourceHandle<TILESET>;
+    using AudioHandle = ResourceHandle<AUDIOINFO>;
+    using MusicHandle = ResourceHandle<MUSICINFO>;
+
     class Context {
     public:
         Context(int width, int height, int flags = WindowResizeable);
@@ -44,10 +54,31 @@ namespace GameLib {
         // clear all search paths for loading files
         void clearSearchPaths();
 
+        const std::vector<std::string>& searchPaths() const { return searchPaths_; }
+
         // find a valid path using the configured search paths
         // if file is not a regular file, returns an empty string
         std::string findSearchPath(const std::string& filename) const;
 
+        // maps a packed asset archive, found with the search paths, that is checked before the file system
+        bool addArchive(const std::string& filename);
+
+        // closes all asset archives, audio clips read from them are read from the search paths instead
+        // call it while no loader thread reads from the archives
+        void clearArchives();
+
+        // returns an SDL_RWops for an asset from an archive, or from the search paths if no archive has it
+        // returns nullptr if it is not found, loaders pass freesrc so SDL closes it
+        // safe to call from loader threads while the search paths and archives are not changed
+        SDL_RWops* openAsset(const std::string& filename) const;
+
+        // reads a whole asset into contents, returns false if it is not found
+        bool readAsset(const std::string& filename, std::string& contents) const;
+
+        // finds an asset without reading it, data points into a mapped archive, or is nullptr and path is its file
+        // safe to call from loader threads while the search paths and archives are not changed
+        bool findAsset(const std::string& filename, const uint8_t*& data, size_t& size, std::string& path) const;
+
         //////////////////////////////////////////////////////////////
         // DRAWING AND IMAGES ////////////////////////////////////////
         //////////////////////////////////////////////////////////////
@@ -58,36 +89,104 @@ namespace GameLib {
         // swap the back buffer to the front
         void swapBuffers();
 
+        // turns waiting for the display refresh in swapBuffers() on or off, returns false if the renderer cannot change it
+        bool setVSync(bool enabled);
+
+        // returns the refresh rate of the display showing the window, or 60 if it is unknown
+        int refreshRate() const;
+
         // load the filename from the current directory, or the search paths
-        SDL_Texture* loadImage(const std::string& filename);
+        ImageHandle loadImage(const std::string& filename);
+
+        // creates a texture from a decoded image and names it after the filename part of filename
+        // the surface is not freed
+        ImageHandle createImage(const std::string& filename, SDL_Surface* surface);
+
+        // creates the texture of an evicted image again, the surface is not freed
+        // a nullptr surface means the reload failed, it is not tried again
+        bool restoreImage(ImageHandle image, SDL_Surface* surface);
+
+        // lets evicted images whose reloads were dropped reload the next time they are drawn
+        void cancelImageReloads();
+
+        // decodes an image again from filename, which it is reloaded from after this, and replaces its texture
+        // uses imageReloader when it is set, the old texture is drawn until the new one is ready
+        void reloadImage(ImageHandle image, const std::string& filename);
+
+        // returns the names of the loaded images
+        std::vector<std::string> imageNames() const;
 
         // frees all currently loaded images
         void freeImages();
 
+        // drops the context's reference to an image, it is freed once other holders release it
+        void unloadImage(const std::string& resourceName);
+
         // returns true if the resource name is loaded
         bool imageLoaded(const std::string& resourceName) const;
 
-        // returns a pointer to the SDL_Texture, or nullptr if it does not exist
+        // returns a handle to the image, or an empty handle if it is not loaded
+        ImageHandle findImage(const std::string& resourceName) const;
+
+        // returns a pointer to the SDL_Texture, or nullptr if it does not exist or is evicted
+        // the texture may be evicted once it is not drawn, draw images by handle to keep them loaded
         SDL_Texture* getImage(const std::string& resourceName) const;
 
+        // marks the image drawn this frame and returns its texture
+        // an evicted image is reloaded and a placeholder is returned meanwhile, nullptr if the handle is stale
+        SDL_Texture* useImage(ImageHandle image);
+
+        // most bytes of image textures kept, 0 keeps every image
+        // past it the images drawn least recently are evicted at the end of a frame, and reloaded when drawn again
+        void setTextureBudget(size_t bytes) { textureBudget_ = bytes; }
+        size_t textureBudget() const { return textureBudget_; }
+        unsigned textureEvictions() const { return textureEvictions_; }
+        unsigned textureReloads() const { return textureReloads_; }
+
+        // decodes an evicted image again and calls restoreImage(), AssetLoader::start() sets it
+        // when it is not set the image is reloaded on the spot
+        std::function<void(ImageHandle image, const std::string& filename)> imageReloader;
+
         // load a tileset with a given tilesetId, width, and height
         int loadTileset(int tilesetId, int w, int h, const std::string& filename);
 
+        // cuts a decoded image into w by h tiles, safe to call from any thread, the caller frees the tiles
+        static std::vector<SDL_Surface*> splitTileset(SDL_Surface* surface, int w, int h);
+
+        // replaces a tileset with textures created from tiles, returns the number of tiles, the tiles are not freed
+        // filename is remembered so the tileset can be reloaded when the file changes
+        int createTileset(int tilesetId, const std::vector<SDL_Surface*>& tiles, const std::string& filename = "");
+
+        // returns the ids of the loaded tilesets
+        std::vector<int> tilesetIds() const;
+
         // frees all currently loaded tilesets
         void freeTilesets();
 
+        // drops the context's reference to a tileset, it is freed once other holders release it
+        void unloadTileset(int tilesetId);
+
+        // returns a handle to the tileset, or an empty handle if it is not loaded
+        TilesetHandle findTileset(int tilesetId) const { return tilesetIds_.get(tilesetId); }
+
         // returns a pointer to the TILEIMAGE, or nullptr if it does not exist
         TILEIMAGE* getTile(int tilesetId, int tileId);
+        TILEIMAGE* getTile(TilesetHandle tileset, int tileId);
 
         // returns a pointer to the SDL_Texture with no error checking
-        TILEIMAGE* getTileFast(int tilesetId, int tileId) { return &tilesets_[tilesetId][tileId]; }
+        TILEIMAGE* getTileFast(int tilesetId, int tileId) {
+            return &tilesets_.getFast(tilesetIds_.getFast(tilesetId)).tiles[tileId];
+        }
 
-        // returns number of tiles in a tileset
-        int getTileCount(int tilesetId) { return (int)tilesets_.at(tilesetId).size(); }
+        // returns number of tiles in a tileset, 0 if it is not loaded
+        int getTileCount(int tilesetId);
 
         // draws a rectangle to the screen. returns 0 if success, -1 if error
         int drawTexture(glm::vec2 position, glm::vec2 size, SDL_Texture* texture);
 
+        // draws an image to the screen, see useImage(). returns 0 if success, -1 if error
+        int drawTexture(glm::vec2 position, glm::vec2 size, ImageHandle image);
+
         // draws a rectangle to the screen. returns 0 if success, -1 if error
         int drawTexture(glm::vec2 position, int tilesetId, int tileId);
 
@@ -100,18 +199,50 @@ namespace GameLib {
 
         // initializes a clip id for use, it frees any audio clip used, nullptr if it doesn't exist
         AUDIOINFO* initAudioClip(int clipId);
-        // returns a pointer to the AUDIOINFO struct with the loaded WAV data, nullptr if it doesn't exist
+        // returns a pointer to the AUDIOINFO struct with the encoded WAV data, nullptr if it doesn't exist
+        // clips are decoded the first time they play and may be evicted again to stay under the audio budget
         AUDIOINFO* loadAudioClip(int clipId, const std::string& filename);
+        // stores a clip found with findAsset() under clipId
+        AUDIOINFO* addAudioClip(int clipId,
+                                const std::string& filename,
+                                const uint8_t* data,
+                                size_t size,
+                                const std::string& path);
+        // decodes a clip now if it is not already decoded, returns false if it cannot be decoded
+        bool decodeAudioClip(int clipId);
+        // returns an SDL_RWops reading the encoded clip, safe to call from loader threads
+        static SDL_RWops* openAudioClip(const AUDIOINFO& audio);
+        // stores a chunk a loader thread decoded, it is freed if the clip was unloaded or decoded meanwhile
+        void setDecodedAudioClip(AudioHandle clip, Mix_Chunk* chunk);
+        // returns the ids of the loaded audio clips
+        std::vector<int> audioClipIds() const;
+        // most bytes of decoded clips kept, the least recently played clips that are not playing are evicted past it
+        void setAudioBudget(size_t bytes);
+        size_t audioBudget() const { return audioBudget_; }
+        // bytes of decoded clips
+        size_t audioDecodedBytes() const { return audioDecodedBytes_; }
+        // clips played without decoding, clips decoded, and clips evicted
+        unsigned audioCacheHits() const { return audioCacheHits_; }
+        unsigned audioCacheMisses() const { return audioCacheMisses_; }
+        unsigned audioEvictions() const { return audioEvictions_; }
         // returns a pointer to the AUDIOINFO struct used for playing this clip, nullptr if it doesn't exist
         AUDIOINFO* getAudioClip(int clipId);
         // frees all audio clips
         void freeAudioClips();
+        // drops the context's reference to an audio clip, it is freed once other holders release it
+        void unloadAudioClip(int clipId);
+        // returns a handle to the audio clip, or an empty handle if it is not loaded
+        AudioHandle findAudioClip(int clipId) const { return audioIds_.get(clipId); }
         // returns the number of audio clips currently allocated
-        int getAudioClipCount() const { return (int)audioClips_.size(); }
+        int getAudioClipCount() const { return (int)audioClips_.count(); }
         // play an audio clip on a channel (-1 if any free channel)
         int playAudioClip(int clipId, int channel = -1);
         // stop an audio channel from playing
         void stopAudioChannel(int channel);
+        // returns the number of mixer channels, 0 if audio is not initialized
+        int audioChannelCount() const;
+        // returns true if a clip is playing on channel
+        bool audioChannelPlaying(int channel) const;
         // set the volume for a specific channel in the range 0 to 1
         void setChannelVolume(int channel, float volume);
         // get the volume for a specific channel in the range 0 to 1
@@ -125,34 +256,87 @@ namespace GameLib {
         MUSICINFO* loadMusicClip(int musicId, const std::string& filename);
         MUSICINFO* getMusicClip(int musicId);
         void freeMusicClips();
-        int getMusicClipCount() const { return (int)musicClips_.size(); }
+        void unloadMusicClip(int musicId);
+        MusicHandle findMusicClip(int musicId) const { return musicIds_.get(musicId); }
+        int getMusicClipCount() const { return (int)musicClips_.count(); }
         bool playMusicClip(int musicId, int loops = 0, int fadems = 0);
         void stopMusicClip();
 
+        //////////////////////////////////////////////////////////////
+        // RESOURCES /////////////////////////////////////////////////
+        //////////////////////////////////////////////////////////////
+
+        // the pools hold every loaded resource, addRef() a handle to keep a resource after it is unloaded by name or id
+        ResourcePool<TEXTUREINFO>& images() { return images_; }
+        ResourcePool<TILESET>& tilesets() { return tilesets_; }
+        ResourcePool<AUDIOINFO>& audioClips() { return audioClips_; }
+        ResourcePool<MUSICINFO>& musicClips() { return musicClips_; }
+
+        // returns the memory kept by loaded images, tilesets, audio and music
+        size_t residentBytes() const {
+            return images_.residentBytes() + tilesets_.residentBytes() + audioClips_.residentBytes() +
+                   musicClips_.residentBytes();
+        }
+
+        // logs the number of resources and memory kept by each type
+        void logResidentMemory() const;
+
         //////////////////////////////////////////////////////////////
         // EVENT HANDLING CODE ///////////////////////////////////////
         //////////////////////////////////////////////////////////////
 
-        // handle all SDL events
+        // handle all SDL events, clears the keys pressed and released during the last call
         int getEvents();
 
         // set quitRequested to a nonzero value to indicate the game loop should end
         int quitRequested{ 0 };
 
-        // keyboard is used to represent the current keys pressed
+        // keyboard is used to represent the current keys pressed, indexed by SDL scancode
         struct KEYBOARDSTATE {
-            std::vector<int> scancodes;
-            std::map<int, int> keys;
+            // keys held down now
+            std::bitset<SDL_NUM_SCANCODES> down;
+            // keys that went down since the last getEvents(), even if they were released again
+            std::bitset<SDL_NUM_SCANCODES> pressed;
+            // keys that went up since the last getEvents()
+            std::bitset<SDL_NUM_SCANCODES> released;
             int mod{ 0 };
+
+            bool isDown(int scancode) const { return down[scancode]; }
+            bool wasPressed(int scancode) const { return pressed[scancode]; }
+            bool wasReleased(int scancode) const { return released[scancode]; }
+
+            // clears pressed and released for a new frame
+            void beginFrame() {
+                pressed.reset();
+                released.reset();
+            }
+
+            // key repeats do not count as presses
+            void keyDown(int scancode) {
+                if (!down[scancode])
+                    pressed.set(scancode);
+                down.set(scancode);
+            }
+
+            void keyUp(int scancode) {
+                if (down[scancode])
+                    released.set(scancode);
+                down.reset(scancode);
+            }
+
+            // returns true once for each press of the key
             bool checkClear(int scancode) {
-                if (scancodes[scancode]) {
-                    scancodes[scancode] = 0;
+                if (pressed[scancode]) {
+                    pressed.reset(scancode);
                     return true;
                 }
                 return false;
-			}
+            }
         } keyboard;
 
+        // key events in the order they happened, for fixed step updates that want the exact time of an input
+        InputEventRing inputEvents;
+
         // MaxGameControllers reflects the XInput library max of four controllers
         static constexpr int MaxGameControllers{ 4 };
 
@@ -160,20 +344,32 @@ namespace GameLib {
         unsigned gameControllersConnected{ 0 };
 
         // This is an array of game pad information. If controller pointer is not null, it is available
+        // controllers are opened and closed as SDL reports them added and removed, and their
+        // state changes with each axis and button event
         struct GAMECONTROLLERSTATE {
             bool enabled{ false };
             SDL_GameController* controller{ nullptr };
+            // SDL instance id used by controller events, -1 if the slot is free
+            SDL_JoystickID instanceId{ -1 };
             std::string name;
             glm::vec2 axis1{ 0.0f, 0.0f };
             glm::vec2 axis2{ 0.0f, 0.0f };
-            float a;
-            float b;
-            float x;
-            float y;
-            float start;
-            float back;
+            float a{ 0.0f };
+            float b{ 0.0f };
+            float x{ 0.0f };
+            float y{ 0.0f };
+            float start{ 0.0f };
+            float back{ 0.0f };
         } gameControllers[MaxGameControllers];
 
+        // samples controllers hz times a second on a thread so their event timestamps do not depend on the frame rate
+        void startControllerSampling(int hz = 1000);
+
+        // stops the sampling thread, controllers go back to SDL events
+        void stopControllerSampling();
+
+        bool controllerSampling() const { return sampling_; }
+
         int screenWidth{ 0 };
         int screenHeight{ 0 };
         SDL_Surface* windowSurface() { return windowSurface_; }
@@ -189,22 +385,64 @@ namespace GameLib {
         SDL_AudioSpec audioSpec_;
         SDL_AudioDeviceID audioDeviceId_{ 0 };
         std::vector<std::string> searchPaths_;
-        std::map<std::string, TILEIMAGE> images_;
-        std::map<int, std::vector<TILEIMAGE>> tilesets_;
-        std::map<int, AUDIOINFO> audioClips_;
-        std::map<int, MUSICINFO> musicClips_;
+        std::vector<std::unique_ptr<Archive>> archives_;
+        ResourcePool<TEXTUREINFO> images_{ [](TEXTUREINFO& t) {
+            if (t.texture)
+                SDL_DestroyTexture(t.texture);
+        } };
+        size_t textureBudget_{ 0 };
+        // counts swapBuffers() calls, images record it when they are drawn
+        unsigned frame_{ 0 };
+        unsigned textureEvictions_{ 0 };
+        unsigned textureReloads_{ 0 };
+        // drawn in place of an image that is being reloaded
+        SDL_Texture* placeholder_{ nullptr };
+        ResourcePool<TILESET> tilesets_{ [](TILESET& tileset) {
+            for (auto& t : tileset.tiles) {
+                if (t.texture)
+                    SDL_DestroyTexture(t.texture);
+            }
+        } };
+        ResourcePool<AUDIOINFO> audioClips_{ [this](AUDIOINFO& audio) {
+            if (audio.chunk)
+                audioDecodedBytes_ -= audio.chunk->alen;
+            audio.free();
+        } };
+        size_t audioBudget_{ 16 * 1024 * 1024 };
+        size_t audioDecodedBytes_{ 0 };
+        unsigned audioUseCount_{ 0 };
+        unsigned audioCacheHits_{ 0 };
+        unsigned audioCacheMisses_{ 0 };
+        unsigned audioEvictions_{ 0 };
+        ResourcePool<MUSICINFO> musicClips_{ [](MUSICINFO& music) { music.free(); } };
+        // names and ids are only looked up when loading, draws and plays index the id tables
+        std::map<std::string, ImageHandle> imageNames_;
+        ResourceIds<TILESET> tilesetIds_;
+        ResourceIds<AUDIOINFO> audioIds_;
+        ResourceIds<MUSICINFO> musicIds_;
 
         bool _init();
         bool _initSubsystems();
         bool _initScreen(int width, int height, int windowFlags);
-        void _openGameControllers();
+        void _addGameController(int deviceIndex);
+        void _removeGameController(SDL_JoystickID instanceId);
         void _closeGameControllers();
-        void _updateGameControllers();
+        int _findGameController(SDL_JoystickID instanceId) const;
+        void _applyControllerEvent(const INPUTEVENT& e);
+        void _sampleControllers(int hz);
+
+        // guards controller pointers while the sampling thread reads them
+        std::mutex controllerMutex_;
+        std::thread controllerThread_;
+        std::atomic<bool> sampling_{ false };
+        // events from the sampling thread, moved to inputEvents by getEvents()
+        InputEventRing controllerEvents_;
         void _kill();
+        void _trimTextures();
+        void _trimAudioCache(AudioHandle keep);
+        bool _audioChunkPlaying(Mix_Chunk* chunk) const;
         void _setError(std::string&& errorString);
 
-        std::vector<TILEIMAGE>& _initTileset(int i);
-        int _addTile(int tilesetId, SDL_Surface* surface);
     };
 }
 
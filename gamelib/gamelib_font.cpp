@@ -2,11 +2,15 @@
 #include <gamelib_font.hpp>
 
 namespace GameLib {
+	// SDL_ttf opens every face with one FreeType library, which cannot open or close faces from two threads at once
+	static std::mutex fontLibraryMutex;
+
 	Font::Font(Context* context) : context_(context) {}
 
 
 	Font::~Font() {
 		if (font_) {
+			std::lock_guard<std::mutex> lock(fontLibraryMutex);
 			TTF_CloseFont(font_);
 			font_ = nullptr;
 		}
@@ -14,8 +18,12 @@ namespace GameLib {
 
 
 	bool Font::load(const std::string& filename, int ptsize) {
-		std::string path = context_->findSearchPath(filename);
-		font_ = TTF_OpenFont(path.c_str(), ptsize);
+		SDL_RWops* rw = context_->openAsset(filename);
+		if (!rw)
+			return false;
+		// the font reads glyphs from rw until it is closed
+		std::lock_guard<std::mutex> lock(fontLibraryMutex);
+		font_ = TTF_OpenFontRW(rw, 1, ptsize);
 		return font_ != nullptr;
 	}
 
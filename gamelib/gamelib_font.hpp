@@ -22,7 +22,7 @@ namespace GameLib {
 		// destructor
 		~Font();
 
-		// loads font from disk using specified point size
+		// loads font from disk using specified point size, may be called from a loader thread
 		bool load(const std::string& path, int ptsize);
 
 		// renders text using color
@@ -0,0 +1,89 @@
+#include "pch.h"
+#include <gamelib_frame_pacer.hpp>
+
+namespace GameLib {
+	void FramePacer::setMode(Context& context, Mode mode, float targetFps) {
+		if (targetFps <= 0.0f)
+			targetFps = (float)context.refreshRate();
+		if (mode == VSYNC && !context.setVSync(true)) {
+			HFLOGWARN("vsync not available, limiting to %3.0f fps", targetFps);
+			mode = LIMITED;
+		} else if (mode != VSYNC) {
+			context.setVSync(false);
+		}
+		mode_ = mode;
+		targetFps_ = mode == UNCAPPED ? 0.0f : targetFps;
+		period_ = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(targetFps_ > 0.0f ? 1.0 / targetFps_ : 0.0));
+		started_ = false;
+		resetStats();
+	}
+
+
+	void FramePacer::present(Context& context) {
+		if (mode_ == LIMITED)
+			_wait();
+		context.swapBuffers();
+		_record(Clock::now());
+	}
+
+
+	double FramePacer::jitterMs() const { return frames_ > 2 ? std::sqrt(m2_ / (frames_ - 2)) * 1000.0 : 0.0; }
+
+
+	void FramePacer::resetStats() {
+		frames_ = 0;
+		lateFrames_ = 0;
+		mean_ = 0.0;
+		m2_ = 0.0;
+		max_ = 0.0;
+	}
+
+
+	void FramePacer::logStats() const {
+		HFLOGINFO("Frames: %u, mean %3.3f ms, jitter %3.3f ms, max %3.3f ms, late %u",
+			frames_,
+			meanFrameMs(),
+			jitterMs(),
+			maxFrameMs(),
+			lateFrames_);
+	}
+
+
+	void FramePacer::_wait() {
+		if (!started_) {
+			next_ = Clock::now();
+			started_ = true;
+			return;
+		}
+		next_ += period_;
+		auto now = Clock::now();
+		if (next_ <= now) {
+			// a slow frame moves the schedule instead of rushing the next frames to catch up
+			next_ = now;
+			return;
+		}
+		// sleeping gives the core back, the spin covers timers that wake up late
+		if (next_ - now > spinTime)
+			std::this_thread::sleep_until(next_ - spinTime);
+		while (Clock::now() < next_)
+			std::this_thread::yield();
+	}
+
+
+	void FramePacer::_record(Clock::time_point now) {
+		if (frames_++ == 0) {
+			lastPresent_ = now;
+			return;
+		}
+		double dt = std::chrono::duration<double>(now - lastPresent_).count();
+		lastPresent_ = now;
+		unsigned n = frames_ - 1;
+		double delta = dt - mean_;
+		mean_ += delta / n;
+		m2_ += delta * (dt - mean_);
+		max_ = std::max(max_, dt);
+		if (period_.count() > 0 && dt > 1.5 * std::chrono::duration<double>(period_).count())
+			lateFrames_++;
+	}
+} // namespace GameLib
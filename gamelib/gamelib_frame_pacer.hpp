@@ -0,0 +1,77 @@
+#ifndef GAMELIB_FRAME_PACER_HPP
+#define GAMELIB_FRAME_PACER_HPP
+
+#include <gamelib_context.hpp>
+#include <chrono>
+
+namespace GameLib {
+	// FramePacer presents frames at a steady rate and measures how steady they were
+	class FramePacer {
+	public:
+		enum Mode {
+			// swapBuffers() waits for the display, falls back to LIMITED at the refresh rate if vsync cannot be set
+			VSYNC,
+			// sleeps, then spins briefly, until the next frame is due
+			LIMITED,
+			// presents as soon as a frame is drawn, for benchmarks
+			UNCAPPED
+		};
+
+		// sets the mode, targetFps is used by LIMITED and 0 means the display refresh rate
+		void setMode(Context& context, Mode mode, float targetFps = 0.0f);
+
+		Mode mode() const { return mode_; }
+
+		// returns the frame rate frames are paced to, 0 when uncapped
+		float targetFps() const { return targetFps_; }
+
+		// waits until the next frame is due, presents it and records the time since the last present
+		// use in place of Context::swapBuffers() at the end of a frame
+		void present(Context& context);
+
+		// number of frames presented since the last resetStats()
+		unsigned frames() const { return frames_; }
+
+		// average time between presents in milliseconds
+		double meanFrameMs() const { return frames_ > 1 ? mean_ * 1000.0 : 0.0; }
+
+		// standard deviation of the time between presents in milliseconds
+		double jitterMs() const;
+
+		// longest time between presents in milliseconds
+		double maxFrameMs() const { return max_ * 1000.0; }
+
+		// number of presents that came more than half a frame after they were due
+		unsigned lateFrames() const { return lateFrames_; }
+
+		void resetStats();
+
+		// logs the frame statistics
+		void logStats() const;
+
+		// time before a frame is due that the pacer stops sleeping and spins, covers coarse OS timers
+		std::chrono::microseconds spinTime{ 1500 };
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void _wait();
+		void _record(Clock::time_point now);
+
+		Mode mode_{ UNCAPPED };
+		float targetFps_{ 0.0f };
+		Clock::duration period_{ 0 };
+		Clock::time_point next_;
+		Clock::time_point lastPresent_;
+		bool started_{ false };
+
+		unsigned frames_{ 0 };
+		unsigned lateFrames_{ 0 };
+		// running mean and sum of squared differences of the present intervals in seconds
+		double mean_{ 0.0 };
+		double m2_{ 0.0 };
+		double max_{ 0.0 };
+	};
+} // namespace GameLib
+
+#endif
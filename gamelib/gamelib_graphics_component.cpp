@@ -10,11 +10,13 @@ namespace GameLib {
 		glm::vec2 c2 = b.center2d();
 		glm::vec2 p1 = a.support(c2);
 		glm::vec2 p2 = b.support(c1);
+		// same inside test as Actor::touching() without finding the support points again
+		bool inside = a.sdf(p2) < 0.0f || b.sdf(p1) < 0.0f;
 		c1 *= g.tileSizef();
 		c2 *= g.tileSizef();
 		p1 *= g.tileSizef();
 		p2 *= g.tileSizef();
-		if (a.touching(b) < 0.0f) {
+		if (inside) {
 			g.draw(c1, { 16, 16 }, Yellow);
 			g.draw(c2, { 16, 16 }, Rose);
 		} else {
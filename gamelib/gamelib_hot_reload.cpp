@@ -0,0 +1,211 @@
+#include "pch.h"
+
+#ifdef __unix__
+#if __cplusplus >= 201703L && __has_include(<filesystem>)
+#include <filesystem>
+namespace filesystem = std::filesystem;
+#else
+#include <experimental/filesystem>
+namespace filesystem = std::experimental::filesystem;
+#endif
+#else
+#include <filesystem>
+namespace filesystem = std::filesystem;
+#endif
+
+#include <gamelib_hot_reload.hpp>
+#include <set>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+namespace GameLib {
+	FileWatcher::~FileWatcher() { clear(); }
+
+
+#ifdef __linux__
+	bool FileWatcher::watch(const std::string& dir) {
+		if (fd_ < 0) {
+			fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd_ < 0) {
+				HFLOGERROR("inotify_init1() failed %d", errno);
+				return false;
+			}
+		}
+		// editors either write the file or move a new file over it
+		int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0) {
+			HFLOGWARN("Unable to watch '%s'", dir.c_str());
+			return false;
+		}
+		std::string path = dir;
+		if (path.empty() || path.back() != '/')
+			path.push_back('/');
+		watches_[wd] = path;
+		dirs_.push_back(path);
+		return true;
+	}
+
+
+	void FileWatcher::clear() {
+		if (fd_ >= 0)
+			::close(fd_);
+		fd_ = -1;
+		watches_.clear();
+		dirs_.clear();
+	}
+
+
+	int FileWatcher::poll(const std::function<void(const std::string& path)>& changed) {
+		if (fd_ < 0)
+			return 0;
+		// a save is often several events, each file is reported once
+		std::set<std::string> paths;
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			ssize_t length = ::read(fd_, buffer, sizeof(buffer));
+			if (length <= 0)
+				break;
+			for (char* p = buffer; p < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)p;
+				p += sizeof(inotify_event) + event->len;
+				auto it = watches_.find(event->wd);
+				if (it == watches_.end() || !event->len || (event->mask & IN_ISDIR))
+					continue;
+				paths.insert(it->second + event->name);
+			}
+		}
+		for (auto& path : paths)
+			changed(path);
+		return (int)paths.size();
+	}
+#else
+	bool FileWatcher::watch(const std::string& dir) {
+		std::error_code ec;
+		if (!filesystem::is_directory(dir, ec)) {
+			HFLOGWARN("Unable to watch '%s'", dir.c_str());
+			return false;
+		}
+		std::string path = dir;
+		if (path.empty() || path.back() != '/')
+			path.push_back('/');
+		dirs_.push_back(path);
+		// files that already exist are not reported
+		_scan(path, nullptr);
+		return true;
+	}
+
+
+	void FileWatcher::clear() {
+		dirs_.clear();
+		times_.clear();
+	}
+
+
+	int FileWatcher::poll(const std::function<void(const std::string& path)>& changed) {
+		unsigned now = SDL_GetTicks();
+		if (now - lastScan_ < pollInterval)
+			return 0;
+		lastScan_ = now;
+		std::vector<std::string> paths;
+		for (auto& dir : dirs_)
+			_scan(dir, &paths);
+		for (auto& path : paths)
+			changed(path);
+		return (int)paths.size();
+	}
+
+
+	void FileWatcher::_scan(const std::string& dir, std::vector<std::string>* changed) {
+		std::error_code ec;
+		for (auto& entry : filesystem::directory_iterator(dir, ec)) {
+			if (!entry.is_regular_file(ec))
+				continue;
+			int64_t time = (int64_t)entry.last_write_time(ec).time_since_epoch().count();
+			if (ec)
+				continue;
+			std::string path = dir + entry.path().filename().string();
+			auto it = times_.find(path);
+			if (it != times_.end() && it->second == time)
+				continue;
+			if (it != times_.end() && changed)
+				changed->push_back(path);
+			times_[path] = time;
+		}
+	}
+#endif
+
+
+	void HotReload::watchSearchPaths() {
+		for (auto& dir : context_.searchPaths())
+			watcher_.watch(dir);
+	}
+
+
+	void HotReload::addWorld(World& world, const std::string& filename) {
+		removeWorld(world);
+		std::string path = context_.findSearchPath(filename);
+		if (path.empty()) {
+			HFLOGWARN("'%s' not found", filename.c_str());
+			return;
+		}
+		worlds_.push_back({ &world, path });
+	}
+
+
+	void HotReload::removeWorld(World& world) {
+		worlds_.erase(std::remove_if(worlds_.begin(), worlds_.end(), [&world](const WORLDFILE& w) { return w.world == &world; }),
+					  worlds_.end());
+	}
+
+
+	void HotReload::update() {
+		watcher_.poll([this](const std::string& path) {
+			if (_reload(path))
+				reloads_++;
+		});
+	}
+
+
+	bool HotReload::_reload(const std::string& path) {
+		// the loose file is read by its path, an archive with the same name would otherwise win
+		auto same = [&path](const std::string& other) {
+			std::error_code ec;
+			return !other.empty() && filesystem::equivalent(path, other, ec);
+		};
+
+		bool reloaded = false;
+		for (auto& w : worlds_) {
+			if (!same(w.path))
+				continue;
+			World* world = w.world;
+			std::string name = path;
+			loader_.readFile(path, [world, name](const std::string& contents) {
+				int tiles = world->reload(contents);
+				HFLOGINFO("reloaded '%s', %d tiles changed", name.c_str(), tiles);
+				return true;
+			});
+			reloaded = true;
+		}
+
+		for (int tilesetId : context_.tilesetIds()) {
+			const TILESET* tileset = context_.tilesets().get(context_.findTileset(tilesetId));
+			if (!tileset || tileset->tiles.empty() || !same(context_.findSearchPath(tileset->filename)))
+				continue;
+			// tiles are separate textures, so the whole tileset is cut again
+			loader_.loadTileset(tilesetId, tileset->tiles[0].w, tileset->tiles[0].h, path);
+			reloaded = true;
+		}
+
+		ImageHandle image = context_.findImage(filesystem::path(path).filename().string());
+		const TEXTUREINFO* info = context_.images().get(image);
+		if (info && same(context_.findSearchPath(info->filename))) {
+			context_.reloadImage(image, path);
+			reloaded = true;
+		}
+		return reloaded;
+	}
+} // namespace GameLib
@@ -0,0 +1,84 @@
+#ifndef GAMELIB_HOT_RELOAD_HPP
+#define GAMELIB_HOT_RELOAD_HPP
+
+#include <gamelib_asset_loader.hpp>
+#include <gamelib_world.hpp>
+
+namespace GameLib {
+	// FileWatcher reports files that were written in watched directories, subdirectories are not watched
+	// Linux uses inotify, other platforms compare modification times every pollInterval
+	class FileWatcher {
+	public:
+		FileWatcher() {}
+		~FileWatcher();
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+
+		// returns false if the directory can not be watched
+		bool watch(const std::string& dir);
+
+		// stops watching every directory
+		void clear();
+
+		// calls changed once for each file written since the last poll, never blocks
+		// returns the number of files reported
+		int poll(const std::function<void(const std::string& path)>& changed);
+
+		// milliseconds between modification time scans when inotify is not available
+		unsigned pollInterval{ 500 };
+
+	private:
+		std::vector<std::string> dirs_;
+#ifdef __linux__
+		int fd_{ -1 };
+		// inotify watch descriptors and their directories
+		std::map<int, std::string> watches_;
+#else
+		void _scan(const std::string& dir, std::vector<std::string>* changed);
+		// last modification time of each file
+		std::map<std::string, int64_t> times_;
+		unsigned lastScan_{ 0 };
+#endif
+	};
+
+	// HotReload applies edits to worlds, tilesets and images while the game runs
+	// Files are read and decoded by the AssetLoader, so a reload does not stall a frame
+	// Worlds only replace the tiles that changed, tilesets and images are replaced whole
+	class HotReload {
+	public:
+		HotReload(Context& context, AssetLoader& loader) : context_(context), loader_(loader) {}
+
+		// watches every search path of the context
+		void watchSearchPaths();
+
+		// watches a directory that is not a search path
+		bool watch(const std::string& dir) { return watcher_.watch(dir); }
+
+		// reloads world when filename changes, world must outlive the HotReload and the loader
+		void addWorld(World& world, const std::string& filename);
+
+		void removeWorld(World& world);
+
+		// starts reloading the files that changed, call once a frame before AssetLoader::update()
+		void update();
+
+		// number of files that changed and were reloaded
+		unsigned reloads() const { return reloads_; }
+
+	private:
+		struct WORLDFILE {
+			World* world{ nullptr };
+			std::string path;
+		};
+
+		bool _reload(const std::string& path);
+
+		Context& context_;
+		AssetLoader& loader_;
+		FileWatcher watcher_;
+		std::vector<WORLDFILE> worlds_;
+		unsigned reloads_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef GAMELIB_INPUT_EVENT_HPP
+#define GAMELIB_INPUT_EVENT_HPP
+
+#include <gamelib_base.hpp>
+#include <atomic>
+
+namespace GameLib {
+	// INPUTEVENT is a single change of a key or controller input
+	struct INPUTEVENT {
+		enum { KEYDOWN, KEYUP, CONTROLLERAXIS, CONTROLLERBUTTON };
+		// SDL_GetTicks() time the event happened
+		uint32_t timestamp{ 0 };
+		uint16_t type{ KEYDOWN };
+		// scancode for keys, controller index << 8 | SDL axis or button for controllers
+		uint16_t code{ 0 };
+		// -1 to 1 for axes, 0 or 1 for keys and buttons
+		float value{ 0.0f };
+	};
+
+	// InputEventRing is a fixed size single producer, single consumer queue of input events
+	// one thread may push while another pops without locks, events are dropped when it is full
+	class InputEventRing {
+	public:
+		static constexpr uint32_t Capacity = 1024;
+
+		// adds an event, returns false and counts a drop if the ring is full
+		bool push(const INPUTEVENT& e) {
+			uint32_t head = head_.load(std::memory_order_relaxed);
+			if (head - tail_.load(std::memory_order_acquire) >= Capacity) {
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			events_[head & (Capacity - 1)] = e;
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// copies the oldest event into e without removing it, returns false if the ring is empty
+		bool peek(INPUTEVENT& e) const {
+			uint32_t tail = tail_.load(std::memory_order_relaxed);
+			if (tail == head_.load(std::memory_order_acquire))
+				return false;
+			e = events_[tail & (Capacity - 1)];
+			return true;
+		}
+
+		// removes the oldest event into e, returns false if the ring is empty
+		bool pop(INPUTEVENT& e) {
+			if (!peek(e))
+				return false;
+			tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			return true;
+		}
+
+		// calls f(e) for every event that happened at or before timestamp, oldest first, returns number consumed
+		template <typename F>
+		int popUntil(uint32_t timestamp, F f) {
+			int count = 0;
+			INPUTEVENT e;
+			// compared as a difference so the SDL tick counter wrapping is handled
+			while (peek(e) && (int32_t)(e.timestamp - timestamp) <= 0) {
+				tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+				f(e);
+				count++;
+			}
+			return count;
+		}
+
+		// drops every queued event, only call from the consumer
+		void clear() { tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release); }
+
+		// returns number of queued events
+		uint32_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+		// returns number of events dropped because the ring was full
+		uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+	private:
+		INPUTEVENT events_[Capacity];
+		// producer and consumer indices on separate cache lines so they do not false share
+		alignas(64) std::atomic<uint32_t> head_{ 0 };
+		alignas(64) std::atomic<uint32_t> tail_{ 0 };
+		std::atomic<uint32_t> dropped_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
@@ -5,58 +5,209 @@
 #define CHECKPOINTER(button)                                                                                                                                   \
     if (!button)                                                                                                                                               \
         button = &nullCommand;
-#define CHECKSCANCODE(x, command)                                                                                                                              \
-    if (context->keyboard.scancodes[SDL_SCANCODE_##x]) {                                                                                                       \
-        command;                                                                                                                                               \
+
+namespace GameLib {
+    // axis commands in the order their values are summed in handle()
+    static InputCommand* InputHandler::*const AxisCommands[] = {
+        &InputHandler::axis1X,
+        &InputHandler::axis1Y,
+        &InputHandler::axis1Z,
+        &InputHandler::axis2X,
+        &InputHandler::axis2Y,
+        &InputHandler::axis2Z,
+    };
+    static_assert(sizeof(AxisCommands) / sizeof(AxisCommands[0]) == InputHandler::AxisCount, "one command for each axis");
+
+    // the index in AxisCommands moved by an SDL_GameControllerAxis, -1 for the triggers
+    static int stickAxis(int axis) {
+        switch (axis) {
+        case SDL_CONTROLLER_AXIS_LEFTX: return 0;
+        case SDL_CONTROLLER_AXIS_LEFTY: return 1;
+        case SDL_CONTROLLER_AXIS_RIGHTX: return 3;
+        case SDL_CONTROLLER_AXIS_RIGHTY: return 4;
+        default: return -1;
+        }
     }
-#define HANDLESCANCODE(x, command, value)                                                                                                                      \
-    if (command && context->keyboard.scancodes[SDL_SCANCODE_##x]) {                                                                                            \
-        bool result = command->execute(value);                                                                                                                 \
-        if (result)                                                                                                                                            \
-            context->keyboard.scancodes[SDL_SCANCODE_##x] = 0;                                                                                                 \
+
+    // the buttons a controller holds, one bit for each SDL_GameControllerButton it keeps
+    static uint32_t heldButtons(const Context::GAMECONTROLLERSTATE& j) {
+        uint32_t held = 0;
+        held |= j.a > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_A : 0;
+        held |= j.b > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_B : 0;
+        held |= j.x > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_X : 0;
+        held |= j.y > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_Y : 0;
+        held |= j.back > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_BACK : 0;
+        held |= j.start > 0.0f ? 1u << SDL_CONTROLLER_BUTTON_START : 0;
+        return held;
+    }
+
+    InputHandler::InputHandler() {
+        const float ONE = 1.0f;
+        keyBindings = {
+            { SDL_SCANCODE_W, &InputHandler::dpadPosY, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_S, &InputHandler::dpadNegY, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_A, &InputHandler::dpadNegX, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_D, &InputHandler::dpadPosX, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_ESCAPE, &InputHandler::back, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_RETURN, &InputHandler::start, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_SPACE, &InputHandler::buttonA, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_LEFT, &InputHandler::axis1X, -ONE, KEYBINDING::AXIS },
+            { SDL_SCANCODE_RIGHT, &InputHandler::axis1X, ONE, KEYBINDING::AXIS },
+            { SDL_SCANCODE_UP, &InputHandler::axis1Y, -ONE, KEYBINDING::AXIS },
+            { SDL_SCANCODE_DOWN, &InputHandler::axis1Y, ONE, KEYBINDING::AXIS },
+            { SDL_SCANCODE_1, &InputHandler::key1, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_2, &InputHandler::key2, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_3, &InputHandler::key3, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_4, &InputHandler::key4, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_5, &InputHandler::key5, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_6, &InputHandler::key6, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_7, &InputHandler::key7, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_8, &InputHandler::key8, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_9, &InputHandler::key9, ONE, KEYBINDING::PRESSED },
+            { SDL_SCANCODE_0, &InputHandler::key0, ONE, KEYBINDING::PRESSED },
+        };
+        buttonBindings = {
+            { SDL_CONTROLLER_BUTTON_A, &InputHandler::buttonA, ONE },
+            { SDL_CONTROLLER_BUTTON_B, &InputHandler::buttonB, ONE },
+            { SDL_CONTROLLER_BUTTON_X, &InputHandler::buttonX, ONE },
+            { SDL_CONTROLLER_BUTTON_Y, &InputHandler::buttonY, ONE },
+            { SDL_CONTROLLER_BUTTON_START, &InputHandler::start, ONE },
+            { SDL_CONTROLLER_BUTTON_BACK, &InputHandler::back, ONE },
+        };
+    }
+
+    void InputHandler::bind(int scancode, InputCommand* InputHandler::*command, float value, KEYBINDING::Trigger trigger) {
+        keyBindings.push_back({ scancode, command, value, trigger });
+    }
+
+    void InputHandler::unbind(int scancode) {
+        keyBindings.erase(std::remove_if(keyBindings.begin(),
+                              keyBindings.end(),
+                              [scancode](const KEYBINDING& b) { return b.scancode == scancode; }),
+            keyBindings.end());
     }
 
-namespace GameLib {
     void InputHandler::handle() {
         Context* context = Locator::getContext();
         _checkPointers();
-        const float ONE = 1.0f;
-        HANDLESCANCODE(W, dpadPosY, ONE);
-        HANDLESCANCODE(S, dpadNegY, ONE);
-        HANDLESCANCODE(A, dpadNegX, ONE);
-        HANDLESCANCODE(D, dpadPosX, ONE);
-        HANDLESCANCODE(ESCAPE, back, ONE);
-        HANDLESCANCODE(RETURN, start, ONE);
-        HANDLESCANCODE(SPACE, buttonA, ONE);
-        glm::vec3 axis1{ 0.0f, 0.0f, 0.0f };
-        CHECKSCANCODE(LEFT, axis1.x -= 1);
-        CHECKSCANCODE(RIGHT, axis1.x += 1);
-        CHECKSCANCODE(UP, axis1.y -= 1);
-        CHECKSCANCODE(DOWN, axis1.y += 1);
+        auto& keyboard = context->keyboard;
 
+        // the first connected controller is used, one that takes its place starts at rest
+        int controller = -1;
         for (int i = 0; i < context->MaxGameControllers; i++) {
-			// use first working controller
             if (context->gameControllers[i].enabled) {
-                axis1.x += context->gameControllers[0].axis1.x;
-                axis1.y += context->gameControllers[0].axis1.y;
-                // axis2.x += context->gameControllers[0].axis2.x;
-                // axis2.y += context->gameControllers[0].axis2.y;
+                controller = i;
                 break;
             }
         }
-        axis1X->execute(axis1.x);
-        axis1Y->execute(axis1.y);
+        if (controller != controller_) {
+            controller_ = controller;
+            heldButtons_ = 0;
+            std::fill(std::begin(stickAxes_), std::end(stickAxes_), 0.0f);
+        }
+        uint32_t held = controller_ >= 0 ? heldButtons(context->gameControllers[controller_]) : 0;
+        if (!stepEvents) {
+            // presses come from the keyboard edges and the controller state, so the queued events are not needed
+            context->inputEvents.clear();
+            for (int button = 0; button < 32; button++) {
+                if ((held & ~heldButtons_) >> button & 1)
+                    _executeButton(button);
+            }
+            if (controller_ >= 0) {
+                const auto& j = context->gameControllers[controller_];
+                stickAxes_[0] = j.axis1.x;
+                stickAxes_[1] = j.axis1.y;
+                stickAxes_[3] = j.axis2.x;
+                stickAxes_[4] = j.axis2.y;
+            }
+        }
+        heldButtons_ = held;
 
-        HANDLESCANCODE(1, key1, ONE);
-        HANDLESCANCODE(2, key2, ONE);
-        HANDLESCANCODE(3, key3, ONE);
-        HANDLESCANCODE(4, key4, ONE);
-        HANDLESCANCODE(5, key5, ONE);
-        HANDLESCANCODE(6, key6, ONE);
-        HANDLESCANCODE(7, key7, ONE);
-        HANDLESCANCODE(8, key8, ONE);
-        HANDLESCANCODE(9, key9, ONE);
-        HANDLESCANCODE(0, key0, ONE);
+        // a released key can be pressed and used up again
+        usedPresses_ &= keyboard.down;
+        std::fill(std::begin(keyAxes_), std::end(keyAxes_), 0.0f);
+        for (auto& b : keyBindings) {
+            switch (b.trigger) {
+            case KEYBINDING::PRESSED:
+                // handleEvents() runs new presses at their step, held keys repeat here either way
+                if (keyboard.wasPressed(b.scancode) ? !stepEvents : (keyboard.isDown(b.scancode) && !usedPresses_[b.scancode]))
+                    _executePressed(b);
+                break;
+            case KEYBINDING::DOWN:
+                if (keyboard.isDown(b.scancode))
+                    (this->*b.command)->execute(b.value);
+                break;
+            case KEYBINDING::AXIS:
+                if (!keyboard.isDown(b.scancode))
+                    break;
+                for (int i = 0; i < AxisCount; i++) {
+                    if (AxisCommands[i] == b.command)
+                        keyAxes_[i] += b.value;
+                }
+                break;
+            }
+        }
+        _executeAxes();
+    }
+
+    void InputHandler::handleEvents(uint32_t timestamp) {
+        Context* context = Locator::getContext();
+        _checkPointers();
+        bool sticksMoved = false;
+        context->inputEvents.popUntil(timestamp, [&](const INPUTEVENT& e) {
+            // controller events carry the controller index in the high byte of the code
+            bool used = (e.code >> 8) == controller_;
+            switch (e.type) {
+            case INPUTEVENT::KEYDOWN:
+                for (auto& b : keyBindings) {
+                    if (b.trigger == KEYBINDING::PRESSED && b.scancode == e.code)
+                        _executePressed(b);
+                }
+                break;
+            case INPUTEVENT::CONTROLLERBUTTON:
+                if (used && e.value > 0.0f)
+                    _executeButton(e.code & 0xff);
+                break;
+            case INPUTEVENT::CONTROLLERAXIS: {
+                int axis = stickAxis(e.code & 0xff);
+                if (used && axis >= 0) {
+                    stickAxes_[axis] = e.value;
+                    sticksMoved = true;
+                }
+                break;
+            }
+            }
+        });
+        if (sticksMoved)
+            _executeAxes();
+    }
+
+    void InputHandler::_executeButton(int button) {
+        for (auto& b : buttonBindings) {
+            if (b.button == button)
+                (this->*b.command)->execute(b.value);
+        }
+    }
+
+    void InputHandler::_executeAxes() {
+        // axes hold their value, so commands only hear about changes
+        for (int i = 0; i < AxisCount; i++) {
+            float value = keyAxes_[i] + stickAxes_[i];
+            InputCommand* command = this->*AxisCommands[i];
+            if (value == axisValues_[i] && command == axisCommands_[i])
+                continue;
+            command->execute(value);
+            axisValues_[i] = value;
+            axisCommands_[i] = command;
+        }
+    }
+
+    bool InputHandler::_executePressed(const KEYBINDING& b) {
+        if (!(this->*b.command)->execute(b.value))
+            return false;
+        Locator::getContext()->keyboard.checkClear(b.scancode);
+        usedPresses_.set(b.scancode);
+        return true;
     }
 
     void InputHandler::_checkPointers() {
@@ -85,7 +236,7 @@ namespace GameLib {
         CHECKPOINTER(key2);
         CHECKPOINTER(key3);
         CHECKPOINTER(key4);
-        CHECKPOINTER(key1);
+        CHECKPOINTER(key5);
         CHECKPOINTER(key6);
         CHECKPOINTER(key7);
         CHECKPOINTER(key8);
@@ -2,12 +2,63 @@
 #define GAMELIB_INPUT_HANDLER_HPP
 
 #include <gamelib_command.hpp>
+#include <bitset>
 
 namespace GameLib {
+    class InputHandler;
+
+    // KEYBINDING maps a scancode to one of the InputHandler commands
+    struct KEYBINDING {
+        enum Trigger {
+            // execute when the key goes down and every frame it is held until the command returns true,
+            // which uses up the press until the key is released
+            PRESSED,
+            // execute every frame the key is held down
+            DOWN,
+            // add value to the axis command while the key is held, axes execute when their value changes
+            AXIS
+        };
+        int scancode{ 0 };
+        InputCommand* InputHandler::*command{ nullptr };
+        float value{ 1.0f };
+        Trigger trigger{ PRESSED };
+    };
+
+    // BUTTONBINDING maps a controller button to one of the InputHandler commands, executed when the button goes down
+    struct BUTTONBINDING {
+        // SDL_GameControllerButton
+        int button{ 0 };
+        InputCommand* InputHandler::*command{ nullptr };
+        float value{ 1.0f };
+    };
+
     class InputHandler {
     public:
+        InputHandler();
+
+        // executes commands for the keyboard and controller state of this frame
         void handle();
 
+        // executes PRESSED and button bindings and moves controller sticks for events queued up to timestamp,
+        // call before each fixed step when stepEvents is true so an input lands on the step it happened in
+        void handleEvents(uint32_t timestamp);
+
+        // true if PRESSED bindings, button bindings and controller sticks come from handleEvents() instead of handle()
+        bool stepEvents{ false };
+
+        // adds a binding, keys may have more than one
+        void bind(int scancode, InputCommand* InputHandler::*command, float value, KEYBINDING::Trigger trigger);
+
+        // removes every binding for the key
+        void unbind(int scancode);
+
+        // the default bindings are WASD for the dpad, arrows for axis 1, escape, return, space and the number keys
+        std::vector<KEYBINDING> keyBindings;
+
+        // the default bindings are A, B, X, Y, start and back to the commands of the same name,
+        // they are read from the first connected controller, whose left and right sticks are axis 1 and axis 2
+        std::vector<BUTTONBINDING> buttonBindings;
+
         InputCommand* axis1X{ nullptr };
         InputCommand* axis1Y{ nullptr };
         InputCommand* axis1Z{ nullptr };
@@ -44,6 +95,32 @@ namespace GameLib {
         InputCommand nullCommand;
 
         void _checkPointers();
+
+        // axis1X to axis2Z
+        static constexpr int AxisCount = 6;
+
+    private:
+        // executes a PRESSED binding, returns true if the command used up the press
+        bool _executePressed(const KEYBINDING& b);
+
+        // executes the bindings of a controller button that went down
+        void _executeButton(int button);
+
+        // executes the axis commands whose keyboard and stick total changed
+        void _executeAxes();
+
+        // keys whose press a PRESSED command used up, cleared once the key is released
+        std::bitset<SDL_NUM_SCANCODES> usedPresses_;
+        // the value each axis command was last executed with, and the command it went to
+        float axisValues_[AxisCount]{};
+        InputCommand* axisCommands_[AxisCount]{};
+        // what the keys and the controller sticks add to each axis
+        float keyAxes_[AxisCount]{};
+        float stickAxes_[AxisCount]{};
+        // the controller whose input is used, -1 when none is connected
+        int controller_{ -1 };
+        // buttons held on that controller at the last handle(), by SDL_GameControllerButton
+        uint32_t heldButtons_{ 0 };
     };
 }
 
@@ -0,0 +1,603 @@
+#include "pch.h"
+#include <gamelib_net.hpp>
+#include <gamelib_snapshot.hpp>
+
+namespace GameLib {
+	namespace {
+		// fields of a NETACTORSTATE that changed, written after the id of each update
+		enum : uint8_t { NETPOSITION = 1, NETVELOCITY = 2, NETSIZE = 4, NETSPRITE = 8, NETFLAGS = 16, NETALL = 31 };
+
+		// a server keeps this many unacknowledged ticks per client, and a client this many decoded ticks
+		constexpr size_t ServerHistory = 64;
+		constexpr size_t ClientHistory = 64;
+		// older acknowledged ticks are not used as baselines, in case the client no longer has them
+		constexpr uint32_t MaxBaselineAge = 32;
+		// messages still queued when a socket closes, like a goodbye, get this long to leave
+		constexpr int LingerMilliseconds = 100;
+
+		template <typename T>
+		void put(std::vector<uint8_t>& out, const T& value) {
+			const uint8_t* bytes = (const uint8_t*)&value;
+			out.insert(out.end(), bytes, bytes + sizeof(T));
+		}
+
+		uint8_t changedFields(const NETACTORSTATE& a, const NETACTORSTATE& b) {
+			uint8_t mask = 0;
+			if (a.position != b.position)
+				mask |= NETPOSITION;
+			if (a.velocity != b.velocity)
+				mask |= NETVELOCITY;
+			if (a.size != b.size)
+				mask |= NETSIZE;
+			if (a.spriteLibId != b.spriteLibId || a.spriteId != b.spriteId)
+				mask |= NETSPRITE;
+			if (a.charDesc != b.charDesc || a.type != b.type || a.flags != b.flags)
+				mask |= NETFLAGS;
+			return mask;
+		}
+
+		void putFields(std::vector<uint8_t>& out, const NETACTORSTATE& s, uint8_t mask) {
+			put(out, s.id);
+			put(out, mask);
+			if (mask & NETPOSITION)
+				put(out, s.position);
+			if (mask & NETVELOCITY)
+				put(out, s.velocity);
+			if (mask & NETSIZE)
+				put(out, s.size);
+			if (mask & NETSPRITE) {
+				put(out, s.spriteLibId);
+				put(out, s.spriteId);
+			}
+			if (mask & NETFLAGS) {
+				put(out, s.charDesc);
+				put(out, s.type);
+				put(out, s.flags);
+			}
+		}
+
+		void readFields(SnapshotReader& r, NETACTORSTATE& s, uint8_t mask) {
+			if (mask & NETPOSITION)
+				r.read(s.position);
+			if (mask & NETVELOCITY)
+				r.read(s.velocity);
+			if (mask & NETSIZE)
+				r.read(s.size);
+			if (mask & NETSPRITE) {
+				r.read(s.spriteLibId);
+				r.read(s.spriteId);
+			}
+			if (mask & NETFLAGS) {
+				r.read(s.charDesc);
+				r.read(s.type);
+				r.read(s.flags);
+			}
+		}
+
+		bool byId(const NETACTORSTATE& s, uint32_t id) { return s.id < id; }
+
+		bool readHeader(SnapshotReader& r, NETHEADER& header) {
+			NETHEADER expected;
+			return r.read(header) && !memcmp(header.magic, expected.magic, 2) && header.version == expected.version;
+		}
+	} // namespace
+
+
+	bool NetSocket::bind(const std::string& endpoint) {
+		close();
+		sock_ = zsock_new_router(("@" + endpoint).c_str());
+		if (!sock_) {
+			HFLOGERROR("cannot bind '%s'", endpoint.c_str());
+			return false;
+		}
+		router_ = true;
+		zsock_set_rcvtimeo(sock_, 0);
+		zsock_set_sndtimeo(sock_, 0);
+		zsock_set_linger(sock_, LingerMilliseconds);
+		return true;
+	}
+
+
+	bool NetSocket::connect(const std::string& endpoint) {
+		close();
+		sock_ = zsock_new_dealer((">" + endpoint).c_str());
+		if (!sock_) {
+			HFLOGERROR("cannot connect to '%s'", endpoint.c_str());
+			return false;
+		}
+		router_ = false;
+		zsock_set_rcvtimeo(sock_, 0);
+		zsock_set_sndtimeo(sock_, 0);
+		zsock_set_linger(sock_, LingerMilliseconds);
+		return true;
+	}
+
+
+	void NetSocket::close() {
+		if (sock_)
+			zsock_destroy(&sock_);
+		sock_ = nullptr;
+		pending_.clear();
+	}
+
+
+	bool NetSocket::send(const std::string& peer, const std::vector<uint8_t>& data) {
+		if (!sock_)
+			return false;
+		zmsg_t* msg = zmsg_new();
+		if (router_)
+			zmsg_addmem(msg, peer.data(), peer.size());
+		zmsg_addmem(msg, data.data(), data.size());
+		if (zmsg_send(&msg, sock_) != 0) {
+			zmsg_destroy(&msg);
+			return false;
+		}
+		bytesSent_ += data.size();
+		return true;
+	}
+
+
+	bool NetSocket::receive(std::string& peer, std::vector<uint8_t>& data) {
+		_pump();
+		if (pending_.empty() || pending_.front().time > now())
+			return false;
+		peer = std::move(pending_.front().peer);
+		data = std::move(pending_.front().data);
+		pending_.pop_front();
+		return true;
+	}
+
+
+	void NetSocket::setConditions(const NETCONDITIONS& conditions) {
+		conditions_ = conditions;
+		rng_.seed(conditions.seed);
+	}
+
+
+	void NetSocket::_pump() {
+		if (!sock_)
+			return;
+		std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+		while (zmsg_t* msg = zmsg_recv(sock_)) {
+			zframe_t* peer = router_ ? zmsg_pop(msg) : nullptr;
+			zframe_t* body = zmsg_pop(msg);
+			if (body && (!router_ || peer)) {
+				bytesReceived_ += zframe_size(body);
+				if (conditions_.loss > 0.0f && uniform(rng_) < conditions_.loss) {
+					messagesDropped_++;
+				} else {
+					PENDING p;
+					float delay = conditions_.latency + conditions_.jitter * (2.0f * uniform(rng_) - 1.0f);
+					p.time = now() + (int64_t)std::max(0.0f, delay);
+					if (peer)
+						p.peer.assign((const char*)zframe_data(peer), zframe_size(peer));
+					p.data.assign(zframe_data(body), zframe_data(body) + zframe_size(body));
+					auto at = std::upper_bound(pending_.begin(), pending_.end(), p.time,
+						[](int64_t t, const PENDING& other) { return t < other.time; });
+					pending_.insert(at, std::move(p));
+				}
+			}
+			if (peer)
+				zframe_destroy(&peer);
+			if (body)
+				zframe_destroy(&body);
+			zmsg_destroy(&msg);
+		}
+	}
+
+
+	NETACTORSTATE NETACTORSTATE::fromActor(const Actor& actor) {
+		NETACTORSTATE s;
+		s.id = actor.getId();
+		s.charDesc = actor.charDesc();
+		s.type = actor.isDynamic() ? Actor::DYNAMIC : (actor.isStatic() ? Actor::STATIC : (actor.isTrigger() ? Actor::TRIGGER : Actor::NONE));
+		s.flags = (actor.visible ? VISIBLE : 0) | (actor.active ? ACTIVE : 0) | (actor.sprite.flipX ? FLIPX : 0) |
+				  (actor.sprite.flipY ? FLIPY : 0);
+		s.position = actor.position2d();
+		s.velocity = actor.velocity2d();
+		s.size = actor.size2d();
+		s.spriteLibId = actor.sprite.libId;
+		// the same frame SimpleGraphicsComponent draws
+		int frame = actor.anim.currentFrame();
+		s.spriteId = frame ? (uint32_t)frame : actor.spriteId();
+		return s;
+	}
+
+
+	bool NetServer::start(const std::string& endpoint) {
+		stop();
+		if (!socket_.bind(endpoint))
+			return false;
+		HFLOGINFO("serving on '%s'", endpoint.c_str());
+		return true;
+	}
+
+
+	void NetServer::stop() {
+		if (!socket_.isOpen())
+			return;
+		socket_.close();
+		clients_.clear();
+	}
+
+
+	void NetServer::update(float deltaTime) {
+		if (!socket_.isOpen())
+			return;
+		_receive();
+		float step = 1.0f / tickRate;
+		accumulator_ += deltaTime;
+		if (accumulator_ < step)
+			return;
+		// a slow frame sends one tick rather than a burst
+		accumulator_ = std::min(accumulator_ - step, step);
+		tick_++;
+		_gather();
+		for (auto& c : clients_)
+			_send(c.second);
+	}
+
+
+	void NetServer::logStats() const {
+		HFLOGINFO("NetServer: %d clients, %u ticks, %llu messages, %llu KB, %llu actors sent, %llu deferred",
+			clientCount(),
+			tick_,
+			(unsigned long long)messagesSent_,
+			(unsigned long long)(socket_.bytesSent() / 1024),
+			(unsigned long long)actorsSent_,
+			(unsigned long long)actorsDeferred_);
+	}
+
+
+	void NetServer::_receive() {
+		std::string peer;
+		std::vector<uint8_t> data;
+		int64_t now = NetSocket::now();
+		while (socket_.receive(peer, data)) {
+			SnapshotReader r(data.data(), data.size());
+			NETHEADER header;
+			if (!readHeader(r, header))
+				continue;
+			if (header.type == NETHEADER::BYE) {
+				if (clients_.erase(peer))
+					HFLOGINFO("client left, %d connected", clientCount());
+				continue;
+			}
+			if (header.type != NETHEADER::CLIENTSTATE)
+				continue;
+			auto it = clients_.find(peer);
+			if (it == clients_.end()) {
+				it = clients_.emplace(peer, CLIENT()).first;
+				it->second.peer = peer;
+				HFLOGINFO("client joined, %d connected", clientCount());
+			}
+			CLIENT& c = it->second;
+			c.lastHeard = now;
+			r.read(c.camera);
+			// acknowledgements can arrive out of order, and only ticks still kept can be baselines
+			if (header.tick > c.ackTick && c.sent.count(header.tick)) {
+				c.ackTick = header.tick;
+				c.sent.erase(c.sent.begin(), c.sent.find(c.ackTick));
+			}
+		}
+
+		int64_t timeoutMs = (int64_t)(timeout * 1000.0f);
+		for (auto it = clients_.begin(); it != clients_.end();) {
+			if (now - it->second.lastHeard > timeoutMs) {
+				HFLOGINFO("client timed out, %d connected", clientCount() - 1);
+				it = clients_.erase(it);
+				continue;
+			}
+			++it;
+		}
+	}
+
+
+	void NetServer::_gather() {
+		current_.clear();
+		for (auto* actors : { &world_.dynamicActors, &world_.staticActors, &world_.triggerActors }) {
+			for (auto& a : *actors)
+				current_.push_back(NETACTORSTATE::fromActor(*a));
+		}
+		std::sort(current_.begin(), current_.end(), [](const NETACTORSTATE& a, const NETACTORSTATE& b) { return a.id < b.id; });
+	}
+
+
+	void NetServer::_send(CLIENT& client) {
+		static const STATES none;
+		auto baseline = client.sent.find(client.ackTick);
+		bool hasBaseline = baseline != client.sent.end() && tick_ - client.ackTick <= MaxBaselineAge;
+		const STATES& base = hasBaseline ? baseline->second : none;
+
+		// both lists are sorted by id, so they are walked together
+		struct CANDIDATE {
+			const NETACTORSTATE* state;
+			uint8_t mask;
+			float priority;
+		};
+		std::vector<uint32_t> removed;
+		std::vector<CANDIDATE> candidates;
+		std::map<uint32_t, float> waiting;
+		size_t i = 0;
+		size_t j = 0;
+		while (i < current_.size() || j < base.size()) {
+			if (j == base.size() || (i < current_.size() && current_[i].id < base[j].id)) {
+				candidates.push_back({ &current_[i++], NETALL, 0.0f });
+			} else if (i == current_.size() || base[j].id < current_[i].id) {
+				removed.push_back(base[j++].id);
+			} else {
+				uint8_t mask = changedFields(current_[i], base[j]);
+				if (mask)
+					candidates.push_back({ &current_[i], mask, 0.0f });
+				i++;
+				j++;
+			}
+		}
+		for (auto& c : candidates) {
+			float distance = glm::length(c.state->position + c.state->size * 0.5f - client.camera);
+			auto it = client.priority.find(c.state->id);
+			float waited = it != client.priority.end() ? it->second : 0.0f;
+			c.priority = waited + priorityRadius / (priorityRadius + distance);
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const CANDIDATE& a, const CANDIDATE& b) { return a.priority > b.priority; });
+
+		NETHEADER header;
+		header.type = NETHEADER::STATE;
+		header.tick = tick_;
+		message_.clear();
+		put(message_, header);
+		put(message_, hasBaseline ? client.ackTick : 0u);
+		put(message_, tickRate);
+		put(message_, (uint32_t)removed.size());
+		size_t countAt = message_.size();
+		put(message_, (uint32_t)0);
+		for (uint32_t id : removed)
+			put(message_, id);
+
+		STATES merged = base;
+		for (uint32_t id : removed) {
+			auto it = std::lower_bound(merged.begin(), merged.end(), id, byId);
+			merged.erase(it);
+		}
+		size_t budget = (size_t)(bandwidth / tickRate);
+		uint32_t count = 0;
+		for (auto& c : candidates) {
+			// at least one actor goes each tick, so a tiny budget still makes progress
+			// a state without a baseline replaces all the client has, so it carries every actor whatever the budget
+			if (hasBaseline && count && message_.size() >= budget) {
+				waiting[c.state->id] = c.priority;
+				actorsDeferred_++;
+				continue;
+			}
+			putFields(message_, *c.state, c.mask);
+			auto it = std::lower_bound(merged.begin(), merged.end(), c.state->id, byId);
+			if (it != merged.end() && it->id == c.state->id)
+				*it = *c.state;
+			else
+				merged.insert(it, *c.state);
+			count++;
+		}
+		memcpy(message_.data() + countAt, &count, sizeof(count));
+		client.priority = std::move(waiting);
+		actorsSent_ += count;
+
+		if (socket_.send(client.peer, message_))
+			messagesSent_++;
+		client.sent[tick_] = std::move(merged);
+		while (client.sent.size() > ServerHistory)
+			client.sent.erase(client.sent.begin());
+	}
+
+
+	bool NetClient::connect(const std::string& endpoint) {
+		disconnect();
+		if (!socket_.connect(endpoint))
+			return false;
+		// the first message makes the server add the client
+		_sendState({ 0.0f, 0.0f });
+		HFLOGINFO("connecting to '%s'", endpoint.c_str());
+		return true;
+	}
+
+
+	void NetClient::disconnect() {
+		if (!socket_.isOpen())
+			return;
+		NETHEADER header;
+		header.type = NETHEADER::BYE;
+		std::vector<uint8_t> message;
+		put(message, header);
+		socket_.send("", message);
+		socket_.close();
+		for (auto& s : shown_)
+			world_.removeActor(s.id);
+		shown_.clear();
+		history_.clear();
+		ackTick_ = 0;
+		received_ = false;
+	}
+
+
+	void NetClient::update(float deltaTime, glm::vec2 camera) {
+		if (!socket_.isOpen())
+			return;
+		std::string peer;
+		std::vector<uint8_t> data;
+		bool fresh = false;
+		while (socket_.receive(peer, data)) {
+			if (_read(data)) {
+				statesReceived_++;
+				fresh = true;
+			}
+		}
+		// acknowledgements go as soon as a state is read, and the camera at least four times a second
+		if (fresh || NetSocket::now() - lastSent_ >= 250)
+			_sendState(camera);
+		if (history_.empty())
+			return;
+
+		double target = (double)ackTick_ - interpolationDelay * tickRate_;
+		if (!received_ || std::abs(renderTick_ - target) > tickRate_ * 0.5) {
+			renderTick_ = target;
+			received_ = true;
+		} else {
+			// the clock follows the arrivals gently so the motion does not jump
+			renderTick_ += deltaTime * tickRate_;
+			renderTick_ += (target - renderTick_) * 0.05;
+		}
+		_apply();
+	}
+
+
+	void NetClient::logStats() const {
+		HFLOGINFO("NetClient: tick %u, %u states, %u dropped, %llu KB received, %u messages lost",
+			ackTick_,
+			statesReceived_,
+			statesDropped_,
+			(unsigned long long)(socket_.bytesReceived() / 1024),
+			socket_.messagesDropped());
+	}
+
+
+	bool NetClient::_read(const std::vector<uint8_t>& data) {
+		SnapshotReader r(data.data(), data.size());
+		NETHEADER header;
+		uint32_t baseTick = 0;
+		float tickRate = 0.0f;
+		uint32_t removedCount = 0;
+		uint32_t updateCount = 0;
+		if (!readHeader(r, header) || header.type != NETHEADER::STATE)
+			return false;
+		r.read(baseTick);
+		r.read(tickRate);
+		r.read(removedCount);
+		r.read(updateCount);
+		if (!r.ok() || header.tick == 0)
+			return false;
+		auto byTick = [](const SNAPSHOT& s, uint32_t tick) { return s.tick < tick; };
+		auto at = std::lower_bound(history_.begin(), history_.end(), header.tick, byTick);
+		if (at != history_.end() && at->tick == header.tick)
+			return false;
+
+		SNAPSHOT s;
+		s.tick = header.tick;
+		if (baseTick) {
+			auto base = std::lower_bound(history_.begin(), history_.end(), baseTick, byTick);
+			if (base == history_.end() || base->tick != baseTick) {
+				statesDropped_++;
+				return false;
+			}
+			s.actors = base->actors;
+		}
+		for (uint32_t i = 0; i < removedCount && r.ok(); i++) {
+			uint32_t id = 0;
+			r.read(id);
+			auto it = std::lower_bound(s.actors.begin(), s.actors.end(), id, byId);
+			if (it != s.actors.end() && it->id == id)
+				s.actors.erase(it);
+		}
+		for (uint32_t i = 0; i < updateCount && r.ok(); i++) {
+			uint32_t id = 0;
+			uint8_t mask = 0;
+			r.read(id);
+			r.read(mask);
+			auto it = std::lower_bound(s.actors.begin(), s.actors.end(), id, byId);
+			if (it == s.actors.end() || it->id != id) {
+				NETACTORSTATE added;
+				added.id = id;
+				it = s.actors.insert(it, added);
+			}
+			readFields(r, *it, mask);
+		}
+		if (!r.ok())
+			return false;
+
+		at = std::lower_bound(history_.begin(), history_.end(), s.tick, byTick);
+		history_.insert(at, std::move(s));
+		while (history_.size() > ClientHistory)
+			history_.pop_front();
+		ackTick_ = std::max(ackTick_, header.tick);
+		if (tickRate > 0.0f)
+			tickRate_ = tickRate;
+		return true;
+	}
+
+
+	void NetClient::_sendState(glm::vec2 camera) {
+		NETHEADER header;
+		header.type = NETHEADER::CLIENTSTATE;
+		header.tick = ackTick_;
+		std::vector<uint8_t> message;
+		put(message, header);
+		put(message, camera);
+		socket_.send("", message);
+		lastSent_ = NetSocket::now();
+	}
+
+
+	void NetClient::_apply() {
+		// a is the newest tick at or before the render tick and b the one after it
+		const SNAPSHOT* a = nullptr;
+		const SNAPSHOT* b = nullptr;
+		for (auto& s : history_) {
+			if (s.tick <= renderTick_) {
+				a = &s;
+			} else {
+				b = &s;
+				break;
+			}
+		}
+		if (!a) {
+			a = b;
+			b = nullptr;
+		}
+		float f = b ? (float)((renderTick_ - a->tick) / (double)(b->tick - a->tick)) : 0.0f;
+		std::vector<NETACTORSTATE> shown = a->actors;
+		if (b) {
+			for (auto& s : shown) {
+				auto it = std::lower_bound(b->actors.begin(), b->actors.end(), s.id, byId);
+				if (it == b->actors.end() || it->id != s.id)
+					continue;
+				s.position = glm::mix(s.position, it->position, f);
+				s.velocity = glm::mix(s.velocity, it->velocity, f);
+			}
+		}
+
+		for (auto& s : shown_) {
+			if (!std::binary_search(shown.begin(), shown.end(), s, [](const NETACTORSTATE& x, const NETACTORSTATE& y) { return x.id < y.id; }))
+				world_.removeActor(s.id);
+		}
+		for (auto& s : shown) {
+			ActorPtr actor = world_.getActor(s.id);
+			if (!actor) {
+				actor = makeActor ? makeActor(s.charDesc)
+								  : GameLib::makeActor("remote", nullptr, nullptr, nullptr, std::make_shared<SimpleGraphicsComponent>());
+				if (!actor)
+					continue;
+				// the server id is kept so later states find the actor
+				ACTORSTATE state;
+				state.id = s.id;
+				state.charDesc = s.charDesc;
+				actor->loadState(state);
+				// the server sends the frame to draw
+				actor->anim.count = 0;
+				switch (s.type) {
+				case Actor::DYNAMIC: world_.addDynamicActor(actor); break;
+				case Actor::STATIC: world_.addStaticActor(actor); break;
+				default: world_.addTriggerActor(actor); break;
+				}
+			}
+			actor->setCharDesc(s.charDesc);
+			actor->teleport({ s.position.x, s.position.y, actor->position.z });
+			actor->velocity = { s.velocity.x, s.velocity.y, 0.0f };
+			actor->size = { s.size.x, s.size.y, actor->size.z };
+			actor->sprite.libId = s.spriteLibId;
+			actor->sprite.id = s.spriteId;
+			actor->sprite.flipX = (s.flags & NETACTORSTATE::FLIPX) != 0;
+			actor->sprite.flipY = (s.flags & NETACTORSTATE::FLIPY) != 0;
+			actor->visible = (s.flags & NETACTORSTATE::VISIBLE) != 0;
+			actor->active = (s.flags & NETACTORSTATE::ACTIVE) != 0;
+		}
+		shown_ = std::move(shown);
+	}
+} // namespace GameLib
@@ -0,0 +1,247 @@
+#ifndef GAMELIB_NET_HPP
+#define GAMELIB_NET_HPP
+
+#include <gamelib_actor.hpp>
+#include <deque>
+#include <random>
+
+namespace GameLib {
+	// NETCONDITIONS simulates a network on messages as they arrive, for testing on localhost or inproc://
+	// Both ends add their latency, so a round trip takes the latency of each
+	struct NETCONDITIONS {
+		// milliseconds added to each message
+		float latency{ 0.0f };
+		// up to this many milliseconds more or less, which can reorder messages
+		float jitter{ 0.0f };
+		// fraction of messages dropped
+		float loss{ 0.0f };
+		unsigned seed{ 1 };
+	};
+
+	// NetSocket sends and receives whole messages over czmq without blocking
+	// A server binds a ROUTER that tells clients apart by peer id, clients connect a DEALER
+	// Messages that can not be sent at once are dropped, like datagrams, and the protocol recovers
+	class NetSocket {
+	public:
+		NetSocket() {}
+		~NetSocket() { close(); }
+		NetSocket(const NetSocket&) = delete;
+		NetSocket& operator=(const NetSocket&) = delete;
+
+		// binds a server to an endpoint such as tcp://*:5555 or inproc://game
+		bool bind(const std::string& endpoint);
+
+		// connects a client to an endpoint such as tcp://localhost:5555 or inproc://game
+		bool connect(const std::string& endpoint);
+
+		void close();
+
+		bool isOpen() const { return sock_ != nullptr; }
+
+		// sends to a peer, clients send to the server with an empty peer
+		bool send(const std::string& peer, const std::vector<uint8_t>& data);
+
+		// takes the next message whose simulated latency has passed, returns false if there is none
+		bool receive(std::string& peer, std::vector<uint8_t>& data);
+
+		// sets the simulated network and restarts its random sequence
+		void setConditions(const NETCONDITIONS& conditions);
+		const NETCONDITIONS& conditions() const { return conditions_; }
+
+		uint64_t bytesSent() const { return bytesSent_; }
+		uint64_t bytesReceived() const { return bytesReceived_; }
+		unsigned messagesDropped() const { return messagesDropped_; }
+
+		// milliseconds from a monotonic clock
+		static int64_t now() { return zclock_mono(); }
+
+	private:
+		struct PENDING {
+			int64_t time{ 0 };
+			std::string peer;
+			std::vector<uint8_t> data;
+		};
+
+		// moves messages from czmq to pending_, dropping and delaying them
+		void _pump();
+
+		zsock_t* sock_{ nullptr };
+		bool router_{ false };
+		NETCONDITIONS conditions_;
+		std::mt19937 rng_{ 1 };
+		// sorted by time
+		std::deque<PENDING> pending_;
+		uint64_t bytesSent_{ 0 };
+		uint64_t bytesReceived_{ 0 };
+		unsigned messagesDropped_{ 0 };
+	};
+
+	// NETACTORSTATE is what clients see of an actor
+	struct NETACTORSTATE {
+		static constexpr uint8_t VISIBLE = 1;
+		static constexpr uint8_t ACTIVE = 2;
+		static constexpr uint8_t FLIPX = 4;
+		static constexpr uint8_t FLIPY = 8;
+
+		uint32_t id{ 0 };
+		char charDesc{ '?' };
+		// Actor::DYNAMIC, STATIC or TRIGGER
+		uint8_t type{ 0 };
+		uint8_t flags{ 0 };
+		uint8_t reserved{ 0 };
+		glm::vec2 position{ 0.0f, 0.0f };
+		glm::vec2 velocity{ 0.0f, 0.0f };
+		glm::vec2 size{ 0.0f, 0.0f };
+		uint32_t spriteLibId{ 0 };
+		// the frame being drawn, from the animation when it has one
+		uint32_t spriteId{ 0 };
+
+		static NETACTORSTATE fromActor(const Actor& actor);
+	};
+
+	// NETHEADER starts every message
+	struct NETHEADER {
+		enum : uint8_t { CLIENTSTATE = 1, STATE = 2, BYE = 3 };
+		char magic[2]{ 'G', 'N' };
+		uint8_t version{ 1 };
+		uint8_t type{ 0 };
+		// STATE: the server tick, CLIENTSTATE: the newest tick the client decoded
+		uint32_t tick{ 0 };
+	};
+
+	// NetServer is the authority for a world and replicates its actors to clients each tick
+	// Each STATE message is a delta against the last tick the client acknowledged, so lost messages
+	// only make the next delta larger. When the bandwidth budget can not hold every changed actor, actors
+	// near the client's camera go first and the rest wait, gaining priority each tick they wait. A client
+	// with no baseline, just joined or silent for too long, is sent every actor regardless of the budget
+	class NetServer {
+	public:
+		NetServer(World& world) : world_(world) {}
+		~NetServer() { stop(); }
+
+		bool start(const std::string& endpoint);
+		void stop();
+
+		bool isRunning() const { return socket_.isOpen(); }
+
+		// reads client messages and sends a STATE to each client every tick, call once a frame after the world updates
+		void update(float deltaTime);
+
+		// ticks a second
+		float tickRate{ 20.0f };
+
+		// bytes a second sent to each client
+		unsigned bandwidth{ 16384 };
+
+		// tiles from the camera at which an actor has half the priority of one at the camera
+		float priorityRadius{ 20.0f };
+
+		// seconds without a message before a client is dropped
+		float timeout{ 5.0f };
+
+		NetSocket& socket() { return socket_; }
+
+		uint32_t tick() const { return tick_; }
+		int clientCount() const { return (int)clients_.size(); }
+
+		// logs bytes and actors sent and deferred
+		void logStats() const;
+
+	private:
+		using STATES = std::vector<NETACTORSTATE>;
+
+		struct CLIENT {
+			std::string peer;
+			glm::vec2 camera{ 0.0f, 0.0f };
+			uint32_t ackTick{ 0 };
+			int64_t lastHeard{ 0 };
+			// what the client has after each tick sent since the acknowledged one, by tick
+			std::map<uint32_t, STATES> sent;
+			// priority of actors waiting to be sent, by id
+			std::map<uint32_t, float> priority;
+		};
+
+		void _receive();
+		void _gather();
+		void _send(CLIENT& client);
+
+		World& world_;
+		NetSocket socket_;
+		std::map<std::string, CLIENT> clients_;
+		// the actors this tick, sorted by id
+		STATES current_;
+		std::vector<uint8_t> message_;
+		uint32_t tick_{ 0 };
+		float accumulator_{ 0.0f };
+
+		uint64_t actorsSent_{ 0 };
+		uint64_t actorsDeferred_{ 0 };
+		uint64_t messagesSent_{ 0 };
+	};
+
+	// NetClient shows the actors of a NetServer in a local world, which must not make actors of its own
+	// States are drawn interpolationDelay seconds behind the newest tick, between the two ticks around
+	// that time, so motion stays smooth when messages arrive late or are lost
+	class NetClient {
+	public:
+		NetClient(World& world) : world_(world) {}
+		~NetClient() { disconnect(); }
+
+		bool connect(const std::string& endpoint);
+
+		// tells the server the client is leaving and removes replicated actors from the world
+		void disconnect();
+
+		bool isConnected() const { return socket_.isOpen(); }
+
+		// true once a STATE has arrived
+		bool hasState() const { return !history_.empty(); }
+
+		// reads STATE messages, acknowledges them with the camera center in tiles and moves actors in the world
+		void update(float deltaTime, glm::vec2 camera);
+
+		// seconds behind the newest tick that actors are shown
+		float interpolationDelay{ 0.1f };
+
+		// makes actors that appear, by default they only have a SimpleGraphicsComponent
+		std::function<ActorPtr(char charDesc)> makeActor;
+
+		NetSocket& socket() { return socket_; }
+
+		uint32_t newestTick() const { return ackTick_; }
+
+		// tick being shown, with the fraction between two ticks
+		double renderTick() const { return renderTick_; }
+
+		unsigned statesReceived() const { return statesReceived_; }
+		// states that could not be read because their baseline was gone
+		unsigned statesDropped() const { return statesDropped_; }
+
+		void logStats() const;
+
+	private:
+		struct SNAPSHOT {
+			uint32_t tick{ 0 };
+			std::vector<NETACTORSTATE> actors;
+		};
+
+		bool _read(const std::vector<uint8_t>& data);
+		void _sendState(glm::vec2 camera);
+		void _apply();
+
+		World& world_;
+		NetSocket socket_;
+		// decoded ticks, oldest first
+		std::deque<SNAPSHOT> history_;
+		std::vector<NETACTORSTATE> shown_;
+		uint32_t ackTick_{ 0 };
+		float tickRate_{ 20.0f };
+		double renderTick_{ 0.0 };
+		int64_t lastSent_{ 0 };
+		bool received_{ false };
+		unsigned statesReceived_{ 0 };
+		unsigned statesDropped_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
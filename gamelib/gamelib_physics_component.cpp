@@ -1,129 +1,50 @@
 #include "pch.h"
 #include <gamelib_base.hpp>
+#include <gamelib_collision.hpp>
 #include <gamelib_locator.hpp>
 #include <gamelib_physics_component.hpp>
-#include <limits>
 
 namespace GameLib {
-	inline bool AABBcollidesAABB(glm::vec3 amin, glm::vec3 amax, glm::vec3 bmin, glm::vec3 bmax) {
-		bool overlapX = (amin.x <= bmax.x && amax.x >= bmin.x);
-		bool overlapY = (amin.y <= bmax.y && amax.y >= bmin.y);
-		bool overlapZ = (amin.z <= bmax.z && amax.z >= bmin.z);
-		return overlapX && overlapY && overlapZ;
-	}
+	namespace {
+		// bodies faster than this are slowed when their velocity is handed back to the actor
+		constexpr float MaxBodySpeed = 32.0f;
 
-	inline bool BroadPhaseAABB(glm::vec3 ap, glm::vec3 as, glm::vec3 av, glm::vec3 bp, glm::vec3 bs) {
-		glm::vec3 amin;
-		amin.x = av.x > 0 ? ap.x : ap.x + av.x;
-		amin.y = av.y > 0 ? ap.y : ap.y + av.y;
-		amin.z = av.z > 0 ? ap.z : ap.z + av.z;
-		glm::vec3 asize;
-		asize.x = av.x > 0 ? as.x + av.x : as.x - av.x;
-		asize.y = av.y > 0 ? as.y + av.y : as.y - av.y;
-		asize.z = av.z > 0 ? as.z + av.z : as.z - av.z;
-		glm::vec amax = amin + asize;
-		return AABBcollidesAABB(amin, amax, bp, bp + bs);
-	}
+		glm::vec2 clampBodySpeed(glm::vec2 v) {
+			if (glm::length(v) > MaxBodySpeed)
+				return glm::normalize(v) * MaxBodySpeed;
+			return v;
+		}
+	} // namespace
 
 	bool BroadPhaseAABB(Actor& a, Actor& b) {
-		if (BroadPhaseAABB(a.lastPosition, a.size, a.velocity, b.position, b.size))
-			return true;
-		return false;
+		glm::vec2 p{ a.lastPosition.x, a.lastPosition.y };
+		return broadPhaseAABB(p, a.size2d(), a.velocity2d(), b.position2d(), b.position2d() + b.size2d());
 	}
 
 	float SweptAABB(Actor& a, Actor& b, glm::vec3& normal) {
-		glm::vec3 inverseEnter;
-		glm::vec3 inverseLeave;
-		glm::vec3 ap1 = a.position;
-		glm::vec3 ap2 = a.position + a.size;
-		glm::vec3 bp1 = b.position;
-		glm::vec3 bp2 = b.position + b.size;
-
-		if (a.velocity.x > 0.0f) {
-			inverseEnter.x = bp1.x - ap2.x;
-			inverseLeave.x = bp2.x - ap1.x;
-		} else {
-			inverseEnter.x = bp2.x - ap1.x;
-			inverseLeave.x = bp1.x - ap2.x;
-		}
-
-		if (a.velocity.y > 0.0f) {
-			inverseEnter.y = bp1.y - ap2.y;
-			inverseLeave.y = bp2.y - ap1.y;
-		} else {
-			inverseEnter.y = bp2.y - ap1.y;
-			inverseLeave.y = bp1.y - ap2.y;
-		}
-
-		glm::vec3 enter;
-		glm::vec3 leave;
-		constexpr float inf = std::numeric_limits<float>::infinity();
-
-		if (a.velocity.x == 0.0f) {
-			enter.x = -inf;
-			leave.x = inf;
-		} else {
-			enter.x = inverseEnter.x / a.velocity.x;
-			leave.x = inverseLeave.x / a.velocity.x;
-		}
-
-		if (a.velocity.y == 0.0f) {
-			enter.y = -inf;
-			leave.y = inf;
-		} else {
-			enter.y = inverseEnter.y / a.velocity.y;
-			leave.y = inverseLeave.y / a.velocity.y;
-		}
-
-		float enterTime = std::max(enter.x, enter.y);
-		float leaveTime = std::min(leave.x, leave.y);
-		normal = { 0.0f, 0.0f, 0.0f };
-		if (enterTime > leaveTime)
-			return 1.0f;
-		if (enter.x < 0.0f && enter.y < 0.0f)
-			return 1.0f;
-		if (enter.x < 0.0f) {
-			if (ap2.x < bp1.x || ap1.x > bp2.x)
-				return 1.0f;
-		}
-		if (enter.y < 0.0f) {
-			if (ap2.y < bp1.y || ap1.y > bp2.y)
-				return 1.0f;
-		}
-		// if (enter.x > 1.0f || enter.y > 1.0f) {
-		//	if (enter.x > enter.y) {
-		//		HFLOGDEBUG("missing a condition?");
-		//	}
-		//	return 1.0f;
-		//}
-
-		if (enter.x > enter.y) {
-			if (inverseEnter.x < 0.0f) {
-				normal = { 1.0f, 0.0f, 0.0f };
-			} else {
-				normal = { -1.0f, 0.0f, 0.0f };
-			}
-		} else {
-			if (inverseEnter.y < 0.0f) {
-				normal = { 0.0f, 1.0f, 0.0f };
-			} else {
-				normal = { 0.0f, -1.0f, 0.0f };
-			}
-		}
-
-		return enterTime;
+		glm::vec2 n;
+		bool hit;
+		float t = sweptAABB(a.position2d(), a.size2d(), a.velocity2d(), b.position2d(), b.position2d() + b.size2d(), n, hit);
+		normal = { n.x, n.y, 0.0f };
+		return t;
 	}
 
 
 	void SimplePhysicsComponent::beginPlay(Actor& a) {
 		auto box2d = Locator::getBox2D();
 		if (box2d && a.box2dId < 0) {
+			// triggers are static sensors so they report overlaps without falling or pushing back
+			// static actors are static bodies so dynamic bodies cannot push them around
+			if (a.isTrigger() || a.isStatic())
+				a.box2dType = b2_staticBody;
 			a.box2dId = box2d->initBody(
 				a.box2dType,
 				a.center2d(),
 				a.sizeHalf2d(),
 				a.physicsInfo.density,
-				a.physicsInfo.friction);
+				a.physicsInfo.friction,
+				a.isTrigger(),
+				(uintptr_t)a.getId() + 1);
 		}
 	}
 
@@ -131,10 +52,24 @@ namespace GameLib {
 	void SimplePhysicsComponent::preupdate(Actor& a) {
 		auto box2d = Locator::getBox2D();
 		if (box2d && a.box2dId >= 0) {
-			auto body = box2d->getBody(a.box2dId, a.box2dType);
-			body->setPosition(a.center2d());
-			body->setVelocity(a.velocity2d());
-			body->applyImpulse({ a.physicsInfo.a.x, a.physicsInfo.a.y });
+			if (!box2d->threaded()) {
+				auto body = box2d->getBody(a.box2dId, a.box2dType);
+				// only bodies that gameplay moved are placed again, so resting bodies can sleep
+				if (glm::length(a.center2d() - body->position()) > 1e-4f)
+					body->setPosition(a.center2d());
+				body->setVelocity(a.velocity2d());
+				body->applyImpulse({ a.physicsInfo.a.x, a.physicsInfo.a.y });
+				return;
+			}
+			// only queue what gameplay changed since the last snapshot so the physics thread keeps its own steps
+			BODYSTATE state = box2d->bodyState(a.box2dId, a.box2dType);
+			if (glm::length(a.center2d() - state.position) > 1e-4f)
+				box2d->setPosition(a.box2dId, a.box2dType, a.center2d());
+			// postupdate() hands back the velocity slowed to MaxBodySpeed, which is not a change made by gameplay
+			if (a.velocity2d() != clampBodySpeed(state.velocity))
+				box2d->setVelocity(a.box2dId, a.box2dType, a.velocity2d());
+			if (a.physicsInfo.a.x != 0.0f || a.physicsInfo.a.y != 0.0f)
+				box2d->applyImpulse(a.box2dId, a.box2dType, { a.physicsInfo.a.x, a.physicsInfo.a.y });
 		}
 	}
 
@@ -142,13 +77,9 @@ namespace GameLib {
 	void SimplePhysicsComponent::postupdate(Actor& a) {
 		auto box2d = Locator::getBox2D();
 		if (box2d && a.box2dId >= 0) {
-			auto body = box2d->getBody(a.box2dId, a.box2dType);
-			a.setCenter2d(body->position());
-			auto velocity = body->velocity();
-			if (glm::length(velocity) > 32) {
-				velocity = glm::normalize(velocity) * 32.0f;
-			}
-			a.setVelocity2d(velocity);
+			BODYSTATE state = box2d->bodyState(a.box2dId, a.box2dType);
+			a.setCenter2d(state.position);
+			a.setVelocity2d(clampBodySpeed(state.velocity));
 		}
 	}
 
@@ -162,20 +93,8 @@ namespace GameLib {
 	}
 
 	bool SimplePhysicsComponent::collideWorld(Actor& a, World& w) {
-		int aix = (int)a.position.x;
-		int aiy = (int)a.position.y;
-		bool fracX = a.position.x - aix > 0;
-		bool fracY = a.position.y - aiy > 0;
-		int anyhit=0;
-		if (w.getTile(aix, aiy).solid())
-			anyhit|=1;
-		if (fracX && w.getTile(aix + 1, aiy).solid())
-			anyhit |= 1;
-		if (fracY && w.getTile(aix, aiy + 1).solid())
-			anyhit |= 1;
-		if (fracX && fracY && w.getTile(aix + 1, aiy + 1).solid())
-			anyhit |= 1;
-		return anyhit;
+		glm::vec2 p{ a.sweepStart.x, a.sweepStart.y };
+		return w.sweepTiles(p, a.size2d(), a.position2d() - p, a.worldHit);
 	}
 
 	bool SimplePhysicsComponent::collideDynamic(Actor& a, Actor& b) { return collides(a, b); }
@@ -229,25 +148,8 @@ namespace GameLib {
 	}
 
 	bool GameLib::DainNickJosephWorldPhysicsComponent::collideWorld(Actor& a, World& w) {
-
-		float subTileSize = 1.0;
-		for (float x = floor(a.position.x); x < ceil(a.position.x + a.size.x); x += subTileSize) {
-			if (w.getTilef(x, floor(a.position.y)).solid()) {
-				return true;
-			}
-			if (w.getTilef(x, ceil(a.position.y + a.size.y) - subTileSize).solid()) {
-				return true;
-			}
-		}
-		for (float y = floor(a.position.y); y < ceil(a.position.y + a.size.y); y += subTileSize) {
-			if (w.getTilef(floor(a.position.x), y).solid()) {
-				return true;
-			}
-			if (w.getTilef(ceil(a.position.x + a.size.x) - subTileSize, y).solid()) {
-				return true;
-			}
-		}
-		return false;
+		glm::vec2 p{ a.sweepStart.x, a.sweepStart.y };
+		return w.sweepTiles(p, a.size2d(), a.position2d() - p, a.worldHit);
 	}
 
 	void GameLib::DainNickJosephWorldPhysicsComponent::update(Actor& a, World& w) {
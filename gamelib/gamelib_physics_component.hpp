@@ -5,6 +5,9 @@
 #include <gamelib_world.hpp>
 
 namespace GameLib {
+	class SnapshotWriter;
+	class SnapshotReader;
+
 	class PhysicsComponent {
 	public:
 		virtual ~PhysicsComponent() {}
@@ -24,6 +27,10 @@ namespace GameLib {
 		virtual bool collideStatic(Actor& a, Actor& b) { return false; }
 		// handles collision between movable actor and trigger
 		virtual bool collideTrigger(Actor& a, Actor& b) { return false; }
+		// writes physics state a snapshot must keep beyond the actor and its body
+		virtual void writeState(const Actor& actor, SnapshotWriter& w) const {}
+		// reads what writeState() wrote in the same order
+		virtual void readState(Actor& actor, SnapshotReader& r) {}
 	};
 
 	class SimplePhysicsComponent : public PhysicsComponent {
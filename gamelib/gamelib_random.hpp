@@ -2,6 +2,7 @@
 #define GAMELIB_RANDOM_HPP
 
 #include <random>
+#include <sstream>
 
 namespace GameLib {
 	class Random {
@@ -14,14 +15,56 @@ namespace GameLib {
 			}
 		}
 
-		unsigned int rd() { return rd_(); }
+		// reseeds the generator, after this rd() also comes from the seeded sequence so runs can be reproduced
+		void seed(unsigned int seed) {
+			mt32_.seed(seed);
+			positive0to1.reset();
+			minus1to1.reset();
+			deterministic_ = true;
+		}
+
+		unsigned int rd() { return deterministic_ ? (unsigned int)mt32_() : rd_(); }
 		float positive() { return positive0to1(mt32_); }
 		float normal() { return minus1to1(mt32_); }
 		int between(int a, int b) { return a + (int)(0.5f + positive() * (b - a)); }
 
+		// returns the generator state and whether it was seeded, for snapshots
+		std::string state() const {
+			std::ostringstream ostr;
+			ostr << deterministic_ << ' ' << mt32_;
+			return ostr.str();
+		}
+
+		// sets what state() returned, returns false and leaves the generator alone if it is damaged
+		bool setState(const std::string& state) {
+			bool deterministic = false;
+			std::mt19937 mt32;
+			if (!parseState(state, mt32, deterministic))
+				return false;
+			setGenerator(mt32, deterministic);
+			return true;
+		}
+
+		// reads what state() returned without setting it, returns false if it is damaged
+		static bool parseState(const std::string& state, std::mt19937& mt32, bool& deterministic) {
+			std::istringstream istr(state);
+			return (bool)(istr >> deterministic >> mt32);
+		}
+
+		// the generator as it is in memory, much quicker to copy than state() but only for this build
+		const std::mt19937& generator() const { return mt32_; }
+		bool deterministic() const { return deterministic_; }
+		void setGenerator(const std::mt19937& mt32, bool deterministic) {
+			mt32_ = mt32;
+			deterministic_ = deterministic;
+			positive0to1.reset();
+			minus1to1.reset();
+		}
+
 	private:
 		std::mt19937 mt32_;
 		std::random_device rd_;
+		bool deterministic_{ false };
 		std::uniform_real_distribution<float> positive0to1{ 0.0f, 1.0f };
 		std::uniform_real_distribution<float> minus1to1{ -1.0f, 1.0f };
 	};
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include <gamelib_replay.hpp>
+
+namespace GameLib {
+	// flush the frame buffer to disk once it grows past this many bytes
+	constexpr size_t ReplayFlushSize = 64 * 1024;
+
+	// flags stored with the scancode of a key change
+	constexpr uint16_t ReplayKeyDown = 0x8000;
+	constexpr uint16_t ReplayKeyPressed = 0x4000;
+	constexpr uint16_t ReplayKeyReleased = 0x2000;
+	constexpr uint16_t ReplayScancodeMask = 0x1fff;
+
+	bool InputRecorder::open(const std::string& path, unsigned seed, int stepsPerFrame, float stepTime) {
+		close();
+		fout_.open(path, std::ios::binary);
+		if (!fout_) {
+			HFLOGERROR("cannot record input to '%s'", path.c_str());
+			return false;
+		}
+		REPLAYHEADER header;
+		header.seed = seed;
+		header.stepsPerFrame = stepsPerFrame;
+		header.stepTime = stepTime;
+		_write(header);
+		frames_ = 0;
+		return true;
+	}
+
+
+	void InputRecorder::close() {
+		if (!fout_.is_open())
+			return;
+		fout_.write((const char*)buffer_.data(), buffer_.size());
+		buffer_.clear();
+		fout_.close();
+	}
+
+
+	void InputRecorder::recordInput(const Context& context) {
+		if (!isOpen())
+			return;
+
+		// keys only change state with a press or release, so only those are written
+		const auto& keyboard = context.keyboard;
+		size_t countOffset = buffer_.size();
+		uint16_t count = 0;
+		_write(count);
+		if ((keyboard.pressed | keyboard.released).any()) {
+			for (size_t i = 0; i < keyboard.down.size(); i++) {
+				if (!keyboard.pressed[i] && !keyboard.released[i])
+					continue;
+				uint16_t change = (uint16_t)i;
+				change |= keyboard.down[i] ? ReplayKeyDown : 0;
+				change |= keyboard.pressed[i] ? ReplayKeyPressed : 0;
+				change |= keyboard.released[i] ? ReplayKeyReleased : 0;
+				_write(change);
+				count++;
+			}
+		}
+		memcpy(&buffer_[countOffset], &count, sizeof(count));
+
+		uint8_t mask = 0;
+		for (int i = 0; i < Context::MaxGameControllers; i++) {
+			if (context.gameControllers[i].enabled)
+				mask |= 1 << i;
+		}
+		_write(mask);
+		for (int i = 0; i < Context::MaxGameControllers; i++) {
+			const auto& j = context.gameControllers[i];
+			if (!j.enabled)
+				continue;
+			_write(j.axis1);
+			_write(j.axis2);
+			_write(j.a);
+			_write(j.b);
+			_write(j.x);
+			_write(j.y);
+			_write(j.start);
+			_write(j.back);
+		}
+	}
+
+
+	void InputRecorder::recordChecksum(uint32_t checksum) {
+		if (!isOpen())
+			return;
+		_write(checksum);
+		frames_++;
+		if (buffer_.size() > ReplayFlushSize) {
+			fout_.write((const char*)buffer_.data(), buffer_.size());
+			buffer_.clear();
+		}
+	}
+
+
+	bool InputReplay::load(const std::string& path) {
+		data_.clear();
+		cursor_ = 0;
+		frames_ = 0;
+		divergences_ = 0;
+		std::ifstream fin(path, std::ios::binary);
+		if (!fin)
+			return false;
+		data_.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+		REPLAYHEADER expected;
+		if (!_read(header_) || memcmp(header_.magic, expected.magic, 4) || header_.version != expected.version) {
+			HFLOGERROR("'%s' is not an input recording", path.c_str());
+			data_.clear();
+			return false;
+		}
+		return true;
+	}
+
+
+	bool InputReplay::playInput(Context& context) {
+		auto& keyboard = context.keyboard;
+		uint16_t count = 0;
+		if (!_read(count))
+			return false;
+		keyboard.beginFrame();
+		for (uint16_t k = 0; k < count; k++) {
+			uint16_t change = 0;
+			if (!_read(change))
+				return false;
+			size_t scancode = change & ReplayScancodeMask;
+			if (scancode >= keyboard.down.size())
+				continue;
+			keyboard.down[scancode] = (change & ReplayKeyDown) != 0;
+			keyboard.pressed[scancode] = (change & ReplayKeyPressed) != 0;
+			keyboard.released[scancode] = (change & ReplayKeyReleased) != 0;
+		}
+
+		uint8_t mask = 0;
+		if (!_read(mask))
+			return false;
+		for (int i = 0; i < Context::MaxGameControllers; i++) {
+			auto& j = context.gameControllers[i];
+			j.enabled = (mask >> i) & 1;
+			if (!j.enabled)
+				continue;
+			if (!_read(j.axis1) || !_read(j.axis2) || !_read(j.a) || !_read(j.b) || !_read(j.x) || !_read(j.y) ||
+				!_read(j.start) || !_read(j.back))
+				return false;
+		}
+		return true;
+	}
+
+
+	bool InputReplay::checkChecksum(uint32_t checksum) {
+		uint32_t recorded = 0;
+		if (!_read(recorded))
+			return false;
+		frames_++;
+		if (recorded == checksum)
+			return true;
+		if (!divergences_) {
+			HFLOGWARN("replay diverged at frame %u, checksum %08x expected %08x", frames_ - 1, checksum, recorded);
+		}
+		divergences_++;
+		return false;
+	}
+} // namespace GameLib
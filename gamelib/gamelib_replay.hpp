@@ -0,0 +1,101 @@
+#ifndef GAMELIB_REPLAY_HPP
+#define GAMELIB_REPLAY_HPP
+
+#include <gamelib_context.hpp>
+#include <cstring>
+
+namespace GameLib {
+	// REPLAYHEADER starts every input recording
+	struct REPLAYHEADER {
+		char magic[4]{ 'G', 'L', 'R', 'P' };
+		uint32_t version{ 2 };
+		// seed passed to GameLib::random before the level was created
+		uint32_t seed{ 0 };
+		// number of world updates run each frame
+		uint32_t stepsPerFrame{ 0 };
+		// length of each world update in seconds
+		float stepTime{ 0.0f };
+	};
+
+	// A recording is a REPLAYHEADER followed by one record per frame:
+	//   uint16 count, then count uint16 keys that were pressed or released, the scancode in the low bits
+	//   with 0x8000 set if the key is down, 0x4000 if it was pressed and 0x2000 if it was released
+	//   uint8 mask of enabled controllers, then for each enabled controller axis1, axis2, a, b, x, y, start, back as floats
+	//   uint32 World::checksum() after the frame was simulated
+	// values are stored in the byte order of the machine that made the recording
+
+	// InputRecorder writes the keyboard and controller state seen each frame to a file
+	class InputRecorder {
+	public:
+		~InputRecorder() { close(); }
+
+		// creates the file and writes the header, returns false if it cannot be created
+		bool open(const std::string& path, unsigned seed, int stepsPerFrame, float stepTime);
+
+		// flushes and closes the file
+		void close();
+
+		bool isOpen() const { return fout_.is_open(); }
+
+		// records the keyboard and controllers, call after Context::getEvents() and before they are handled
+		void recordInput(const Context& context);
+
+		// records the checksum of the world once the frame has been simulated
+		void recordChecksum(uint32_t checksum);
+
+		// returns number of frames recorded
+		unsigned frames() const { return frames_; }
+
+	private:
+		template <typename T>
+		void _write(const T& value) {
+			const uint8_t* bytes = (const uint8_t*)&value;
+			buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+		}
+
+		std::ofstream fout_;
+		std::vector<uint8_t> buffer_;
+		unsigned frames_{ 0 };
+	};
+
+	// InputReplay feeds a recording back into the Context in place of SDL events
+	class InputReplay {
+	public:
+		// reads the whole recording, returns false if it is missing or not a recording
+		bool load(const std::string& path);
+
+		bool isLoaded() const { return !data_.empty(); }
+
+		const REPLAYHEADER& header() const { return header_; }
+
+		// replaces the keyboard and controllers with the next recorded frame, returns false at the end of the recording
+		bool playInput(Context& context);
+
+		// compares checksum with the one recorded for this frame, returns false and logs the first divergence
+		bool checkChecksum(uint32_t checksum);
+
+		// returns number of frames played
+		unsigned frames() const { return frames_; }
+
+		// returns number of frames whose checksum did not match
+		unsigned divergences() const { return divergences_; }
+
+	private:
+		template <typename T>
+		bool _read(T& value) {
+			if (cursor_ + sizeof(T) > data_.size())
+				return false;
+			memcpy(&value, &data_[cursor_], sizeof(T));
+			cursor_ += sizeof(T);
+			return true;
+		}
+
+		REPLAYHEADER header_;
+		std::vector<uint8_t> data_;
+		size_t cursor_{ 0 };
+		unsigned frames_{ 0 };
+		unsigned divergences_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef GAMELIB_RESOURCE_POOL_HPP
+#define GAMELIB_RESOURCE_POOL_HPP
+
+#include <gamelib_base.hpp>
+#include <deque>
+#include <functional>
+
+namespace GameLib {
+	// ResourceHandle names a resource in a ResourcePool<T>
+	// a handle to an unloaded resource is stale because its slot has moved on to a new generation
+	template <typename T>
+	struct ResourceHandle {
+		// slot index + 1, so a default handle is empty
+		uint32_t index{ 0 };
+		uint32_t generation{ 0 };
+
+		explicit operator bool() const { return index != 0; }
+		bool operator==(const ResourceHandle& h) const { return index == h.index && generation == h.generation; }
+		bool operator!=(const ResourceHandle& h) const { return !(*this == h); }
+	};
+
+	// ResourcePool keeps resources of one type in dense slots that handles index
+	// Resources are reference counted, the last release() unloads them with the function given to the pool
+	template <typename T>
+	class ResourcePool {
+	public:
+		using Handle = ResourceHandle<T>;
+		using Unload = std::function<void(T&)>;
+
+		ResourcePool(Unload unload) : unload_(unload) {}
+		ResourcePool(const ResourcePool&) = delete;
+		ResourcePool& operator=(const ResourcePool&) = delete;
+
+		// returns a handle to an empty resource with one reference, fill it in with get()
+		Handle add() {
+			uint32_t i;
+			if (!freeSlots_.empty()) {
+				i = freeSlots_.back();
+				freeSlots_.pop_back();
+			} else {
+				i = (uint32_t)slots_.size();
+				slots_.emplace_back();
+			}
+			SLOT& s = slots_[i];
+			s.refs = 1;
+			s.bytes = 0;
+			count_++;
+			return { i + 1, s.generation };
+		}
+
+		// returns true if h names a resource that is still loaded
+		bool valid(Handle h) const { return _slot(h) != nullptr; }
+
+		// returns the resource, or nullptr if the handle is stale
+		T* get(Handle h) {
+			SLOT* s = _slot(h);
+			return s ? &s->resource : nullptr;
+		}
+		const T* get(Handle h) const {
+			const SLOT* s = _slot(h);
+			return s ? &s->resource : nullptr;
+		}
+
+		// returns the resource with no checks
+		T& getFast(Handle h) { return slots_[h.index - 1].resource; }
+
+		void addRef(Handle h) {
+			if (SLOT* s = _slot(h))
+				s->refs++;
+		}
+
+		// drops a reference, unloads the resource and returns true if it was the last one
+		bool release(Handle h) {
+			SLOT* s = _slot(h);
+			if (!s || --s->refs > 0)
+				return false;
+			_free(h.index - 1);
+			return true;
+		}
+
+		// unloads the resource now, handles still holding references become stale
+		void unload(Handle h) {
+			if (valid(h))
+				_free(h.index - 1);
+		}
+
+		// number of references to the resource, 0 if the handle is stale
+		int refs(Handle h) const {
+			const SLOT* s = _slot(h);
+			return s ? s->refs : 0;
+		}
+
+		// records how much memory the resource keeps resident
+		void setBytes(Handle h, size_t bytes) {
+			SLOT* s = _slot(h);
+			if (!s)
+				return;
+			residentBytes_ += bytes - s->bytes;
+			s->bytes = bytes;
+		}
+
+		size_t bytes(Handle h) const {
+			const SLOT* s = _slot(h);
+			return s ? s->bytes : 0;
+		}
+
+		// total memory kept resident by the loaded resources
+		size_t residentBytes() const { return residentBytes_; }
+
+		// number of loaded resources
+		size_t count() const { return count_; }
+
+	private:
+		struct SLOT {
+			T resource;
+			uint32_t generation{ 0 };
+			int refs{ 0 };
+			size_t bytes{ 0 };
+		};
+
+		SLOT* _slot(Handle h) { return const_cast<SLOT*>(static_cast<const ResourcePool*>(this)->_slot(h)); }
+		const SLOT* _slot(Handle h) const {
+			if (h.index - 1u >= slots_.size())
+				return nullptr;
+			const SLOT& s = slots_[h.index - 1];
+			return s.generation == h.generation && s.refs > 0 ? &s : nullptr;
+		}
+
+		void _free(uint32_t i) {
+			SLOT& s = slots_[i];
+			unload_(s.resource);
+			s.resource = T();
+			s.refs = 0;
+			s.generation++;
+			residentBytes_ -= s.bytes;
+			s.bytes = 0;
+			freeSlots_.push_back(i);
+			count_--;
+		}
+
+		Unload unload_;
+		// a deque never moves its elements, so pointers from get() stay valid while other resources load
+		std::deque<SLOT> slots_;
+		std::vector<uint32_t> freeSlots_;
+		size_t count_{ 0 };
+		size_t residentBytes_{ 0 };
+	};
+
+	// ResourceIds maps the int ids games use for tilesets and clips to handles with an array
+	// ids may be negative, the table grows to cover the lowest and highest id set
+	template <typename T>
+	class ResourceIds {
+	public:
+		using Handle = ResourceHandle<T>;
+
+		// returns the handle for id, or an empty handle
+		Handle get(int id) const {
+			size_t i = (size_t)((int64_t)id - first_);
+			return i < handles_.size() ? handles_[i] : Handle();
+		}
+
+		// returns the handle for id with no checks
+		Handle getFast(int id) const { return handles_[(size_t)((int64_t)id - first_)]; }
+
+		void set(int id, Handle h) {
+			if (handles_.empty()) {
+				first_ = id;
+			} else if (id < first_) {
+				handles_.insert(handles_.begin(), (size_t)(first_ - id), Handle());
+				first_ = id;
+			}
+			size_t i = (size_t)((int64_t)id - first_);
+			if (i >= handles_.size())
+				handles_.resize(i + 1);
+			handles_[i] = h;
+		}
+
+		// calls fn(id, handle) for every id with a handle
+		template <typename Fn>
+		void forEach(Fn fn) const {
+			for (size_t i = 0; i < handles_.size(); i++) {
+				if (handles_[i])
+					fn((int)(first_ + (int64_t)i), handles_[i]);
+			}
+		}
+
+		void clear() {
+			handles_.clear();
+			first_ = 0;
+		}
+
+	private:
+		std::vector<Handle> handles_;
+		int64_t first_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
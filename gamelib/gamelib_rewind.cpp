@@ -0,0 +1,168 @@
+#include "pch.h"
+#include <gamelib_rewind.hpp>
+
+namespace GameLib {
+	namespace {
+		// RUN is followed by count XORed words
+		struct RUN {
+			uint32_t skip{ 0 };
+			uint32_t count{ 0 };
+		};
+
+		inline uint64_t loadWord(const uint8_t* p, size_t i) {
+			uint64_t w;
+			memcpy(&w, p + i * sizeof(uint64_t), sizeof(w));
+			return w;
+		}
+	} // namespace
+
+
+	void RewindBuffer::record() {
+		Hf::StopWatch stopwatch;
+		if (!empty() && current_ + 1 < endFrame())
+			_dropAfter(current_);
+		const std::vector<uint8_t>& data = snapshot_.save();
+		unsigned frame = empty() ? first_ : endFrame();
+
+		FRAME f;
+		f.keyframe = frame;
+		f.key = true;
+		if (!empty()) {
+			const FRAME& key = frames_[frames_.back().keyframe - first_];
+			// a delta needs the same layout as its keyframe, which changes with the actors and pages
+			if (frame - key.keyframe < keyframeInterval && key.data.size() == data.size() &&
+				data.size() % sizeof(uint64_t) == 0) {
+				_encode(key.data.data(), data.data(), data.size(), delta_);
+				if (delta_.size() < data.size() / 2) {
+					f.keyframe = key.keyframe;
+					f.key = false;
+					f.data.assign(delta_.begin(), delta_.end());
+				}
+			}
+		}
+		if (f.key) {
+			f.data.assign(data.begin(), data.end());
+			keyframes_++;
+		}
+		bytes_ += f.data.size();
+		frames_.push_back(std::move(f));
+		current_ = frame;
+		_trim();
+		recordMilliseconds_ = stopwatch.stop_msf();
+	}
+
+
+	bool RewindBuffer::restore(unsigned frame) {
+		if (frame < first_ || frame >= endFrame())
+			return false;
+		Hf::StopWatch stopwatch;
+		const FRAME& f = frames_[frame - first_];
+		bool restored;
+		if (f.key) {
+			restored = snapshot_.load(f.data.data(), f.data.size());
+		} else {
+			const FRAME& key = frames_[f.keyframe - first_];
+			decoded_.assign(key.data.begin(), key.data.end());
+			restored = _decode(f.data, decoded_) && snapshot_.load(decoded_.data(), decoded_.size());
+		}
+		if (restored)
+			current_ = frame;
+		restoreMilliseconds_ = stopwatch.stop_msf();
+		return restored;
+	}
+
+
+	void RewindBuffer::clear() {
+		frames_.clear();
+		first_ = 0;
+		current_ = 0;
+		bytes_ = 0;
+		keyframes_ = 0;
+	}
+
+
+	void RewindBuffer::logStats() const {
+		HFLOGINFO("RewindBuffer: frames %u to %u, %d keyframes, %zu KB, record %3.3f ms, restore %3.3f ms",
+			first_,
+			endFrame(),
+			keyframes_,
+			bytes_ / 1024,
+			recordMilliseconds_,
+			restoreMilliseconds_);
+	}
+
+
+	void RewindBuffer::_encode(const uint8_t* key, const uint8_t* frame, size_t size, std::vector<uint8_t>& delta) {
+		delta.clear();
+		size_t words = size / sizeof(uint64_t);
+		size_t i = 0;
+		while (i < words) {
+			size_t start = i;
+			while (i < words && loadWord(key, i) == loadWord(frame, i))
+				i++;
+			if (i == words)
+				break;
+			RUN run;
+			run.skip = (uint32_t)(i - start);
+			size_t first = i;
+			while (i < words && loadWord(key, i) != loadWord(frame, i))
+				i++;
+			run.count = (uint32_t)(i - first);
+			size_t at = delta.size();
+			delta.resize(at + sizeof(RUN) + run.count * sizeof(uint64_t));
+			memcpy(delta.data() + at, &run, sizeof(run));
+			at += sizeof(run);
+			for (size_t j = first; j < i; j++, at += sizeof(uint64_t)) {
+				uint64_t x = loadWord(key, j) ^ loadWord(frame, j);
+				memcpy(delta.data() + at, &x, sizeof(x));
+			}
+		}
+	}
+
+
+	bool RewindBuffer::_decode(const std::vector<uint8_t>& delta, std::vector<uint8_t>& frame) {
+		size_t words = frame.size() / sizeof(uint64_t);
+		size_t word = 0;
+		for (size_t at = 0; at < delta.size();) {
+			RUN run;
+			if (delta.size() - at < sizeof(run))
+				return false;
+			memcpy(&run, delta.data() + at, sizeof(run));
+			at += sizeof(run);
+			word += run.skip;
+			if (word + run.count > words || (delta.size() - at) / sizeof(uint64_t) < run.count)
+				return false;
+			for (uint32_t j = 0; j < run.count; j++, word++, at += sizeof(uint64_t)) {
+				uint64_t x;
+				memcpy(&x, delta.data() + at, sizeof(x));
+				x ^= loadWord(frame.data(), word);
+				memcpy(frame.data() + word * sizeof(uint64_t), &x, sizeof(x));
+			}
+		}
+		return true;
+	}
+
+
+	void RewindBuffer::_dropAfter(unsigned frame) {
+		while (endFrame() > frame + 1) {
+			bytes_ -= frames_.back().data.size();
+			if (frames_.back().key)
+				keyframes_--;
+			frames_.pop_back();
+		}
+	}
+
+
+	void RewindBuffer::_trim() {
+		// deltas can not be restored without their keyframe, so a keyframe goes with the deltas after it
+		while (bytes_ > memoryBudget && keyframes_ > 1) {
+			do {
+				bytes_ -= frames_.front().data.size();
+				if (frames_.front().key)
+					keyframes_--;
+				frames_.pop_front();
+				first_++;
+			} while (!frames_.front().key);
+		}
+	}
+} // namespace GameLib
@@ -0,0 +1,92 @@
+#ifndef GAMELIB_REWIND_HPP
+#define GAMELIB_REWIND_HPP
+
+#include <gamelib_snapshot.hpp>
+#include <deque>
+
+namespace GameLib {
+	// RewindBuffer records a WorldSnapshot of each frame in a ring that stays under memoryBudget bytes
+	// Every keyframeInterval frames the whole snapshot is kept, frames between keep only the words that
+	// differ from their keyframe, XORed, with runs of equal words skipped. Tiles that did not change and
+	// actors that did not move cost nothing, and any frame is restored from its keyframe and one delta
+	// When over budget the oldest keyframe is dropped with its deltas
+	class RewindBuffer {
+	public:
+		RewindBuffer(World& world) : snapshot_(world) {}
+
+		// records the world as the next frame, call once a frame after it updates
+		// if an earlier frame was restored, the frames after it are dropped first
+		void record();
+
+		// restores a recorded frame, returns false if it was dropped or never recorded
+		bool restore(unsigned frame);
+
+		bool stepBack() { return !empty() && current_ > first_ && restore(current_ - 1); }
+		bool stepForward() { return !empty() && current_ + 1 < endFrame() && restore(current_ + 1); }
+
+		// drops every frame, the next frame recorded is frame 0
+		void clear();
+
+		bool empty() const { return frames_.empty(); }
+
+		// oldest frame kept
+		unsigned firstFrame() const { return first_; }
+
+		// one past the newest frame
+		unsigned endFrame() const { return first_ + (unsigned)frames_.size(); }
+
+		// frame last recorded or restored
+		unsigned currentFrame() const { return current_; }
+
+		// bytes of keyframes and deltas kept
+		size_t bytes() const { return bytes_; }
+
+		// snapshot used to save and restore, set its makeActor to bring back actors removed since a frame
+		WorldSnapshot& snapshot() { return snapshot_; }
+
+		// bytes kept before the oldest frames are dropped, the newest keyframe and its deltas are always kept
+		size_t memoryBudget{ 64 << 20 };
+
+		// frames from one keyframe to the next
+		unsigned keyframeInterval{ 60 };
+
+		// milliseconds the last record() and restore() took
+		float recordMilliseconds() const { return recordMilliseconds_; }
+		float restoreMilliseconds() const { return restoreMilliseconds_; }
+
+		// logs the frames, bytes and timing
+		void logStats() const;
+
+	private:
+		struct FRAME {
+			// frame number of the keyframe, the same as this frame for keyframes
+			unsigned keyframe{ 0 };
+			bool key{ false };
+			// the snapshot for keyframes, runs of XORed words for deltas
+			std::vector<uint8_t> data;
+		};
+
+		// writes the words of frame that differ from key as runs of a skip count, a count and the XORed words
+		static void _encode(const uint8_t* key, const uint8_t* frame, size_t size, std::vector<uint8_t>& delta);
+
+		// XORs the words of a delta into frame, which holds a copy of its keyframe
+		static bool _decode(const std::vector<uint8_t>& delta, std::vector<uint8_t>& frame);
+
+		void _dropAfter(unsigned frame);
+		void _trim();
+
+		WorldSnapshot snapshot_;
+		std::deque<FRAME> frames_;
+		unsigned first_{ 0 };
+		unsigned current_{ 0 };
+		size_t bytes_{ 0 };
+		int keyframes_{ 0 };
+		// reused so recording a delta does not allocate until it is kept
+		std::vector<uint8_t> delta_;
+		std::vector<uint8_t> decoded_;
+		float recordMilliseconds_{ 0.0f };
+		float restoreMilliseconds_{ 0.0f };
+	};
+} // namespace GameLib
+
+#endif
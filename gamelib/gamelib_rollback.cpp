@@ -0,0 +1,360 @@
+#include "pch.h"
+#include <gamelib_locator.hpp>
+#include <gamelib_rollback.hpp>
+
+namespace GameLib {
+	namespace {
+		template <typename T>
+		void put(std::vector<uint8_t>& out, const T& value) {
+			const uint8_t* bytes = (const uint8_t*)&value;
+			out.insert(out.end(), bytes, bytes + sizeof(T));
+		}
+
+		// averages timings so one slow tick does not decide how far to predict
+		void average(float& value, float ms) { value = value > 0.0f ? value + (ms - value) * 0.05f : ms; }
+
+		// FNV-1a over a saved snapshot, so the overlaps and component state are checked as well as the actors
+		uint32_t hash(const std::vector<uint8_t>& data) {
+			uint32_t h = 2166136261u;
+			for (uint8_t b : data) {
+				h ^= b;
+				h *= 16777619u;
+			}
+			return h;
+		}
+	} // namespace
+
+
+	RollbackSession::RollbackSession(World& world) : world_(world), snapshot_(world) {
+		// tiles do not change during play, so only actors and the random state are saved each tick
+		snapshot_.pages = false;
+		snapshot_.portable = false;
+	}
+
+
+	bool RollbackSession::host(const std::string& endpoint) {
+		close();
+		if (!_open() || !socket_.bind(endpoint))
+			return false;
+		local_ = 0;
+		HFLOGINFO("hosting rollback session on '%s'", endpoint.c_str());
+		return true;
+	}
+
+
+	bool RollbackSession::join(const std::string& endpoint) {
+		close();
+		if (!_open() || !socket_.connect(endpoint))
+			return false;
+		local_ = 1;
+		// the host learns who the guest is from its first message
+		_send();
+		HFLOGINFO("joining rollback session on '%s'", endpoint.c_str());
+		return true;
+	}
+
+
+	void RollbackSession::close() {
+		if (!socket_.isOpen())
+			return;
+		ROLLBACKHEADER header;
+		header.type = ROLLBACKHEADER::BYE;
+		header.tick = tick_;
+		message_.clear();
+		put(message_, header);
+		socket_.send(peer_, message_);
+		socket_.close();
+		peer_.clear();
+		connected_ = false;
+	}
+
+
+	bool RollbackSession::advance(const ROLLBACKINPUT& input) {
+		if (!socket_.isOpen())
+			return false;
+		_receive();
+		if (!connected_) {
+			_send();
+			return false;
+		}
+		_rollback();
+		_checkSync();
+
+		int remote = 1 - local_;
+		if (tick_ >= received_[remote] + _predictionLimit()) {
+			waits_++;
+			_send();
+			return false;
+		}
+		// the player that is ahead skips a tick now and then so the other one catches up
+		int advantage = (int)tick_ - (int)remoteTick_;
+		if (advantage - remoteAdvantage_ >= 2 && tick_ - lastSkip_ >= 10) {
+			lastSkip_ = tick_;
+			skips_++;
+			_send();
+			return false;
+		}
+
+		inputs_[local_][received_[local_] % InputRing] = input;
+		received_[local_]++;
+		_save(tick_);
+		_simulate(tick_);
+		tick_++;
+		_send();
+		return true;
+	}
+
+
+	void RollbackSession::logStats() const {
+		HFLOGINFO("RollbackSession: player %d, tick %u, %u rollbacks of %u ticks, deepest %u, worst %3.3f ms, %u waits, %u skips, %u desyncs",
+			local_,
+			tick_,
+			rollbacks_,
+			resimulated_,
+			deepest_,
+			worstRollbackMilliseconds_,
+			waits_,
+			skips_,
+			desyncs_);
+		HFLOGINFO("RollbackSession: save %3.3f ms, restore %3.3f ms, tick %3.3f ms on average, %llu KB sent",
+			saveMilliseconds_,
+			restoreMilliseconds_,
+			stepMilliseconds_,
+			(unsigned long long)(socket_.bytesSent() / 1024));
+	}
+
+
+	bool RollbackSession::_open() {
+		if (maxRollback < 1)
+			maxRollback = 1;
+		// remote inputs are read up to half the ring ahead, local ones are kept until acknowledged
+		if (maxRollback + inputDelay >= InputRing / 4) {
+			HFLOGERROR("maxRollback and inputDelay must be less than %u ticks together", InputRing / 4);
+			return false;
+		}
+		tick_ = 0;
+		for (int p = 0; p < Players; p++) {
+			for (auto& input : inputs_[p])
+				input = ROLLBACKINPUT();
+			// both players start with empty input for the delayed ticks
+			received_[p] = inputDelay;
+		}
+		for (auto& input : used_)
+			input = ROLLBACKINPUT();
+		rollbackFrom_ = ~0u;
+		// the ring holds the tick being rolled back to and every tick run since
+		states_.assign(maxRollback + 2, STATE());
+		remoteTick_ = 0;
+		remoteAck_ = inputDelay;
+		remoteAdvantage_ = 0;
+		remoteSyncTick_ = 0;
+		remoteChecksum_ = 0;
+		checkedTick_ = 0;
+		lastSkip_ = 0;
+		connected_ = false;
+		return true;
+	}
+
+
+	void RollbackSession::_receive() {
+		std::string peer;
+		std::vector<uint8_t> data;
+		int remote = 1 - local_;
+		int64_t now = NetSocket::now();
+		while (socket_.receive(peer, data)) {
+			SnapshotReader r(data.data(), data.size());
+			ROLLBACKHEADER header;
+			ROLLBACKHEADER expected;
+			if (!r.read(header) || memcmp(header.magic, expected.magic, 2) || header.version != expected.version)
+				continue;
+			// a host plays with the first guest that arrives
+			if (local_ == 0) {
+				if (peer_.empty())
+					peer_ = peer;
+				else if (peer != peer_)
+					continue;
+			}
+			if (header.type == ROLLBACKHEADER::BYE) {
+				// the game goes on alone
+				HFLOGINFO("the other player left at tick %u", header.tick);
+				socket_.close();
+				peer_.clear();
+				connected_ = false;
+				return;
+			}
+			if (header.type != ROLLBACKHEADER::INPUT)
+				continue;
+
+			uint32_t ack = 0;
+			int32_t advantage = 0;
+			uint32_t syncTick = 0;
+			uint32_t checksum = 0;
+			uint32_t first = 0;
+			uint16_t count = 0;
+			r.read(ack);
+			r.read(advantage);
+			r.read(syncTick);
+			r.read(checksum);
+			r.read(first);
+			r.read(count);
+			if (!r.ok())
+				continue;
+			if (!connected_)
+				HFLOGINFO("player %d connected", remote);
+			connected_ = true;
+			lastHeard_ = now;
+			remoteTick_ = std::max(remoteTick_, header.tick);
+			remoteAck_ = std::max(remoteAck_, ack);
+			remoteAdvantage_ = advantage;
+			if (syncTick > remoteSyncTick_) {
+				remoteSyncTick_ = syncTick;
+				remoteChecksum_ = checksum;
+			}
+			for (uint32_t i = 0; i < count; i++) {
+				ROLLBACKINPUT input;
+				if (!r.read(input))
+					break;
+				// inputs are resent until acknowledged, so only the next one missing is taken
+				unsigned t = first + i;
+				if (t != received_[remote])
+					continue;
+				if (t >= tick_ + InputRing / 2)
+					break;
+				inputs_[remote][t % InputRing] = input;
+				received_[remote]++;
+				if (t < tick_ && used_[t % InputRing] != input)
+					rollbackFrom_ = std::min(rollbackFrom_, t);
+			}
+		}
+		// a goodbye can be lost with the connection, so silence also ends the session
+		if (connected_ && now - lastHeard_ > (int64_t)(timeout * 1000.0f)) {
+			HFLOGINFO("the other player timed out at tick %u", tick_);
+			socket_.close();
+			peer_.clear();
+			connected_ = false;
+		}
+	}
+
+
+	void RollbackSession::_send() {
+		if (!socket_.isOpen() || (local_ == 0 && peer_.empty()))
+			return;
+		int remote = 1 - local_;
+		ROLLBACKHEADER header;
+		header.type = ROLLBACKHEADER::INPUT;
+		header.tick = tick_;
+		message_.clear();
+		put(message_, header);
+		put(message_, (uint32_t)received_[remote]);
+		put(message_, (int32_t)((int)tick_ - (int)remoteTick_));
+
+		// the newest saved tick every input before it is known for, so both players saved the same world
+		unsigned syncTick = std::min(std::min(received_[0], received_[1]), tick_ ? tick_ - 1 : 0);
+		const STATE& state = states_[syncTick % states_.size()];
+		bool synced = syncTick && state.tick == syncTick;
+		put(message_, (uint32_t)(synced ? syncTick : 0));
+		put(message_, synced ? state.checksum : 0u);
+
+		// every local input the other player has not acknowledged goes in every message
+		unsigned last = received_[local_];
+		unsigned first = std::max(remoteAck_, last > InputRing / 2 ? last - InputRing / 2 : 0u);
+		first = std::min(first, last);
+		put(message_, (uint32_t)first);
+		put(message_, (uint16_t)(last - first));
+		for (unsigned t = first; t < last; t++)
+			put(message_, _input(local_, t));
+		socket_.send(peer_, message_);
+	}
+
+
+	void RollbackSession::_save(unsigned tick) {
+		Hf::StopWatch stopwatch;
+		STATE& state = states_[tick % states_.size()];
+		const std::vector<uint8_t>& data = snapshot_.save();
+		// the ring keeps its buffers, so saving stops allocating once they are large enough
+		state.data.assign(data.begin(), data.end());
+		state.tick = tick;
+		state.checksum = hash(state.data);
+		average(saveMilliseconds_, stopwatch.stop_msf());
+	}
+
+
+	void RollbackSession::_rollback() {
+		unsigned from = rollbackFrom_;
+		rollbackFrom_ = ~0u;
+		if (from >= tick_)
+			return;
+		const STATE& state = states_[from % states_.size()];
+		if (state.tick != from) {
+			HFLOGERROR("tick %u is no longer saved, the players will desync", from);
+			return;
+		}
+		Hf::StopWatch stopwatch;
+		Hf::StopWatch restoreStopwatch;
+		if (!snapshot_.load(state.data.data(), state.data.size())) {
+			HFLOGERROR("cannot restore tick %u", from);
+			return;
+		}
+		average(restoreMilliseconds_, restoreStopwatch.stop_msf());
+		resimulating_ = true;
+		for (unsigned t = from; t < tick_; t++) {
+			if (t > from)
+				_save(t);
+			_simulate(t);
+		}
+		resimulating_ = false;
+		rollbacks_++;
+		resimulated_ += tick_ - from;
+		deepest_ = std::max(deepest_, tick_ - from);
+		worstRollbackMilliseconds_ = std::max(worstRollbackMilliseconds_, stopwatch.stop_msf());
+	}
+
+
+	void RollbackSession::_simulate(unsigned tick) {
+		ROLLBACKINPUT inputs[Players];
+		for (int p = 0; p < Players; p++) {
+			if (tick < received_[p])
+				inputs[p] = _input(p, tick);
+			else if (received_[p])
+				inputs[p] = _input(p, received_[p] - 1);
+		}
+		used_[tick % InputRing] = inputs[1 - local_];
+		Hf::StopWatch stopwatch;
+		// Box2D keeps contacts and warm starting that snapshots do not, so it is made again from the
+		// bodies before every tick and a restored tick steps like the first time it ran
+		if (Box2D* box2d = Locator::getBox2D())
+			box2d->rebuild();
+		if (step)
+			step(tick, inputs);
+		average(stepMilliseconds_, stopwatch.stop_msf());
+	}
+
+
+	void RollbackSession::_checkSync() {
+		unsigned syncTick = remoteSyncTick_;
+		if (!syncTick || syncTick <= checkedTick_)
+			return;
+		// our saved world for the tick may still change until every input before it is known
+		if (syncTick >= tick_ || syncTick > std::min(received_[0], received_[1]))
+			return;
+		checkedTick_ = syncTick;
+		const STATE& state = states_[syncTick % states_.size()];
+		if (state.tick != syncTick)
+			return;
+		if (state.checksum != remoteChecksum_) {
+			if (!desyncs_)
+				HFLOGERROR("players desynced at tick %u", syncTick);
+			desyncs_++;
+		}
+	}
+
+
+	unsigned RollbackSession::_predictionLimit() const {
+		// every tick predicted may have to be saved and run again in one frame
+		float cost = saveMilliseconds_ + stepMilliseconds_;
+		unsigned limit = maxRollback;
+		if (cost > 0.0f)
+			limit = std::min(limit, std::max(1u, (unsigned)(frameBudget / cost)));
+		return limit;
+	}
+} // namespace GameLib
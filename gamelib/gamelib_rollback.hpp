@@ -0,0 +1,164 @@
+#ifndef GAMELIB_ROLLBACK_HPP
+#define GAMELIB_ROLLBACK_HPP
+
+#include <gamelib_net.hpp>
+#include <gamelib_snapshot.hpp>
+
+namespace GameLib {
+	// ROLLBACKINPUT is what one player does in one tick, the game decides what the fields mean
+	struct ROLLBACKINPUT {
+		float axisX{ 0.0f };
+		float axisY{ 0.0f };
+		uint32_t buttons{ 0 };
+
+		bool operator==(const ROLLBACKINPUT& other) const {
+			return axisX == other.axisX && axisY == other.axisY && buttons == other.buttons;
+		}
+		bool operator!=(const ROLLBACKINPUT& other) const { return !(*this == other); }
+	};
+
+	// ROLLBACKHEADER starts every rollback message
+	struct ROLLBACKHEADER {
+		enum : uint8_t { INPUT = 1, BYE = 2 };
+		char magic[2]{ 'G', 'R' };
+		uint8_t version{ 1 };
+		uint8_t type{ 0 };
+		// the next tick the sender will simulate
+		uint32_t tick{ 0 };
+	};
+
+	// RollbackSession runs a deterministic game for two players, one on each end of a NetSocket
+	// Each tick both players' inputs are passed to step. Local input is sent ahead and used inputDelay
+	// ticks later, when the other player's input for a tick has not arrived it is predicted to be the
+	// same as the last one that did. The world is saved before each tick into a ring of the last
+	// maxRollback ticks, and when an input arrives that differs from its prediction the world is restored
+	// to that tick and the ticks since are run again. The session waits rather than predict further
+	// than the ring or the frame budget allows, and briefly when it runs ahead of the other player
+	// The players compare a hash of each saved snapshot, so any state a snapshot keeps is checked
+	// Box2D is rebuilt before each tick, so its contacts and warm starting never outlive a saved tick
+	class RollbackSession {
+	public:
+		static constexpr int Players = 2;
+
+		RollbackSession(World& world);
+		~RollbackSession() { close(); }
+
+		// waits for the other player on an endpoint such as tcp://*:5556, the host is player 0
+		bool host(const std::string& endpoint);
+
+		// connects to a host, the guest is player 1
+		bool join(const std::string& endpoint);
+
+		// tells the other player the session is over
+		void close();
+
+		// false once closed or the other player leaves
+		bool isOpen() const { return socket_.isOpen(); }
+
+		// true once a message from the other player has arrived
+		bool isConnected() const { return connected_; }
+
+		int localPlayer() const { return local_; }
+
+		// runs one tick with the input of each player, the world must only change through this
+		// it is called again for ticks that are simulated again, so it must not have other effects
+		std::function<void(unsigned tick, const ROLLBACKINPUT* inputs)> step;
+
+		// reads the other player's input, rolls back if a prediction was wrong, then runs the next tick
+		// with this input, call once a frame. Returns false if it waited instead of running a tick
+		bool advance(const ROLLBACKINPUT& input);
+
+		// ticks between reading local input and using it, more hides more latency but responds later
+		// set before host() or join(), both players must use the same delay
+		unsigned inputDelay{ 2 };
+
+		// ticks that can be predicted and rolled back, set before host() or join()
+		unsigned maxRollback{ 8 };
+
+		// milliseconds a frame may spend simulating ticks again, limits prediction when ticks are slow
+		float frameBudget{ 8.0f };
+
+		// seconds without a message before the other player is taken to have left
+		float timeout{ 5.0f };
+
+		// next tick to run
+		unsigned tick() const { return tick_; }
+
+		// true while step is running a tick again
+		bool resimulating() const { return resimulating_; }
+
+		NetSocket& socket() { return socket_; }
+
+		// snapshot used to save and restore, set its makeActor to bring back actors removed since a tick
+		WorldSnapshot& snapshot() { return snapshot_; }
+
+		unsigned rollbacks() const { return rollbacks_; }
+		// ticks whose saved snapshots hashed differently for the players
+		unsigned desyncs() const { return desyncs_; }
+
+		// logs rollbacks, waits and the cost of saving, restoring and simulating again
+		void logStats() const;
+
+	private:
+		// inputs kept for each player, enough for the ring and the input delay
+		static constexpr unsigned InputRing = 256;
+
+		struct STATE {
+			unsigned tick{ ~0u };
+			uint32_t checksum{ 0 };
+			std::vector<uint8_t> data;
+		};
+
+		bool _open();
+		void _receive();
+		void _send();
+		void _save(unsigned tick);
+		void _rollback();
+		void _simulate(unsigned tick);
+		void _checkSync();
+		unsigned _predictionLimit() const;
+		const ROLLBACKINPUT& _input(int player, unsigned tick) const { return inputs_[player][tick % InputRing]; }
+
+		World& world_;
+		WorldSnapshot snapshot_;
+		NetSocket socket_;
+		std::string peer_;
+		int local_{ 0 };
+		bool connected_{ false };
+		bool resimulating_{ false };
+		int64_t lastHeard_{ 0 };
+
+		unsigned tick_{ 0 };
+		// inputs of each player by tick, known for ticks before received_
+		ROLLBACKINPUT inputs_[Players][InputRing];
+		unsigned received_[Players]{ 0, 0 };
+		// remote inputs each tick was run with, compared when the real ones arrive
+		ROLLBACKINPUT used_[InputRing];
+		// earliest tick run with a wrong prediction, or ~0u
+		unsigned rollbackFrom_{ ~0u };
+		std::vector<STATE> states_;
+
+		// newest tick and inputs the other player reported
+		unsigned remoteTick_{ 0 };
+		unsigned remoteAck_{ 0 };
+		int remoteAdvantage_{ 0 };
+		unsigned remoteSyncTick_{ 0 };
+		uint32_t remoteChecksum_{ 0 };
+		unsigned checkedTick_{ 0 };
+		unsigned lastSkip_{ 0 };
+		std::vector<uint8_t> message_;
+
+		unsigned rollbacks_{ 0 };
+		unsigned resimulated_{ 0 };
+		unsigned deepest_{ 0 };
+		unsigned waits_{ 0 };
+		unsigned skips_{ 0 };
+		unsigned desyncs_{ 0 };
+		float saveMilliseconds_{ 0.0f };
+		float restoreMilliseconds_{ 0.0f };
+		float stepMilliseconds_{ 0.0f };
+		float worstRollbackMilliseconds_{ 0.0f };
+	};
+} // namespace GameLib
+
+#endif
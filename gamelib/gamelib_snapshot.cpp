@@ -0,0 +1,514 @@
+#include "pch.h"
+#include <gamelib_random.hpp>
+#include <gamelib_snapshot.hpp>
+
+namespace GameLib {
+	bool SnapshotWriter::open(const std::string& path, size_t bufferSize) {
+		close();
+		fout_.open(path, std::ios::binary | std::ios::trunc);
+		if (!fout_) {
+			HFLOGERROR("cannot write '%s'", path.c_str());
+			return false;
+		}
+		toFile_ = true;
+		bufferSize_ = std::max<size_t>(bufferSize, 4096);
+		buffer_.reserve(bufferSize_);
+		_start();
+		return true;
+	}
+
+
+	void SnapshotWriter::openMemory() {
+		close();
+		_start();
+	}
+
+
+	bool SnapshotWriter::finish() {
+		endSection();
+		SNAPSHOTHEADER header;
+		header.sectionCount = sectionCount_;
+		_patch(0, &header, sizeof(header));
+		if (!toFile_)
+			return true;
+		_flush();
+		fout_.flush();
+		bool written = (bool)fout_;
+		close();
+		return written;
+	}
+
+
+	void SnapshotWriter::close() {
+		if (fout_.is_open())
+			fout_.close();
+		fout_.clear();
+		toFile_ = false;
+	}
+
+
+	void SnapshotWriter::beginSection(uint32_t tag) {
+		endSection();
+		sectionStart_ = offset();
+		inSection_ = true;
+		sectionCount_++;
+		SNAPSHOTSECTION section;
+		section.tag = tag;
+		write(section);
+	}
+
+
+	void SnapshotWriter::endSection() {
+		if (!inSection_)
+			return;
+		align();
+		uint64_t size = offset() - sectionStart_ - sizeof(SNAPSHOTSECTION);
+		_patch(sectionStart_ + offsetof(SNAPSHOTSECTION, size), &size, sizeof(size));
+		inSection_ = false;
+	}
+
+
+	void SnapshotWriter::write(const void* data, size_t size) {
+		if (!toFile_) {
+			buffer_.insert(buffer_.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+			return;
+		}
+		if (buffer_.size() + size > bufferSize_)
+			_flush();
+		// large arrays skip the buffer
+		if (size >= bufferSize_) {
+			fout_.write((const char*)data, size);
+			flushed_ += size;
+			return;
+		}
+		buffer_.insert(buffer_.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	}
+
+
+	void SnapshotWriter::align() {
+		static const uint8_t zeros[SnapshotAlignment]{};
+		size_t padding = (size_t)((SnapshotAlignment - offset() % SnapshotAlignment) % SnapshotAlignment);
+		write(zeros, padding);
+	}
+
+
+	uint64_t SnapshotWriter::beginBlock() {
+		uint64_t block = offset();
+		write((uint64_t)0);
+		return block;
+	}
+
+
+	void SnapshotWriter::endBlock(uint64_t block) {
+		uint64_t size = offset() - block - sizeof(uint64_t);
+		_patch(block, &size, sizeof(size));
+	}
+
+
+	void SnapshotWriter::_start() {
+		buffer_.clear();
+		flushed_ = 0;
+		sectionStart_ = 0;
+		inSection_ = false;
+		sectionCount_ = 0;
+		write(SNAPSHOTHEADER());
+	}
+
+
+	void SnapshotWriter::_flush() {
+		if (buffer_.empty())
+			return;
+		fout_.write((const char*)buffer_.data(), buffer_.size());
+		flushed_ += buffer_.size();
+		buffer_.clear();
+	}
+
+
+	void SnapshotWriter::_patch(uint64_t offset, const void* data, size_t size) {
+		if (offset >= flushed_) {
+			memcpy(buffer_.data() + (offset - flushed_), data, size);
+			return;
+		}
+		// the value was already written, so the file is patched in place
+		_flush();
+		fout_.seekp((std::streamoff)offset);
+		fout_.write((const char*)data, size);
+		fout_.seekp(0, std::ios::end);
+	}
+
+
+	bool SnapshotFile::open(const std::string& path) {
+		close();
+		if (!file_.open(path)) {
+			HFLOGERROR("'%s' not found", path.c_str());
+			return false;
+		}
+		data_ = file_.data();
+		size_ = file_.size();
+		return _index(path.c_str());
+	}
+
+
+	bool SnapshotFile::open(const void* data, size_t size) {
+		close();
+		data_ = (const uint8_t*)data;
+		size_ = size;
+		return _index("snapshot");
+	}
+
+
+	void SnapshotFile::close() {
+		file_.close();
+		data_ = nullptr;
+		size_ = 0;
+		sections_.clear();
+	}
+
+
+	SnapshotReader SnapshotFile::section(uint32_t tag) const {
+		for (auto& s : sections_) {
+			if (s.tag == tag)
+				return SnapshotReader(data_ + s.offset, s.size);
+		}
+		return SnapshotReader();
+	}
+
+
+	bool SnapshotFile::_index(const char* name) {
+		SNAPSHOTHEADER expected;
+		SNAPSHOTHEADER header;
+		bool valid = data_ && size_ >= sizeof(header);
+		if (valid) {
+			memcpy(&header, data_, sizeof(header));
+			valid = !memcmp(header.magic, expected.magic, 4) && header.version == expected.version;
+		}
+		size_t offset = sizeof(header);
+		for (uint32_t i = 0; valid && i < header.sectionCount; i++) {
+			SNAPSHOTSECTION section;
+			valid = sizeof(section) <= size_ - offset;
+			if (!valid)
+				break;
+			memcpy(&section, data_ + offset, sizeof(section));
+			offset += sizeof(section);
+			valid = section.size <= size_ - offset;
+			if (!valid)
+				break;
+			sections_.push_back({ section.tag, offset, (size_t)section.size });
+			offset += (size_t)section.size;
+		}
+		if (!valid) {
+			HFLOGERROR("'%s' is not a snapshot", name);
+			close();
+			return false;
+		}
+		return true;
+	}
+
+
+	bool WorldSnapshot::save(const std::string& path) {
+		Hf::StopWatch stopwatch;
+		if (!writer_.open(path))
+			return false;
+		write(writer_);
+		bool saved = writer_.finish();
+		milliseconds_ = stopwatch.stop_msf();
+		return saved;
+	}
+
+
+	const std::vector<uint8_t>& WorldSnapshot::save() {
+		Hf::StopWatch stopwatch;
+		writer_.openMemory();
+		write(writer_);
+		writer_.finish();
+		milliseconds_ = stopwatch.stop_msf();
+		return writer_.data();
+	}
+
+
+	bool WorldSnapshot::load(const std::string& path) {
+		Hf::StopWatch stopwatch;
+		SnapshotFile snapshot;
+		bool loaded = snapshot.open(path) && read(snapshot);
+		milliseconds_ = stopwatch.stop_msf();
+		return loaded;
+	}
+
+
+	bool WorldSnapshot::load(const void* data, size_t size) {
+		Hf::StopWatch stopwatch;
+		SnapshotFile snapshot;
+		bool loaded = snapshot.open(data, size) && read(snapshot);
+		milliseconds_ = stopwatch.stop_msf();
+		return loaded;
+	}
+
+
+	void WorldSnapshot::write(SnapshotWriter& w) const {
+		w.beginSection(WorldTag);
+		w.write((int32_t)world_.worldSizeX);
+		w.write((int32_t)world_.worldSizeY);
+
+		// tiles are written a field at a time so there is no padding to copy and each column reads in place
+		constexpr int count = WorldTilesX * WorldTilesY;
+		char charDescs[count];
+		uint32_t spriteIds[count];
+		uint32_t flags[count];
+		w.beginSection(PagesTag);
+		w.write(pages ? (uint32_t)world_.residentPages() : 0u);
+		for (int py = 0; pages && py < world_.pagesY(); py++) {
+			for (int px = 0; px < world_.pagesX(); px++) {
+				const WORLDPAGE* page = world_.getPage(px, py);
+				if (!page)
+					continue;
+				for (int i = 0; i < count; i++) {
+					charDescs[i] = page->tiles[i].charDesc;
+					spriteIds[i] = page->tiles[i].spriteId;
+					flags[i] = page->tiles[i].flags;
+				}
+				w.write((int32_t)px);
+				w.write((int32_t)py);
+				w.align();
+				w.write(charDescs, sizeof(charDescs));
+				w.align();
+				w.write(spriteIds, sizeof(spriteIds));
+				w.write(flags, sizeof(flags));
+				w.write(page->collisionTiles, sizeof(page->collisionTiles));
+				w.align();
+			}
+		}
+
+		auto lists = { &world_.dynamicActors, &world_.staticActors, &world_.triggerActors };
+		uint32_t actorCount = 0;
+		for (auto* actors : lists)
+			actorCount += (uint32_t)actors->size();
+		w.beginSection(ActorsTag);
+		w.write(actorCount);
+		w.align();
+		for (auto* actors : lists) {
+			for (auto& a : *actors) {
+				ACTORSTATE state;
+				a->saveState(state);
+				w.write(state);
+			}
+		}
+
+		// each actor has a block for each component, in the same order as the actors
+		w.beginSection(ComponentsTag);
+		for (auto* actors : lists) {
+			for (auto& a : *actors) {
+				uint64_t block = w.beginBlock();
+				if (a->actorComponent())
+					a->actorComponent()->writeState(*a, w);
+				w.endBlock(block);
+				block = w.beginBlock();
+				if (a->physicsComponent())
+					a->physicsComponent()->writeState(*a, w);
+				w.endBlock(block);
+			}
+		}
+
+		// the overlap cache of each actor, so events after a restore begin and end the same overlaps
+		w.beginSection(OverlapsTag);
+		for (auto* actors : lists) {
+			for (auto& a : *actors) {
+				w.write((int32_t)a->triggerInfo.overlapCount);
+				w.write((uint32_t)a->triggerInfo.overlaps.size());
+				for (auto& o : a->triggerInfo.overlaps)
+					w.write((uint32_t)o.id);
+			}
+		}
+
+		if (portable) {
+			w.beginSection(RandomTag);
+			w.writeString(random.state());
+		} else {
+			static_assert(std::is_trivially_copyable<std::mt19937>::value, "the generator is copied as bytes");
+			w.beginSection(RandomMemoryTag);
+			w.write((uint8_t)random.deterministic());
+			w.align();
+			w.write(random.generator());
+		}
+		w.endSection();
+	}
+
+
+	bool WorldSnapshot::read(const SnapshotFile& snapshot) {
+		// every section is found and checked first, so a damaged snapshot changes nothing
+		SnapshotReader r = snapshot.section(WorldTag);
+		int32_t sizeX = 0;
+		int32_t sizeY = 0;
+		if (!r.read(sizeX) || !r.read(sizeY) || sizeX <= 0 || sizeY <= 0) {
+			HFLOGERROR("snapshot has no world");
+			return false;
+		}
+		if (!_findPages(snapshot.section(PagesTag))) {
+			HFLOGERROR("snapshot pages are damaged");
+			return false;
+		}
+		if (!_findActors(snapshot.section(ActorsTag), snapshot.section(ComponentsTag), snapshot.section(OverlapsTag))) {
+			HFLOGERROR("snapshot actors are damaged");
+			return false;
+		}
+		bool deterministic = false;
+		std::mt19937 generator;
+		r = snapshot.section(RandomMemoryTag);
+		if (r.ok()) {
+			uint8_t seeded = 0;
+			r.read(seeded);
+			r.align();
+			r.read(generator);
+			deterministic = seeded != 0;
+		} else {
+			std::string state;
+			r = snapshot.section(RandomTag);
+			if (r.readString(state) && !Random::parseState(state, generator, deterministic))
+				r = SnapshotReader();
+		}
+		if (!r.ok()) {
+			HFLOGERROR("snapshot random state is damaged");
+			return false;
+		}
+
+		// pages that are not in the snapshot are left alone unless the world changes size
+		if (sizeX != world_.worldSizeX || sizeY != world_.worldSizeY)
+			world_.resize(sizeX, sizeY, false);
+		for (auto& page : pages_)
+			world_.writePage(page.px, page.py, page.charDescs, page.spriteIds, page.flags, page.collisionTiles);
+		_restoreActors();
+		_restoreOverlaps();
+		random.setGenerator(generator, deterministic);
+		pages_.clear();
+		actors_.clear();
+		restored_.clear();
+		return true;
+	}
+
+
+	bool WorldSnapshot::_findPages(SnapshotReader r) {
+		constexpr int count = WorldTilesX * WorldTilesY;
+		uint32_t pageCount = 0;
+		pages_.clear();
+		if (!r.read(pageCount))
+			return false;
+		for (uint32_t i = 0; i < pageCount; i++) {
+			PAGE page;
+			r.read(page.px);
+			r.read(page.py);
+			r.align();
+			page.charDescs = r.view<char>(count);
+			r.align();
+			page.spriteIds = r.view<uint32_t>(count);
+			page.flags = r.view<uint32_t>(count);
+			page.collisionTiles = r.view<uint8_t>(sizeof(WORLDPAGE::collisionTiles));
+			r.align();
+			if (!r.ok())
+				return false;
+			pages_.push_back(page);
+		}
+		return true;
+	}
+
+
+	bool WorldSnapshot::_findActors(SnapshotReader r, SnapshotReader components, SnapshotReader overlaps) {
+		uint32_t count = 0;
+		actors_.clear();
+		r.read(count);
+		r.align();
+		const ACTORSTATE* states = r.view<ACTORSTATE>(count);
+		if (!states || !components.ok() || !overlaps.ok())
+			return false;
+		actors_.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			ACTOR& actor = actors_[i];
+			actor.state = &states[i];
+			actor.actorState = components.block();
+			actor.physicsState = components.block();
+			overlaps.read(actor.overlapCount);
+			overlaps.read(actor.overlapIdCount);
+			actor.overlapIds = overlaps.view<uint32_t>(actor.overlapIdCount);
+			if (!components.ok() || !actor.overlapIds)
+				return false;
+		}
+		return true;
+	}
+
+
+	void WorldSnapshot::_restoreActors() {
+		std::vector<unsigned> ids(actors_.size());
+		for (size_t i = 0; i < actors_.size(); i++)
+			ids[i] = actors_[i].state->id;
+		std::sort(ids.begin(), ids.end());
+		std::vector<unsigned> gone;
+		for (auto* actors : { &world_.dynamicActors, &world_.staticActors, &world_.triggerActors }) {
+			for (auto& a : *actors) {
+				if (!std::binary_search(ids.begin(), ids.end(), a->getId()))
+					gone.push_back(a->getId());
+			}
+		}
+		// the saved overlaps are put back as they were, so no events are sent for the ones that go
+		for (unsigned id : gone)
+			world_.removeActor(id, false);
+
+		// actors update in list order, so the lists are put back in the order they were saved
+		std::vector<ActorPtr> dynamicActors;
+		std::vector<ActorPtr> staticActors;
+		std::vector<ActorPtr> triggerActors;
+		restored_.assign(actors_.size(), nullptr);
+		for (size_t i = 0; i < actors_.size(); i++) {
+			ACTOR& actor = actors_[i];
+			const ACTORSTATE& state = *actor.state;
+			ActorPtr a = world_.getActor(state.id);
+			if (!a) {
+				a = makeActor ? makeActor(state.charDesc) : nullptr;
+				if (!a) {
+					HFLOGWARN("Unable to restore actor %u '%c'", state.id, state.charDesc);
+					continue;
+				}
+				a->loadState(state);
+				switch (state.type) {
+				case Actor::DYNAMIC: world_.addDynamicActor(a); break;
+				case Actor::STATIC: world_.addStaticActor(a); break;
+				default: world_.addTriggerActor(a); break;
+				}
+				// the body is made where the actor is, then given its saved motion below
+				if (a->physicsComponent())
+					a->physicsComponent()->beginPlay(*a);
+			}
+			a->loadState(state);
+			if (a->actorComponent())
+				a->actorComponent()->readState(*a, actor.actorState);
+			if (a->physicsComponent())
+				a->physicsComponent()->readState(*a, actor.physicsState);
+			switch (state.type) {
+			case Actor::DYNAMIC: dynamicActors.push_back(a); break;
+			case Actor::STATIC: staticActors.push_back(a); break;
+			default: triggerActors.push_back(a); break;
+			}
+			restored_[i] = a;
+		}
+		world_.dynamicActors = std::move(dynamicActors);
+		world_.staticActors = std::move(staticActors);
+		world_.triggerActors = std::move(triggerActors);
+		world_.triggersMoved();
+	}
+
+
+	void WorldSnapshot::_restoreOverlaps() {
+		for (size_t i = 0; i < actors_.size(); i++) {
+			const ACTOR& actor = actors_[i];
+			if (!restored_[i])
+				continue;
+			// the ids are saved sorted, triggers that were not restored are dropped
+			auto& info = restored_[i]->triggerInfo;
+			info.overlaps.clear();
+			info.current.clear();
+			for (uint32_t k = 0; k < actor.overlapIdCount; k++) {
+				if (ActorPtr trigger = world_.getActor(actor.overlapIds[k]))
+					info.overlaps.push_back({ actor.overlapIds[k], trigger });
+			}
+			info.overlapCount = actor.overlapCount;
+			info.overlapping = !info.overlaps.empty() || actor.overlapCount > 0;
+		}
+	}
+} // namespace GameLib
@@ -0,0 +1,281 @@
+#ifndef GAMELIB_SNAPSHOT_HPP
+#define GAMELIB_SNAPSHOT_HPP
+
+#include <gamelib_actor.hpp>
+#include <gamelib_archive.hpp>
+#include <fstream>
+
+namespace GameLib {
+	// SNAPSHOTHEADER starts a snapshot, sections follow it
+	struct SNAPSHOTHEADER {
+		char magic[4]{ 'G', 'L', 'S', 'S' };
+		// version 3 added the overlaps section, which every snapshot has
+		// version 4 added the angle and angular velocity of Box2D bodies
+		uint32_t version{ 4 };
+		uint32_t sectionCount{ 0 };
+		uint32_t reserved{ 0 };
+	};
+
+	// SNAPSHOTSECTION starts each section, sections are padded so every section starts aligned
+	struct SNAPSHOTSECTION {
+		uint32_t tag{ 0 };
+		uint32_t reserved{ 0 };
+		// bytes after this struct, including padding
+		uint64_t size{ 0 };
+	};
+
+	// sections and aligned data start on this boundary, so arrays can be read in place
+	constexpr size_t SnapshotAlignment = 16;
+
+	// returns a section tag made of four characters
+	constexpr uint32_t snapshotTag(char a, char b, char c, char d) {
+		return (uint32_t)(uint8_t)a | (uint32_t)(uint8_t)b << 8 | (uint32_t)(uint8_t)c << 16 | (uint32_t)(uint8_t)d << 24;
+	}
+
+	// SnapshotWriter streams a snapshot through a buffer to a file, or keeps it in memory
+	// Values are written in machine byte order, like replays
+	class SnapshotWriter {
+	public:
+		SnapshotWriter() {}
+		~SnapshotWriter() { close(); }
+		SnapshotWriter(const SnapshotWriter&) = delete;
+		SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+		// starts a snapshot at path, which is written each time bufferSize bytes are buffered
+		bool open(const std::string& path, size_t bufferSize = 65536);
+
+		// starts a snapshot in memory, data() holds it after finish(), memory is kept for the next snapshot
+		void openMemory();
+
+		// ends the last section and writes the header, returns false if a write failed
+		bool finish();
+
+		// closes the file without finishing it
+		void close();
+
+		void beginSection(uint32_t tag);
+		void endSection();
+
+		void write(const void* data, size_t size);
+
+		template <typename T>
+		void write(const T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "only plain data can be written");
+			write(&value, sizeof(T));
+		}
+
+		void writeString(const std::string& s) {
+			write((uint32_t)s.size());
+			write(s.data(), s.size());
+		}
+
+		// pads to SnapshotAlignment so SnapshotReader::view() can read the next array in place
+		void align();
+
+		// starts a block whose size is written in front of it, so readers can skip what they do not read
+		uint64_t beginBlock();
+		void endBlock(uint64_t block);
+
+		// bytes written so far
+		uint64_t offset() const { return flushed_ + buffer_.size(); }
+
+		// the snapshot made by openMemory()
+		const std::vector<uint8_t>& data() const { return buffer_; }
+
+	private:
+		void _start();
+		void _flush();
+		void _patch(uint64_t offset, const void* data, size_t size);
+
+		std::ofstream fout_;
+		bool toFile_{ false };
+		std::vector<uint8_t> buffer_;
+		size_t bufferSize_{ 0 };
+		// bytes already written to the file
+		uint64_t flushed_{ 0 };
+		uint64_t sectionStart_{ 0 };
+		bool inSection_{ false };
+		uint32_t sectionCount_{ 0 };
+	};
+
+	// SnapshotReader reads values from memory it does not own, a read past the end fails and every read after it
+	class SnapshotReader {
+	public:
+		SnapshotReader() {}
+		SnapshotReader(const void* data, size_t size) : data_((const uint8_t*)data), size_(size), ok_(true) {}
+
+		bool read(void* data, size_t size) {
+			if (!ok_ || size > size_ - pos_)
+				return ok_ = false;
+			memcpy(data, data_ + pos_, size);
+			pos_ += size;
+			return true;
+		}
+
+		template <typename T>
+		bool read(T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "only plain data can be read");
+			return read(&value, sizeof(T));
+		}
+
+		bool readString(std::string& s) {
+			uint32_t size = 0;
+			const char* p = read(size) ? view<char>(size) : nullptr;
+			if (p)
+				s.assign(p, size);
+			return p != nullptr;
+		}
+
+		// returns count values where they are, without copying, or nullptr if they are past the end or unaligned
+		template <typename T>
+		const T* view(size_t count) {
+			static_assert(std::is_trivially_copyable<T>::value, "only plain data can be viewed");
+			if (!ok_ || count > (size_ - pos_) / sizeof(T) || (uintptr_t)(data_ + pos_) % alignof(T)) {
+				ok_ = false;
+				return nullptr;
+			}
+			const T* p = (const T*)(data_ + pos_);
+			pos_ += count * sizeof(T);
+			return p;
+		}
+
+		// skips the padding written by SnapshotWriter::align()
+		void align() { pos_ = std::min(size_, (pos_ + SnapshotAlignment - 1) / SnapshotAlignment * SnapshotAlignment); }
+
+		// returns a reader of a block written between beginBlock() and endBlock() and moves past it
+		SnapshotReader block() {
+			uint64_t size = 0;
+			const uint8_t* p = read(size) && size <= size_ - pos_ ? view<uint8_t>((size_t)size) : nullptr;
+			if (!p)
+				return SnapshotReader();
+			return SnapshotReader(p, (size_t)size);
+		}
+
+		size_t remaining() const { return size_ - pos_; }
+
+		// false if the reader is empty or a read failed
+		bool ok() const { return ok_; }
+
+	private:
+		const uint8_t* data_{ nullptr };
+		size_t size_{ 0 };
+		size_t pos_{ 0 };
+		bool ok_{ false };
+	};
+
+	// SnapshotFile maps a snapshot into memory, or uses one already in memory, and finds its sections
+	class SnapshotFile {
+	public:
+		SnapshotFile() {}
+		SnapshotFile(const SnapshotFile&) = delete;
+		SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+		// returns false if the file is missing or not a snapshot
+		bool open(const std::string& path);
+
+		// reads a snapshot that stays in memory owned by the caller until close()
+		bool open(const void* data, size_t size);
+
+		void close();
+
+		bool isOpen() const { return data_ != nullptr; }
+
+		// returns a reader of the section, or an empty reader that is not ok() if there is none
+		SnapshotReader section(uint32_t tag) const;
+
+	private:
+		struct SECTION {
+			uint32_t tag{ 0 };
+			size_t offset{ 0 };
+			size_t size{ 0 };
+		};
+
+		bool _index(const char* name);
+
+		MappedFile file_;
+		const uint8_t* data_{ nullptr };
+		size_t size_{ 0 };
+		std::vector<SECTION> sections_;
+	};
+
+	// WorldSnapshot saves and restores a world during play: the tiles of resident pages, the state of every actor
+	// with its Box2D body, state written by the actor and physics components, the triggers each actor overlaps,
+	// and GameLib::random
+	// Tiles are written as columns of fields with no padding so a mapped snapshot is read in place
+	// Restoring matches actors by id, so a snapshot is restored into the world it was taken from
+	class WorldSnapshot {
+	public:
+		WorldSnapshot(World& world) : world_(world) {}
+
+		bool save(const std::string& path);
+
+		// saves into memory, the bytes stay valid until the next save
+		const std::vector<uint8_t>& save();
+
+		bool load(const std::string& path);
+		bool load(const void* data, size_t size);
+
+		// writes the sections of a snapshot, the writer is opened and finished by the caller
+		void write(SnapshotWriter& writer) const;
+
+		// restores the world from a snapshot, returns false and leaves the world alone if a section is missing or damaged
+		bool read(const SnapshotFile& snapshot);
+
+		// when set, actors in the snapshot that are not in the world are made with makeActor(charDesc)
+		// and have their body made by the physics component, otherwise they are skipped
+		// actors in the world that are not in the snapshot are always removed
+		std::function<ActorPtr(char charDesc)> makeActor;
+
+		// when false no pages are written, for frequent saves of a world whose tiles do not change during play
+		bool pages{ true };
+
+		// when false the random generator is copied as it is in memory instead of written as text, which is
+		// quicker but only reads back in the same build, for snapshots that never leave the process
+		bool portable{ true };
+
+		// milliseconds the last save or load took
+		float milliseconds() const { return milliseconds_; }
+
+		static constexpr uint32_t WorldTag = snapshotTag('W', 'R', 'L', 'D');
+		static constexpr uint32_t PagesTag = snapshotTag('P', 'A', 'G', 'E');
+		static constexpr uint32_t ActorsTag = snapshotTag('A', 'C', 'T', 'R');
+		static constexpr uint32_t ComponentsTag = snapshotTag('C', 'O', 'M', 'P');
+		static constexpr uint32_t OverlapsTag = snapshotTag('O', 'V', 'L', 'P');
+		static constexpr uint32_t RandomTag = snapshotTag('R', 'A', 'N', 'D');
+		static constexpr uint32_t RandomMemoryTag = snapshotTag('R', 'N', 'D', 'M');
+
+	private:
+		// a page and an actor of a snapshot, found where they are and checked before anything is restored
+		struct PAGE {
+			int32_t px{ 0 };
+			int32_t py{ 0 };
+			const char* charDescs{ nullptr };
+			const uint32_t* spriteIds{ nullptr };
+			const uint32_t* flags{ nullptr };
+			const uint8_t* collisionTiles{ nullptr };
+		};
+		struct ACTOR {
+			const ACTORSTATE* state{ nullptr };
+			SnapshotReader actorState;
+			SnapshotReader physicsState;
+			int32_t overlapCount{ 0 };
+			uint32_t overlapIdCount{ 0 };
+			const uint32_t* overlapIds{ nullptr };
+		};
+
+		bool _findPages(SnapshotReader r);
+		bool _findActors(SnapshotReader r, SnapshotReader components, SnapshotReader overlaps);
+		void _restoreActors();
+		void _restoreOverlaps();
+
+		World& world_;
+		SnapshotWriter writer_;
+		std::vector<PAGE> pages_;
+		std::vector<ACTOR> actors_;
+		// the actors restored by _restoreActors() in snapshot order, nullptr for the ones skipped
+		std::vector<ActorPtr> restored_;
+		float milliseconds_{ 0.0f };
+	};
+} // namespace GameLib
+
+#endif
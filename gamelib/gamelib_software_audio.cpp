@@ -0,0 +1,421 @@
+#include "pch.h"
+#include <gamelib_software_audio.hpp>
+#include <gamelib_locator.hpp>
+#include <bitset>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GAMELIB_MIXER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GAMELIB_MIXER_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define GAMELIB_MIXER_NEON
+#endif
+
+namespace GameLib {
+	namespace {
+		inline int countBits(uint32_t bits) { return (int)std::bitset<32>(bits).count(); }
+	} // namespace
+
+
+	void mixVoiceScalar(float* dst, const float* src, size_t count, float left, float right) {
+		for (size_t i = 0; i < count; i += 2) {
+			dst[i] += src[i] * left;
+			dst[i + 1] += src[i + 1] * right;
+		}
+	}
+
+
+	uint64_t finishMixScalar(float* samples, size_t count, float volume, int16_t* pcm) {
+		uint64_t clipped = 0;
+		for (size_t i = 0; i < count; i++) {
+			float s = samples[i] * volume;
+			if (s > 1.0f || s < -1.0f) {
+				clipped++;
+				s = s > 1.0f ? 1.0f : -1.0f;
+			}
+			samples[i] = s;
+			if (pcm)
+				pcm[i] = (int16_t)std::lround(s * 32767.0f);
+		}
+		return clipped;
+	}
+
+
+	void mixVoice(float* dst, const float* src, size_t count, float left, float right) {
+		size_t i = 0;
+#if defined(GAMELIB_MIXER_AVX2)
+		const __m256 gain = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+		for (; i + 8 <= count; i += 8) {
+			__m256 d = _mm256_loadu_ps(dst + i);
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(src + i), gain)));
+		}
+#elif defined(GAMELIB_MIXER_SSE2)
+		const __m128 gain = _mm_setr_ps(left, right, left, right);
+		for (; i + 4 <= count; i += 4) {
+			__m128 d = _mm_loadu_ps(dst + i);
+			_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(src + i), gain)));
+		}
+#elif defined(GAMELIB_MIXER_NEON)
+		const float32x4_t gain = { left, right, left, right };
+		for (; i + 4 <= count; i += 4)
+			vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vld1q_f32(src + i), gain)));
+#endif
+		// count is always even, so the tail starts on a left sample
+		mixVoiceScalar(dst + i, src + i, count - i, left, right);
+	}
+
+
+	uint64_t finishMix(float* samples, size_t count, float volume, int16_t* pcm) {
+		uint64_t clipped = 0;
+		size_t i = 0;
+#if defined(GAMELIB_MIXER_AVX2)
+		const __m256 v = _mm256_set1_ps(volume);
+		const __m256 hi = _mm256_set1_ps(1.0f);
+		const __m256 lo = _mm256_set1_ps(-1.0f);
+		const __m256 scale = _mm256_set1_ps(32767.0f);
+		for (; i + 8 <= count; i += 8) {
+			__m256 s = _mm256_mul_ps(_mm256_loadu_ps(samples + i), v);
+			__m256 outside = _mm256_or_ps(_mm256_cmp_ps(s, hi, _CMP_GT_OQ), _mm256_cmp_ps(s, lo, _CMP_LT_OQ));
+			clipped += countBits((uint32_t)_mm256_movemask_ps(outside));
+			s = _mm256_min_ps(_mm256_max_ps(s, lo), hi);
+			_mm256_storeu_ps(samples + i, s);
+			if (pcm) {
+				// rounds half away from zero like std::lround, the fraction is exact and twice it truncates to the step
+				__m256 x = _mm256_mul_ps(s, scale);
+				__m256i n = _mm256_cvttps_epi32(x);
+				__m256 fraction = _mm256_sub_ps(x, _mm256_cvtepi32_ps(n));
+				n = _mm256_add_epi32(n, _mm256_cvttps_epi32(_mm256_add_ps(fraction, fraction)));
+				// packs within each 128 bit lane, so the lanes are put back in order afterwards
+				__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(n, n), 0x08);
+				_mm_storeu_si128((__m128i*)(pcm + i), _mm256_castsi256_si128(packed));
+			}
+		}
+#elif defined(GAMELIB_MIXER_SSE2)
+		const __m128 v = _mm_set1_ps(volume);
+		const __m128 hi = _mm_set1_ps(1.0f);
+		const __m128 lo = _mm_set1_ps(-1.0f);
+		const __m128 scale = _mm_set1_ps(32767.0f);
+		for (; i + 4 <= count; i += 4) {
+			__m128 s = _mm_mul_ps(_mm_loadu_ps(samples + i), v);
+			__m128 outside = _mm_or_ps(_mm_cmpgt_ps(s, hi), _mm_cmplt_ps(s, lo));
+			clipped += countBits((uint32_t)_mm_movemask_ps(outside));
+			s = _mm_min_ps(_mm_max_ps(s, lo), hi);
+			_mm_storeu_ps(samples + i, s);
+			if (pcm) {
+				// rounds half away from zero like std::lround, the fraction is exact and twice it truncates to the step
+				__m128 x = _mm_mul_ps(s, scale);
+				__m128i n = _mm_cvttps_epi32(x);
+				__m128 fraction = _mm_sub_ps(x, _mm_cvtepi32_ps(n));
+				n = _mm_add_epi32(n, _mm_cvttps_epi32(_mm_add_ps(fraction, fraction)));
+				_mm_storel_epi64((__m128i*)(pcm + i), _mm_packs_epi32(n, n));
+			}
+		}
+#elif defined(GAMELIB_MIXER_NEON)
+		const float32x4_t v = vdupq_n_f32(volume);
+		const float32x4_t hi = vdupq_n_f32(1.0f);
+		const float32x4_t lo = vdupq_n_f32(-1.0f);
+		const float32x4_t scale = vdupq_n_f32(32767.0f);
+		for (; i + 4 <= count; i += 4) {
+			float32x4_t s = vmulq_f32(vld1q_f32(samples + i), v);
+			uint32x4_t outside = vorrq_u32(vcgtq_f32(s, hi), vcltq_f32(s, lo));
+			// lanes outside are all ones, shifted down they count one each
+			clipped += vaddvq_u32(vshrq_n_u32(outside, 31));
+			s = vminq_f32(vmaxq_f32(s, lo), hi);
+			vst1q_f32(samples + i, s);
+			// vcvtaq rounds half away from zero like std::lround
+			if (pcm)
+				vst1_s16(pcm + i, vqmovn_s32(vcvtaq_s32_f32(vmulq_f32(s, scale))));
+		}
+#endif
+		return clipped + finishMixScalar(samples + i, count - i, volume, pcm ? pcm + i : nullptr);
+	}
+
+
+	const char* mixerKernelName() {
+#if defined(GAMELIB_MIXER_AVX2)
+		return "AVX2";
+#elif defined(GAMELIB_MIXER_SSE2)
+		return "SSE2";
+#elif defined(GAMELIB_MIXER_NEON)
+		return "NEON";
+#else
+		return "scalar";
+#endif
+	}
+
+
+	bool SoftwareAudio::loadClip(int clipId, const std::string& filename) {
+		SDL_RWops* rw = Locator::getContext()->openAsset(filename);
+		if (!rw) {
+			HFLOGWARN("Unable to load '%s'", filename.c_str());
+			return false;
+		}
+		return _decode(clipId, filename, rw);
+	}
+
+
+	int SoftwareAudio::loadClips(Context& context) {
+		int count = 0;
+		for (int clipId : context.audioClipIds()) {
+			AUDIOINFO* audio = context.getAudioClip(clipId);
+			SDL_RWops* rw = audio ? Context::openAudioClip(*audio) : nullptr;
+			if (rw && _decode(clipId, audio->name, rw))
+				count++;
+		}
+		return count;
+	}
+
+
+	bool SoftwareAudio::_decode(int clipId, const std::string& filename, SDL_RWops* rw) {
+		SDL_AudioSpec spec;
+		Uint8* wav;
+		Uint32 length;
+		if (!SDL_LoadWAV_RW(rw, 1, &spec, &wav, &length)) {
+			HFLOGWARN("Unable to decode '%s': %s", filename.c_str(), SDL_GetError());
+			return false;
+		}
+		SDL_AudioCVT cvt;
+		if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq, AUDIO_F32SYS, 2, frequency_) < 0) {
+			HFLOGWARN("Unable to convert '%s': %s", filename.c_str(), SDL_GetError());
+			SDL_FreeWAV(wav);
+			return false;
+		}
+		std::vector<uint8_t> converted(length * (size_t)cvt.len_mult);
+		std::memcpy(converted.data(), wav, length);
+		SDL_FreeWAV(wav);
+		cvt.buf = converted.data();
+		cvt.len = (int)length;
+		if (cvt.needed && SDL_ConvertAudio(&cvt) < 0) {
+			HFLOGWARN("Unable to convert '%s': %s", filename.c_str(), SDL_GetError());
+			return false;
+		}
+		size_t samples = (size_t)(cvt.needed ? cvt.len_cvt : cvt.len) / sizeof(float) & ~(size_t)1;
+		CLIP& clip = clips_[clipId];
+		clip.samples.resize(samples);
+		std::memcpy(clip.samples.data(), converted.data(), samples * sizeof(float));
+		return true;
+	}
+
+
+	void SoftwareAudio::setClipPan(int clipId, float pan) { clips_[clipId].pan = std::clamp(pan, -1.0f, 1.0f); }
+
+
+	void SoftwareAudio::setClipGain(int clipId, float gain) { clips_[clipId].gain = gain; }
+
+
+	bool SoftwareAudio::start(Mode mode, const std::string& wavPath) {
+		stop();
+		mode_ = mode;
+		if (!wavPath.empty()) {
+			fout_.open(wavPath, std::ios::binary);
+			if (!fout_) {
+				HFLOGERROR("cannot write audio to '%s'", wavPath.c_str());
+				return false;
+			}
+			wavBytes_ = 0;
+			_writeWavHeader(0);
+		}
+		stopping_ = false;
+		framesDue_ = 0;
+		thread_ = std::thread(&SoftwareAudio::_run, this);
+		HFLOGINFO("Software audio: %dHz, %d frame blocks, %s", frequency_, blockFrames_, mixerKernelName());
+		return true;
+	}
+
+
+	void SoftwareAudio::stop() {
+		if (thread_.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mixMutex_);
+				stopping_ = true;
+			}
+			mixReady_.notify_one();
+			thread_.join();
+		}
+		if (fout_.is_open()) {
+			// the sizes are only known now, so the header is written again
+			fout_.seekp(0);
+			_writeWavHeader(wavBytes_);
+			fout_.close();
+		}
+	}
+
+
+	void SoftwareAudio::mix(int frames) {
+		{
+			std::lock_guard<std::mutex> lock(requestMutex_);
+			std::lock_guard<std::mutex> mixLock(mixMutex_);
+			commands_.insert(commands_.end(), requests_.begin(), requests_.end());
+			requests_.clear();
+		}
+		_applyCommands();
+		_mix(frames);
+	}
+
+
+	void SoftwareAudio::playAudio(int audioClipId, bool stopPrevious) {
+		std::lock_guard<std::mutex> lock(requestMutex_);
+		requests_.push_back({ audioClipId, true, stopPrevious });
+	}
+
+
+	void SoftwareAudio::stopAudio(int audioClipId) {
+		std::lock_guard<std::mutex> lock(requestMutex_);
+		requests_.push_back({ audioClipId, false, false });
+	}
+
+
+	void SoftwareAudio::setVolume(float volume) { volume_ = volume; }
+
+
+	void SoftwareAudio::update() {
+		std::lock_guard<std::mutex> lock(requestMutex_);
+		{
+			std::lock_guard<std::mutex> mixLock(mixMutex_);
+			commands_.insert(commands_.end(), requests_.begin(), requests_.end());
+			if (mode_ == STEPPED && thread_.joinable())
+				framesDue_ += stepFrames;
+		}
+		requests_.clear();
+		mixReady_.notify_one();
+	}
+
+
+	void SoftwareAudio::logStats() const {
+		uint64_t frames = framesMixed_;
+		double seconds = (double)frames / frequency_;
+		double mixSeconds = mixNanoseconds_ * 1e-9;
+		HFLOGINFO("Software audio: %3.3f s mixed in %3.3f ms (%3.2f%% of real time), %3.1f voices average, %u peak, %llu samples clipped",
+			seconds,
+			mixSeconds * 1000.0,
+			seconds > 0.0 ? mixSeconds / seconds * 100.0 : 0.0,
+			frames ? (double)voiceFrames_ / frames : 0.0,
+			(unsigned)peakVoices_,
+			(unsigned long long)clippedSamples_);
+	}
+
+
+	void SoftwareAudio::_run() {
+		const auto blockTime = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>((double)blockFrames_ / frequency_));
+		Clock::time_point next = Clock::now();
+		for (;;) {
+			int frames = 0;
+			{
+				std::unique_lock<std::mutex> lock(mixMutex_);
+				if (mode_ == REALTIME) {
+					next += blockTime;
+					mixReady_.wait_until(lock, next, [this] { return stopping_; });
+				} else {
+					mixReady_.wait(lock, [this] { return stopping_ || framesDue_ > 0; });
+				}
+				// a stepped run mixes the frames it asked for before it stops, so the WAV file is complete
+				if (stopping_ && (mode_ == REALTIME || !framesDue_))
+					return;
+				if (mode_ == REALTIME) {
+					frames = blockFrames_;
+				} else {
+					frames = framesDue_;
+					framesDue_ = 0;
+				}
+			}
+			_applyCommands();
+			_mix(frames);
+		}
+	}
+
+
+	void SoftwareAudio::_applyCommands() {
+		{
+			std::lock_guard<std::mutex> lock(mixMutex_);
+			applying_.swap(commands_);
+		}
+		for (auto& c : applying_) {
+			if (!c.play || c.stopPrevious) {
+				voices_.erase(std::remove_if(voices_.begin(), voices_.end(), [&c](const VOICE& v) { return v.clipId == c.clipId; }),
+					voices_.end());
+			}
+			if (!c.play)
+				continue;
+			auto it = clips_.find(c.clipId);
+			if (it == clips_.end() || it->second.samples.empty())
+				continue;
+			if ((int)voices_.size() >= maxVoices && !voices_.empty())
+				voices_.erase(voices_.begin());
+			const CLIP& clip = it->second;
+			// constant power, so a centered clip is 3 dB down in each channel
+			float angle = (clip.pan + 1.0f) * 0.25f * glm::pi<float>();
+			VOICE v;
+			v.clipId = c.clipId;
+			v.clip = &clip;
+			v.left = std::cos(angle) * clip.gain;
+			v.right = std::sin(angle) * clip.gain;
+			voices_.push_back(v);
+		}
+		applying_.clear();
+	}
+
+
+	void SoftwareAudio::_mix(int frames) {
+		while (frames > 0) {
+			int n = std::min(frames, blockFrames_);
+			_mixBlock(n);
+			frames -= n;
+		}
+	}
+
+
+	void SoftwareAudio::_mixBlock(int frames) {
+		auto t0 = Clock::now();
+		size_t count = (size_t)frames * 2;
+		buffer_.assign(count, 0.0f);
+		unsigned voices = (unsigned)voices_.size();
+		uint64_t voiceFrames = 0;
+		for (auto& v : voices_) {
+			size_t n = std::min((size_t)frames, v.clip->samples.size() / 2 - v.frame);
+			mixVoice(buffer_.data(), v.clip->samples.data() + v.frame * 2, n * 2, v.left, v.right);
+			v.frame += n;
+			voiceFrames += n;
+		}
+		// finished voices are removed in order, so the oldest voice stays first
+		voices_.erase(std::remove_if(voices_.begin(), voices_.end(), [](const VOICE& v) { return v.frame * 2 >= v.clip->samples.size(); }),
+			voices_.end());
+		bool writing = fout_.is_open();
+		if (writing)
+			pcm_.resize(count);
+		clippedSamples_ += finishMix(buffer_.data(), count, volume_, writing ? pcm_.data() : nullptr);
+		mixNanoseconds_ += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+
+		if (writing) {
+			fout_.write((const char*)pcm_.data(), count * sizeof(int16_t));
+			wavBytes_ += (uint32_t)(count * sizeof(int16_t));
+		}
+		framesMixed_ += frames;
+		voiceFrames_ += voiceFrames;
+		if (voices > peakVoices_)
+			peakVoices_ = voices;
+	}
+
+
+	void SoftwareAudio::_writeWavHeader(uint32_t dataBytes) {
+		auto u32 = [this](uint32_t x) { fout_.write((const char*)&x, 4); };
+		auto u16 = [this](uint16_t x) { fout_.write((const char*)&x, 2); };
+		fout_.write("RIFF", 4);
+		u32(36 + dataBytes);
+		fout_.write("WAVEfmt ", 8);
+		u32(16);
+		u16(1);
+		u16(2);
+		u32((uint32_t)frequency_);
+		u32((uint32_t)frequency_ * 4);
+		u16(4);
+		u16(16);
+		fout_.write("data", 4);
+		u32(dataBytes);
+	}
+} // namespace GameLib
@@ -0,0 +1,159 @@
+#ifndef GAMELIB_SOFTWARE_AUDIO_HPP
+#define GAMELIB_SOFTWARE_AUDIO_HPP
+
+#include <gamelib_audio.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+namespace GameLib {
+	// returns the name of the instruction set the mixing kernels were built for
+	const char* mixerKernelName();
+
+	// adds count interleaved stereo samples of src to dst, scaled by left and right, count must be even
+	void mixVoice(float* dst, const float* src, size_t count, float left, float right);
+
+	// scales samples by volume, clamps them to full scale and converts them to 16 bit into pcm if it is not nullptr
+	// returns the number of samples that were clamped
+	uint64_t finishMix(float* samples, size_t count, float volume, int16_t* pcm);
+
+	// mixVoice() and finishMix() without SIMD, the kernels must give the same samples
+	void mixVoiceScalar(float* dst, const float* src, size_t count, float left, float right);
+	uint64_t finishMixScalar(float* samples, size_t count, float volume, int16_t* pcm);
+
+	// SoftwareAudio mixes clips into a float buffer on its own thread instead of sending them to SDL_mixer
+	// It needs no audio device, so tests and benchmarks can measure audio costs headless
+	// The mix is written to a 16 bit stereo WAV file or discarded, music is not mixed
+	class SoftwareAudio : public IAudio {
+	public:
+		enum Mode {
+			// the thread mixes in step with the clock, like a sound card would consume it
+			REALTIME,
+			// each update() mixes stepFrames, so a run that is faster than real time still mixes all of its audio
+			STEPPED
+		};
+
+		SoftwareAudio(int frequency = 48000, int blockFrames = 1024) : frequency_(frequency), blockFrames_(blockFrames) {}
+		~SoftwareAudio() override { stop(); }
+		SoftwareAudio(const SoftwareAudio&) = delete;
+		SoftwareAudio& operator=(const SoftwareAudio&) = delete;
+
+		// clips and their settings must not change while the mixing thread runs
+
+		// decodes a WAV clip from the context's archives or search paths to stereo float at the mixer frequency
+		bool loadClip(int clipId, const std::string& filename);
+
+		// decodes every clip loaded into the context, returns the number decoded
+		int loadClips(Context& context);
+
+		// constant power pan from -1 (left) to 1 (right), the default is 0
+		void setClipPan(int clipId, float pan);
+
+		// gain applied to every voice of a clip, the default is 1
+		void setClipGain(int clipId, float gain);
+
+		// starts the mixing thread, the mix is written to wavPath or discarded if it is empty
+		bool start(Mode mode = REALTIME, const std::string& wavPath = "");
+
+		// stops the mixing thread and finishes the WAV file
+		void stop();
+
+		bool running() const { return thread_.joinable(); }
+
+		// mixes frames on the calling thread, for benchmarks, must not be called while the thread runs
+		void mix(int frames);
+
+		void playAudio(int audioClipId, bool stopPrevious) override;
+		void stopAudio(int audioClipId) override;
+		void setVolume(float volume) override;
+		float getVolume() const override { return volume_; }
+		// passes the requests of this frame to the mixer and, when STEPPED, mixes stepFrames
+		void update() override;
+
+		// logs the voices, mixing cost and clipping
+		void logStats() const;
+
+		int frequency() const { return frequency_; }
+
+		// frames mixed by each update() when STEPPED, 800 is 1/60 s at 48 kHz
+		int stepFrames{ 800 };
+
+		// most voices mixed at once, the oldest voice is stopped past it
+		int maxVoices{ 64 };
+
+		uint64_t framesMixed() const { return framesMixed_; }
+		// time spent mixing in nanoseconds, without writing the WAV file
+		uint64_t mixNanoseconds() const { return mixNanoseconds_; }
+		unsigned peakVoices() const { return peakVoices_; }
+		// samples past full scale that were clipped
+		uint64_t clippedSamples() const { return clippedSamples_; }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct CLIP {
+			// interleaved left and right samples
+			std::vector<float> samples;
+			float gain{ 1.0f };
+			float pan{ 0.0f };
+		};
+
+		struct VOICE {
+			int clipId{ -1 };
+			// clips do not change while the mixer runs, so voices keep a pointer
+			const CLIP* clip{ nullptr };
+			size_t frame{ 0 };
+			float left{ 1.0f };
+			float right{ 1.0f };
+		};
+
+		struct COMMAND {
+			int clipId{ -1 };
+			bool play{ true };
+			bool stopPrevious{ false };
+		};
+
+		bool _decode(int clipId, const std::string& filename, SDL_RWops* rw);
+		void _run();
+		void _applyCommands();
+		void _mix(int frames);
+		void _mixBlock(int frames);
+		void _writeWavHeader(uint32_t dataBytes);
+
+		int frequency_;
+		int blockFrames_;
+		Mode mode_{ REALTIME };
+		std::atomic<float> volume_{ 1.0f };
+
+		std::map<int, CLIP> clips_;
+
+		std::mutex requestMutex_;
+		std::vector<COMMAND> requests_;
+
+		// guards commands_, framesDue_ and stopping_ between update() and the mixing thread
+		std::mutex mixMutex_;
+		std::condition_variable mixReady_;
+		std::vector<COMMAND> commands_;
+		int framesDue_{ 0 };
+		bool stopping_{ false };
+		std::thread thread_;
+
+		// only touched by the mixing thread, or by mix() when it is not running
+		std::vector<VOICE> voices_;
+		std::vector<COMMAND> applying_;
+		std::vector<float> buffer_;
+		std::vector<int16_t> pcm_;
+		std::ofstream fout_;
+		uint32_t wavBytes_{ 0 };
+
+		std::atomic<uint64_t> framesMixed_{ 0 };
+		std::atomic<uint64_t> mixNanoseconds_{ 0 };
+		std::atomic<unsigned> peakVoices_{ 0 };
+		std::atomic<uint64_t> clippedSamples_{ 0 };
+		std::atomic<uint64_t> voiceFrames_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
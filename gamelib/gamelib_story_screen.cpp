@@ -48,8 +48,8 @@ namespace GameLib {
 	void StoryScreen::setImage(int image, const std::string& path, float w, float h) {
 		if (image < 0 || image >= MAX_IMAGES)
 			return;
-		images[image].texture = context->loadImage(path);
-		if (!images[image].texture) {
+		images[image].image = context->loadImage(path);
+		if (!images[image].image) {
 			HFLOGWARN("Image not found '%s'", path.c_str());
 		}
 		images[image].size.x = w * ptsize;
@@ -88,6 +88,9 @@ namespace GameLib {
 				tickCount++;
 			}
 			_drawFrame();
+			if (loader_)
+				loader_->update();
+			Locator::getAudio()->update();
 			bool a = abutton.checkClear();
 			bool b = enterButton.checkClear();
 			bool c = escapeButton.checkClear();
@@ -104,10 +107,10 @@ namespace GameLib {
 
 
 	bool StoryScreen::load(const std::string& path) {
-		std::string foundPath = context->findSearchPath(path);
-		std::ifstream fin(foundPath);
-		if (!fin)
+		std::string contents;
+		if (!context->readAsset(path, contents))
 			return false;
+		std::istringstream fin(contents);
 		return readStream(fin);
 	}
 
@@ -281,17 +284,17 @@ namespace GameLib {
 
 			glm::vec2 location = position + center - size2 * scale;
 			SDL_Rect dstrect{ (int)location.x, (int)location.y, (int)(img.size.x * scale), (int)(img.size.y * scale) };
-			if (img.texture) {
-				SDL_SetTextureBlendMode(img.texture, SDL_BLENDMODE_BLEND);
-				SDL_SetTextureAlphaMod(img.texture, (Uint8)(255 * imageCurve));
+			if (SDL_Texture* texture = context->useImage(img.image)) {
+				SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+				SDL_SetTextureAlphaMod(texture, (Uint8)(255 * imageCurve));
 				SDL_RenderCopyEx(context->renderer(),
-					img.texture,
+					texture,
 					nullptr,
 					&dstrect,
 					angle,
 					nullptr,
 					SDL_RendererFlip::SDL_FLIP_NONE);
-				SDL_SetTextureAlphaMod(img.texture, 255);
+				SDL_SetTextureAlphaMod(texture, 255);
 			}
 		}
 
@@ -344,7 +347,8 @@ namespace GameLib {
 
 			if (lastCharsDrawn_ != charsDrawn) {
 				lastCharsDrawn_ = charsDrawn;
-				context->playAudioClip(blipSoundId_);
+				// the voice manager merges blips that come faster than its dedup window
+				Locator::getAudio()->playAudio(blipSoundId_, false);
 			}
 		}
 	} // namespace GameLib
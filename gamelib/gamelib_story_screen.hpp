@@ -2,6 +2,7 @@
 #define GAMELIB_STORY_SCREEN_HPP
 
 #include <gamelib_actor.hpp>
+#include <gamelib_asset_loader.hpp>
 #include <gamelib_font.hpp>
 #include <gamelib_world.hpp>
 
@@ -37,6 +38,9 @@ namespace GameLib {
 		// sound effects
 		void setBlipSound(int blipSoundId) { blipSoundId_ = blipSoundId; }
 
+		// finishes assets from loader each frame so they load while the story plays
+		void setLoader(AssetLoader* loader) { loader_ = loader; }
+
 		void newFrame(int duration,
 			int headerColor,
 			int headerShadowColor,
@@ -145,6 +149,7 @@ namespace GameLib {
 		// editing variables
 		// int curFont_{ 0 };
 		int blipSoundId_{ 0 };
+		AssetLoader* loader_{ nullptr };
 
 		// playback variables
 		size_t lastCharsDrawn_{ 0 };
@@ -195,7 +200,7 @@ namespace GameLib {
 
 		static constexpr int MAX_IMAGES = 16;
 		struct IMAGEINFO {
-			SDL_Texture* texture{ nullptr };
+			ImageHandle image;
 			SDL_Rect rect;
 			glm::vec2 size;
 		} images[MAX_IMAGES];
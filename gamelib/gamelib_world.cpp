@@ -2,6 +2,7 @@
 #include <gamelib_actor.hpp>
 #include <gamelib_locator.hpp>
 #include <gamelib_world.hpp>
+#include <limits>
 
 namespace GameLib {
 	namespace Tokens {
@@ -23,19 +24,134 @@ namespace GameLib {
 	World::World() { resize(worldSizeX, worldSizeY); }
 
 	World::~World() {
-		tiles.clear();
-		collisionTiles.clear();
+		pages_.clear();
 		dynamicActors.clear();
 		staticActors.clear();
 		triggerActors.clear();
+		actorsById_.clear();
 	}
 
-	void World::resize(unsigned sizeX, unsigned sizeY) {
-		unsigned numTiles = sizeX * sizeY;
-		tiles.resize(numTiles);
+	void World::resize(unsigned sizeX, unsigned sizeY, bool allocate) {
+		int px = ((int)sizeX + WorldTilesX - 1) / WorldTilesX;
+		int py = ((int)sizeY + WorldTilesY - 1) / WorldTilesY;
+		if ((int)sizeX == worldSizeX && (int)sizeY == worldSizeY && (int)pages_.size() == px * py &&
+			residentPages_ == (allocate ? px * py : 0))
+			return;
+		// the rows move, so every tile is placed again
+		for (int j = 0; j < pagesY_; j++) {
+			for (int i = 0; i < pagesX_; i++)
+				evictPage(i, j);
+		}
 		worldSizeX = sizeX;
 		worldSizeY = sizeY;
-		collisionTiles.resize(numTiles * CollisionTileResolution);
+		collisionSizeX = worldSizeX * CollisionTileResolution;
+		collisionSizeY = worldSizeY * CollisionTileResolution;
+		pagesX_ = px;
+		pagesY_ = py;
+		pages_.clear();
+		pages_.resize((size_t)px * py);
+		rowText_.assign(sizeY, std::string());
+		rowTokens_.assign(sizeY, 0);
+		if (!allocate)
+			return;
+		for (auto& page : pages_)
+			page = std::make_unique<WORLDPAGE>();
+		residentPages_ = px * py;
+	}
+
+
+	void WORLDPAGE::bakeRow(int y) {
+		runs[y].clear();
+		for (int x = 0; x < WorldTilesX;) {
+			if (!tile(x, y).solid()) {
+				x++;
+				continue;
+			}
+			RUN run;
+			run.x = (uint8_t)x;
+			while (x < WorldTilesX && tile(x, y).solid())
+				x++;
+			run.length = (uint8_t)(x - run.x);
+			runs[y].push_back(run);
+		}
+	}
+
+
+	WORLDPAGE* World::getPage(int px, int py) {
+		if (px < 0 || py < 0 || px >= pagesX_ || py >= pagesY_)
+			return nullptr;
+		return pages_[py * pagesX_ + px].get();
+	}
+
+
+	const WORLDPAGE* World::getPage(int px, int py) const {
+		if (px < 0 || py < 0 || px >= pagesX_ || py >= pagesY_)
+			return nullptr;
+		return pages_[py * pagesX_ + px].get();
+	}
+
+
+	void World::setPage(int px, int py, WorldPagePtr page) {
+		if (px < 0 || py < 0 || px >= pagesX_ || py >= pagesY_ || !page)
+			return;
+		evictPage(px, py);
+		for (int y = 0; y < WorldTilesY; y++)
+			_addRowToPhysics(*page, px, py, y);
+		page->dirtyRows = 0;
+		pages_[py * pagesX_ + px] = std::move(page);
+		residentPages_++;
+	}
+
+
+	void World::evictPage(int px, int py) {
+		WORLDPAGE* page = getPage(px, py);
+		if (!page)
+			return;
+		for (int y = 0; y < WorldTilesY; y++)
+			_removeRowFromPhysics(*page, y);
+		pages_[py * pagesX_ + px].reset();
+		residentPages_--;
+	}
+
+
+	int World::writePage(int px,
+		int py,
+		const char* charDescs,
+		const uint32_t* spriteIds,
+		const uint32_t* flags,
+		const uint8_t* collisionTiles) {
+		if (px < 0 || py < 0 || px >= pagesX_ || py >= pagesY_)
+			return 0;
+		constexpr int count = WorldTilesX * WorldTilesY;
+		WORLDPAGE* page = getPage(px, py);
+		if (!page) {
+			auto fresh = std::make_unique<WORLDPAGE>();
+			for (int i = 0; i < count; i++) {
+				Tile& t = fresh->tiles[i];
+				t.charDesc = charDescs[i];
+				t.spriteId = spriteIds[i];
+				t.flags = flags[i];
+			}
+			memcpy(fresh->collisionTiles, collisionTiles, sizeof(fresh->collisionTiles));
+			fresh->bake();
+			setPage(px, py, std::move(fresh));
+			return count;
+		}
+		int changed = 0;
+		for (int i = 0; i < count; i++) {
+			Tile& t = page->tiles[i];
+			if (t.charDesc == charDescs[i] && t.spriteId == spriteIds[i] && t.flags == flags[i])
+				continue;
+			t.charDesc = charDescs[i];
+			t.spriteId = spriteIds[i];
+			t.flags = flags[i];
+			page->dirtyRows |= 1u << (i / WorldTilesX);
+			changed++;
+		}
+		memcpy(page->collisionTiles, collisionTiles, sizeof(page->collisionTiles));
+		if (changed)
+			_rebuildDirtyRows(py);
+		return changed;
 	}
 
 	void World::start(float t) {
@@ -72,6 +188,12 @@ namespace GameLib {
 	}
 
 	void World::physics(float deltaTime) {
+		// keep trigger sensors where their actors are
+		for (auto a : triggerActors) {
+			a->preupdate();
+		}
+		// triggers may have moved since the last step
+		triggerBoxesValid_ = false;
 		for (auto a : staticActors) {
 			a->preupdate();
 		}
@@ -88,8 +210,12 @@ namespace GameLib {
 			actor->physics(deltaTime, *this);
 		}
 
+		// games without Box2D, such as gingerrun, only use the actor tests above
 		auto box2d = Locator::getBox2D();
-		box2d->update(deltaTime);
+		if (box2d) {
+			box2d->update(deltaTime);
+			_dispatchContacts(*box2d);
+		}
 
 		for (auto a : staticActors) {
 			a->postupdate();
@@ -99,6 +225,174 @@ namespace GameLib {
 		}
 	}
 
+	void World::_dispatchContacts(Box2D& box2d) {
+		box2d.takeContactEvents(contactEvents_);
+		if (!useContactEvents)
+			return;
+		// user data holds actor id + 1, so tiles and other bodies without an actor are 0
+		auto findActor = [this](uintptr_t userData) { return userData ? getActor((unsigned)(userData - 1)) : nullptr; };
+		for (auto& e : contactEvents_) {
+			ActorPtr a = findActor(e.a);
+			ActorPtr b = findActor(e.b);
+			if (e.begin) {
+				if (a && a->active)
+					a->beginContact(b.get(), *this);
+				if (b && b->active)
+					b->beginContact(a.get(), *this);
+			} else {
+				if (a)
+					a->endContact(b.get(), *this);
+				if (b)
+					b->endContact(a.get(), *this);
+			}
+		}
+	}
+
+	template <typename F>
+	void World::_forEachActor(glm::vec2 lower, glm::vec2 upper, F f) const {
+		auto visit = [&](Actor* a) {
+			if (!a || !a->active || !overlapAABB(lower, upper, a->position2d(), a->position2d() + a->size2d()))
+				return true;
+			return f(*a);
+		};
+		auto box2d = Locator::getBox2D();
+		if (box2d) {
+			bool more = true;
+			box2d->queryAABB(lower, upper, [&](uintptr_t userData) {
+				// the broadphase returns padded boxes, so actors are checked against their own boxes
+				more = !userData || visit(getActor((unsigned)(userData - 1)).get());
+				return more;
+			});
+			if (!more)
+				return;
+		}
+		// actors without a Box2D body are not in the broadphase, so they are found in the lists
+		for (auto* actors : { &dynamicActors, &staticActors, &triggerActors }) {
+			for (auto& a : *actors) {
+				if (box2d && a->box2dId >= 0)
+					continue;
+				if (!visit(a.get()))
+					return;
+			}
+		}
+	}
+
+	int World::queryActors(glm::vec2 lower, glm::vec2 upper, Actor** results, int maxResults) const {
+		int count = 0;
+		if (maxResults <= 0)
+			return 0;
+		_forEachActor(lower, upper, [&](Actor& a) {
+			results[count++] = &a;
+			return count < maxResults;
+		});
+		return count;
+	}
+
+	int World::queryTiles(glm::vec2 lower, glm::vec2 upper, glm::ivec2* results, int maxResults) const {
+		int count = 0;
+		int x1 = std::max(0, (int)std::floor(lower.x));
+		int y1 = std::max(0, (int)std::floor(lower.y));
+		int x2 = std::min(worldSizeX - 1, (int)std::floor(upper.x));
+		int y2 = std::min(worldSizeY - 1, (int)std::floor(upper.y));
+		for (int y = y1; y <= y2 && count < maxResults; y++) {
+			for (int x = x1; x <= x2 && count < maxResults; x++) {
+				if (getTile(x, y).solid())
+					results[count++] = { x, y };
+			}
+		}
+		return count;
+	}
+
+	bool World::raycast(glm::vec2 p1, glm::vec2 p2, RAYHIT& hit, const Actor* ignore) const {
+		hit = RAYHIT{};
+		glm::vec2 d = p2 - p1;
+		TILEHIT tileHit;
+		if (sweepTiles(p1, { 0.0f, 0.0f }, d, tileHit)) {
+			hit.t = tileHit.t;
+			hit.normal = tileHit.normal;
+			hit.tile = tileHit.tile;
+		}
+
+		auto accept = [&](const Actor* a) { return a && a != ignore && a->active && !a->isTrigger(); };
+		auto box2d = Locator::getBox2D();
+		if (box2d) {
+			// only look as far as the tile that was hit
+			RAYCASTHIT bodyHit;
+			bool found = box2d->raycast(p1, p1 + d * hit.t, bodyHit, [&](uintptr_t userData) {
+				return userData && accept(getActor((unsigned)(userData - 1)).get());
+			});
+			if (found) {
+				hit.t *= bodyHit.fraction;
+				hit.normal = bodyHit.normal;
+				hit.actor = getActor((unsigned)(bodyHit.userData - 1)).get();
+				hit.tile = { -1, -1 };
+			}
+		}
+		// actors without a Box2D body are swept against one by one
+		for (auto* actors : { &dynamicActors, &staticActors }) {
+			for (auto& a : *actors) {
+				if (!accept(a.get()) || (box2d && a->box2dId >= 0))
+					continue;
+				bool entered;
+				glm::vec2 bmin = a->position2d();
+				glm::vec2 bmax = bmin + a->size2d();
+				float t = sweptAABB(p1, { 0.0f, 0.0f }, d, bmin, bmax, entered);
+				if (entered && t >= 0.0f && t < hit.t) {
+					hit.t = t;
+					hit.normal = normalAABB(p1 + d * t, bmin, bmax);
+					hit.actor = a.get();
+					hit.tile = { -1, -1 };
+				}
+			}
+		}
+		hit.point = p1 + d * hit.t;
+		return hit.actor || hit.tile.x >= 0;
+	}
+
+	int World::raycasts(const glm::vec2* p1, const glm::vec2* p2, int count, RAYHIT* hits, const Actor* ignore) const {
+		int hitCount = 0;
+		for (int i = 0; i < count; i++) {
+			if (raycast(p1[i], p2[i], hits[i], ignore))
+				hitCount++;
+		}
+		return hitCount;
+	}
+
+	int World::nearestActors(glm::vec2 p,
+		float radius,
+		int k,
+		Actor** results,
+		float* distances,
+		const Actor* ignore) const {
+		auto distance = [p](const Actor* a) {
+			return std::max(0.0f, distanceAABB(p, a->position2d(), a->position2d() + a->size2d()));
+		};
+		int count = 0;
+		if (k <= 0)
+			return 0;
+		_forEachActor(p - radius, p + radius, [&](Actor& a) {
+			if (&a == ignore)
+				return true;
+			float d = distance(&a);
+			if (d > radius || (count == k && d >= distance(results[count - 1])))
+				return true;
+			// insertion keeps results sorted, k is expected to be small
+			int i = std::min(count, k - 1);
+			while (i > 0 && distance(results[i - 1]) > d) {
+				results[i] = results[i - 1];
+				i--;
+			}
+			results[i] = &a;
+			count = std::min(count + 1, k);
+			return true;
+		});
+		if (distances) {
+			for (int i = 0; i < count; i++)
+				distances[i] = distance(results[i]);
+		}
+		return count;
+	}
+
 	void World::drawTiles(Graphics& graphics) { _draw(graphics); }
 
 	void World::draw(Graphics& graphics) {
@@ -121,59 +415,230 @@ namespace GameLib {
 
 	void World::addDynamicActor(ActorPtr a) {
 		a->makeDynamic();
+		actorsById_[a->getId()] = a;
 		dynamicActors.push_back(a);
 	}
 
 	void World::addStaticActor(ActorPtr a) {
 		a->makeStatic();
+		actorsById_[a->getId()] = a;
 		staticActors.push_back(a);
 	}
 
 	void World::addTriggerActor(ActorPtr a) {
 		a->makeTrigger();
+		actorsById_[a->getId()] = a;
 		triggerActors.push_back(a);
+		triggerBoxesValid_ = false;
 	}
 
+	ActorPtr World::removeActor(unsigned id, bool endOverlaps) {
+		ActorPtr actor = getActor(id);
+		if (!actor)
+			return nullptr;
+		actorsById_.erase(id);
+		// order is kept so actors keep updating in the order they were added
+		for (auto* actors : { &dynamicActors, &staticActors, &triggerActors }) {
+			actors->erase(std::remove(actors->begin(), actors->end(), actor), actors->end());
+		}
+		if (actor->isTrigger())
+			triggerBoxesValid_ = false;
+		if (actor->box2dId >= 0) {
+			if (auto box2d = Locator::getBox2D())
+				box2d->destroyBody(actor->box2dId, actor->box2dType);
+			actor->box2dId = -1;
+		}
+		if (endOverlaps)
+			actor->endOverlaps(*this);
+		return actor;
+	}
 
-	void World::setTile(int x, int y, Tile tile) {
-		if (x >= worldSizeX || y >= worldSizeY)
-			return;
-		auto index = y * worldSizeX + x;
-		tiles[index] = std::move(tile);
+	void World::_buildTriggerBoxes() {
+		triggerBoxes_.clear();
+		triggerList_.clear();
+		triggerReach_.clear();
+		for (auto& a : triggerActors)
+			triggerList_.push_back(a.get());
+		// sorted by left edge, ties by id so the order does not depend on the list
+		std::sort(triggerList_.begin(), triggerList_.end(), [](const Actor* a, const Actor* b) {
+			if (a->position.x != b->position.x)
+				return a->position.x < b->position.x;
+			return a->getId() < b->getId();
+		});
+		float reach = -std::numeric_limits<float>::infinity();
+		for (auto* a : triggerList_) {
+			triggerBoxes_.push_back(a->position2d(), a->position2d() + a->size2d());
+			reach = std::max(reach, triggerBoxes_.maxX.back());
+			triggerReach_.push_back(reach);
+		}
+		triggerHits_.resize(triggerBoxes_.maskWords());
+		triggerBoxesValid_ = true;
 	}
 
-	Tile& World::getTile(int x, int y) {
-		static Tile t;
-		if (x >= worldSizeX || y >= worldSizeY)
-			return t;
-		auto index = y * worldSizeX + x;
-		return tiles[index];
+	ActorPtr World::getActor(unsigned id) const {
+		auto it = actorsById_.find(id);
+		if (it == actorsById_.end())
+			return nullptr;
+		return it->second.lock();
+	}
+
+
+	uint32_t World::checksum() const {
+		// FNV-1a over the raw bits so any difference in a float shows up
+		uint32_t hash = 2166136261u;
+		auto mix = [&hash](const void* data, size_t size) {
+			const uint8_t* bytes = (const uint8_t*)data;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+		};
+		mix(&worldSizeX, sizeof(worldSizeX));
+		mix(&worldSizeY, sizeof(worldSizeY));
+		// tiles of resident pages a field at a time, so padding in Tile never reaches the hash
+		for (int py = 0; py < pagesY(); py++) {
+			for (int px = 0; px < pagesX(); px++) {
+				const WORLDPAGE* page = getPage(px, py);
+				if (!page)
+					continue;
+				mix(&px, sizeof(px));
+				mix(&py, sizeof(py));
+				for (const Tile& tile : page->tiles) {
+					mix(&tile.charDesc, sizeof(tile.charDesc));
+					mix(&tile.spriteId, sizeof(tile.spriteId));
+					mix(&tile.flags, sizeof(tile.flags));
+				}
+			}
+		}
+		for (auto actors : { &dynamicActors, &staticActors, &triggerActors }) {
+			for (auto& actor : *actors) {
+				unsigned id = actor->getId();
+				uint8_t active = actor->active ? 1 : 0;
+				mix(&id, sizeof(id));
+				mix(&active, sizeof(active));
+				mix(&actor->position, sizeof(actor->position));
+				mix(&actor->velocity, sizeof(actor->velocity));
+			}
+		}
+		return hash;
+	}
+
+
+	void World::setTile(int x, int y, Tile tile) {
+		if (x < 0 || y < 0 || x >= worldSizeX || y >= worldSizeY)
+			return;
+		if (WORLDPAGE* page = getPage(x / WorldTilesX, y / WorldTilesY))
+			page->tile(x % WorldTilesX, y % WorldTilesY) = std::move(tile);
 	}
 
 	const Tile& World::getTile(int x, int y) const {
 		static Tile t;
-		if (x >= worldSizeX || y >= worldSizeY)
+		if (x < 0 || y < 0 || x >= worldSizeX || y >= worldSizeY)
+			return t;
+		const WORLDPAGE* page = getPage(x / WorldTilesX, y / WorldTilesY);
+		// tiles of pages that are not resident read as empty
+		if (!page)
 			return t;
-		auto index = y * worldSizeX + x;
-		return tiles[index];
+		return page->tile(x % WorldTilesX, y % WorldTilesY);
 	}
 
 	int World::getCollisionTile(float x, float y) const {
-		int ix = (int)(CollisionTileResolution * x);
-		int iy = (int)(CollisionTileResolution * y);
-		ix = clamp<int>(ix, 0, collisionSizeX - 1);
-		iy = clamp<int>(iy, 0, collisionSizeY - 1);
-		int index = iy * collisionSizeX + ix;
-		return collisionTiles[index];
+		constexpr int pageSizeX = WorldTilesX * CollisionTileResolution;
+		constexpr int pageSizeY = WorldTilesY * CollisionTileResolution;
+		int ix = clamp<int>((int)(CollisionTileResolution * x), 0, collisionSizeX - 1);
+		int iy = clamp<int>((int)(CollisionTileResolution * y), 0, collisionSizeY - 1);
+		const WORLDPAGE* page = getPage(ix / pageSizeX, iy / pageSizeY);
+		if (!page)
+			return 0;
+		return page->collisionTiles[(iy % pageSizeY) * pageSizeX + ix % pageSizeX];
 	}
 
 	void World::setCollisionTile(float x, float y, int value) {
-		int ix = (int)(CollisionTileResolution * x);
-		int iy = (int)(CollisionTileResolution * y);
-		ix = clamp<int>(ix, 0, collisionSizeX - 1);
-		iy = clamp<int>(iy, 0, collisionSizeY - 1);
-		int index = iy * collisionSizeX + ix;
-		collisionTiles[index] = value;
+		constexpr int pageSizeX = WorldTilesX * CollisionTileResolution;
+		constexpr int pageSizeY = WorldTilesY * CollisionTileResolution;
+		int ix = clamp<int>((int)(CollisionTileResolution * x), 0, collisionSizeX - 1);
+		int iy = clamp<int>((int)(CollisionTileResolution * y), 0, collisionSizeY - 1);
+		WORLDPAGE* page = getPage(ix / pageSizeX, iy / pageSizeY);
+		if (page)
+			page->collisionTiles[(iy % pageSizeY) * pageSizeX + ix % pageSizeX] = (uint8_t)value;
+	}
+
+	bool World::sweepTiles(glm::vec2 p, glm::vec2 s, glm::vec2 delta, TILEHIT& hit) const {
+		hit = TILEHIT{};
+		// tiles are half open, so a box edge lying on a tile boundary does not touch the next tile
+		auto firstTile = [](float a) { return (int)std::floor(a); };
+		auto lastTile = [](float a, float b) { return std::max((int)std::ceil(b) - 1, (int)std::floor(a)); };
+		auto solidAt = [&](int x, int y) {
+			if (!getTile(x, y).solid())
+				return false;
+			hit.tile = { x, y };
+			return true;
+		};
+
+		// a box that starts inside a solid tile hits immediately
+		for (int y = firstTile(p.y); y <= lastTile(p.y, p.y + s.y); y++) {
+			for (int x = firstTile(p.x); x <= lastTile(p.x, p.x + s.x); x++) {
+				if (solidAt(x, y)) {
+					hit.t = 0.0f;
+					return true;
+				}
+			}
+		}
+
+		// walk the leading edges across tile boundaries in time order
+		constexpr float inf = std::numeric_limits<float>::infinity();
+		int stepX = delta.x > 0.0f ? 1 : (delta.x < 0.0f ? -1 : 0);
+		int stepY = delta.y > 0.0f ? 1 : (delta.y < 0.0f ? -1 : 0);
+		int nextX = stepX > 0 ? (int)std::ceil(p.x + s.x) : (int)std::floor(p.x) - 1;
+		int nextY = stepY > 0 ? (int)std::ceil(p.y + s.y) : (int)std::floor(p.y) - 1;
+		float timeX = stepX ? ((stepX > 0 ? nextX : nextX + 1) - (stepX > 0 ? p.x + s.x : p.x)) / delta.x : inf;
+		float timeY = stepY ? ((stepY > 0 ? nextY : nextY + 1) - (stepY > 0 ? p.y + s.y : p.y)) / delta.y : inf;
+		float stepTimeX = stepX ? 1.0f / std::abs(delta.x) : inf;
+		float stepTimeY = stepY ? 1.0f / std::abs(delta.y) : inf;
+
+		while (true) {
+			float t = std::min(timeX, timeY);
+			if (t > 1.0f)
+				return false;
+			bool enterX = timeX <= t;
+			bool enterY = timeY <= t;
+			glm::vec2 q = p + delta * t;
+			int x1 = firstTile(q.x);
+			int x2 = lastTile(q.x, q.x + s.x);
+			int y1 = firstTile(q.y);
+			int y2 = lastTile(q.y, q.y + s.y);
+			// include the tiles being entered so a diagonal move through a corner is not missed
+			if (enterX) {
+				x1 = std::min(x1, nextX);
+				x2 = std::max(x2, nextX);
+			}
+			if (enterY) {
+				y1 = std::min(y1, nextY);
+				y2 = std::max(y2, nextY);
+			}
+			if (enterX) {
+				for (int y = y1; y <= y2; y++) {
+					if (solidAt(nextX, y)) {
+						hit.t = t;
+						hit.normal = { (float)-stepX, 0.0f };
+						return true;
+					}
+				}
+				nextX += stepX;
+				timeX += stepTimeX;
+			}
+			if (enterY) {
+				for (int x = x1; x <= x2; x++) {
+					if (solidAt(x, nextY)) {
+						hit.t = t;
+						hit.normal = { 0.0f, (float)-stepY };
+						return true;
+					}
+				}
+				nextY += stepY;
+				timeY += stepTimeY;
+			}
+		}
 	}
 
 	std::istream& World::readCharStream(std::istream& s) {
@@ -184,11 +649,9 @@ namespace GameLib {
 			return s;
 		Tokens::Tiles token = Tokens::worldTokens[cmd];
 
-		// ensure objects don't pass through
-		auto box2d = Locator::getBox2D();
-
 		char c;
 		unsigned val;
+		std::string text;
 		switch (token) {
 		case Tokens::Tiles::WORLDSIZE:
 			unsigned w, h;
@@ -196,34 +659,38 @@ namespace GameLib {
 			s >> h;
 			resize(w, h);
 			break;
-		case Tokens::Tiles::WORLD:
-			int row;
+		case Tokens::Tiles::WORLD: {
+			int row = -1;
 			s >> row;
+			if (row < 0 || row >= worldSizeY)
+				break;
+			std::getline(s, text);
+			if (text == rowText_[row] && rowTokens_[row] == tokensVersion_)
+				break;
+			rowText_[row] = text;
+			rowTokens_[row] = tokensVersion_;
+			std::istringstream rs(text);
 			for (int i = 0; i < worldSizeX; i++) {
-				char c;
-				s >> c;
-				unsigned tile = c;
-				if (Tokens::charToTiles.count(c)) {
-					tile = Tokens::charToTiles[tile];
-				}
-				setTile(i, row, Tile(tile, c));
-
-				unsigned flags = Tile::SOLID;
-				if (Tokens::charToFlags.count(c)) {
-					flags = Tokens::charToFlags[c];
-				}
-				getTile(i, row).flags = flags;
-				_addTileToPhysics(i, row);
+				c = '?';
+				rs >> c;
+				if (_placeTile(i, row, tileFromChar(c)))
+					tilesReplaced_++;
 			}
+			_rebuildDirtyRows(row / WorldTilesY);
 			break;
+		}
 		case Tokens::Tiles::FLAGS:
 			s >> c;
 			s >> val;
+			if (!Tokens::charToFlags.count(c) || Tokens::charToFlags[c] != val)
+				tokensVersion_++;
 			Tokens::charToFlags[c] = val;
 			break;
 		case Tokens::Tiles::DEFINE:
 			s >> c;
 			s >> val;
+			if (!Tokens::charToTiles.count(c) || Tokens::charToTiles[c] != val)
+				tokensVersion_++;
 			Tokens::charToTiles[c] = val;
 			break;
 		default: HFLOGWARN("cmd '%' not implemented", cmd.c_str());
@@ -292,22 +759,102 @@ namespace GameLib {
 		return s;
 	}
 
+	Tile World::tileFromChar(char c) {
+		Tile tile(c, c);
+		auto spriteId = Tokens::charToTiles.find(c);
+		if (spriteId != Tokens::charToTiles.end())
+			tile.spriteId = spriteId->second;
+		auto flags = Tokens::charToFlags.find(c);
+		tile.flags = flags != Tokens::charToFlags.end() ? flags->second : Tile::SOLID;
+		return tile;
+	}
+
 	void World::_draw(Graphics& g) {
-		for (int x = 0; x < worldSizeX; x++) {
-			for (int y = 0; y < worldSizeY; y++) {
-				GameLib::SPRITEINFO s;
-				s.position = { x * 32, y * 32 };
-				Tile& t = getTile(x, y);
-				g.draw(0, t.spriteId, s.position.x, s.position.y);
+		// only resident pages are drawn
+		for (int py = 0; py < pagesY_; py++) {
+			for (int px = 0; px < pagesX_; px++) {
+				const WORLDPAGE* page = getPage(px, py);
+				if (!page)
+					continue;
+				int x0 = px * WorldTilesX;
+				int y0 = py * WorldTilesY;
+				for (int x = 0; x < WorldTilesX && x0 + x < worldSizeX; x++) {
+					for (int y = 0; y < WorldTilesY && y0 + y < worldSizeY; y++) {
+						GameLib::SPRITEINFO s;
+						s.position = { (x0 + x) * 32, (y0 + y) * 32 };
+						const Tile& t = page->tile(x, y);
+						g.draw(0, t.spriteId, s.position.x, s.position.y);
+					}
+				}
 			}
 		}
 	}
 
-	void World::_addTileToPhysics(int i, int j) {
-		auto tile = getTile(i, j);
-		if (!tile.solid())
+	void World::_addRowToPhysics(WORLDPAGE& page, int px, int py, int y) {
+		auto box2d = Locator::getBox2D();
+		if (!box2d)
 			return;
+		// a run of solid tiles is one body, so bodies grow with rows rather than tiles
+		float top = (float)(py * WorldTilesY + y);
+		for (auto& run : page.runs[y]) {
+			float left = (float)(px * WorldTilesX + run.x);
+			float halfWidth = run.length * 0.5f;
+			page.bodies[y].push_back(box2d->initBody(
+				b2_staticBody, { left + halfWidth, top + 0.5f }, { halfWidth - 0.05f, 0.45f }, 1.0f, 0.3f));
+		}
+	}
+
+
+	void World::_removeRowFromPhysics(WORLDPAGE& page, int y) {
 		auto box2d = Locator::getBox2D();
-		tile.box2dId = box2d->initBody(b2_staticBody, { i + 0.5f, j + 0.5f }, { 0.45f, 0.45f }, 1.0f, 0.3f);
+		for (int id : page.bodies[y]) {
+			if (box2d)
+				box2d->destroyBody(id, b2_staticBody);
+		}
+		page.bodies[y].clear();
+	}
+
+
+	void World::_rebuildDirtyRows(int py) {
+		for (int px = 0; px < pagesX_; px++) {
+			WORLDPAGE* page = getPage(px, py);
+			if (!page || !page->dirtyRows)
+				continue;
+			for (int y = 0; y < WorldTilesY; y++) {
+				if (!(page->dirtyRows & (1u << y)))
+					continue;
+				_removeRowFromPhysics(*page, y);
+				page->bakeRow(y);
+				_addRowToPhysics(*page, px, py, y);
+			}
+			page->dirtyRows = 0;
+		}
+	}
+
+
+	bool World::_placeTile(int x, int y, const Tile& tile) {
+		if (x < 0 || y < 0 || x >= worldSizeX || y >= worldSizeY)
+			return false;
+		WORLDPAGE* page = getPage(x / WorldTilesX, y / WorldTilesY);
+		if (!page)
+			return false;
+		Tile& old = page->tile(x % WorldTilesX, y % WorldTilesY);
+		if (old.charDesc == tile.charDesc && old.spriteId == tile.spriteId && old.flags == tile.flags)
+			return false;
+		old = tile;
+		page->dirtyRows |= 1u << (y % WorldTilesY);
+		return true;
+	}
+
+
+	int World::reload(const std::string& contents) {
+		tilesReplaced_ = 0;
+		std::istringstream in(contents);
+		std::string line;
+		while (std::getline(in, line)) {
+			std::istringstream istr(line);
+			readCharStream(istr);
+		}
+		return tilesReplaced_;
 	}
 } // namespace GameLib
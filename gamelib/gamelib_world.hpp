@@ -1,6 +1,8 @@
 #ifndef GAMELIB_WORLD_HPP
 #define GAMELIB_WORLD_HPP
 
+#include <gamelib_box2d.hpp>
+#include <gamelib_collision.hpp>
 #include <gamelib_graphics.hpp>
 #include <gamelib_object.hpp>
 
@@ -35,10 +37,62 @@ namespace GameLib {
 		char charDesc{ '?' };
 		unsigned spriteId{ 0 };
 		unsigned flags{ EMPTY };
-		int box2dId { -1 };
+	};
+
+	// WORLDPAGE is a WorldTilesX by WorldTilesY block of tiles, worlds are stored, loaded and evicted by page
+	struct WORLDPAGE {
+		static_assert(WorldTilesX <= 255 && WorldTilesY <= 32, "runs hold a column in a byte and dirtyRows a row in a bit");
+
+		// a run of solid tiles in a row, which shares one static body
+		struct RUN {
+			uint8_t x{ 0 };
+			uint8_t length{ 0 };
+		};
+
+		Tile tiles[WorldTilesX * WorldTilesY];
+		uint8_t collisionTiles[WorldTilesX * WorldTilesY * CollisionTileResolution * CollisionTileResolution]{};
+		// runs of solid tiles in each row, found by bakeRow()
+		std::vector<RUN> runs[WorldTilesY];
+		// Box2D static bodies of the runs in each row
+		std::vector<int> bodies[WorldTilesY];
+		// rows whose tiles changed since their bodies were made
+		uint32_t dirtyRows{ 0 };
+
+		Tile& tile(int x, int y) { return tiles[y * WorldTilesX + x]; }
+		const Tile& tile(int x, int y) const { return tiles[y * WorldTilesX + x]; }
+
+		// finds the runs of solid tiles in row y, does not touch Box2D so it is safe on any thread
+		void bakeRow(int y);
+		void bake() {
+			for (int y = 0; y < WorldTilesY; y++)
+				bakeRow(y);
+		}
+	};
+	using WorldPagePtr = std::unique_ptr<WORLDPAGE>;
+
+	// TILEHIT describes the first solid tile touched by a box swept through the world
+	struct TILEHIT {
+		// fraction of the sweep when the tile was touched, 0 if it already overlapped
+		float t{ 1.0f };
+		// normal of the tile face that was hit, zero if it already overlapped
+		glm::vec2 normal{ 0.0f, 0.0f };
+		// tile coordinates
+		glm::ivec2 tile{ -1, -1 };
 	};
 
 	class Actor;
+
+	// RAYHIT describes the first actor or solid tile hit by a ray
+	struct RAYHIT {
+		// fraction along the ray where it hit
+		float t{ 1.0f };
+		glm::vec2 point{ 0.0f, 0.0f };
+		glm::vec2 normal{ 0.0f, 0.0f };
+		// actor that was hit, or nullptr if a tile was hit
+		Actor* actor{ nullptr };
+		// tile that was hit, or -1, -1 if an actor was hit
+		glm::ivec2 tile{ -1, -1 };
+	};
 	using ActorPtr = std::shared_ptr<Actor>;
 	using ActorWPtr = std::weak_ptr<Actor>;
 
@@ -48,7 +102,8 @@ namespace GameLib {
 		World();
 		virtual ~World();
 
-		void resize(unsigned sizeX, unsigned sizeY);
+		// sets the size in tiles, every page is allocated unless allocate is false, which leaves them to setPage()
+		void resize(unsigned sizeX, unsigned sizeY, bool allocate = true);
 
 		void start(float t);
 		void update(float deltaTime);
@@ -56,8 +111,8 @@ namespace GameLib {
 		void drawTiles(Graphics& graphics);
 		void draw(Graphics& graphics);
 
+		// tiles are only changed through setTile(), reads of unloaded or outside tiles share one empty tile
 		void setTile(int x, int y, Tile ptr);
-		Tile& getTile(int x, int y);
 		const Tile& getTile(glm::vec3 p) const { return getTile((int)p.x, (int)p.y); }
 		const Tile& getTile(glm::vec3 p, int offsetX, int offsetY) const {
 			return getTile((int)p.x + offsetX, (int)p.y + offsetY);
@@ -65,13 +120,48 @@ namespace GameLib {
 		const Tile& getTile(int x, int y) const;
 		const Tile& getTilef(float x, float y) const { return getTile(int(x), int(y)); }
 		int getCollisionTile(float x, float y) const;
+
+		// sweeps a box at p with size s along delta, visiting only the tiles the box passes through
+		// returns true and fills in hit for the first solid tile touched
+		bool sweepTiles(glm::vec2 p, glm::vec2 s, glm::vec2 delta, TILEHIT& hit) const;
 		void setCollisionTile(float x, float y, int value);
 
 		std::istream& readCharStream(std::istream& s) override;
 		std::ostream& writeCharStream(std::ostream& s) const override;
 
-		std::vector<Tile> tiles;
-		std::vector<uint8_t> collisionTiles;
+		// applies a world file that was already read, rows that did not change are skipped
+		// and only tiles that differ are replaced, with their Box2D bodies, returns the number of tiles replaced
+		// load() is incremental the same way, a new world size rebuilds every tile
+		int reload(const std::string& contents);
+
+		// returns the tile for a character using the define and flags lines read so far
+		static Tile tileFromChar(char c);
+
+		// number of pages in each direction, pages on the right and bottom edges may be partly outside the world
+		int pagesX() const { return pagesX_; }
+		int pagesY() const { return pagesY_; }
+
+		// returns the page, or nullptr if it is outside the world or not resident
+		WORLDPAGE* getPage(int px, int py);
+		const WORLDPAGE* getPage(int px, int py) const;
+
+		// adds a page whose runs were baked and makes their bodies, replacing the page there
+		void setPage(int px, int py, WorldPagePtr page);
+
+		// destroys the bodies of a page and frees it, tiles in it read as empty
+		void evictPage(int px, int py);
+
+		// writes a page from columns of tile fields, allocating it if it is not resident, only rows that
+		// changed get new bodies, returns the number of tiles that changed
+		int writePage(int px,
+			int py,
+			const char* charDescs,
+			const uint32_t* spriteIds,
+			const uint32_t* flags,
+			const uint8_t* collisionTiles);
+
+		// number of pages in memory
+		int residentPages() const { return residentPages_; }
 
 		// Dynamic actors are solid actors with game logic
 		std::vector<ActorPtr> dynamicActors;
@@ -85,13 +175,61 @@ namespace GameLib {
 		void addStaticActor(ActorPtr a);
 		void addTriggerActor(ActorPtr a);
 
+		// takes an actor out of the world and destroys its Box2D body, returns nullptr if it is not in the world
+		// overlaps the actor is part of end with the usual events unless endOverlaps is false
+		ActorPtr removeActor(unsigned id, bool endOverlaps = true);
+
+		// returns the actor with this id, or nullptr if it is not in the world
+		ActorPtr getActor(unsigned id) const;
+
+		// returns a hash of the world size and the id, position and velocity of every actor
+		// runs with the same seed and input produce the same checksum each frame
+		uint32_t checksum() const;
+
+		// spatial queries use the Box2D broadphase when Box2D is available and otherwise scan every actor
+		// with Box2D, only actors that have bodies are found. Results go into caller buffers and nothing is allocated
+
+		// writes active actors overlapping the box from lower to upper into results, returns number written
+		int queryActors(glm::vec2 lower, glm::vec2 upper, Actor** results, int maxResults) const;
+
+		// writes solid tiles overlapping the box from lower to upper into results, returns number written
+		int queryTiles(glm::vec2 lower, glm::vec2 upper, glm::ivec2* results, int maxResults) const;
+
+		// finds the first solid tile or non trigger actor other than ignore on the segment from p1 to p2
+		bool raycast(glm::vec2 p1, glm::vec2 p2, RAYHIT& hit, const Actor* ignore = nullptr) const;
+
+		// casts count rays from p1[i] to p2[i] into hits[i], returns number of rays that hit
+		int raycasts(const glm::vec2* p1, const glm::vec2* p2, int count, RAYHIT* hits, const Actor* ignore = nullptr) const;
+
+		// writes up to k active actors other than ignore whose boxes are within radius of p into results,
+		// nearest first, and their distances into distances if it is not nullptr, returns number written
+		int nearestActors(glm::vec2 p,
+			float radius,
+			int k,
+			Actor** results,
+			float* distances = nullptr,
+			const Actor* ignore = nullptr) const;
+
+		// calls f(trigger) for each trigger actor whose box overlaps the box from lower to upper
+		// the trigger boxes are kept in a packed array sorted by their left edge, rebuilt after triggers are
+		// added, removed or may have moved, and only the run of boxes that can reach the box is tested in one batch
+		template <typename F>
+		void forEachTrigger(glm::vec2 lower, glm::vec2 upper, F f);
+
+		// rebuilds the trigger boxes before the next forEachTrigger(), call after moving a trigger during physics
+		void triggersMoved() { triggerBoxesValid_ = false; }
+
+		// when true, collisions and overlaps come from Box2D contact events after each step
+		// instead of every actor testing every other actor
+		bool useContactEvents{ false };
+
 		// number of tiles in the X direction
 		int worldSizeX{ WorldPagesX * WorldTilesX };
 
 		// number of tiles in the Y direction
 		int worldSizeY{ WorldPagesY * WorldTilesY };
 
-		// number of collision tiles in one tile
+		// number of collision tiles horizontally
 		int collisionSizeX = worldSizeX * CollisionTileResolution;
 
 		// number of collision tiles vertically
@@ -108,8 +246,62 @@ namespace GameLib {
 
 	protected:
 		virtual void _draw(Graphics& g);
-		virtual void _addTileToPhysics(int x, int y);
+		// makes the bodies of the baked runs in a page row
+		void _addRowToPhysics(WORLDPAGE& page, int px, int py, int y);
+		void _removeRowFromPhysics(WORLDPAGE& page, int y);
+		// bakes the dirty rows of the pages in a band of page rows and makes their bodies again
+		void _rebuildDirtyRows(int py);
+		// replaces a tile and marks its row dirty, returns false if the tile was already the same
+		bool _placeTile(int x, int y, const Tile& tile);
+
+		// pages by py * pagesX_ + px, nullptr if not resident
+		std::vector<WorldPagePtr> pages_;
+		int pagesX_{ 0 };
+		int pagesY_{ 0 };
+		int residentPages_{ 0 };
+
+		// text of each row when it was last read, unchanged rows are skipped
+		std::vector<std::string> rowText_;
+		// a change to define or flags changes how rows read, rows read before it are read again
+		std::vector<unsigned> rowTokens_;
+		unsigned tokensVersion_{ 0 };
+		int tilesReplaced_{ 0 };
+
+		// sends buffered Box2D contact events to the actors involved
+		void _dispatchContacts(Box2D& box2d);
+
+		std::map<unsigned, ActorWPtr> actorsById_;
+
+		// contact events taken from Box2D each frame, kept to reuse the allocation
+		std::vector<CONTACTEVENT> contactEvents_;
+
+		// calls f(actor) for each active actor whose box overlaps the box from lower to upper until f returns false
+		template <typename F>
+		void _forEachActor(glm::vec2 lower, glm::vec2 upper, F f) const;
+
+		// fills triggerBoxes_, triggerList_ and triggerReach_ from triggerActors
+		void _buildTriggerBoxes();
+
+		// boxes of triggerActors sorted by minX, the actor of each box, and a hit mask to test them against
+		AABBArray triggerBoxes_;
+		std::vector<Actor*> triggerList_;
+		std::vector<uint32_t> triggerHits_;
+		// the largest maxX of the boxes up to each one, so the first box that can reach a point is a binary search
+		std::vector<float> triggerReach_;
+		bool triggerBoxesValid_{ false };
 	};
+
+	template <typename F>
+	void World::forEachTrigger(glm::vec2 lower, glm::vec2 upper, F f) {
+		if (!triggerBoxesValid_)
+			_buildTriggerBoxes();
+		// boxes before first end left of lower.x and boxes from last on start right of upper.x
+		size_t first = std::lower_bound(triggerReach_.begin(), triggerReach_.end(), lower.x) - triggerReach_.begin();
+		size_t last = std::upper_bound(triggerBoxes_.minX.begin(), triggerBoxes_.minX.end(), upper.x) - triggerBoxes_.minX.begin();
+		if (first >= last || !overlapAABBs(lower, upper, triggerBoxes_, first, last, triggerHits_.data()))
+			return;
+		forEachHit(triggerHits_.data(), last - first, [&](size_t i) { f(*triggerList_[first + i]); });
+	}
 } // namespace GameLib
 
 #endif
@@ -0,0 +1,291 @@
+#include "pch.h"
+#include <gamelib_actor.hpp>
+#include <gamelib_physics_component.hpp>
+#include <gamelib_world_streamer.hpp>
+
+namespace GameLib {
+	WorldStreamer::~WorldStreamer() {
+		*self_ = nullptr;
+		close();
+	}
+
+
+	bool WorldStreamer::open(const std::string& path) {
+		close();
+		std::ifstream fin(path, std::ios::binary);
+		if (!fin) {
+			HFLOGERROR("'%s' not found", path.c_str());
+			return false;
+		}
+		auto source = std::make_shared<SOURCE>();
+		source->path = path;
+		uint64_t offset = 0;
+		std::string line;
+		while (std::getline(fin, line)) {
+			uint64_t lineOffset = offset;
+			offset += line.size() + 1;
+			std::istringstream istr(line);
+			std::string cmd;
+			istr >> cmd;
+			std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+			if (cmd == "WORLDSIZE") {
+				int w = 0, h = 0;
+				istr >> w >> h;
+				world_.resize(w, h, false);
+				source->worldSizeX = w;
+				source->rows.assign(h, ROW());
+			} else if (cmd == "WORLD") {
+				int row = -1;
+				istr >> row >> std::ws;
+				std::streamoff start = istr.tellg();
+				if (row < 0 || row >= (int)source->rows.size() || start < 0)
+					continue;
+				std::string text = line.substr((size_t)start);
+				while (!text.empty() && isspace((unsigned char)text.back()))
+					text.pop_back();
+				ROW& r = source->rows[row];
+				r.offset = lineOffset + (uint64_t)start;
+				r.length = (uint32_t)text.size();
+				r.dense = text.find_first_of(" \t") == std::string::npos;
+			} else {
+				// define and flags lines
+				std::istringstream again(line);
+				world_.readCharStream(again);
+			}
+		}
+		if (source->rows.empty() || source->worldSizeX <= 0) {
+			HFLOGERROR("'%s' has no worldsize", path.c_str());
+			return false;
+		}
+		// loader threads look tiles up here instead of in the define and flags maps
+		for (int c = 0; c < 256; c++)
+			source->tiles[c] = World::tileFromChar((char)c);
+		source_ = source;
+		states_.assign((size_t)world_.pagesX() * world_.pagesY(), EVICTED);
+		HFLOGINFO("streaming '%s', %d x %d pages", path.c_str(), world_.pagesX(), world_.pagesY());
+		return true;
+	}
+
+
+	void WorldStreamer::close() {
+		if (!source_)
+			return;
+		for (int index : resident_)
+			world_.evictPage(index % world_.pagesX(), index / world_.pagesX());
+		resident_.clear();
+		states_.clear();
+		saved_.clear();
+		source_ = nullptr;
+	}
+
+
+	void WorldStreamer::update(glm::vec2 center) {
+		if (!source_)
+			return;
+		int cx = (int)std::floor(center.x / WorldTilesX);
+		int cy = (int)std::floor(center.y / WorldTilesY);
+		int keep = std::max(keepRadius, radius);
+		auto distance = [cx, cy](int px, int py) { return std::max(std::abs(px - cx), std::abs(py - cy)); };
+
+		for (size_t i = 0; i < resident_.size();) {
+			int index = resident_[i];
+			if (distance(index % world_.pagesX(), index / world_.pagesX()) > keep) {
+				_evict(index);
+				continue;
+			}
+			i++;
+		}
+
+		// nearest pages are queued first
+		for (int r = 0; r <= radius; r++) {
+			for (int py = cy - r; py <= cy + r; py++) {
+				for (int px = cx - r; px <= cx + r; px++) {
+					if (distance(px, py) == r)
+						_load(px, py);
+				}
+			}
+		}
+
+		_saveActors();
+	}
+
+
+	void WorldStreamer::logStats() const {
+		HFLOGINFO("WorldStreamer: %d pages resident (%zu KB), %u loaded, %u evicted, %u actors evicted, %u restored",
+			world_.residentPages(),
+			residentBytes() / 1024,
+			pagesLoaded_,
+			pagesEvicted_,
+			actorsEvicted_,
+			actorsRestored_);
+	}
+
+
+	WorldPagePtr WorldStreamer::_readPage(const SOURCE& source, int px, int py) {
+		auto page = std::make_unique<WORLDPAGE>();
+		std::ifstream fin(source.path, std::ios::binary);
+		int x0 = px * WorldTilesX;
+		int y0 = py * WorldTilesY;
+		int width = std::min(WorldTilesX, source.worldSizeX - x0);
+		std::string text;
+		char row[WorldTilesX];
+		for (int y = 0; y < WorldTilesY && y0 + y < (int)source.rows.size(); y++) {
+			const ROW& r = source.rows[y0 + y];
+			if (!r.length)
+				continue;
+			// tiles past the end of a row read as '?', like World::readCharStream()
+			std::fill(row, row + WorldTilesX, '?');
+			if (r.dense) {
+				int count = std::min(width, (int)r.length - x0);
+				if (count > 0) {
+					fin.seekg((std::streamoff)(r.offset + x0));
+					fin.read(row, count);
+				}
+			} else {
+				text.resize(r.length);
+				fin.seekg((std::streamoff)r.offset);
+				fin.read(&text[0], r.length);
+				int x = -x0;
+				for (char c : text) {
+					if (isspace((unsigned char)c))
+						continue;
+					if (x >= width)
+						break;
+					if (x >= 0)
+						row[x] = c;
+					x++;
+				}
+			}
+			fin.clear();
+			for (int x = 0; x < width; x++)
+				page->tile(x, y) = source.tiles[(uint8_t)row[x]];
+		}
+		page->bake();
+		return page;
+	}
+
+
+	void WorldStreamer::_load(int px, int py) {
+		if (px < 0 || py < 0 || px >= world_.pagesX() || py >= world_.pagesY())
+			return;
+		PAGESTATE& state = states_[py * world_.pagesX() + px];
+		if (state != EVICTED)
+			return;
+		state = LOADING;
+		auto source = source_;
+		auto self = self_;
+		loader_.queue([source, self, px, py]() -> AssetLoader::Finish {
+			// the page is shared so the finish can be copied
+			auto page = std::make_shared<WorldPagePtr>(_readPage(*source, px, py));
+			return [source, self, px, py, page]() {
+				WorldStreamer* streamer = *self;
+				if (!streamer || streamer->source_ != source)
+					return false;
+				streamer->_install(px, py, std::move(*page));
+				return true;
+			};
+		});
+	}
+
+
+	void WorldStreamer::_install(int px, int py, WorldPagePtr page) {
+		int index = py * world_.pagesX() + px;
+		world_.setPage(px, py, std::move(page));
+		states_[index] = RESIDENT;
+		resident_.push_back(index);
+		pagesLoaded_++;
+		_restoreActors(index);
+	}
+
+
+	void WorldStreamer::_evict(int index) {
+		world_.evictPage(index % world_.pagesX(), index / world_.pagesX());
+		states_[index] = EVICTED;
+		resident_.erase(std::remove(resident_.begin(), resident_.end(), index), resident_.end());
+		pagesEvicted_++;
+	}
+
+
+	void WorldStreamer::_saveActors() {
+		ActorPtr pinned = this->pinned.lock();
+		auto pageOf = [this](const Actor& a) {
+			glm::vec3 c = a.center();
+			int px = clamp((int)std::floor(c.x / WorldTilesX), 0, world_.pagesX() - 1);
+			int py = clamp((int)std::floor(c.y / WorldTilesY), 0, world_.pagesY() - 1);
+			return py * world_.pagesX() + px;
+		};
+		std::vector<ActorPtr> leaving;
+		for (auto* actors : { &world_.dynamicActors, &world_.staticActors, &world_.triggerActors }) {
+			for (auto& a : *actors) {
+				if (a != pinned && states_[pageOf(*a)] != RESIDENT)
+					leaving.push_back(a);
+			}
+		}
+		for (auto& a : leaving) {
+			SAVEDACTOR saved;
+			saved.list = a->isDynamic() ? 0 : (a->isStatic() ? 1 : 2);
+			if (makeActor) {
+				// the same layout as one actor of a snapshot, written before the body is destroyed
+				ACTORSTATE state;
+				a->saveState(state);
+				writer_.openMemory();
+				writer_.write(state);
+				uint64_t block = writer_.beginBlock();
+				if (a->actorComponent())
+					a->actorComponent()->writeState(*a, writer_);
+				writer_.endBlock(block);
+				block = writer_.beginBlock();
+				if (a->physicsComponent())
+					a->physicsComponent()->writeState(*a, writer_);
+				writer_.endBlock(block);
+				saved.state.assign(writer_.data().begin() + sizeof(SNAPSHOTHEADER), writer_.data().end());
+			} else {
+				saved.actor = a;
+			}
+			saved_[pageOf(*a)].push_back(std::move(saved));
+			world_.removeActor(a->getId());
+			actorsEvicted_++;
+		}
+	}
+
+
+	void WorldStreamer::_restoreActors(int index) {
+		auto it = saved_.find(index);
+		if (it == saved_.end())
+			return;
+		std::vector<SAVEDACTOR> saved = std::move(it->second);
+		saved_.erase(it);
+		for (auto& s : saved) {
+			ActorPtr a = s.actor;
+			ACTORSTATE state;
+			SnapshotReader r(s.state.data(), s.state.size());
+			if (!a) {
+				a = makeActor && r.read(state) ? makeActor(state.charDesc) : nullptr;
+				if (!a) {
+					HFLOGWARN("Unable to restore actor %u '%c'", state.id, state.charDesc);
+					continue;
+				}
+				a->loadState(state);
+			}
+			switch (s.list) {
+			case 0: world_.addDynamicActor(a); break;
+			case 1: world_.addStaticActor(a); break;
+			default: world_.addTriggerActor(a); break;
+			}
+			// only the body is made again, a kept actor component still has its state
+			if (a->physicsComponent())
+				a->physicsComponent()->beginPlay(*a);
+			if (!s.actor) {
+				// the body was made where the actor is, loading again gives it its saved motion
+				a->loadState(state);
+				SnapshotReader actorState = r.block();
+				SnapshotReader physicsState = r.block();
+				if (a->actorComponent())
+					a->actorComponent()->readState(*a, actorState);
+				if (a->physicsComponent())
+					a->physicsComponent()->readState(*a, physicsState);
+			}
+			actorsRestored_++;
+		}
+	}
+} // namespace GameLib
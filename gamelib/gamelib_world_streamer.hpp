@@ -0,0 +1,120 @@
+#ifndef GAMELIB_WORLD_STREAMER_HPP
+#define GAMELIB_WORLD_STREAMER_HPP
+
+#include <gamelib_asset_loader.hpp>
+#include <gamelib_snapshot.hpp>
+#include <gamelib_world.hpp>
+#include <array>
+
+namespace GameLib {
+	// WorldStreamer keeps the pages of a world file near the camera in memory, for worlds of hundreds of pages
+	// Pages within radius of the center are read and their solid runs baked on the AssetLoader threads,
+	// then added with their bodies in AssetLoader::update(). Pages past keepRadius are evicted
+	// Actors only run in resident pages, the rest are taken out of the world and put back when their page is
+	// loaded again. With makeActor they are freed and only their ACTORSTATE and component state are kept
+	// Memory for tiles and bodies depends on keepRadius, not on the size of the world
+	class WorldStreamer {
+	public:
+		WorldStreamer(World& world, AssetLoader& loader) : world_(world), loader_(loader) {}
+		~WorldStreamer();
+		WorldStreamer(const WorldStreamer&) = delete;
+		WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+		// reads the define and flags lines and finds each row of a world file, the world is sized with no pages
+		// the file is read from disk while pages stream, so it can not come from an archive
+		bool open(const std::string& path);
+
+		// evicts every page and forgets evicted actors
+		void close();
+
+		bool isOpen() const { return source_ != nullptr; }
+
+		// loads pages within radius of center, in tiles, evicts pages past keepRadius, and moves actors
+		// in and out of the world with their pages, call once a frame
+		void update(glm::vec2 center);
+
+		// same as update() for the center of the camera
+		void update(const IGraphics& graphics) { update(graphics.centerf() / graphics.tileSizef()); }
+
+		// pages in each direction of the center page that are loaded
+		int radius{ 1 };
+
+		// pages in each direction of the center page that are kept, at least radius
+		int keepRadius{ 2 };
+
+		// an actor that is never taken out of the world, usually the player
+		ActorWPtr pinned;
+
+		// when set, evicted actors are freed and made again with makeActor(charDesc) when their page loads
+		// otherwise they are kept out of the world until then, and only their state is read back
+		std::function<ActorPtr(char charDesc)> makeActor;
+
+		// most pages that can be resident, whatever the size of the world
+		int maxResidentPages() const { return (2 * keepRadius + 1) * (2 * keepRadius + 1); }
+
+		// bytes of tiles in memory
+		size_t residentBytes() const { return (size_t)world_.residentPages() * sizeof(WORLDPAGE); }
+
+		unsigned pagesLoaded() const { return pagesLoaded_; }
+		unsigned pagesEvicted() const { return pagesEvicted_; }
+		unsigned actorsEvicted() const { return actorsEvicted_; }
+		unsigned actorsRestored() const { return actorsRestored_; }
+
+		// logs the pages and actors moved in and out
+		void logStats() const;
+
+	private:
+		enum PAGESTATE : uint8_t { EVICTED, LOADING, RESIDENT };
+
+		// ROW is where the tiles of a row start in the file
+		struct ROW {
+			uint64_t offset{ 0 };
+			uint32_t length{ 0 };
+			// no whitespace between the tiles, so column x is at offset + x
+			bool dense{ false };
+		};
+
+		// SOURCE is what the loader threads read, it does not change once open() returns
+		struct SOURCE {
+			std::string path;
+			int worldSizeX{ 0 };
+			std::vector<ROW> rows;
+			std::array<Tile, 256> tiles;
+		};
+
+		struct SAVEDACTOR {
+			// 0 dynamic, 1 static, 2 trigger
+			int list{ 0 };
+			// an ACTORSTATE then blocks written by the actor and physics components, when makeActor is set
+			std::vector<uint8_t> state;
+			// the actor itself when makeActor is not set
+			ActorPtr actor;
+		};
+
+		static WorldPagePtr _readPage(const SOURCE& source, int px, int py);
+		void _load(int px, int py);
+		void _install(int px, int py, WorldPagePtr page);
+		void _evict(int index);
+		void _saveActors();
+		void _restoreActors(int index);
+
+		World& world_;
+		AssetLoader& loader_;
+		std::shared_ptr<const SOURCE> source_;
+		// pending loads check it, so pages that finish after the streamer is gone or reopened are dropped
+		std::shared_ptr<WorldStreamer*> self_{ std::make_shared<WorldStreamer*>(this) };
+		std::vector<PAGESTATE> states_;
+		std::vector<int> resident_;
+		// actors taken out of the world by page index
+		std::map<int, std::vector<SAVEDACTOR>> saved_;
+		// writes the state of evicted actors, its memory is kept for the next one
+		SnapshotWriter writer_;
+
+		unsigned pagesLoaded_{ 0 };
+		unsigned pagesEvicted_{ 0 };
+		unsigned actorsEvicted_{ 0 };
+		unsigned actorsRestored_{ 0 };
+	};
+} // namespace GameLib
+
+#endif
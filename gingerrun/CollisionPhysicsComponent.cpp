@@ -26,62 +26,72 @@ void CollisionPhysicsComponent::update(GameLib::Actor& actor, GameLib::World& wo
         actor.velocity.y = 0;
     }
 
-    GameLib::Actor* actorA = &actor;
-    // do collision detection
+    // gather the other actors into a packed array so they are tested in one batch
+    candidates_.clear();
+    boxes_.clear();
     for (auto& actorB : world.dynamicActors) {
         if (!actorB->active)
             continue;
         if (actorB->getId() == actor.getId())
             continue;
-        if (collides(*actorB, actor)) {
-            // back both up a tiny slice at a time
-            const float minidt = 0.001f;
-            for (int i = 0; i < 100; i++) {
-                if (actorB->movable)
-                    actorB->position -= actorB->velocity * minidt;
-                if (actorA->movable)
-                    actorA->position -= actorA->velocity * minidt;
-                if (!collides(*actorA, *actorB))
-                    break;
+        candidates_.push_back(actorB.get());
+        boxes_.push_back(actorB->position2d(), actorB->position2d() + actorB->size2d());
+    }
+    hitMask_.resize(boxes_.maskWords());
+    glm::vec2 start{ prevPosition.x, prevPosition.y };
+    glm::vec2 move = actor.position2d() - start;
+    glm::vec2 size = actor.size2d();
+    if (!GameLib::broadPhaseAABBs(start, size, move, boxes_, hitMask_.data()))
+        return;
+
+    // find the first actor that A runs into this step and stop A there
+    if (actor.movable) {
+        float firstHit = 1.0f;
+        GameLib::Actor* firstActor = nullptr;
+        sweptMask_.resize(boxes_.maskWords());
+        entryTime_.resize(boxes_.size());
+        GameLib::sweptAABBs(start, size, move, boxes_, sweptMask_.data(), entryTime_.data());
+        GameLib::forEachHit(sweptMask_.data(), candidates_.size(), [&](size_t i) {
+            float t = entryTime_[i];
+            if (t >= 0.0f && t < firstHit) {
+                firstHit = t;
+                firstActor = candidates_[i];
             }
-            // if actors are still colliding, move A up or to the side
-            if ((actorA->movable && !actorB->movable) && collides(*actorA, *actorB)) {
-                float horz = actorA->position.x - actorB->position.x;
-                float vert = actorA->position.y - actorB->position.y;
-                bool moveup = std::abs(horz) > std::abs(vert);
-                if (moveup) {
-                    if (vert < 0) {
-                        actorA->position.y = actorB->position.y - actorA->size.y;
-                    } else {
-                        actorA->position.y = actorB->position.y + actorB->size.y;
-                    }
-                } else {
-                    if (horz < 0) {
-                        actorA->position.x = actorB->position.x - actorA->size.x;
-                    } else {
-                        actorA->position.x = actorB->position.x + actorB->size.x;
-                    }
-                }
-                if (collides(*actorA, *actorB)) {
-                    actorA->position.y = 0;
-                }
+        });
+        if (firstActor) {
+            glm::vec2 p = start + move * firstHit;
+            GameLib::CONTACTINFO contact;
+            GameLib::contactAABB(p, p + size, firstActor->position2d(), firstActor->position2d() + firstActor->size2d(), contact);
+            // only undo the motion into B, A keeps sliding along its face
+            if (contact.normal.x != 0.0f) {
+                actor.position.x = p.x;
+                if (actor.velocity.x * contact.normal.x > 0.0f)
+                    actor.velocity.x = 0.0f;
+            } else {
+                actor.position.y = p.y;
+                if (actor.velocity.y * contact.normal.y > 0.0f)
+                    actor.velocity.y = 0.0f;
             }
-
-            // HFLOGDEBUG("boom! between %d and %d", actorB->getId(), actor.getId());
         }
     }
-}
 
-bool CollisionPhysicsComponent::collides(GameLib::Actor& a, GameLib::Actor& b) {
-    glm::vec3 amin = a.position;
-    glm::vec3 amax = a.position + a.size;
-    glm::vec3 bmin = b.position;
-    glm::vec3 bmax = b.position + b.size;
-
-    bool overlapX = (amin.x <= bmax.x && amax.x >= bmin.x);
-    bool overlapY = (amin.y <= bmax.y && amax.y >= bmin.z);
-    bool overlapZ = (amin.z <= bmax.z && amax.z >= bmin.z);
-    return overlapX && overlapY && overlapZ;
+    // push apart anything that still overlaps along the axis of least penetration
+    GameLib::forEachHit(hitMask_.data(), candidates_.size(), [&](size_t i) {
+        GameLib::Actor* actorB = candidates_[i];
+        GameLib::CONTACTINFO contact;
+        if (!actor.contact(*actorB, contact) || contact.distance >= 0.0f)
+            return;
+        glm::vec3 push{ contact.normal.x * contact.distance, contact.normal.y * contact.distance, 0.0f };
+        if (actor.movable && actorB->movable) {
+            actor.position += push * 0.5f;
+            actorB->position -= push * 0.5f;
+        } else if (actor.movable) {
+            actor.position += push;
+        } else if (actorB->movable) {
+            actorB->position -= push;
+        }
+        // HFLOGDEBUG("boom! between %d and %d", actorB->getId(), actor.getId());
+    });
 }
 
 bool CollisionPhysicsComponent::pointInside(glm::vec3 p, GameLib::Actor& a) {
@@ -8,6 +8,11 @@ public:
     void update(GameLib::Actor& actor, GameLib::World& world) override;
 
 private:
-    bool collides(GameLib::Actor& a, GameLib::Actor& b);
     bool pointInside(glm::vec3 p, GameLib::Actor& a);
+
+    std::vector<GameLib::Actor*> candidates_;
+    GameLib::AABBArray boxes_;
+    std::vector<uint32_t> hitMask_;
+    std::vector<uint32_t> sweptMask_;
+    std::vector<float> entryTime_;
 };
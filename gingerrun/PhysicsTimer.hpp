@@ -0,0 +1,20 @@
+#pragma once
+#include <hatchetfish_stopwatch.hpp>
+
+// times every World::physics call of a run, msPerFrame() is 0 until a frame is timed
+class PhysicsTimer {
+public:
+    void start() { stopwatch_.start(); }
+    void stop() {
+        time_ += stopwatch_.stop_ms();
+        frames_++;
+    }
+
+    double frames() const { return frames_; }
+    double msPerFrame() const { return frames_ ? time_ / frames_ : 0.0; }
+
+private:
+    Hf::StopWatch stopwatch_;
+    double time_{ 0 };
+    double frames_{ 0 };
+};
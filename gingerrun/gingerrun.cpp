@@ -7,6 +7,7 @@
 #include "ColumnActorComponent.hpp"
 #include "ColumnGraphicsComponent.hpp"
 #include "GingerbreadInputComponent.hpp"
+#include "PhysicsTimer.hpp"
 #include <gamelib.hpp>
 
 #pragma comment(lib, "gamelib.lib")
@@ -74,10 +75,13 @@ public:
 void testSprites(GameLib::Context& context,
 	int spriteCount,
 	int& spritesDrawn,
-	SDL_Texture* testPNG,
-	SDL_Texture* testJPG);
+	GameLib::ImageHandle testPNG,
+	GameLib::ImageHandle testJPG);
 
 int main(int argc, char** argv) {
+	// -stress fills the world with columns and runners to measure collision cost
+	bool stressTest = argc > 1 && std::string(argv[1]) == "-stress";
+
 	GameLib::Context context(1280, 720, GameLib::WindowDefault);
 	GameLib::Audio audio;
 	GameLib::InputHandler input;
@@ -113,8 +117,10 @@ int main(int argc, char** argv) {
 
 	context.addSearchPath("./assets");
 	context.addSearchPath("../assets");
-	SDL_Texture* testPNG = context.loadImage("godzilla.png");
-	SDL_Texture* testJPG = context.loadImage("parrot.jpg");
+	if (!context.addArchive("./assets.pak"))
+		context.addArchive("../assets.pak");
+	GameLib::ImageHandle testPNG = context.loadImage("godzilla.png");
+	GameLib::ImageHandle testJPG = context.loadImage("parrot.jpg");
 	graphics.setTileSize({ 32, 32 });
 	int spriteCount = context.loadTileset(0, 32, 32, "GingerRun.png");
 	if (!spriteCount) {
@@ -177,7 +183,7 @@ int main(int argc, char** argv) {
 	alienActor->speed = globalSpeed;
 
 	std::vector<GameLib::ActorPtr> columns;
-	for (int i = 0; i < 0 /*world.worldSizeX*/; i++) {
+	for (int i = 0; i < (stressTest ? world.worldSizeX : 0); i++) {
 		auto actor = GameLib::makeActor("column",
 			std::make_shared<GameLib::InputComponent>(),
 			std::make_shared<ColumnActorComponent>(),
@@ -195,8 +201,28 @@ int main(int argc, char** argv) {
 		actor->movable = false;
 	}
 
+	constexpr int StressRunners = 256;
+	for (int i = 0; i < (stressTest ? StressRunners : 0); i++) {
+		auto runner = GameLib::makeActor("runner",
+			std::make_shared<GameLib::InputComponent>(),
+			std::make_shared<GameLib::ActorComponent>(),
+			std::make_shared<CollisionPhysicsComponent>(),
+			std::make_shared<GameLib::SimpleGraphicsComponent>());
+		world.addDynamicActor(runner);
+		runner->position.x = GameLib::random.positive() * (world.worldSizeX - 1);
+		runner->position.y = GameLib::random.positive() * (world.worldSizeY - 2);
+		runner->velocity.x = GameLib::random.normal() * 4.0f;
+		runner->setSprite(1, 0);
+		runner->speed = globalSpeed;
+	}
+
+	PhysicsTimer physicsTimer;
 	float t0 = stopwatch.stop_sf();
 
+	// stress runs measure collision cost, so frames are not held back
+	GameLib::FramePacer pacer;
+	pacer.setMode(context, stressTest ? GameLib::FramePacer::UNCAPPED : GameLib::FramePacer::VSYNC);
+
 	context.playMusicClip(0);
 	world.start(t0);
 	while (!context.quitRequested) {
@@ -222,6 +248,9 @@ int main(int argc, char** argv) {
 		//}
 
 		world.update(dt);
+		physicsTimer.start();
+		world.physics(dt);
+		physicsTimer.stop();
 		world.draw(graphics);
 
 		minchofont.draw(0, 0, "Hello, world!", GameLib::Red, GameLib::Font::SHADOWED);
@@ -247,13 +276,17 @@ int main(int argc, char** argv) {
 			GameLib::Gold,
 			GameLib::Font::VALIGN_BOTTOM | GameLib::Font::SHADOWED);
 
-		context.swapBuffers();
+		// sounds requested during the frame go to the mixer together
+		audio.update();
+		pacer.present(context);
 		frames++;
-		std::this_thread::yield();
 	}
 	double totalTime = stopwatch.stop_s();
 	HFLOGDEBUG("Sprites/sec = %5.1f", spritesDrawn / totalTime);
 	HFLOGDEBUG("Frames/sec = %5.1f", frames / totalTime);
+	HFLOGDEBUG("Physics ms/frame = %5.3f", physicsTimer.msPerFrame());
+	pacer.logStats();
+	audio.logStats();
 
 	return 0;
 }
@@ -261,8 +294,8 @@ int main(int argc, char** argv) {
 void testSprites(GameLib::Context& context,
 	int spriteCount,
 	int& spritesDrawn,
-	SDL_Texture* testPNG,
-	SDL_Texture* testJPG) {
+	GameLib::ImageHandle testPNG,
+	GameLib::ImageHandle testJPG) {
 	// if (context.keyboard.scancodes[SDL_SCANCODE_ESCAPE]) {
 	//    context.quitRequested = true;
 	//}
@@ -17,6 +17,8 @@ namespace GameLib {
 		void endOverlap(Actor& a, Actor& b) override;
 		void beginTriggerOverlap(Actor& a, Actor& b) override;
 		void endTriggerOverlap(Actor& a, Actor& b) override;
+		void writeState(const Actor& a, SnapshotWriter& w) const override;
+		void readState(Actor& a, SnapshotReader& r) override;
 
 	private:
 		struct STATICINFO {
@@ -1,4 +1,5 @@
 #include "FoodActorComponent.hpp"
+#include <gamelib_snapshot.hpp>
 
 #include <gamelib_locator.hpp>
 #include <gamelib_random.hpp>
@@ -360,8 +361,9 @@ namespace GameLib {
 		}
 		triggerInfo.position = a.position;
 		triggerInfo.t = 2.0f;
-		b.position.x = 1 + random.positive() * (Locator::getWorld()->worldSizeX - 2);
-		b.position.y = 1 + random.positive() * (Locator::getWorld()->worldSizeY - 2);
+		float x = 1 + random.positive() * (Locator::getWorld()->worldSizeX - 2);
+		float y = 1 + random.positive() * (Locator::getWorld()->worldSizeY - 2);
+		b.teleport({ x, y, b.position.z });
 		Locator::getAudio()->playAudio(1, true);
 	}
 
@@ -369,4 +371,26 @@ namespace GameLib {
 	void FoodActorComponent::endTriggerOverlap(Actor& a, Actor& b) {
 		HFLOGDEBUG("Trigger actor '%d' is not overlapped by actor '%d'", a.getId(), b.getId());
 	}
+
+
+	void FoodActorComponent::writeState(const Actor& a, SnapshotWriter& w) const {
+		w.write((uint8_t)staticInfo.horizontal);
+		w.write(staticInfo.movement);
+		w.write(staticInfo.position);
+		w.write(staticInfo.t);
+		w.write(triggerInfo.position);
+		w.write(triggerInfo.t);
+	}
+
+
+	void FoodActorComponent::readState(Actor& a, SnapshotReader& r) {
+		uint8_t horizontal = 0;
+		r.read(horizontal);
+		r.read(staticInfo.movement);
+		r.read(staticInfo.position);
+		r.read(staticInfo.t);
+		r.read(triggerInfo.position);
+		r.read(triggerInfo.t);
+		staticInfo.horizontal = horizontal != 0;
+	}
 } // namespace GameLib
@@ -7,11 +7,17 @@
 #include <gamelib_story_screen.hpp>
 
 constexpr int SOUND_BLIP = 6;
+// longer clips are decoded on the loader threads before they first play
+constexpr size_t PRELOAD_CLIP_BYTES = 256 * 1024;
+// story screen images that are not on screen are evicted past this and reload when they are drawn again
+constexpr size_t TEXTURE_BUDGET = 4 * 1024 * 1024;
 
 
 void Game::init() {
 	GameLib::Locator::provide(&context);
-	if (context.audioInitialized())
+	if (!mixAudioPath.empty())
+		GameLib::Locator::provide(&softwareAudio);
+	else if (context.audioInitialized())
 		GameLib::Locator::provide(&audio);
 	GameLib::Locator::provide(&input);
 	GameLib::Locator::provide(&graphics);
@@ -19,8 +25,9 @@ void Game::init() {
 	GameLib::Locator::provide(&box2d);
 
 	box2d.init();
+	context.setTextureBudget(TEXTURE_BUDGET);
 
-	audio.setVolume(0.2f);
+	GameLib::Locator::getAudio()->setVolume(0.2f);
 
 	PlaySoundCommand play0(0, false);
 	PlaySoundCommand play1(1, false);
@@ -41,6 +48,9 @@ void Game::init() {
 	input.start = &shakeCommand;
 	input.axis1X = &xaxisCommand;
 	input.axis1Y = &yaxisCommand;
+
+	rollback.step = [this](unsigned tick, const GameLib::ROLLBACKINPUT* inputs) { _rollbackStep(tick, inputs); };
+	streamer.makeActor = [this](char charDesc) { return _makeStreamedActor(charDesc); };
 }
 
 
@@ -48,20 +58,86 @@ void Game::kill() {
 	double totalTime = stopwatch.stop_s();
 	HFLOGDEBUG("Sprites/sec = %5.1f", spritesDrawn / totalTime);
 	HFLOGDEBUG("Frames/sec = %5.1f", frames / totalTime);
+	pacer.logStats();
+	audio.logStats();
+	box2d.stopThread();
+	context.stopControllerSampling();
+	if (softwareAudio.running()) {
+		softwareAudio.stop();
+		softwareAudio.logStats();
+	}
+	if (streamWorld)
+		streamer.logStats();
+	if (!rewind.empty())
+		rewind.logStats();
+	if (netServer.isRunning()) {
+		netServer.logStats();
+		netServer.stop();
+	}
+	if (netClient.isConnected()) {
+		netClient.logStats();
+		netClient.disconnect();
+	}
+	if (!rollbackHost.empty() || !rollbackJoin.empty()) {
+		rollback.logStats();
+		rollback.close();
+	}
+
+	if (replay.isLoaded()) {
+		HFLOGINFO("Replayed %u frames in %5.3f s, %u diverged", replay.frames(), totalTime, replay.divergences());
+	}
+	recorder.close();
 
 	actorPool.clear();
 }
 
 
 void Game::main(int argc, char** argv) {
+	_parseArgs(argc, argv);
 	init();
 	loadData();
-	showIntro();
-	initLevel(1);
-	if (playGame()) {
-		showWonEnding();
+	if (!headless)
+		showIntro();
+	finishLoading();
+	if (deterministic)
+		GameLib::random.seed(seed);
+	// recordings hold the keyboard state each frame rather than timed events, so only live play uses them
+	input.stepEvents = !deterministic;
+	// controllers are sampled on a thread of their own, so sticks and buttons land on the step they moved in
+	if (input.stepEvents)
+		context.startControllerSampling();
+	// the session is open before the level so the second player is made
+	if (!rollbackHost.empty())
+		rollback.host(rollbackHost);
+	else if (!rollbackJoin.empty())
+		rollback.join(rollbackJoin);
+	if (rollback.isOpen()) {
+		rollback.socket().setConditions(netConditions);
+		soakRandom.seed(seed + rollback.localPlayer());
+	}
+	// a client gets every actor from the server
+	if (!joinEndpoint.empty() && netClient.connect(joinEndpoint)) {
+		netClient.socket().setConditions(netConditions);
 	} else {
-		showLostEnding();
+		initLevel(1);
+	}
+	if (!serveEndpoint.empty() && netServer.start(serveEndpoint))
+		netServer.socket().setConditions(netConditions);
+	if (physicsThread) {
+		// the thread steps on its own clock, so runs that must repeat exactly keep stepping in update()
+		if (deterministic) {
+			HFLOGWARN("-physicsthread is ignored in deterministic runs");
+		} else {
+			box2d.startThread(PHYSICS_THREAD_STEP);
+		}
+	}
+	bool gameWon = playGame();
+	if (!headless) {
+		if (gameWon) {
+			showWonEnding();
+		} else {
+			showLostEnding();
+		}
 	}
 	kill();
 }
@@ -71,36 +147,66 @@ void Game::loadData() {
 	for (auto sp : searchPaths) {
 		context.addSearchPath(sp);
 	}
-	SDL_Texture* testPNG = context.loadImage("godzilla.png");
-	SDL_Texture* testJPG = context.loadImage("parrot.jpg");
-	graphics.setTileSize({ 32, 32 });
-	int spriteCount = context.loadTileset(0, 32, 32, "Tiles32x32.png");
-	if (!spriteCount) {
-		HFLOGWARN("Tileset not found");
+	for (auto& ap : archivePaths) {
+		if (context.addArchive(ap))
+			break;
 	}
-	context.loadTileset(GameLib::LIBXOR_TILESET32, 32, 32, "LibXORColors32x32.png");
-
-	context.loadAudioClip(0, "starbattle-bad.wav");
-	context.loadAudioClip(1, "starbattle-dead.wav");
-	context.loadAudioClip(2, "starbattle-endo.wav");
-	context.loadAudioClip(3, "starbattle-exo.wav");
-	context.loadAudioClip(4, "starbattle-ok.wav");
-	context.loadAudioClip(5, "starbattle-pdead.wav");
-	context.loadAudioClip(SOUND_BLIP, "blip.wav");
-	context.loadMusicClip(0, "starbattlemusic1.mp3");
-	context.loadMusicClip(1, "starbattlemusic2.mp3");
-	context.loadMusicClip(2, "distoro2.mid");
-
-	gothicfont.load("fonts-japanese-gothic.ttf", 36);
-	minchofont.load("fonts-japanese-mincho.ttf", 36);
-
+	loadStartTime = stopwatch.stop_sf();
+	loader.onProgress = [](unsigned finished, unsigned queued) { HFLOGDEBUG("loaded %u of %u assets", finished, queued); };
+	loader.start();
+
+	// the intro blips as text appears, so its sound is queued first
+	loader.loadAudioClip(SOUND_BLIP, "blip.wav");
+	loader.loadImage("godzilla.png");
+	loader.loadImage("parrot.jpg");
+	graphics.setTileSize({ 32, 32 });
+	tilesetLoaded = loader.loadTileset(0, 32, 32, "Tiles32x32.png");
+	loader.loadTileset(GameLib::LIBXOR_TILESET32, 32, 32, "LibXORColors32x32.png");
+
+	loader.loadAudioClip(0, "starbattle-bad.wav");
+	loader.loadAudioClip(1, "starbattle-dead.wav");
+	loader.loadAudioClip(2, "starbattle-endo.wav");
+	loader.loadAudioClip(3, "starbattle-exo.wav");
+	loader.loadAudioClip(4, "starbattle-ok.wav");
+	loader.loadAudioClip(5, "starbattle-pdead.wav");
+	loader.loadMusicClip(0, "starbattlemusic1.mp3");
+	loader.loadMusicClip(1, "starbattlemusic2.mp3");
+	loader.loadMusicClip(2, "distoro2.mid");
+
+	loader.loadFont(gothicfont, "fonts-japanese-gothic.ttf", 36);
+	loader.loadFont(minchofont, "fonts-japanese-mincho.ttf", 36);
+
+	// the world adds its tiles to Box2D, so it loads here while the loader threads decode
 	worldPath = context.findSearchPath(worldPath);
-	if (!world.load(worldPath)) {
+	if (streamWorld ? !streamer.open(worldPath) : !world.load(worldPath)) {
 		HFLOGWARN("world.txt not found");
 	}
 }
 
 
+void Game::finishLoading() {
+	if (!loader.finish()) {
+		HFLOGWARN("Some assets did not load");
+	}
+	if (!tilesetLoaded.get()) {
+		HFLOGWARN("Tileset not found");
+	}
+	HFLOGINFO("Loaded %u assets in %3.3f s", loader.queued(), stopwatch.stop_sf() - loadStartTime);
+	context.logResidentMemory();
+	hotReload.watchSearchPaths();
+	// a streamed world reads its rows from the file as it goes, so it is not reloaded
+	if (!streamWorld)
+		hotReload.addWorld(world, worldPath);
+	if (!mixAudioPath.empty()) {
+		softwareAudio.loadClips(context);
+		// deterministic runs mix the time they simulate, however fast they run
+		softwareAudio.stepFrames = (int)(softwareAudio.frequency() * FIXED_STEPS_PER_FRAME * MS_PER_UPDATE);
+		auto mode = deterministic ? GameLib::SoftwareAudio::STEPPED : GameLib::SoftwareAudio::REALTIME;
+		softwareAudio.start(mode, mixAudioPath == "null" ? "" : mixAudioPath);
+	}
+}
+
+
 void Game::initLevel(int levelNum) {
 	auto NewDungeonActor = []() { return std::make_shared<GameLib::DungeonActorComponent>(); };
 	auto NewFoodActor = []() { return std::make_shared<GameLib::FoodActorComponent>(); };
@@ -113,32 +219,66 @@ void Game::initLevel(int levelNum) {
 	auto NewGraphics = []() { return std::make_shared<GameLib::SimpleGraphicsComponent>(); };
 	auto NewDebugGraphics = []() { return std::make_shared<GameLib::DebugGraphicsComponent>(); };
 
+	loader.preloadAudioClips(PRELOAD_CLIP_BYTES);
+
 	float cx = world.worldSizeX * 0.5f;
 	float cy = world.worldSizeY * 0.5f;
 	float speed = (float)graphics.getTileSizeX();
 
 	GameLib::ActorPtr player;
-	player = _makeActor(cx + 6, cy, 16, 2, NewInput(), NewPlayerActor(), NewPhysics(), NewGraphics());
+	auto playerInput = NewInput();
+	if (rollback.isOpen())
+		playerInput->input = &playerInputs[0];
+	player = _makeActor(cx + 6, cy, 16, 2, playerInput, NewPlayerActor(), NewPhysics(), NewGraphics());
+	player->setCharDesc('P');
 	world.addDynamicActor(player);
+	if (rollback.isOpen()) {
+		playerInput = NewInput();
+		playerInput->input = &playerInputs[1];
+		player = _makeActor(cx - 6, cy, 16, 2, playerInput, NewPlayerActor(), NewPhysics(), NewGraphics());
+		player->setCharDesc('P');
+		world.addDynamicActor(player);
+	}
 
 
 
 	GameLib::ActorPtr actor;
-	actor = _makeActor(19, 10, 4, 103, nullptr, NewFoodActor(), NewPhysics(), NewGraphics());
+	actor = _makeStreamedActor('F');
+	actor->position = { 19.0f, 10.0f, actor->position.z };
 	world.addTriggerActor(actor);
 
-		actor = _makeActor(1, 30, 4, 103, nullptr, NewFoodActor(), NewPhysics(), NewGraphics());
+		actor = _makeStreamedActor('F');
+	actor->position = { 1.0f, 30.0f, actor->position.z };
 	world.addTriggerActor(actor);
 
-			actor = _makeActor(11, 20, 4, 103, nullptr, NewFoodActor(), NewPhysics(), NewGraphics());
+			actor = _makeStreamedActor('F');
+	actor->position = { 11.0f, 20.0f, actor->position.z };
 	world.addTriggerActor(actor);
 }
 
 
+GameLib::ActorPtr Game::_makeStreamedActor(char charDesc) {
+	// the player is pinned, so food is all a streamed world leaves behind
+	if (charDesc != 'F')
+		return nullptr;
+	auto actor = _makeActor(0,
+		0,
+		4,
+		103,
+		nullptr,
+		std::make_shared<GameLib::FoodActorComponent>(),
+		std::make_shared<GameLib::SimplePhysicsComponent>(),
+		std::make_shared<GameLib::SimpleGraphicsComponent>());
+	actor->setCharDesc(charDesc);
+	return actor;
+}
+
+
 void Game::showIntro() {
 	// context.playMusicClip(0);
 	GameLib::StoryScreen ss;
 	ss.setBlipSound(SOUND_BLIP);
+	ss.setLoader(&loader);
 	if (!ss.load("dialog.txt")) {
 		// do something default
 		ss.setFont(0, "URWClassico-Bold.ttf", 2.0f);
@@ -210,12 +350,22 @@ void Game::showLostEnding() {
 
 
 void Game::startTiming() {
-	t0 = stopwatch.stop_sf();
+	t0 = deterministic ? 0.0f : stopwatch.stop_sf();
 	lag = 0.0f;
 }
 
 
 void Game::updateTiming() {
+	if (deterministic) {
+		// time only moves in whole updates so nothing depends on the wall clock
+		dt = FIXED_STEPS_PER_FRAME * MS_PER_UPDATE;
+		t1 = (frameCount + 1) * dt;
+		t0 = t1;
+		GameLib::Context::deltaTime = dt;
+		GameLib::Context::currentTime_s = t1;
+		GameLib::Context::currentTime_ms = t1 * 1000;
+		return;
+	}
 	t1 = stopwatch.stop_sf();
 	dt = t1 - t0;
 	t0 = t1;
@@ -250,41 +400,105 @@ void Game::shake(int amount, float timeLength, float dt) {
 
 
 bool Game::playGame() {
+	pacer.setMode(context, paceMode, paceFps);
 	stopwatch.start();
 	startTiming();
 	world.start(t0);
+	if (streamWorld) {
+		// the pages around the player load before the first frame
+		streamer.pinned = world.dynamicActors[0];
+		streamer.update(world.dynamicActors[0]->center2d());
+		loader.finish();
+	}
 	graphics.setCenter(graphics.origin());
 	bool gameWon = false;
 	bool gameOver = false;
 	while (!context.quitRequested && !gameOver) {
 		updateTiming();
+		uint32_t frameTicks = SDL_GetTicks();
 
-		context.getEvents();
+		if (replay.isLoaded()) {
+			if (!replay.playInput(context))
+				break;
+		} else {
+			context.getEvents();
+		}
+		recorder.recordInput(context);
 		input.handle();
 		_debugKeys();
 
-		context.clearScreen(backColor);
-		world.drawTiles(graphics);
+		if (!headless) {
+			context.clearScreen(backColor);
+			world.drawTiles(graphics);
+		}
+		// restoring frames would make recordings and replays diverge, and streamed pages are not all saved
+		bool joined = netClient.isConnected();
+		bool rewindable = !deterministic && !streamWorld && !joined;
+		bool rewound = rewindable && context.keyboard.isDown(SDL_SCANCODE_BACKSPACE);
+		// branches that run no fixed steps still take this frame's presses, or the event queue fills up and drops them
+		if (joined) {
+			// the server moves the actors, the client only shows them around its camera
+			netClient.update(dt, glm::vec2(graphics.center()) / graphics.tileSizef());
+			input.handleEvents(frameTicks);
+			lag = 0.0f;
+		} else if (rollback.isOpen()) {
+			// the session runs the ticks, and runs them again when the other player's input was mispredicted
+			rollback.advance(_localInput());
+			input.handleEvents(frameTicks);
+			lag = 0.0f;
+		} else if (rewound) {
+			rewind.stepBack();
+			input.handleEvents(frameTicks);
+			lag = 0.0f;
+		} else if (deterministic) {
+			// after a rollback session ends the local player goes on alone
+			playerInputs[rollback.localPlayer()] = _localInput();
+			for (int i = 0; i < FIXED_STEPS_PER_FRAME; i++) {
+				updateWorld();
+			}
+			lag = 0.0f;
+			uint32_t checksum = world.checksum();
+			recorder.recordChecksum(checksum);
+			if (replay.isLoaded())
+				replay.checkChecksum(checksum);
+		}
 		while (lag >= Game::MS_PER_UPDATE) {
+			// each update takes the key presses that happened before the end of the time it simulates
+			input.handleEvents(frameTicks - (uint32_t)((lag - Game::MS_PER_UPDATE) * 1000.0f));
 			updateWorld();
 			lag -= Game::MS_PER_UPDATE;
 		}
-		if(world.dynamicActors[0]->shouldWin==true){
+		if (rewindable && !rewound)
+			rewind.record();
+		netServer.update(dt);
+		// without a session the soak counts frames, so it still ends
+		if (soakFrames && (rollback.isOpen() ? rollback.tick() : frameCount) >= soakFrames)
+			gameOver = true;
+		// only the server decides when the game ends
+		if(!joined && world.dynamicActors[0]->shouldWin==true){
 			HFLOGDEBUG("gmae shpuld have won");
 			gameWon=true;
 			gameOver=true;
 		}
-		if(world.dynamicActors[0]->actorComponent()->getHealth(*world.dynamicActors[0])<0){
+		if(!joined && world.dynamicActors[0]->actorComponent()->getHealth(*world.dynamicActors[0])<0){
 			gameOver=true;
 		}
 		shake();
 		updateCamera();
+		if (streamWorld)
+			streamer.update(graphics);
+		frames++;
+		frameCount++;
+
+		// sounds requested during the frame go to the mixer together
+		hotReload.update();
+		loader.update();
+		GameLib::Locator::getAudio()->update();
+		if (headless)
+			continue;
 		drawWorld();
 		drawHUD();
-
-		context.swapBuffers();
-		frames++;
-		std::this_thread::yield();
+		pacer.present(context);
 	}
 
 	return gameWon;
@@ -292,7 +506,12 @@ bool Game::playGame() {
 
 
 void Game::updateCamera() {
-	glm::ivec2 xy = world.dynamicActors[0]->pixelCenter(graphics);
+	// a client has no player until the first state arrives
+	if (world.dynamicActors.empty())
+		return;
+	// in a rollback session each player follows their own actor
+	size_t local = std::min((size_t)rollback.localPlayer(), world.dynamicActors.size() - 1);
+	glm::ivec2 xy = world.dynamicActors[local]->pixelCenter(graphics);
 	glm::ivec2 center = graphics.center();
 	center.x = GameLib::clamp(center.x, xy.x - 100, xy.x + 100);
 	center.y = GameLib::clamp(center.y, xy.y - 100, xy.y + 100);
@@ -323,7 +542,10 @@ void Game::drawHUD() {
 
 	int x = (int)graphics.getCenterX();
 	int y = (int)graphics.getCenterY() >> 1;
-	int hp = world.dynamicActors[0]->actorComponent()->getHealth(*world.dynamicActors[0]);
+	int hp = 0;
+	// replicated actors have no actor component
+	if (!world.dynamicActors.empty() && world.dynamicActors[0]->actorComponent())
+		hp = world.dynamicActors[0]->actorComponent()->getHealth(*world.dynamicActors[0]);
 	float s = GameLib::wave(t1, 1.0f);
 	SDL_Color c = GameLib::MakeColorHI(7, 4, s, false);
 	minchofont.draw(
@@ -354,13 +576,121 @@ void Game::drawHUD() {
 
 
 void Game::_debugKeys() {
-	if (context.keyboard.checkClear(SDL_SCANCODE_F5)) {
+	// changing the world outside a tick would desync a rollback session
+	bool shared = rollback.isOpen();
+	if (!streamWorld && !shared && context.keyboard.checkClear(SDL_SCANCODE_F5)) {
 		if (!world.load(worldPath)) {
 			HFLOGWARN("world.txt not found");
 		}
 	}
 
+	// a streamed world only has its resident pages in a snapshot, so quick saves need the whole world
+	if (!streamWorld && !shared && context.keyboard.checkClear(SDL_SCANCODE_F6)) {
+		if (snapshot.save("quicksave.snap"))
+			HFLOGINFO("saved quicksave.snap in %3.3f ms", snapshot.milliseconds());
+	}
+
+	if (!streamWorld && !shared && context.keyboard.checkClear(SDL_SCANCODE_F7)) {
+		if (snapshot.load("quicksave.snap"))
+			HFLOGINFO("restored quicksave.snap in %3.3f ms", snapshot.milliseconds());
+	}
+
 	if (shakeCommand.checkClear()) {
 		shake(4, 5, 50 * MS_PER_UPDATE);
 	}
 }
+
+
+void Game::_parseArgs(int argc, char** argv) {
+	std::string recordPath;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-seed" && i + 1 < argc) {
+			seed = (unsigned)std::stoul(argv[++i]);
+			deterministic = true;
+		} else if (arg == "-record" && i + 1 < argc) {
+			recordPath = argv[++i];
+			deterministic = true;
+		} else if (arg == "-replay" && i + 1 < argc) {
+			if (!replay.load(argv[++i])) {
+				HFLOGWARN("cannot replay '%s'", argv[i]);
+				continue;
+			}
+			if (replay.header().stepsPerFrame != FIXED_STEPS_PER_FRAME || replay.header().stepTime != MS_PER_UPDATE) {
+				HFLOGWARN("recording was made with different update steps and will diverge");
+			}
+			seed = replay.header().seed;
+			deterministic = true;
+			headless = true;
+		} else if (arg == "-fps" && i + 1 < argc) {
+			paceFps = std::stof(argv[++i]);
+			paceMode = GameLib::FramePacer::LIMITED;
+		} else if (arg == "-uncapped") {
+			paceMode = GameLib::FramePacer::UNCAPPED;
+		} else if (arg == "-mixaudio" && i + 1 < argc) {
+			mixAudioPath = argv[++i];
+		} else if (arg == "-streamworld") {
+			streamWorld = true;
+		} else if (arg == "-contactevents") {
+			world.useContactEvents = true;
+		} else if (arg == "-physicsthread") {
+			physicsThread = true;
+		} else if (arg == "-serve" && i + 1 < argc) {
+			serveEndpoint = argv[++i];
+		} else if (arg == "-join" && i + 1 < argc) {
+			joinEndpoint = argv[++i];
+		} else if (arg == "-netlatency" && i + 1 < argc) {
+			netConditions.latency = std::stof(argv[++i]);
+		} else if (arg == "-netjitter" && i + 1 < argc) {
+			netConditions.jitter = std::stof(argv[++i]);
+		} else if (arg == "-netloss" && i + 1 < argc) {
+			netConditions.loss = std::stof(argv[++i]);
+		} else if (arg == "-rollbackhost" && i + 1 < argc) {
+			rollbackHost = argv[++i];
+			deterministic = true;
+		} else if (arg == "-rollbackjoin" && i + 1 < argc) {
+			rollbackJoin = argv[++i];
+			deterministic = true;
+		} else if (arg == "-soak" && i + 1 < argc) {
+			soakFrames = (unsigned)std::stoul(argv[++i]);
+		}
+	}
+	// the seed is known once every argument is read
+	if (!recordPath.empty() && !recorder.open(recordPath, seed, FIXED_STEPS_PER_FRAME, MS_PER_UPDATE)) {
+		HFLOGWARN("input will not be recorded");
+	}
+}
+
+
+GameLib::ROLLBACKINPUT Game::_localInput() {
+	if (!soakFrames) {
+		GameLib::ROLLBACKINPUT input;
+		input.axisX = xaxisCommand.getAmount();
+		input.axisY = yaxisCommand.getAmount();
+		return input;
+	}
+	// the soak changes direction every few frames, from its own generator so the world's is left alone
+	if (soakRandom() % 8 == 0) {
+		soakInput.axisX = (float)((int)(soakRandom() % 3) - 1);
+		soakInput.axisY = (float)((int)(soakRandom() % 3) - 1);
+	}
+	return soakInput;
+}
+
+
+void Game::_rollbackStep(unsigned tick, const GameLib::ROLLBACKINPUT* inputs) {
+	for (int p = 0; p < GameLib::RollbackSession::Players; p++)
+		playerInputs[p] = inputs[p];
+	// time comes from the tick so a tick run again sees the same time, and the players agree when one waits
+	float t = (tick + 1) * FIXED_STEPS_PER_FRAME * MS_PER_UPDATE;
+	GameLib::Context::currentTime_s = t;
+	GameLib::Context::currentTime_ms = t * 1000;
+	// sounds already played the first time the tick ran
+	GameLib::IAudio* audio = GameLib::Locator::getAudio();
+	if (rollback.resimulating())
+		GameLib::Locator::provide((GameLib::IAudio*)nullptr);
+	for (int i = 0; i < FIXED_STEPS_PER_FRAME; i++) {
+		updateWorld();
+	}
+	GameLib::Locator::provide(audio);
+}
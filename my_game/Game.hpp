@@ -13,7 +13,10 @@ public:
 	void init();
 	void kill();
 
+	// queues the assets on the loader, they finish while the intro plays
 	virtual void loadData();
+	// waits for the assets that are still loading
+	virtual void finishLoading();
 	virtual void initLevel(int levelNum);
 
 	// return true if game won, false if game lost
@@ -42,19 +45,71 @@ protected:
 
 	static constexpr float MS_PER_UPDATE = 0.001f;
 
+	// -seed, -record and -replay make runs deterministic, every frame runs exactly this many updates
+	static constexpr int FIXED_STEPS_PER_FRAME = 16;
+	bool deterministic{ false };
+	// replays skip the story screens and drawing and run as fast as possible
+	bool headless{ false };
+	unsigned seed{ 1 };
+	unsigned frameCount{ 0 };
+	GameLib::InputRecorder recorder;
+	GameLib::InputReplay replay;
+
 	GameLib::Context context{ 1280, 720, GameLib::WindowDefault };
 	GameLib::Audio audio;
+	// -mixaudio FILE mixes the sounds in software into a WAV file instead of the sound card, -mixaudio null discards them
+	GameLib::SoftwareAudio softwareAudio;
+	std::string mixAudioPath;
 	GameLib::InputHandler input;
 	GameLib::Graphics graphics{ &context };
+	// -contactevents takes collisions and trigger overlaps from Box2D contact events instead of testing every actor
 	GameLib::World world;
+	// -physicsthread steps Box2D on its own thread every PHYSICS_THREAD_STEP seconds
 	GameLib::Box2D box2d;
+	static constexpr float PHYSICS_THREAD_STEP = 1.0f / 120.0f;
+	bool physicsThread{ false };
 	GameLib::Font gothicfont{ &context };
 	GameLib::Font minchofont{ &context };
+	// declared after the fonts and context it loads into so it stops first
+	GameLib::AssetLoader loader{ context };
+	// edits to the world, tilesets and images in the search paths are applied while the game runs
+	GameLib::HotReload hotReload{ context, loader };
+	// -streamworld keeps only the pages of the world near the camera in memory
+	GameLib::WorldStreamer streamer{ world, loader };
+	bool streamWorld{ false };
+	// F6 saves the world to quicksave.snap and F7 restores it
+	GameLib::WorldSnapshot snapshot{ world };
+	// holding backspace steps back through the last frames, playing on continues from there
+	GameLib::RewindBuffer rewind{ world };
+	// -serve ENDPOINT replicates the world to clients, -join ENDPOINT shows the world of a server instead of playing
+	GameLib::NetServer netServer{ world };
+	GameLib::NetClient netClient{ world };
+	std::string serveEndpoint;
+	std::string joinEndpoint;
+	// -netlatency MS, -netjitter MS and -netloss FRACTION simulate a slow network on the messages received
+	GameLib::NETCONDITIONS netConditions;
+	// -rollbackhost ENDPOINT and -rollbackjoin ENDPOINT play two players, each running the whole game
+	GameLib::RollbackSession rollback{ world };
+	std::string rollbackHost;
+	std::string rollbackJoin;
+	GameLib::ROLLBACKINPUT playerInputs[GameLib::RollbackSession::Players];
+	// -soak FRAMES plays random input until that tick, or that frame without a session, and quits
+	unsigned soakFrames{ 0 };
+	std::mt19937 soakRandom;
+	GameLib::ROLLBACKINPUT soakInput;
+	GameLib::AssetLoader::Future tilesetLoaded;
+	float loadStartTime{ 0 };
 	SDL_Color backColor{ GameLib::Azure };
 
 	std::vector<std::string> searchPaths{ "./assets", "../assets" };
+	// the first archive found is mapped and searched before the search paths
+	std::vector<std::string> archivePaths{ "./assets.pak", "../assets.pak" };
 	std::string worldPath{ "world.txt" };
 	Hf::StopWatch stopwatch;
+	GameLib::FramePacer pacer;
+	// -fps N limits to N frames a second and -uncapped draws as fast as possible, otherwise frames follow vsync
+	GameLib::FramePacer::Mode paceMode{ GameLib::FramePacer::VSYNC };
+	float paceFps{ 0.0f };
 	double spritesDrawn{ 0 };
 	double frames{ 0 };
 	float t0{ 0 };
@@ -69,6 +124,11 @@ protected:
 	MovementCommand yaxisCommand;
 
 	virtual void _debugKeys();
+	virtual void _parseArgs(int argc, char** argv);
+	GameLib::ROLLBACKINPUT _localInput();
+	// makes the actors a streamed world frees when their page is evicted, by charDesc
+	GameLib::ActorPtr _makeStreamedActor(char charDesc);
+	void _rollbackStep(unsigned tick, const GameLib::ROLLBACKINPUT* inputs);
 
 	GameLib::ActorPtr _makeActor(float x,
 		float y,
@@ -84,7 +144,9 @@ protected:
 		actor->speed = speed;
 		// actor->size = { 0.75f, 0.5f, 1.0f };
 		actor->setSprite(0, spriteId);
-		actorPool.push_back(actor);
+		// a streamed world frees actors whose page is evicted, so the pool must not keep them
+		if (!streamWorld)
+			actorPool.push_back(actor);
 		return actor;
 	}
 };
@@ -5,6 +5,14 @@
 
 namespace GameLib {
 	void MyInputComponent::update(Actor& actor) {
+		if (input) {
+			actor.velocity.x = input->axisX * 10;
+			if (actor.jumped == false) {
+				actor.velocity.y = input->axisY * 1000.0f;
+				actor.jumped = true;
+			}
+			return;
+		}
 		auto axis1 = Locator::getInput()->axis1X;
 		if (axis1)
 			actor.velocity.x = axis1->getAmount()*10;
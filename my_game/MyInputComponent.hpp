@@ -3,12 +3,16 @@
 
 #include <gamelib_actor.hpp>
 #include <gamelib_input_component.hpp>
+#include <gamelib_rollback.hpp>
 
 namespace GameLib {
     class MyInputComponent : public InputComponent {
     public:
         virtual ~MyInputComponent() {}
         void update(Actor& actor) override;
+
+        // when set, the actor follows this input instead of the input handler, for a player of a rollback session
+        const ROLLBACKINPUT* input{ nullptr };
     };
 }
 
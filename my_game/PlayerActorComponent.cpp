@@ -1,4 +1,5 @@
 #include "PlayerActorComponent.hpp"
+#include <gamelib_snapshot.hpp>
 
 #include <gamelib_locator.hpp>
 #include <gamelib_random.hpp>
@@ -85,4 +86,28 @@ namespace GameLib {
 	void PlayerActorComponent::endTriggerOverlap(Actor& a, Actor& b) {
 		HFLOGDEBUG("Trigger actor '%d' is not overlapped by actor '%d'", a.getId(), b.getId());
 	}
+
+
+	void PlayerActorComponent::writeState(const Actor& a, SnapshotWriter& w) const {
+		w.write(health);
+		w.write((uint8_t)staticInfo.horizontal);
+		w.write(staticInfo.movement);
+		w.write(staticInfo.position);
+		w.write(staticInfo.t);
+		w.write(triggerInfo.position);
+		w.write(triggerInfo.t);
+	}
+
+
+	void PlayerActorComponent::readState(Actor& a, SnapshotReader& r) {
+		uint8_t horizontal = 0;
+		r.read(health);
+		r.read(horizontal);
+		r.read(staticInfo.movement);
+		r.read(staticInfo.position);
+		r.read(staticInfo.t);
+		r.read(triggerInfo.position);
+		r.read(triggerInfo.t);
+		staticInfo.horizontal = horizontal != 0;
+	}
 } // namespace GameLib
@@ -369,8 +369,9 @@ namespace GameLib {
 		}
 		triggerInfo.position = a.position;
 		triggerInfo.t = 2.0f;
-		b.position.x = 1 + random.positive() * (Locator::getWorld()->worldSizeX - 2);
-		b.position.y = 1 + random.positive() * (Locator::getWorld()->worldSizeY - 2);
+		float x = 1 + random.positive() * (Locator::getWorld()->worldSizeX - 2);
+		float y = 1 + random.positive() * (Locator::getWorld()->worldSizeY - 2);
+		b.teleport({ x, y, b.position.z });
 		Locator::getAudio()->playAudio(1, true);
 	}
 
@@ -44,6 +44,8 @@ void Game::kill() {
 	double totalTime = stopwatch.stop_s();
 	HFLOGDEBUG("Sprites/sec = %5.1f", spritesDrawn / totalTime);
 	HFLOGDEBUG("Frames/sec = %5.1f", frames / totalTime);
+	pacer.logStats();
+	audio.logStats();
 
 	actorPool.clear();
 }
@@ -67,8 +69,12 @@ void Game::loadData() {
 	for (auto sp : searchPaths) {
 		context.addSearchPath(sp);
 	}
-	SDL_Texture* testPNG = context.loadImage("godzilla.png");
-	SDL_Texture* testJPG = context.loadImage("parrot.jpg");
+	for (auto& ap : archivePaths) {
+		if (context.addArchive(ap))
+			break;
+	}
+	GameLib::ImageHandle testPNG = context.loadImage("godzilla.png");
+	GameLib::ImageHandle testJPG = context.loadImage("parrot.jpg");
 	graphics.setTileSize({ 32, 32 });
 	int spriteCount = context.loadTileset(0, 32, 32, "Tiles32x32.png");
 	if (!spriteCount) {
@@ -352,6 +358,7 @@ void Game::shake(int amount, float timeLength, float dt) {
 
 
 bool Game::playGame() {
+	pacer.setMode(context, GameLib::FramePacer::VSYNC);
 	stopwatch.start();
 	startTiming();
 	world.start(t0);
@@ -377,9 +384,10 @@ bool Game::playGame() {
 		drawWorld();
 		drawHUD();
 
-		context.swapBuffers();
+		// sounds requested during the frame go to the mixer together
+		audio.update();
+		pacer.present(context);
 		frames++;
-		std::this_thread::yield();
 	}
 
 	return gameWon;
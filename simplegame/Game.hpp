@@ -53,8 +53,11 @@ protected:
 	SDL_Color backColor{ GameLib::Azure };
 
 	std::vector<std::string> searchPaths{ "./assets", "../assets" };
+	// the first archive found is mapped and searched before the search paths
+	std::vector<std::string> archivePaths{ "./assets.pak", "../assets.pak" };
 	std::string worldPath{ "world.txt" };
 	Hf::StopWatch stopwatch;
+	GameLib::FramePacer pacer;
 	double spritesDrawn{ 0 };
 	double frames{ 0 };
 	float t0{ 0 };
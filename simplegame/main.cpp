@@ -15,8 +15,8 @@
 void testSprites(GameLib::Context& context,
 	int spriteCount,
 	int& spritesDrawn,
-	SDL_Texture* testPNG,
-	SDL_Texture* testJPG);
+	GameLib::ImageHandle testPNG,
+	GameLib::ImageHandle testJPG);
 
 
 
@@ -29,8 +29,8 @@ int main(int argc, char** argv) {
 void testSprites(GameLib::Context& context,
 	int spriteCount,
 	int& spritesDrawn,
-	SDL_Texture* testPNG,
-	SDL_Texture* testJPG) {
+	GameLib::ImageHandle testPNG,
+	GameLib::ImageHandle testJPG) {
 	// if (context.keyboard.scancodes[SDL_SCANCODE_ESCAPE]) {
 	//    context.quitRequested = true;
 	//}
@@ -0,0 +1,79 @@
+#include <gamelib_collision.hpp>
+#include <hatchetfish_stopwatch.hpp>
+#include <cstdio>
+#include <random>
+
+using namespace GameLib;
+
+// times one box against a few thousand, pair by pair and with the batched kernels
+int main(int argc, char** argv) {
+	constexpr size_t count = 4096;
+	constexpr int rounds = 2000;
+	std::mt19937 rng{ 487 };
+	std::uniform_real_distribution<float> position(-512.0f, 512.0f);
+	std::uniform_real_distribution<float> size(1.0f, 32.0f);
+
+	AABBArray boxes;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		boxes.push_back(p, p + glm::vec2{ size(rng), size(rng) });
+	}
+	std::vector<uint32_t> mask(boxes.maskWords());
+	std::vector<float> entry(count);
+	std::vector<float> normalX(count);
+	std::vector<float> normalY(count);
+	glm::vec2 s{ 16.0f, 16.0f };
+	glm::vec2 v{ 24.0f, -12.0f };
+
+	// the hit count is printed so the compiler cannot drop the loops
+	size_t hits = 0;
+	Hf::StopWatch stopwatch;
+	for (int r = 0; r < rounds; r++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		for (size_t i = 0; i < count; i++) {
+			bool hit;
+			sweptAABB(p, s, v, { boxes.minX[i], boxes.minY[i] }, { boxes.maxX[i], boxes.maxY[i] }, hit);
+			hits += hit;
+		}
+	}
+	double scalarMs = stopwatch.stop_ms();
+
+	stopwatch.start();
+	for (int r = 0; r < rounds; r++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		hits += sweptAABBs(p, s, v, boxes, mask.data(), entry.data());
+	}
+	double sweptMs = stopwatch.stop_ms();
+
+	stopwatch.start();
+	for (int r = 0; r < rounds; r++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		hits += broadPhaseAABBs(p, s, v, boxes, mask.data());
+	}
+	double broadMs = stopwatch.stop_ms();
+
+	stopwatch.start();
+	for (int r = 0; r < rounds; r++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		CONTACTINFO contact;
+		for (size_t i = 0; i < count; i++)
+			hits += contactAABB(p, p + s, { boxes.minX[i], boxes.minY[i] }, { boxes.maxX[i], boxes.maxY[i] }, contact);
+	}
+	double contactMs = stopwatch.stop_ms();
+
+	stopwatch.start();
+	for (int r = 0; r < rounds; r++) {
+		glm::vec2 p{ position(rng), position(rng) };
+		hits += contactAABBs(p, p + s, boxes, mask.data(), entry.data(), normalX.data(), normalY.data());
+	}
+	double contactsMs = stopwatch.stop_ms();
+
+	double pairs = (double)count * rounds;
+	printf("%zu boxes x %d rounds, %zu hits\n", count, rounds, hits);
+	printf("sweptAABB       %8.3f ms  %6.2f ns/pair\n", scalarMs, scalarMs * 1e6 / pairs);
+	printf("sweptAABBs      %8.3f ms  %6.2f ns/pair  (%s)\n", sweptMs, sweptMs * 1e6 / pairs, collisionKernelName());
+	printf("broadPhaseAABBs %8.3f ms  %6.2f ns/pair  (%s)\n", broadMs, broadMs * 1e6 / pairs, collisionKernelName());
+	printf("contactAABB     %8.3f ms  %6.2f ns/pair\n", contactMs, contactMs * 1e6 / pairs);
+	printf("contactAABBs    %8.3f ms  %6.2f ns/pair  (%s)\n", contactsMs, contactsMs * 1e6 / pairs, collisionKernelName());
+	return 0;
+}
@@ -0,0 +1,49 @@
+#include <gamelib_software_audio.hpp>
+#include <hatchetfish_stopwatch.hpp>
+#include <cstdio>
+#include <random>
+
+using namespace GameLib;
+
+// times mixing voices and finishing the mix, with the SIMD kernels and without
+int main(int argc, char** argv) {
+	// blocks of the default 1024 stereo frames, about 43 s of 48 kHz audio
+	constexpr size_t count = 2048;
+	constexpr int voices = 16;
+	constexpr int blocks = 2000;
+	std::mt19937 rng{ 487 };
+	std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+
+	std::vector<std::vector<float>> clips(voices, std::vector<float>(count));
+	for (auto& clip : clips) {
+		for (auto& s : clip)
+			s = sample(rng);
+	}
+	std::vector<float> buffer(count);
+	std::vector<int16_t> pcm(count);
+
+	// the clipped count is printed so the compiler cannot drop the loops
+	uint64_t clipped = 0;
+	Hf::StopWatch stopwatch;
+	for (int b = 0; b < blocks; b++) {
+		std::fill(buffer.begin(), buffer.end(), 0.0f);
+		for (int v = 0; v < voices; v++)
+			mixVoiceScalar(buffer.data(), clips[v].data(), count, 0.2f, 0.15f);
+		clipped += finishMixScalar(buffer.data(), count, 0.9f, pcm.data());
+	}
+	double scalarMs = stopwatch.stop_ms();
+
+	stopwatch.start();
+	for (int b = 0; b < blocks; b++) {
+		std::fill(buffer.begin(), buffer.end(), 0.0f);
+		for (int v = 0; v < voices; v++)
+			mixVoice(buffer.data(), clips[v].data(), count, 0.2f, 0.15f);
+		clipped += finishMix(buffer.data(), count, 0.9f, pcm.data());
+	}
+	double simdMs = stopwatch.stop_ms();
+
+	printf("%d blocks of %d voices, %zu samples each, %llu clipped\n", blocks, voices, count, (unsigned long long)clipped);
+	printf("scalar  %8.3f ms\n", scalarMs);
+	printf("%-7s %8.3f ms  %5.2fx\n", mixerKernelName(), simdMs, scalarMs / simdMs);
+	return 0;
+}
@@ -0,0 +1,69 @@
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <gamelib.hpp>
+#include <cstdio>
+
+// number of failed checks, each test returns it from main so ctest sees the failure
+inline int& testFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+// logs a failed condition with where it failed and keeps going so one run shows every failure
+#define CHECK(condition)                                                             \
+	do {                                                                             \
+		if (!(condition)) {                                                          \
+			testFailures()++;                                                        \
+			if (testFailures() <= 20)                                                \
+				printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		}                                                                            \
+	} while (0)
+
+// prints the result of a test, call at the end of main
+inline int testResult(const char* name) {
+	if (testFailures())
+		printf("%s: %d checks failed\n", name, testFailures());
+	else
+		printf("%s: passed\n", name);
+	return testFailures() ? 1 : 0;
+}
+
+// counts the overlap events an actor or trigger hears and keeps the counts in snapshots
+class CountingActorComponent : public GameLib::ActorComponent {
+public:
+	void beginOverlap(GameLib::Actor& a, GameLib::Actor& b) override { begins++; }
+	void endOverlap(GameLib::Actor& a, GameLib::Actor& b) override { ends++; }
+	void beginTriggerOverlap(GameLib::Actor& a, GameLib::Actor& b) override { begins++; }
+	void endTriggerOverlap(GameLib::Actor& a, GameLib::Actor& b) override { ends++; }
+
+	void writeState(const GameLib::Actor& actor, GameLib::SnapshotWriter& w) const override {
+		w.write(begins);
+		w.write(ends);
+	}
+	void readState(GameLib::Actor& actor, GameLib::SnapshotReader& r) override {
+		r.read(begins);
+		r.read(ends);
+	}
+
+	int begins{ 0 };
+	int ends{ 0 };
+};
+
+// an actor with simple physics and the counter it reports to
+struct ENTRY {
+	GameLib::ActorPtr actor;
+	std::shared_ptr<CountingActorComponent> counter;
+};
+
+inline ENTRY makeEntry(glm::vec2 p, glm::vec2 size) {
+	ENTRY e;
+	e.counter = std::make_shared<CountingActorComponent>();
+	e.actor = std::make_shared<GameLib::Actor>(nullptr, e.counter, std::make_shared<GameLib::SimplePhysicsComponent>(), nullptr);
+	e.actor->teleport({ p.x, p.y, 0.0f });
+	e.actor->size = { size.x, size.y, 1.0f };
+	e.actor->clipToWorld = false;
+	return e;
+}
+
+#endif
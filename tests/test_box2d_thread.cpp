@@ -0,0 +1,59 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace GameLib;
+
+namespace {
+	constexpr int Bodies = 16;
+	constexpr int Rounds = 400;
+
+	// bodies are far apart and there is no gravity, so each stays where it was made unless a command moves it
+	glm::vec2 spawnPosition(int id, int round) { return { 10.0f * id, 0.25f * round }; }
+} // namespace
+
+// bodies are destroyed and made again at the same index while the physics thread steps them
+int main(int argc, char** argv) {
+	Box2D box2d;
+	box2d.setGravity({ 0.0f, 0.0f });
+	std::vector<glm::vec2> spawns(Bodies);
+	for (int id = 0; id < Bodies; id++) {
+		spawns[id] = spawnPosition(id, 0);
+		CHECK(box2d.initBody(b2_dynamicBody, spawns[id], { 0.5f, 0.5f }, 1.0f, 0.0f) == id);
+	}
+	box2d.startThread(1.0f / 480.0f);
+	CHECK(box2d.threaded());
+
+	int reused = 0;
+	for (int round = 1; round <= Rounds; round++) {
+		int id = round % Bodies;
+		// commands for the old body are still queued when it is destroyed
+		box2d.setVelocity(id, b2_dynamicBody, { 50.0f, 50.0f });
+		box2d.setPosition(id, b2_dynamicBody, { -100.0f, -100.0f });
+		box2d.applyImpulse(id, b2_dynamicBody, { 10.0f, 0.0f });
+		box2d.destroyBody(id, b2_dynamicBody);
+		spawns[id] = spawnPosition(id, round);
+		int newId = box2d.initBody(b2_dynamicBody, spawns[id], { 0.5f, 0.5f }, 1.0f, 0.0f);
+		reused += newId == id ? 1 : 0;
+
+		// the new body never shows the old body's state or takes its commands
+		box2d.update(1.0f / 60.0f);
+		for (int i = 0; i < Bodies; i++) {
+			BODYSTATE state = box2d.bodyState(i, b2_dynamicBody);
+			CHECK(glm::length(state.position - spawns[i]) < 1e-4f);
+			CHECK(state.velocity == glm::vec2(0.0f, 0.0f));
+		}
+		if (round % 8 == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(reused == Rounds);
+
+	box2d.stopThread();
+	CHECK(!box2d.threaded());
+	for (int i = 0; i < Bodies; i++) {
+		CHECK(glm::length(box2d.getBody(i)->position() - spawns[i]) < 1e-4f);
+		CHECK(box2d.getBody(i)->velocity() == glm::vec2(0.0f, 0.0f));
+	}
+	return testResult("test_box2d_thread");
+}
@@ -0,0 +1,294 @@
+#include "test.hpp"
+#include <gamelib_collision.hpp>
+#include <limits>
+#include <random>
+
+using namespace GameLib;
+
+namespace {
+	// the per pair tests the physics components used before the batched kernels, kept as the reference
+	bool oracleCollides(glm::vec3 amin, glm::vec3 amax, glm::vec3 bmin, glm::vec3 bmax) {
+		bool overlapX = (amin.x <= bmax.x && amax.x >= bmin.x);
+		bool overlapY = (amin.y <= bmax.y && amax.y >= bmin.y);
+		bool overlapZ = (amin.z <= bmax.z && amax.z >= bmin.z);
+		return overlapX && overlapY && overlapZ;
+	}
+
+	bool oracleBroadPhase(glm::vec3 ap, glm::vec3 as, glm::vec3 av, glm::vec3 bp, glm::vec3 bs) {
+		glm::vec3 amin;
+		amin.x = av.x > 0 ? ap.x : ap.x + av.x;
+		amin.y = av.y > 0 ? ap.y : ap.y + av.y;
+		amin.z = av.z > 0 ? ap.z : ap.z + av.z;
+		glm::vec3 asize;
+		asize.x = av.x > 0 ? as.x + av.x : as.x - av.x;
+		asize.y = av.y > 0 ? as.y + av.y : as.y - av.y;
+		asize.z = av.z > 0 ? as.z + av.z : as.z - av.z;
+		return oracleCollides(amin, amin + asize, bp, bp + bs);
+	}
+
+	float oracleSwept(glm::vec3 ap, glm::vec3 as, glm::vec3 av, glm::vec3 bp, glm::vec3 bs, glm::vec3& normal) {
+		glm::vec3 inverseEnter;
+		glm::vec3 inverseLeave;
+		glm::vec3 ap1 = ap;
+		glm::vec3 ap2 = ap + as;
+		glm::vec3 bp1 = bp;
+		glm::vec3 bp2 = bp + bs;
+
+		if (av.x > 0.0f) {
+			inverseEnter.x = bp1.x - ap2.x;
+			inverseLeave.x = bp2.x - ap1.x;
+		} else {
+			inverseEnter.x = bp2.x - ap1.x;
+			inverseLeave.x = bp1.x - ap2.x;
+		}
+
+		if (av.y > 0.0f) {
+			inverseEnter.y = bp1.y - ap2.y;
+			inverseLeave.y = bp2.y - ap1.y;
+		} else {
+			inverseEnter.y = bp2.y - ap1.y;
+			inverseLeave.y = bp1.y - ap2.y;
+		}
+
+		glm::vec3 enter;
+		glm::vec3 leave;
+		constexpr float inf = std::numeric_limits<float>::infinity();
+
+		if (av.x == 0.0f) {
+			enter.x = -inf;
+			leave.x = inf;
+		} else {
+			enter.x = inverseEnter.x / av.x;
+			leave.x = inverseLeave.x / av.x;
+		}
+
+		if (av.y == 0.0f) {
+			enter.y = -inf;
+			leave.y = inf;
+		} else {
+			enter.y = inverseEnter.y / av.y;
+			leave.y = inverseLeave.y / av.y;
+		}
+
+		float enterTime = std::max(enter.x, enter.y);
+		float leaveTime = std::min(leave.x, leave.y);
+		normal = { 0.0f, 0.0f, 0.0f };
+		if (enterTime > leaveTime)
+			return 1.0f;
+		if (enter.x < 0.0f && enter.y < 0.0f)
+			return 1.0f;
+		if (enter.x < 0.0f) {
+			if (ap2.x < bp1.x || ap1.x > bp2.x)
+				return 1.0f;
+		}
+		if (enter.y < 0.0f) {
+			if (ap2.y < bp1.y || ap1.y > bp2.y)
+				return 1.0f;
+		}
+
+		if (enter.x > enter.y) {
+			normal = { inverseEnter.x < 0.0f ? 1.0f : -1.0f, 0.0f, 0.0f };
+		} else {
+			normal = { 0.0f, inverseEnter.y < 0.0f ? 1.0f : -1.0f, 0.0f };
+		}
+		return enterTime;
+	}
+
+	// the distance from p to box b found by measuring to every face, negative inside
+	float oracleDistance(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax) {
+		if (overlapAABB(p, p, bmin, bmax))
+			return -std::min(std::min(p.x - bmin.x, bmax.x - p.x), std::min(p.y - bmin.y, bmax.y - p.y));
+		return glm::length(p - closestPointAABB(p, bmin, bmax));
+	}
+
+	// the normal of the face of box b nearest to p, faces on the y axis win ties like normalAABB()
+	glm::vec2 oracleNormal(glm::vec2 p, glm::vec2 bmin, glm::vec2 bmax) {
+		if (!overlapAABB(p, p, bmin, bmax))
+			return glm::normalize(p - closestPointAABB(p, bmin, bmax));
+		float faceX = std::min(p.x - bmin.x, bmax.x - p.x);
+		float faceY = std::min(p.y - bmin.y, bmax.y - p.y);
+		if (faceX < faceY)
+			return { bmax.x - p.x <= p.x - bmin.x ? 1.0f : -1.0f, 0.0f };
+		return { 0.0f, bmax.y - p.y <= p.y - bmin.y ? 1.0f : -1.0f };
+	}
+
+	bool near(glm::vec2 a, glm::vec2 b) { return glm::length(a - b) <= 1e-3f; }
+
+	// the first point of box b on the segment from p to q, found by trying every place the segment
+	// crosses a face and keeping the earliest one that lies on the box
+	glm::vec2 oracleSupport(glm::vec2 p, glm::vec2 q, glm::vec2 bmin, glm::vec2 bmax) {
+		glm::vec2 d = q - p;
+		float best = 2.0f;
+		float times[5] = { 0.0f, 2.0f, 2.0f, 2.0f, 2.0f };
+		if (d.x != 0.0f) {
+			times[1] = (bmin.x - p.x) / d.x;
+			times[2] = (bmax.x - p.x) / d.x;
+		}
+		if (d.y != 0.0f) {
+			times[3] = (bmin.y - p.y) / d.y;
+			times[4] = (bmax.y - p.y) / d.y;
+		}
+		for (float t : times) {
+			glm::vec2 x = p + d * t;
+			if (t >= 0.0f && t <= 1.0f && t < best && overlapAABB(x, x, bmin - 1e-3f, bmax + 1e-3f))
+				best = t;
+		}
+		return best > 1.0f ? q : p + d * best;
+	}
+
+	// checks the contact between two boxes against the gaps and depths measured on each axis
+	void checkContact(glm::vec2 amin, glm::vec2 amax, glm::vec2 bmin, glm::vec2 bmax, const CONTACTINFO& contact, bool overlap) {
+		CHECK(overlap == overlapAABB(amin, amax, bmin, bmax));
+		// the closest points lie on their boxes
+		CHECK(overlapAABB(contact.pointA, contact.pointA, amin - 1e-3f, amax + 1e-3f));
+		CHECK(overlapAABB(contact.pointB, contact.pointB, bmin - 1e-3f, bmax + 1e-3f));
+		glm::vec2 dir{ (bmin.x + bmax.x) >= (amin.x + amax.x) ? 1.0f : -1.0f, (bmin.y + bmax.y) >= (amin.y + amax.y) ? 1.0f : -1.0f };
+		if (overlap) {
+			float depthX = std::min(amax.x - bmin.x, bmax.x - amin.x);
+			float depthY = std::min(amax.y - bmin.y, bmax.y - amin.y);
+			CHECK(contact.distance == -std::min(depthX, depthY));
+			glm::vec2 normal = depthX < depthY ? glm::vec2{ dir.x, 0.0f } : glm::vec2{ 0.0f, dir.y };
+			CHECK(contact.normal == normal);
+		} else {
+			glm::vec2 gap{ std::max(0.0f, std::max(bmin.x - amax.x, amin.x - bmax.x)),
+						   std::max(0.0f, std::max(bmin.y - amax.y, amin.y - bmax.y)) };
+			CHECK(std::abs(contact.distance - glm::length(gap)) <= 1e-3f);
+			CHECK(std::abs(glm::length(contact.pointB - contact.pointA) - contact.distance) <= 1e-3f);
+			CHECK(near(contact.normal, glm::normalize(contact.pointB - contact.pointA)));
+		}
+	}
+
+	glm::vec3 to3d(glm::vec2 v, float z) { return { v.x, v.y, z }; }
+
+	// positions and sizes on a quarter grid so edges touch often, sizes that are not multiples of 8
+	// and velocities that are often zero on an axis exercise the edge cases of every kernel
+	struct BOXGEN {
+		std::mt19937 rng{ 487 };
+
+		float grid(int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng) * 0.25f; }
+		glm::vec2 position() { return { grid(-128, 128), grid(-128, 128) }; }
+		glm::vec2 size() { return { grid(1, 80), grid(1, 80) }; }
+		float speed() { return std::uniform_int_distribution<int>(0, 4)(rng) ? grid(-64, 64) : 0.0f; }
+		glm::vec2 velocity() { return { speed(), speed() }; }
+	};
+
+	void testBatch(BOXGEN& gen, size_t count) {
+		AABBArray boxes;
+		std::vector<glm::vec2> bmin;
+		std::vector<glm::vec2> bmax;
+		for (size_t i = 0; i < count; i++) {
+			glm::vec2 p = gen.position();
+			bmin.push_back(p);
+			bmax.push_back(p + gen.size());
+			boxes.push_back(bmin.back(), bmax.back());
+		}
+		std::vector<uint32_t> mask(boxes.maskWords() + 1, 0xdeadbeef);
+		std::vector<float> entry(count + 1, -2.0f);
+
+		glm::vec2 p = gen.position();
+		glm::vec2 s = gen.size();
+		glm::vec2 v = gen.velocity();
+
+		int hits = overlapAABBs(p, p + s, boxes, mask.data());
+		int expected = 0;
+		for (size_t i = 0; i < count; i++) {
+			bool hit = oracleCollides(to3d(p, 0), to3d(p + s, 1), to3d(bmin[i], 0), to3d(bmax[i], 1));
+			CHECK(testHit(mask.data(), i) == hit);
+			CHECK(overlapAABB(p, p + s, bmin[i], bmax[i]) == hit);
+			expected += hit;
+		}
+		CHECK(hits == expected);
+		// bits past the last box are clear and the word past the mask is untouched
+		for (size_t i = count; i < boxes.maskWords() * 32; i++)
+			CHECK(!testHit(mask.data(), i));
+		CHECK(mask[boxes.maskWords()] == 0xdeadbeef);
+
+		// a run of the boxes is tested the same way, with bit 0 for its first box
+		size_t first = count ? std::uniform_int_distribution<size_t>(0, count)(gen.rng) : 0;
+		size_t last = count ? std::uniform_int_distribution<size_t>(first, count)(gen.rng) : 0;
+		std::vector<uint32_t> runMask(((last - first + 31) >> 5) + 1, 0xdeadbeef);
+		hits = overlapAABBs(p, p + s, boxes, first, last, runMask.data());
+		expected = 0;
+		for (size_t i = first; i < last; i++) {
+			CHECK(testHit(runMask.data(), i - first) == testHit(mask.data(), i));
+			expected += testHit(mask.data(), i);
+		}
+		CHECK(hits == expected);
+		for (size_t i = last - first; i < ((last - first + 31) >> 5) * 32; i++)
+			CHECK(!testHit(runMask.data(), i));
+		CHECK(runMask.back() == 0xdeadbeef);
+
+		hits = broadPhaseAABBs(p, s, v, boxes, mask.data());
+		expected = 0;
+		for (size_t i = 0; i < count; i++) {
+			bool hit = oracleBroadPhase(to3d(p, 0), to3d(s, 1), to3d(v, 0), to3d(bmin[i], 0), to3d(bmax[i] - bmin[i], 1));
+			CHECK(testHit(mask.data(), i) == hit);
+			CHECK(broadPhaseAABB(p, s, v, bmin[i], bmax[i]) == hit);
+			expected += hit;
+		}
+		CHECK(hits == expected);
+
+		hits = sweptAABBs(p, s, v, boxes, mask.data(), entry.data());
+		expected = 0;
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 oracleNormal;
+			float t = oracleSwept(to3d(p, 0), to3d(s, 1), to3d(v, 0), to3d(bmin[i], 0), to3d(bmax[i] - bmin[i], 1), oracleNormal);
+			bool hit = oracleNormal != glm::vec3(0.0f);
+			CHECK(testHit(mask.data(), i) == hit);
+			CHECK(entry[i] == t);
+
+			glm::vec2 normal;
+			bool scalarHit;
+			float scalarT = sweptAABB(p, s, v, bmin[i], bmax[i], normal, scalarHit);
+			CHECK(scalarHit == hit);
+			CHECK(scalarT == t);
+			CHECK(normal.x == oracleNormal.x && normal.y == oracleNormal.y);
+			expected += hit;
+		}
+		CHECK(hits == expected);
+		CHECK(entry[count] == -2.0f);
+
+		std::vector<float> distance(count + 1, -2.0f);
+		std::vector<float> normalX(count + 1, -2.0f);
+		std::vector<float> normalY(count + 1, -2.0f);
+		hits = contactAABBs(p, p + s, boxes, mask.data(), distance.data(), normalX.data(), normalY.data());
+		expected = 0;
+		for (size_t i = 0; i < count; i++) {
+			CONTACTINFO contact;
+			bool hit = contactAABB(p, p + s, bmin[i], bmax[i], contact);
+			checkContact(p, p + s, bmin[i], bmax[i], contact, hit);
+			// the batched kernels match the per pair query exactly
+			CHECK(testHit(mask.data(), i) == hit);
+			CHECK(distance[i] == contact.distance);
+			CHECK(normalX[i] == contact.normal.x && normalY[i] == contact.normal.y);
+			expected += hit;
+		}
+		CHECK(hits == expected);
+		CHECK(distance[count] == -2.0f && normalX[count] == -2.0f && normalY[count] == -2.0f);
+	}
+	// the point queries against single boxes, with points inside, outside and on the edges
+	void testPoints(BOXGEN& gen) {
+		glm::vec2 bmin = gen.position();
+		glm::vec2 bmax = bmin + gen.size();
+		glm::vec2 p = gen.position() * 0.25f + bmin;
+		glm::vec2 q = gen.position();
+		CHECK(std::abs(distanceAABB(p, bmin, bmax) - oracleDistance(p, bmin, bmax)) <= 1e-3f);
+		CHECK(near(normalAABB(p, bmin, bmax), oracleNormal(p, bmin, bmax)));
+		CHECK(near(supportAABB(p, q, bmin, bmax), oracleSupport(p, q, bmin, bmax)));
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	printf("collision kernels: %s\n", collisionKernelName());
+	BOXGEN gen;
+	// every count up to a few SIMD widths covers the vector loops and every tail length
+	for (int round = 0; round < 200; round++) {
+		for (size_t count = 0; count <= 40; count++)
+			testBatch(gen, count);
+	}
+	for (int round = 0; round < 50; round++)
+		testBatch(gen, 1000);
+	for (int round = 0; round < 20000; round++)
+		testPoints(gen);
+	return testResult("test_collision");
+}
@@ -0,0 +1,135 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <cmath>
+
+using namespace GameLib;
+
+namespace {
+	constexpr float Step = 1.0f / 60.0f;
+	constexpr int Steps = 400;
+	constexpr int Lanes = 6;
+
+	// the same actors and triggers in a world of their own with its own Box2D
+	// actors move along lanes of triggers and stop a tenth of a tile apart, so edges never nearly touch
+	// and Box2D's skin around its boxes cannot make the two ways disagree
+	struct SCENE {
+		Box2D box2d;
+		World world;
+		std::vector<ENTRY> actors;
+		std::vector<ENTRY> statics;
+		std::vector<ENTRY> triggers;
+
+		SCENE(bool contactEvents) {
+			Locator::provide(&box2d);
+			box2d.setGravity({ 0.0f, 0.0f });
+			world.useContactEvents = contactEvents;
+			for (int lane = 0; lane < Lanes; lane++) {
+				for (int k = 0; k < 8; k++) {
+					triggers.push_back(makeEntry({ 3.0f * k, 3.0f * lane }, { k % 3 ? 1.0f : 2.0f, 1.0f }));
+					world.addTriggerActor(triggers.back().actor);
+				}
+				actors.push_back(makeEntry(actorPosition(lane, 0), { 1.0f, 1.0f }));
+				world.addDynamicActor(actors.back().actor);
+			}
+			// static actors have lanes of their own with one trigger, one of them starts on it
+			for (int i = 0; i < 2; i++) {
+				float y = 3.0f * (Lanes + i);
+				triggers.push_back(makeEntry({ 3.0f, y }, { 1.0f, 1.0f }));
+				world.addTriggerActor(triggers.back().actor);
+				statics.push_back(makeEntry(staticPosition(i, 0), { 1.0f, 1.0f }));
+				world.addStaticActor(statics.back().actor);
+			}
+			world.start(0.0f);
+		}
+
+		static glm::vec2 actorPosition(int lane, int step) {
+			int tenths = (step + 7 * lane) % 240;
+			return { 0.05f + tenths * 0.1f, 3.0f * lane + 0.5f };
+		}
+
+		static glm::vec2 staticPosition(int i, int step) {
+			bool onTrigger = ((step / 40) + i) % 2 == 0;
+			return { onTrigger ? 3.5f : 10.5f, 3.0f * (Lanes + i) + 0.25f };
+		}
+
+		void step(int s) {
+			Locator::provide(&box2d);
+			for (int lane = 0; lane < Lanes; lane++) {
+				glm::vec2 p = actorPosition(lane, s);
+				actors[lane].actor->teleport({ p.x, p.y, 0.0f });
+			}
+			for (int i = 0; i < (int)statics.size(); i++) {
+				glm::vec2 p = staticPosition(i, s);
+				statics[i].actor->teleport({ p.x, p.y, 0.0f });
+			}
+			world.update(Step);
+			world.physics(Step);
+		}
+
+		// the index in triggers of the trigger with the id
+		int triggerIndex(unsigned id) const {
+			for (int i = 0; i < (int)triggers.size(); i++) {
+				if (triggers[i].actor->getId() == id)
+					return i;
+			}
+			return -1;
+		}
+
+		std::vector<int> overlapsOf(const Actor& a) const {
+			std::vector<int> overlaps;
+			for (auto& o : a.triggerInfo.overlaps)
+				overlaps.push_back(triggerIndex(o.id));
+			std::sort(overlaps.begin(), overlaps.end());
+			return overlaps;
+		}
+	};
+
+	// the contact event world must hear the same events and cache the same overlaps as the overlap cache world
+	void compare(const SCENE& events, const SCENE& cache, int step) {
+		auto compareEntries = [&](const std::vector<ENTRY>& a, const std::vector<ENTRY>& b) {
+			for (size_t i = 0; i < a.size(); i++) {
+				CHECK(a[i].counter->begins == b[i].counter->begins);
+				CHECK(a[i].counter->ends == b[i].counter->ends);
+				CHECK(events.overlapsOf(*a[i].actor) == cache.overlapsOf(*b[i].actor));
+				CHECK(a[i].actor->triggerInfo.overlapCount == b[i].actor->triggerInfo.overlapCount);
+				CHECK(a[i].actor->triggerInfo.overlapping == b[i].actor->triggerInfo.overlapping);
+			}
+		};
+		int failures = testFailures();
+		compareEntries(events.actors, cache.actors);
+		compareEntries(events.statics, cache.statics);
+		compareEntries(events.triggers, cache.triggers);
+		if (testFailures() != failures)
+			printf("step %d differs\n", step);
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	SCENE events(true);
+	SCENE cache(false);
+	for (int s = 1; s <= Steps; s++) {
+		// an actor and a trigger leave while overlapping, ending their overlaps once
+		if (s == 150 || s == 250) {
+			for (SCENE* scene : { &events, &cache }) {
+				Locator::provide(&scene->box2d);
+				ENTRY& leaving = s == 150 ? scene->actors[0] : scene->triggers[Lanes * 8];
+				CHECK(leaving.actor->triggerInfo.overlapping);
+				scene->world.removeActor(leaving.actor->getId());
+				CHECK(leaving.counter->begins == leaving.counter->ends);
+			}
+		}
+		events.step(s);
+		cache.step(s);
+		compare(events, cache, s);
+	}
+
+	int begins = 0;
+	for (auto& a : events.actors)
+		begins += a.counter->begins;
+	printf("%d overlaps began on the lanes, %d on static actors\n", begins, events.statics[0].counter->begins + events.statics[1].counter->begins);
+	CHECK(begins > 50);
+	// static bodies never touch static sensors in Box2D, the overlap cache finds these
+	CHECK(events.statics[0].counter->begins > 1 && events.statics[1].counter->begins > 1);
+	Locator::provide((Box2D*)nullptr);
+	return testResult("test_contact_events");
+}
@@ -0,0 +1,79 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <cmath>
+#include <random>
+#include "CollisionPhysicsComponent.hpp"
+#include "PhysicsTimer.hpp"
+
+using namespace GameLib;
+
+namespace {
+	constexpr float Step = 1.0f / 60.0f;
+	constexpr int Steps = 600;
+
+	// the deepest any runner sits inside a column, the push out should keep this near zero
+	float deepestPenetration(const std::vector<ActorPtr>& runners, const std::vector<ActorPtr>& columns) {
+		float deepest = 0.0f;
+		for (auto& r : runners) {
+			for (auto& c : columns) {
+				CONTACTINFO contact;
+				if (r->contact(*c, contact))
+					deepest = std::max(deepest, -contact.distance);
+			}
+		}
+		return deepest;
+	}
+} // namespace
+
+// the gingerrun -stress scene without a window: a row of immovable columns and runners falling onto it
+int main(int argc, char** argv) {
+	World world;
+	std::mt19937 rng{ 487 };
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> normal;
+
+	std::vector<ActorPtr> columns;
+	for (int i = 0; i < world.worldSizeX; i++) {
+		auto column = makeActor("column", nullptr, std::make_shared<ActorComponent>(), std::make_shared<SimplePhysicsComponent>(), nullptr);
+		column->clipToWorld = false;
+		column->position = { (float)i, (float)world.worldSizeY - 1, 0.0f };
+		column->movable = false;
+		columns.push_back(column);
+		world.addDynamicActor(column);
+	}
+	std::vector<ActorPtr> runners;
+	for (int i = 0; i < 256; i++) {
+		auto runner = makeActor("runner", nullptr, std::make_shared<ActorComponent>(), std::make_shared<CollisionPhysicsComponent>(), nullptr);
+		runner->position = { unit(rng) * (world.worldSizeX - 1), unit(rng) * (world.worldSizeY - 2), 0.0f };
+		runner->velocity.x = normal(rng) * 4.0f;
+		runners.push_back(runner);
+		world.addDynamicActor(runner);
+	}
+
+	// a run that ends before its first frame has no average to report
+	PhysicsTimer timer;
+	CHECK(timer.frames() == 0 && timer.msPerFrame() == 0.0);
+
+	world.start(0.0f);
+	for (int step = 0; step < Steps; step++) {
+		world.update(Step);
+		timer.start();
+		world.physics(Step);
+		timer.stop();
+	}
+	printf("%d steps, physics %.3f ms/frame\n", Steps, timer.msPerFrame());
+	CHECK(timer.frames() == Steps);
+	CHECK(timer.msPerFrame() > 0.0 && std::isfinite(timer.msPerFrame()));
+
+	// every runner is still in the world and resting on or between the columns, not inside them
+	// runners pushed apart after clipping may stick out of the world by part of a tile
+	for (auto& r : runners) {
+		CHECK(std::isfinite(r->position.x) && std::isfinite(r->position.y));
+		CHECK(r->position.x >= -0.5f && r->position.x <= world.worldSizeX - r->size.x + 0.5f);
+		CHECK(r->position.y >= -0.5f && r->position.y <= world.worldSizeY - r->size.y + 0.5f);
+	}
+	float deepest = deepestPenetration(runners, columns);
+	printf("deepest penetration into a column %.4f\n", deepest);
+	CHECK(deepest < 0.25f);
+	return testResult("test_gingerrun_physics");
+}
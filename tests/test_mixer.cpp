@@ -0,0 +1,71 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <cmath>
+#include <random>
+
+using namespace GameLib;
+
+namespace {
+	// an odd count leaves a tail for every kernel width to finish without SIMD
+	constexpr size_t Count = 4099;
+} // namespace
+
+// the SIMD kernels must give the samples the scalar ones give
+int main(int argc, char** argv) {
+	printf("mixer kernels: %s\n", mixerKernelName());
+	std::mt19937 rng{ 487 };
+	std::uniform_real_distribution<float> sample(-1.5f, 1.5f);
+
+	// mixing stereo voices, even counts only, compilers may fuse the scalar multiply and add so a rounding apart is allowed
+	std::vector<float> src(Count + 1);
+	std::vector<float> simd(Count + 1);
+	for (size_t i = 0; i < src.size(); i++) {
+		src[i] = sample(rng);
+		simd[i] = sample(rng);
+	}
+	std::vector<float> scalar = simd;
+	for (size_t count : { (size_t)2, (size_t)6, (size_t)14, Count + 1 }) {
+		mixVoice(simd.data(), src.data(), count, 0.75f, -0.3f);
+		mixVoiceScalar(scalar.data(), src.data(), count, 0.75f, -0.3f);
+	}
+	int mixed = 0;
+	for (size_t i = 0; i < simd.size(); i++)
+		mixed += std::abs(simd[i] - scalar[i]) <= 1e-6f * std::max(1.0f, std::abs(scalar[i])) ? 1 : 0;
+	CHECK(mixed == (int)simd.size());
+
+	// finishing the mix, with samples that land exactly halfway between two 16 bit steps
+	std::vector<float> samples(Count);
+	int ties = 0;
+	for (size_t i = 0; i < Count; i++) {
+		if (i % 3) {
+			samples[i] = sample(rng);
+			continue;
+		}
+		// look a few floats around k + 0.5 steps for one that scales to it exactly
+		float k = (float)((int)(rng() % 65534) - 32767) + 0.5f;
+		float s = k / 32767.0f;
+		for (int step = 0; step < 8 && s * 32767.0f != k; step++)
+			s = std::nextafter(s, s * 32767.0f < k ? 2.0f : -2.0f);
+		ties += s * 32767.0f == k ? 1 : 0;
+		samples[i] = s;
+	}
+	printf("%d samples land halfway between steps\n", ties);
+	CHECK(ties > 100);
+	for (float volume : { 1.0f, 0.8f, 1.7f }) {
+		std::vector<float> simdSamples = samples;
+		std::vector<float> scalarSamples = samples;
+		std::vector<int16_t> simdPcm(Count);
+		std::vector<int16_t> scalarPcm(Count);
+		uint64_t simdClipped = finishMix(simdSamples.data(), Count, volume, simdPcm.data());
+		uint64_t scalarClipped = finishMixScalar(scalarSamples.data(), Count, volume, scalarPcm.data());
+		CHECK(simdClipped == scalarClipped);
+		CHECK(simdClipped > 0);
+		CHECK(simdSamples == scalarSamples);
+		CHECK(simdPcm == scalarPcm);
+		// without pcm only the samples are finished
+		std::vector<float> unwritten = samples;
+		CHECK(finishMix(unwritten.data(), Count, volume, nullptr) == scalarClipped);
+		CHECK(unwritten == scalarSamples);
+	}
+	return testResult("test_mixer");
+}
@@ -0,0 +1,108 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace GameLib;
+
+namespace {
+	constexpr float Step = 1.0f / 60.0f;
+	constexpr int Actors = 60;
+
+	ActorPtr makeMover(glm::vec2 p, glm::vec2 v) {
+		ActorPtr a = makeEntry(p, { 1.0f, 1.0f }).actor;
+		a->velocity = { v.x, v.y, 0.0f };
+		return a;
+	}
+
+	// ids of the actors in a world, sorted
+	std::vector<unsigned> actorIds(const World& world) {
+		std::vector<unsigned> ids;
+		for (auto* actors : { &world.dynamicActors, &world.staticActors, &world.triggerActors }) {
+			for (auto& a : *actors)
+				ids.push_back(a->getId());
+		}
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+} // namespace
+
+// a client over inproc:// with latency, jitter and loss ends up showing what the server has
+int main(int argc, char** argv) {
+	World serverWorld;
+	World clientWorld;
+	NetServer server(serverWorld);
+	NetClient client(clientWorld);
+	// a budget of a few actors a tick, so most states leave actors waiting
+	server.bandwidth = 4000;
+	NETCONDITIONS conditions;
+	conditions.latency = 40.0f;
+	conditions.jitter = 20.0f;
+	conditions.loss = 0.1f;
+
+	for (int i = 0; i < Actors; i++)
+		serverWorld.addDynamicActor(makeMover({ 5.0f + (i % 10) * 8.0f, 5.0f + (i / 10) * 8.0f }, { 1.0f + i % 3, 0.5f * (i % 4) }));
+	// these stay for the whole run, so the client must never lose them once it has them
+	std::vector<unsigned> kept;
+	for (int i = 0; i < Actors / 2; i++)
+		kept.push_back(serverWorld.dynamicActors[i]->getId());
+
+	CHECK(server.start("inproc://net-test"));
+	CHECK(client.connect("inproc://net-test"));
+	server.socket().setConditions(conditions);
+	conditions.seed++;
+	client.socket().setConditions(conditions);
+
+	int lost = 0;
+	auto frame = [&](bool moving) {
+		if (moving) {
+			for (auto& a : serverWorld.dynamicActors)
+				a->position += a->velocity * Step;
+		}
+		server.update(Step);
+		client.update(Step, { 40.0f, 20.0f });
+		if (client.hasState()) {
+			for (unsigned id : kept)
+				lost += clientWorld.getActor(id) ? 0 : 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(4));
+	};
+
+	for (int f = 0; f < 180; f++) {
+		// actors come and go on the server
+		if (f % 30 == 15) {
+			serverWorld.removeActor(serverWorld.dynamicActors.back()->getId());
+			serverWorld.addDynamicActor(makeMover({ 2.0f * (f / 30), 70.0f }, { 2.0f, 0.0f }));
+		}
+		frame(true);
+	}
+	CHECK(client.hasState());
+
+	// the client hears nothing for longer than a baseline is kept, so the next state carries everything
+	NETCONDITIONS silent = conditions;
+	silent.loss = 1.0f;
+	client.socket().setConditions(silent);
+	for (int f = 0; f < 150; f++)
+		frame(true);
+	client.socket().setConditions(conditions);
+	for (int f = 0; f < 120; f++)
+		frame(true);
+
+	// once the actors stop the client catches up to exactly where they are
+	for (int f = 0; f < 120; f++)
+		frame(false);
+	server.logStats();
+	client.logStats();
+	CHECK(lost == 0);
+	CHECK(client.statesReceived() > 20);
+	CHECK(actorIds(clientWorld) == actorIds(serverWorld));
+	for (auto& a : serverWorld.dynamicActors) {
+		ActorPtr shown = clientWorld.getActor(a->getId());
+		CHECK(shown && glm::length(shown->position2d() - a->position2d()) < 1e-4f);
+	}
+
+	client.disconnect();
+	CHECK(clientWorld.dynamicActors.empty());
+	server.stop();
+	return testResult("test_net");
+}
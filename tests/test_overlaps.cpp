@@ -0,0 +1,90 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <random>
+
+using namespace GameLib;
+
+namespace {
+	bool cached(const Actor& a, unsigned id) {
+		for (auto& o : a.triggerInfo.overlaps) {
+			if (o.id == id)
+				return true;
+		}
+		return false;
+	}
+
+	// the cached overlaps and the events heard must agree with testing every actor against every trigger
+	void checkOverlaps(World& world, std::vector<ENTRY>& actors, std::vector<ENTRY>& triggers) {
+		for (auto& a : actors) {
+			int expected = 0;
+			for (auto& t : triggers) {
+				bool overlap = collides(*a.actor, *t.actor);
+				CHECK(cached(*a.actor, t.actor->getId()) == overlap);
+				expected += overlap;
+			}
+			CHECK((int)a.actor->triggerInfo.overlaps.size() == expected);
+			CHECK(a.counter->begins - a.counter->ends == expected);
+			CHECK(std::is_sorted(a.actor->triggerInfo.overlaps.begin(), a.actor->triggerInfo.overlaps.end()));
+		}
+		for (auto& t : triggers) {
+			int expected = 0;
+			for (auto& a : actors)
+				expected += collides(*a.actor, *t.actor);
+			CHECK(t.actor->triggerInfo.overlapCount == expected);
+			CHECK(t.counter->begins - t.counter->ends == expected);
+		}
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	World world;
+	std::mt19937 rng{ 487 };
+	std::uniform_int_distribution<int> coordinate(0, 160);
+	auto place = [&](Actor& a) { a.position = { coordinate(rng) * 0.25f, coordinate(rng) * 0.25f, 0.0f }; };
+
+	std::vector<ENTRY> actors;
+	std::vector<ENTRY> triggers;
+	for (int i = 0; i < 60; i++) {
+		actors.push_back(makeEntry({ 0.0f, 0.0f }, { 2.0f, 2.0f }));
+		place(*actors.back().actor);
+		world.addDynamicActor(actors.back().actor);
+	}
+	for (int i = 0; i < 70; i++) {
+		triggers.push_back(makeEntry({ 0.0f, 0.0f }, { 2.0f, 2.0f }));
+		// a few wide triggers reach past many that start after them
+		if (i % 10 == 0)
+			triggers.back().actor->size.x = 12.0f;
+		place(*triggers.back().actor);
+		world.addTriggerActor(triggers.back().actor);
+	}
+
+	for (int step = 0; step < 200; step++) {
+		// actors jump around and some triggers move between steps
+		for (auto& a : actors)
+			place(*a.actor);
+		for (auto& t : triggers) {
+			if (coordinate(rng) < 16)
+				place(*t.actor);
+		}
+		world.physics(1.0f / 60.0f);
+		checkOverlaps(world, actors, triggers);
+
+		// removing either side of an overlap ends it
+		if (step % 20 == 10) {
+			ENTRY t = triggers.back();
+			triggers.pop_back();
+			world.removeActor(t.actor->getId());
+			CHECK(t.actor->triggerInfo.overlapCount == 0);
+			CHECK(t.counter->begins == t.counter->ends);
+			checkOverlaps(world, actors, triggers);
+
+			ENTRY a = actors.back();
+			actors.pop_back();
+			world.removeActor(a.actor->getId());
+			CHECK(a.actor->triggerInfo.overlaps.empty());
+			CHECK(a.counter->begins == a.counter->ends);
+			checkOverlaps(world, actors, triggers);
+		}
+	}
+	return testResult("test_overlaps");
+}
@@ -0,0 +1,130 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <random>
+
+using namespace GameLib;
+
+namespace {
+	// actors scattered over part of the world, half of them with Box2D bodies and half without
+	struct SCENE {
+		std::vector<ActorPtr> actors;
+		int bodies{ 0 };
+
+		void build(World& world, unsigned seed) {
+			std::mt19937 rng{ seed };
+			std::uniform_real_distribution<float> place(1.0f, 40.0f);
+			for (int i = 0; i < 160; i++) {
+				// actors without a physics component get no body
+				std::shared_ptr<PhysicsComponent> physics;
+				if (i % 2 == 0)
+					physics = std::make_shared<SimplePhysicsComponent>();
+				auto a = std::make_shared<Actor>(nullptr, std::make_shared<ActorComponent>(), physics, nullptr);
+				a->teleport({ place(rng), place(rng), 0.0f });
+				a->size = { 0.5f + (i % 3) * 0.5f, 1.0f, 1.0f };
+				a->clipToWorld = false;
+				if (i % 5 == 0)
+					world.addTriggerActor(a);
+				else if (i % 5 == 1)
+					world.addStaticActor(a);
+				else
+					world.addDynamicActor(a);
+				actors.push_back(a);
+			}
+			world.start(0.0f);
+			for (auto& a : actors)
+				bodies += a->box2dId >= 0 ? 1 : 0;
+		}
+
+		std::vector<unsigned> bruteQuery(glm::vec2 lower, glm::vec2 upper) const {
+			std::vector<unsigned> ids;
+			for (auto& a : actors) {
+				if (overlapAABB(lower, upper, a->position2d(), a->position2d() + a->size2d()))
+					ids.push_back(a->getId());
+			}
+			std::sort(ids.begin(), ids.end());
+			return ids;
+		}
+
+		float bruteRaycast(const World& world, glm::vec2 p1, glm::vec2 p2) const {
+			glm::vec2 d = p2 - p1;
+			float t = 1.0f;
+			TILEHIT tileHit;
+			if (world.sweepTiles(p1, { 0.0f, 0.0f }, d, tileHit))
+				t = tileHit.t;
+			for (auto& a : actors) {
+				if (a->isTrigger())
+					continue;
+				bool entered;
+				float at = sweptAABB(p1, { 0.0f, 0.0f }, d, a->position2d(), a->position2d() + a->size2d(), entered);
+				if (entered && at >= 0.0f && at < t)
+					t = at;
+			}
+			return t;
+		}
+	};
+
+	// every query must find what testing each actor finds, whether or not the actor has a body
+	void checkQueries(const World& world, const SCENE& scene) {
+		std::mt19937 rng{ 31 };
+		std::uniform_real_distribution<float> place(0.0f, 42.0f);
+		std::vector<Actor*> results(scene.actors.size());
+		std::vector<float> distances(scene.actors.size());
+		for (int q = 0; q < 200; q++) {
+			glm::vec2 p{ place(rng), place(rng) };
+			glm::vec2 lower = p - glm::vec2{ 3.0f, 2.0f };
+			glm::vec2 upper = p + glm::vec2{ 2.0f, 3.0f };
+
+			int count = world.queryActors(lower, upper, results.data(), (int)results.size());
+			std::vector<unsigned> ids;
+			for (int i = 0; i < count; i++)
+				ids.push_back(results[i]->getId());
+			std::sort(ids.begin(), ids.end());
+			CHECK(ids == scene.bruteQuery(lower, upper));
+
+			// the k nearest are as near as the k nearest found by sorting every actor
+			const int k = 5;
+			const float radius = 4.0f;
+			std::vector<float> brute;
+			for (auto& a : scene.actors) {
+				float d = std::max(0.0f, distanceAABB(p, a->position2d(), a->position2d() + a->size2d()));
+				if (d <= radius)
+					brute.push_back(d);
+			}
+			std::sort(brute.begin(), brute.end());
+			brute.resize(std::min((int)brute.size(), k));
+			count = world.nearestActors(p, radius, k, results.data(), distances.data());
+			CHECK(count == (int)brute.size());
+			for (int i = 0; i < count && i < (int)brute.size(); i++)
+				CHECK(std::abs(distances[i] - brute[i]) < 1e-5f);
+
+			// Box2D keeps a thin skin around its boxes, so body hits may land a little early
+			glm::vec2 p2 = p + glm::vec2{ place(rng) - 21.0f, place(rng) - 21.0f };
+			RAYHIT hit;
+			world.raycast(p, p2, hit);
+			float t = scene.bruteRaycast(world, p, p2);
+			CHECK(std::abs(hit.t - t) * glm::length(p2 - p) < 0.05f);
+		}
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	{
+		World world;
+		SCENE scene;
+		scene.build(world, 5);
+		CHECK(scene.bodies == 0);
+		checkQueries(world, scene);
+	}
+	{
+		Box2D box2d;
+		Locator::provide(&box2d);
+		World world;
+		SCENE scene;
+		scene.build(world, 5);
+		printf("%d of %d actors have bodies\n", scene.bodies, (int)scene.actors.size());
+		CHECK(scene.bodies > 0 && scene.bodies < (int)scene.actors.size());
+		checkQueries(world, scene);
+	}
+	Locator::provide((Box2D*)nullptr);
+	return testResult("test_queries");
+}
@@ -0,0 +1,82 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+
+using namespace GameLib;
+
+namespace {
+	struct RESOURCE {
+		int value{ 0 };
+	};
+	using Handle = ResourceHandle<RESOURCE>;
+} // namespace
+
+int main(int argc, char** argv) {
+	std::vector<int> unloaded;
+	ResourcePool<RESOURCE> pool([&unloaded](RESOURCE& r) { unloaded.push_back(r.value); });
+
+	// references keep a resource loaded until the last one is released
+	Handle a = pool.add();
+	pool.get(a)->value = 1;
+	pool.setBytes(a, 100);
+	pool.addRef(a);
+	CHECK(pool.refs(a) == 2 && pool.count() == 1 && pool.residentBytes() == 100);
+	CHECK(!pool.release(a));
+	CHECK(pool.valid(a) && unloaded.empty());
+	CHECK(pool.release(a));
+	CHECK(!pool.valid(a) && !pool.get(a) && pool.refs(a) == 0 && pool.bytes(a) == 0);
+	CHECK(unloaded.size() == 1 && unloaded[0] == 1);
+	CHECK(pool.count() == 0 && pool.residentBytes() == 0);
+
+	// the next resource reuses the slot with a new generation, the old handle stays stale
+	Handle b = pool.add();
+	CHECK(b.index == a.index && b != a);
+	CHECK(pool.get(b) && pool.get(b)->value == 0);
+	pool.get(b)->value = 2;
+	CHECK(!pool.valid(a) && !pool.get(a));
+	// calls through a stale handle leave the new resource alone
+	pool.addRef(a);
+	pool.setBytes(a, 50);
+	CHECK(!pool.release(a));
+	pool.unload(a);
+	CHECK(pool.refs(b) == 1 && pool.bytes(b) == 0 && pool.residentBytes() == 0);
+	CHECK(pool.get(b)->value == 2 && unloaded.size() == 1);
+
+	// unload() drops every reference at once
+	pool.addRef(b);
+	pool.setBytes(b, 30);
+	pool.unload(b);
+	CHECK(!pool.valid(b) && unloaded.size() == 2 && unloaded[1] == 2);
+	CHECK(pool.count() == 0 && pool.residentBytes() == 0);
+
+	// empty and out of range handles name nothing
+	CHECK(!pool.valid(Handle()) && !pool.get(Handle()));
+	CHECK(!pool.valid(Handle{ 1000, 0 }));
+
+	// get() pointers stay put while more resources are added
+	Handle first = pool.add();
+	RESOURCE* p = pool.get(first);
+	for (int i = 0; i < 1000; i++)
+		pool.add();
+	CHECK(pool.get(first) == p && pool.count() == 1001);
+
+	// ids map to handles, including negative ids below the first one set
+	ResourceIds<RESOURCE> ids;
+	CHECK(!ids.get(0) && !ids.get(-5));
+	ids.set(10, b);
+	ids.set(-3, first);
+	CHECK(ids.get(10) == b && ids.get(-3) == first);
+	CHECK(!ids.get(0) && !ids.get(11) && !ids.get(-4));
+	CHECK(ids.getFast(-3) == first);
+	// a stale handle under an id is still returned, the pool is what rejects it
+	CHECK(ids.get(10) && !pool.valid(ids.get(10)));
+	ids.set(10, Handle());
+	int visited = 0;
+	ids.forEach([&](int id, Handle h) {
+		CHECK(id == -3 && h == first);
+		visited++;
+	});
+	CHECK(visited == 1);
+	ids.clear();
+	CHECK(!ids.get(-3));
+	return testResult("test_resource_pool");
+}
@@ -0,0 +1,91 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+
+using namespace GameLib;
+
+namespace {
+	constexpr int Frames = 300;
+	constexpr int Actors = 12;
+
+	// a frame of play: actors move, a tile changes now and then and the random generator is drawn from
+	void step(World& world, int frame) {
+		for (auto& a : world.dynamicActors) {
+			if (GameLib::random.rd() % 8 == 0)
+				a->velocity = { GameLib::random.normal() * 4.0f, GameLib::random.normal() * 4.0f, 0.0f };
+		}
+		if (frame % 7 == 0)
+			world.setTile(frame % 100, 20 + frame % 30, Tile(frame, '#'));
+		world.physics(1.0f / 60.0f);
+	}
+
+	struct RECORDED {
+		uint32_t checksum{ 0 };
+		std::string random;
+	};
+
+	RECORDED recorded(const World& world) { return { world.checksum(), GameLib::random.state() }; }
+
+	bool restored(RewindBuffer& rewind, const World& world, unsigned frame, const std::vector<RECORDED>& frames) {
+		return rewind.restore(frame) && rewind.currentFrame() == frame && world.checksum() == frames[frame].checksum &&
+			   GameLib::random.state() == frames[frame].random;
+	}
+} // namespace
+
+// every frame comes back from its keyframe and XORed delta, before and after the oldest frames are trimmed
+int main(int argc, char** argv) {
+	World world;
+	RewindBuffer rewind(world);
+	rewind.keyframeInterval = 30;
+	rewind.snapshot().makeActor = [](char) { return makeEntry({ 0.0f, 0.0f }, { 1.0f, 1.0f }).actor; };
+	for (int i = 0; i < Actors; i++) {
+		ActorPtr a = makeEntry({ 10.0f + 5.0f * i, 40.0f }, { 1.0f, 1.0f }).actor;
+		a->velocity = { 1.0f, 0.5f * (i % 3), 0.0f };
+		world.addDynamicActor(a);
+	}
+	GameLib::random.seed(3);
+
+	std::vector<RECORDED> frames;
+	for (int frame = 0; frame < Frames; frame++) {
+		// an actor added changes the layout, so the frame after starts a keyframe before the interval is up
+		if (frame == 100)
+			world.addDynamicActor(makeEntry({ 5.0f, 5.0f }, { 1.0f, 1.0f }).actor);
+		step(world, frame);
+		rewind.record();
+		frames.push_back(recorded(world));
+	}
+	CHECK(rewind.firstFrame() == 0 && rewind.endFrame() == Frames);
+	size_t snapshotBytes = rewind.snapshot().save().size();
+	printf("%d frames of %zu bytes kept in %zu bytes\n", Frames, snapshotBytes, rewind.bytes());
+	CHECK(rewind.bytes() < Frames * snapshotBytes / 4);
+
+	// newest to oldest, so actors are removed and made again on the way
+	for (int frame = Frames - 1; frame >= 0; frame--)
+		CHECK(restored(rewind, world, frame, frames));
+	CHECK(!rewind.restore(Frames));
+	CHECK(rewind.stepForward() && rewind.currentFrame() == 1);
+	CHECK(rewind.stepBack() && !rewind.stepBack());
+
+	// over budget the oldest keyframes go with their deltas, the frames kept still restore
+	CHECK(restored(rewind, world, Frames - 1, frames));
+	rewind.memoryBudget = rewind.bytes() / 3;
+	step(world, Frames);
+	rewind.record();
+	frames.push_back(recorded(world));
+	CHECK(rewind.firstFrame() > 0 && rewind.endFrame() == Frames + 1);
+	CHECK(rewind.bytes() <= rewind.memoryBudget);
+	CHECK(!rewind.restore(rewind.firstFrame() - 1));
+	for (unsigned frame = rewind.firstFrame(); frame < rewind.endFrame(); frame++)
+		CHECK(restored(rewind, world, frame, frames));
+
+	// recording after stepping back drops the frames after the one restored
+	unsigned back = rewind.endFrame() - 10;
+	CHECK(restored(rewind, world, back, frames));
+	step(world, back + 1);
+	rewind.record();
+	frames.resize(back + 1);
+	frames.push_back(recorded(world));
+	CHECK(rewind.endFrame() == back + 2);
+	CHECK(restored(rewind, world, back, frames));
+	CHECK(restored(rewind, world, back + 1, frames));
+	return testResult("test_rewind");
+}
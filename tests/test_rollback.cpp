@@ -0,0 +1,160 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using namespace GameLib;
+
+namespace {
+	constexpr float Step = 1.0f / 60.0f;
+
+	// moves with its velocity and scores the triggers it runs into, like the food in my_game
+	class ScoringActorComponent : public ActorComponent {
+	public:
+		void update(Actor& a, World& world) override {
+			// Box2D moves actors that have bodies
+			if (a.box2dId < 0)
+				a.position += a.velocity * a.dt;
+		}
+		void beginOverlap(Actor& a, Actor& b) override { score += 20; }
+		void endOverlap(Actor& a, Actor& b) override { score -= 1; }
+
+		void writeState(const Actor& actor, SnapshotWriter& w) const override { w.write(score); }
+		void readState(Actor& actor, SnapshotReader& r) override { r.read(score); }
+
+		int score{ 0 };
+	};
+
+	ActorPtr makeActor(char charDesc) {
+		auto a = std::make_shared<Actor>(nullptr,
+			std::make_shared<ScoringActorComponent>(),
+			std::make_shared<SimplePhysicsComponent>(),
+			nullptr);
+		a->setCharDesc(charDesc);
+		return a;
+	}
+
+	// one player's copy of the game, running its own session
+	struct PLAYER {
+		// outlives the world, whose actors have bodies in it
+		std::unique_ptr<Box2D> box2d;
+		World world;
+		RollbackSession session{ world };
+		std::mt19937 rng;
+		ROLLBACKINPUT input;
+		// changes component state the other player does not, to show the hash sees it
+		bool cheat{ false };
+
+		PLAYER(unsigned seed, bool bodies) : rng(seed) {
+			if (bodies) {
+				box2d = std::make_unique<Box2D>();
+				box2d->setGravity({ 0.0f, 0.0f });
+				world.useContactEvents = true;
+			}
+			session.step = [this](unsigned tick, const ROLLBACKINPUT* inputs) {
+				for (int p = 0; p < RollbackSession::Players; p++)
+					world.dynamicActors[p]->velocity = glm::vec3{ inputs[p].axisX, inputs[p].axisY, 0.0f } * 12.0f;
+				if (cheat && tick == 100)
+					((ScoringActorComponent*)world.dynamicActors[0]->actorComponent())->score++;
+				world.update(Step);
+				world.physics(Step);
+			};
+		}
+
+		// both players share the Locator, so each points it at its own Box2D before touching its world
+		void provide() { Locator::provide(box2d.get()); }
+
+		// random input that changes every few frames
+		void frame() {
+			provide();
+			if (rng() % 8 == 0) {
+				input.axisX = (float)((int)(rng() % 3) - 1);
+				input.axisY = (float)((int)(rng() % 3) - 1);
+			}
+			session.advance(input);
+		}
+	};
+
+	// two sessions over inproc:// with the network made worse, returns the desyncs either player saw
+	// with bodies, the actors have Box2D bodies and the players push crates into pillars and each other
+	unsigned soak(const std::string& endpoint, const NETCONDITIONS& conditions, bool cheat, bool bodies = false) {
+		PLAYER host(1, bodies);
+		PLAYER guest(2, bodies);
+		guest.cheat = cheat;
+
+		// the host's world is copied into the guest's, so actor ids match
+		for (int i = 0; i < RollbackSession::Players; i++) {
+			ActorPtr a = makeActor('P');
+			a->position = { 10.0f + i * 20.0f, 20.0f, 0.0f };
+			host.world.addDynamicActor(a);
+		}
+		for (int i = 0; i < 40; i++) {
+			ActorPtr a = makeActor('T');
+			a->position = { (float)(i % 8) * 5.0f + 2.0f, (float)(i / 8) * 8.0f + 2.0f, 0.0f };
+			host.world.addTriggerActor(a);
+		}
+		for (int i = 0; bodies && i < 12; i++) {
+			ActorPtr crate = makeActor('C');
+			crate->position = { (float)(i % 4) * 8.0f + 6.0f, (float)(i / 4) * 9.0f + 12.0f, 0.0f };
+			host.world.addDynamicActor(crate);
+			ActorPtr pillar = makeActor('W');
+			pillar->position = { (float)(i % 4) * 8.0f + 9.5f, (float)(i / 4) * 9.0f + 15.5f, 0.0f };
+			pillar->size = { 2.0f, 2.0f, 0.0f };
+			host.world.addStaticActor(pillar);
+		}
+		host.provide();
+		host.world.start(0.0f);
+		WorldSnapshot hostSnapshot(host.world);
+		WorldSnapshot guestSnapshot(guest.world);
+		guestSnapshot.makeActor = makeActor;
+		const std::vector<uint8_t>& start = hostSnapshot.save();
+		guest.provide();
+		CHECK(guestSnapshot.load(start.data(), start.size()));
+		CHECK(guest.world.dynamicActors.size() == host.world.dynamicActors.size());
+
+		CHECK(host.session.host(endpoint));
+		CHECK(guest.session.join(endpoint));
+		NETCONDITIONS guestConditions = conditions;
+		guestConditions.seed++;
+		host.session.socket().setConditions(conditions);
+		guest.session.socket().setConditions(guestConditions);
+		for (int frame = 0; frame < 600; frame++) {
+			host.frame();
+			guest.frame();
+			std::this_thread::sleep_for(std::chrono::milliseconds(4));
+		}
+		printf("%s: ticks %u/%u, rollbacks %u/%u, desyncs %u/%u\n",
+			endpoint.c_str(),
+			host.session.tick(),
+			guest.session.tick(),
+			host.session.rollbacks(),
+			guest.session.rollbacks(),
+			host.session.desyncs(),
+			guest.session.desyncs());
+		CHECK(host.session.tick() > 200 && guest.session.tick() > 200);
+		CHECK(host.session.rollbacks() + guest.session.rollbacks() > 0);
+		// the players ran through triggers, so the overlaps were rolled back too
+		int score = 0;
+		for (int p = 0; p < RollbackSession::Players; p++)
+			score += ((ScoringActorComponent*)host.world.dynamicActors[p]->actorComponent())->score;
+		CHECK(score != 0);
+		guest.session.close();
+		host.session.close();
+		Locator::provide((Box2D*)nullptr);
+		return host.session.desyncs() + guest.session.desyncs();
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	NETCONDITIONS conditions;
+	conditions.latency = 30.0f;
+	conditions.jitter = 15.0f;
+	conditions.loss = 0.05f;
+	CHECK(soak("inproc://rollback-soak", conditions, false) == 0);
+	// Box2D is rebuilt before each tick, so its contacts cannot make a restored tick run differently
+	CHECK(soak("inproc://rollback-box2d", conditions, false, true) == 0);
+	// a difference only in component state must be reported
+	CHECK(soak("inproc://rollback-cheat", conditions, true) > 0);
+	return testResult("test_rollback");
+}
@@ -0,0 +1,233 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <fstream>
+
+using namespace GameLib;
+
+namespace {
+	// the counter of the actor in the world with the id, which is made again when a snapshot restores it
+	CountingActorComponent& counterOf(World& world, unsigned id) {
+		return *static_cast<CountingActorComponent*>(world.getActor(id)->actorComponent());
+	}
+
+	// where the data of a section starts in a snapshot, or 0 if there is none
+	size_t sectionOffset(const std::vector<uint8_t>& snapshot, uint32_t tag) {
+		size_t offset = sizeof(SNAPSHOTHEADER);
+		while (offset + sizeof(SNAPSHOTSECTION) <= snapshot.size()) {
+			SNAPSHOTSECTION section;
+			memcpy(&section, snapshot.data() + offset, sizeof(section));
+			offset += sizeof(section);
+			if (section.tag == tag)
+				return offset;
+			offset += (size_t)section.size;
+		}
+		return 0;
+	}
+
+	std::vector<uint8_t> readFile(const char* path) {
+		std::ifstream fin(path, std::ios::binary);
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	// restoring puts back the overlaps each actor had, so events are neither sent again nor lost
+	void testOverlaps() {
+		World world;
+		WorldSnapshot snapshot(world);
+		ENTRY actor = makeEntry({ 4.0f, 4.0f }, { 1.0f, 1.0f });
+		ENTRY trigger = makeEntry({ 4.5f, 4.0f }, { 1.0f, 1.0f });
+		world.addDynamicActor(actor.actor);
+		world.addTriggerActor(trigger.actor);
+		unsigned triggerId = trigger.actor->getId();
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->begins == 1 && trigger.counter->begins == 1);
+
+		// restoring a snapshot taken during an overlap does not begin it again
+		std::vector<uint8_t> overlapping = snapshot.save();
+		actor.actor->teleport({ 20.0f, 4.0f, 0.0f });
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->ends == 1 && trigger.counter->ends == 1);
+		CHECK(snapshot.load(overlapping.data(), overlapping.size()));
+		CHECK(actor.actor->triggerInfo.overlaps.size() == 1);
+		CHECK(trigger.actor->triggerInfo.overlapCount == 1);
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->begins == 1 && actor.counter->ends == 0);
+		CHECK(trigger.counter->begins == 1 && trigger.counter->ends == 0);
+
+		// restoring a snapshot taken after the overlap ended does not end it again
+		actor.actor->teleport({ 20.0f, 4.0f, 0.0f });
+		world.physics(1.0f / 60.0f);
+		std::vector<uint8_t> apart = snapshot.save();
+		actor.actor->teleport({ 4.0f, 4.0f, 0.0f });
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->begins == 2);
+		CHECK(snapshot.load(apart.data(), apart.size()));
+		CHECK(actor.actor->triggerInfo.overlaps.empty());
+		CHECK(trigger.actor->triggerInfo.overlapCount == 0 && !trigger.actor->triggerInfo.overlapping);
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->begins == 1 && actor.counter->ends == 1);
+		CHECK(trigger.counter->begins == 1 && trigger.counter->ends == 1);
+
+		// a trigger made again by the snapshot is the one the restored overlap points to
+		world.removeActor(triggerId);
+		snapshot.makeActor = [](char) { return makeEntry({ 0.0f, 0.0f }, { 1.0f, 1.0f }).actor; };
+		CHECK(snapshot.load(overlapping.data(), overlapping.size()));
+		ActorPtr remade = world.getActor(triggerId);
+		CHECK(remade && remade != trigger.actor);
+		auto& overlaps = actor.actor->triggerInfo.overlaps;
+		CHECK(remade && overlaps.size() == 1 && overlaps[0].actor.lock() == remade);
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->begins == 1 && actor.counter->ends == 0);
+		CHECK(remade && counterOf(world, triggerId).begins == 1);
+		actor.actor->teleport({ 20.0f, 4.0f, 0.0f });
+		world.physics(1.0f / 60.0f);
+		CHECK(actor.counter->ends == 1);
+		CHECK(remade && counterOf(world, triggerId).ends == 1);
+
+		// the checksum sees a changed tile, and restoring the tiles restores it
+		uint32_t checksum = world.checksum();
+		std::vector<uint8_t> tiles = snapshot.save();
+		world.setTile(2, 2, Tile(3, '#'));
+		CHECK(world.checksum() != checksum);
+		CHECK(snapshot.load(tiles.data(), tiles.size()));
+		CHECK(world.checksum() == checksum);
+	}
+
+	// tiles, actors and the random generator all come back as they were saved
+	void testRoundTrip(bool portable) {
+		World world;
+		WorldSnapshot snapshot(world);
+		snapshot.portable = portable;
+		snapshot.makeActor = [](char) { return makeEntry({ 0.0f, 0.0f }, { 1.0f, 1.0f }).actor; };
+		for (int x = 0; x < 60; x += 3)
+			world.setTile(x, 10 + x % 4, Tile(1, '#'));
+		std::vector<ENTRY> actors;
+		for (int i = 0; i < 8; i++) {
+			actors.push_back(makeEntry({ 2.0f + 4.0f * i, 3.0f + 0.5f * i }, { 1.0f, 1.0f + 0.25f * i }));
+			actors.back().actor->velocity = { 0.5f * i, -0.25f * i, 0.0f };
+			if (i % 4 == 3)
+				world.addTriggerActor(actors.back().actor);
+			else
+				world.addDynamicActor(actors.back().actor);
+		}
+		world.physics(1.0f / 60.0f);
+		GameLib::random.seed(17);
+		GameLib::random.rd();
+		uint32_t checksum = world.checksum();
+		unsigned removedId = actors[2].actor->getId();
+		glm::vec3 removedPosition = actors[2].actor->position;
+		std::vector<uint8_t> saved = snapshot.save();
+		std::vector<unsigned> draws;
+		for (int i = 0; i < 4; i++)
+			draws.push_back(GameLib::random.rd());
+
+		// change everything the snapshot holds
+		world.setTile(0, 10, Tile());
+		world.setTile(70, 30, Tile(2, '#'));
+		for (auto& a : actors)
+			a.actor->teleport(a.actor->position + glm::vec3{ 1.5f, -0.5f, 0.0f });
+		world.removeActor(removedId);
+		ENTRY added = makeEntry({ 30.0f, 30.0f }, { 1.0f, 1.0f });
+		world.addDynamicActor(added.actor);
+		GameLib::random.seed(99);
+		CHECK(world.checksum() != checksum);
+
+		CHECK(snapshot.load(saved.data(), saved.size()));
+		CHECK(world.checksum() == checksum);
+		CHECK(!world.getActor(added.actor->getId()));
+		ActorPtr remade = world.getActor(removedId);
+		CHECK(remade && remade->position == removedPosition);
+		CHECK(remade && remade->velocity == glm::vec3(1.0f, -0.5f, 0.0f));
+		CHECK(world.getTile(0, 10).charDesc == '#' && world.getTile(70, 30).charDesc != '#');
+		std::vector<unsigned> again;
+		for (int i = 0; i < 4; i++)
+			again.push_back(GameLib::random.rd());
+		CHECK(again == draws);
+	}
+
+	// a file written through a small buffer patches section sizes that were already flushed
+	void testFile() {
+		World world;
+		WorldSnapshot snapshot(world);
+		for (int x = 0; x < 100; x += 7)
+			world.setTile(x, x % 50, Tile(1, '#'));
+		ENTRY actor = makeEntry({ 5.0f, 5.0f }, { 1.0f, 1.0f });
+		world.addDynamicActor(actor.actor);
+		std::vector<uint8_t> saved = snapshot.save();
+		CHECK(saved.size() > 4 * 4096);
+
+		const char* path = "test_snapshot.glss";
+		SnapshotWriter writer;
+		CHECK(writer.open(path, 4096));
+		snapshot.write(writer);
+		CHECK(writer.finish());
+		CHECK(readFile(path) == saved);
+
+		uint32_t checksum = world.checksum();
+		world.setTile(7, 7, Tile());
+		actor.actor->teleport({ 9.0f, 9.0f, 0.0f });
+		CHECK(snapshot.load(path));
+		CHECK(world.checksum() == checksum);
+		std::remove(path);
+	}
+
+	// a cut or damaged snapshot is rejected before any of it is applied
+	void testDamaged() {
+		World world;
+		WorldSnapshot snapshot(world);
+		ENTRY actor = makeEntry({ 4.0f, 4.0f }, { 1.0f, 1.0f });
+		ENTRY trigger = makeEntry({ 4.5f, 4.0f }, { 1.0f, 1.0f });
+		world.addDynamicActor(actor.actor);
+		world.addTriggerActor(trigger.actor);
+		world.physics(1.0f / 60.0f);
+		std::vector<uint8_t> saved = snapshot.save();
+
+		world.setTile(1, 1, Tile(1, '#'));
+		actor.actor->teleport({ 20.0f, 4.0f, 0.0f });
+		GameLib::random.seed(5);
+		uint32_t checksum = world.checksum();
+		std::string state = GameLib::random.state();
+		auto unchanged = [&]() { return world.checksum() == checksum && GameLib::random.state() == state; };
+
+		for (size_t size : { (size_t)0, sizeof(SNAPSHOTHEADER) + 8, saved.size() / 2, saved.size() - 16, saved.size() - 1 }) {
+			CHECK(!snapshot.load(saved.data(), size));
+			CHECK(unchanged());
+		}
+
+		// the overlaps come after the pages and actors, a count past their end must not leave those restored
+		std::vector<uint8_t> damaged = saved;
+		size_t overlaps = sectionOffset(damaged, WorldSnapshot::OverlapsTag);
+		CHECK(overlaps > 0);
+		uint32_t count = 0xffffffffu;
+		memcpy(damaged.data() + overlaps + sizeof(int32_t), &count, sizeof(count));
+		CHECK(!snapshot.load(damaged.data(), damaged.size()));
+		CHECK(unchanged());
+
+		// so must a random state that does not parse
+		damaged = saved;
+		size_t rand = sectionOffset(damaged, WorldSnapshot::RandomTag);
+		CHECK(rand > 0);
+		memcpy(damaged.data() + rand + sizeof(uint32_t), "x", 1);
+		CHECK(!snapshot.load(damaged.data(), damaged.size()));
+		CHECK(unchanged());
+
+		// and a snapshot from an older version
+		damaged = saved;
+		uint32_t version = 2;
+		memcpy(damaged.data() + offsetof(SNAPSHOTHEADER, version), &version, sizeof(version));
+		CHECK(!snapshot.load(damaged.data(), damaged.size()));
+		CHECK(unchanged());
+
+		CHECK(snapshot.load(saved.data(), saved.size()));
+		CHECK(!unchanged());
+		CHECK(actor.actor->triggerInfo.overlaps.size() == 1);
+	}
+} // namespace
+
+int main(int argc, char** argv) {
+	testOverlaps();
+	testRoundTrip(true);
+	testRoundTrip(false);
+	testFile();
+	testDamaged();
+	return testResult("test_snapshot");
+}
@@ -0,0 +1,107 @@
+#include "test.hpp"
+#include <gamelib.hpp>
+#include <random>
+
+using namespace GameLib;
+
+namespace {
+	constexpr int Samples = 4096;
+
+	// the solid tile the box overlaps at p, tiles are half open like in sweepTiles()
+	bool overlapsSolid(const World& world, glm::vec2 p, glm::vec2 s, glm::ivec2* tile = nullptr) {
+		for (int y = (int)std::floor(p.y); y < p.y + s.y; y++) {
+			for (int x = (int)std::floor(p.x); x < p.x + s.x; x++) {
+				if (world.getTile(x, y).solid()) {
+					if (tile)
+						*tile = { x, y };
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// moves the box in small steps and returns the first sample that overlaps a solid tile, or -1
+	float bruteForceSweep(const World& world, glm::vec2 p, glm::vec2 s, glm::vec2 delta) {
+		for (int i = 0; i <= Samples; i++) {
+			float t = (float)i / Samples;
+			if (overlapsSolid(world, p + delta * t, s))
+				return t;
+		}
+		return -1.0f;
+	}
+
+	// counts the world collisions an actor hears
+	class WallActorComponent : public ActorComponent {
+	public:
+		void handleCollisionWorld(Actor& actor, World& world) override { hits++; }
+		int hits{ 0 };
+	};
+} // namespace
+
+int main(int argc, char** argv) {
+	World world;
+	std::mt19937 rng{ 487 };
+	std::uniform_real_distribution<float> coordinate(2.0f, 38.0f);
+	std::uniform_real_distribution<float> size(0.3f, 2.5f);
+	std::uniform_real_distribution<float> move(-12.0f, 12.0f);
+	for (int y = 0; y < 40; y++) {
+		for (int x = 0; x < 40; x++) {
+			Tile tile;
+			tile.flags = rng() % 8 ? Tile::EMPTY : Tile::SOLID;
+			world.setTile(x, y, tile);
+		}
+	}
+
+	// sweepTiles() must find the same first tile as sampling the whole move
+	int sweeps = 0;
+	int hits = 0;
+	for (int i = 0; i < 4000; i++) {
+		glm::vec2 p{ coordinate(rng), coordinate(rng) };
+		glm::vec2 s{ size(rng), size(rng) };
+		if (overlapsSolid(world, p, s))
+			continue;
+		glm::vec2 delta{ move(rng), rng() % 4 ? move(rng) : 0.0f };
+		TILEHIT hit;
+		bool swept = world.sweepTiles(p, s, delta, hit);
+		float t = bruteForceSweep(world, p, s, delta);
+		sweeps++;
+		CHECK(swept == (t >= 0.0f));
+		if (!swept || t < 0.0f)
+			continue;
+		hits++;
+		// the sweep finds the exact time, sampling finds the first sample after it
+		CHECK(hit.t <= t && t - hit.t <= 1.0f / Samples + 1e-5f);
+		CHECK(world.getTile(hit.tile.x, hit.tile.y).solid());
+		glm::vec2 q = p + delta * t;
+		CHECK(hit.tile.x < q.x + s.x && hit.tile.x + 1 > q.x && hit.tile.y < q.y + s.y && hit.tile.y + 1 > q.y);
+		CHECK(std::abs(hit.normal.x) + std::abs(hit.normal.y) == 1.0f);
+	}
+	printf("%d sweeps, %d hits\n", sweeps, hits);
+	CHECK(hits > sweeps / 4);
+
+	// an actor moved through a wall between two physics steps is stopped by it, not only checked where it lands
+	World walled;
+	Tile wall;
+	wall.flags = Tile::SOLID;
+	for (int y = 0; y < 10; y++)
+		walled.setTile(20, y, wall);
+	auto counter = std::make_shared<WallActorComponent>();
+	auto actor = std::make_shared<Actor>(nullptr, counter, std::make_shared<SimplePhysicsComponent>(), nullptr);
+	actor->position = { 17.0f, 4.0f, 0.0f };
+	walled.addDynamicActor(actor);
+	walled.start(0.0f);
+	walled.physics(1.0f / 60.0f);
+	CHECK(counter->hits == 0);
+	actor->position.x = 23.0f;
+	walled.physics(1.0f / 60.0f);
+	CHECK(counter->hits == 1);
+	CHECK(actor->worldHit.tile == glm::ivec2(20, 4));
+	CHECK(actor->worldHit.normal == glm::vec2(-1.0f, 0.0f));
+
+	// a teleport is not swept
+	actor->teleport({ 17.0f, 4.0f, 0.0f });
+	walled.physics(1.0f / 60.0f);
+	CHECK(counter->hits == 1);
+	return testResult("test_sweep_tiles");
+}